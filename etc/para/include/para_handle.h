@@ -24,10 +24,18 @@ namespace OHOS {
             virtual ~ParaHandle() = default;
             static bool SetDefaultIme(int32_t userId, const std::string &imeName);
             static std::string GetDefaultIme(int32_t userId);
+            static int64_t GetStandbyBudgetKb();
+            static int32_t GetLogLevel();
+            static bool IsLazyHandshake();
+            static bool IsTraceEnabled();
 
         private:
             static const char *DEFAULT_IME_KEY;
             static const char *DEFAULT_IME_NAME;
+            static const char *STANDBY_BUDGET_KEY;
+            static const char *LOG_LEVEL_KEY;
+            static const char *LAZY_HANDSHAKE_KEY;
+            static const char *TRACE_KEY;
             static constexpr int CONFIG_LEN = 128;
             static const int32_t main_userId = 100;
         };
@@ -13,12 +13,17 @@
  * limitations under the License.
  */
 #include "para_handle.h"
+#include <cstdlib>
 #include "parameter.h"
 
 namespace OHOS {
     namespace MiscServices {
         const char *ParaHandle::DEFAULT_IME_KEY = "persist.sys.default_ime";
         const char *ParaHandle::DEFAULT_IME_NAME = "com.example.kikakeyboard/ServiceExtAbility";
+        const char *ParaHandle::STANDBY_BUDGET_KEY = "persist.sys.ime_standby_budget_kb";
+        const char *ParaHandle::LOG_LEVEL_KEY = "persist.sys.ime_log_level";
+        const char *ParaHandle::LAZY_HANDSHAKE_KEY = "persist.sys.ime_lazy_handshake";
+        const char *ParaHandle::TRACE_KEY = "persist.sys.ime_trace";
         bool ParaHandle::SetDefaultIme(int32_t userId, const std::string &imeName)
         {
             if (userId != main_userId) {
@@ -44,5 +49,45 @@ namespace OHOS {
             SetDefaultIme(userId, DEFAULT_IME_NAME);
             return DEFAULT_IME_NAME;
         }
+
+        int64_t ParaHandle::GetStandbyBudgetKb()
+        {
+            char value[CONFIG_LEN];
+            int code = GetParameter(STANDBY_BUDGET_KEY, "0", value, CONFIG_LEN);
+            if (code <= 0) {
+                return 0;
+            }
+            return strtoll(value, nullptr, 10);
+        }
+
+        int32_t ParaHandle::GetLogLevel()
+        {
+            char value[CONFIG_LEN];
+            int code = GetParameter(LOG_LEVEL_KEY, "0", value, CONFIG_LEN);
+            if (code <= 0) {
+                return 0;
+            }
+            return static_cast<int32_t>(strtol(value, nullptr, 10));
+        }
+
+        bool ParaHandle::IsLazyHandshake()
+        {
+            char value[CONFIG_LEN];
+            int code = GetParameter(LAZY_HANDSHAKE_KEY, "0", value, CONFIG_LEN);
+            if (code <= 0) {
+                return false;
+            }
+            return strtol(value, nullptr, 10) != 0;
+        }
+
+        bool ParaHandle::IsTraceEnabled()
+        {
+            char value[CONFIG_LEN];
+            int code = GetParameter(TRACE_KEY, "0", value, CONFIG_LEN);
+            if (code <= 0) {
+                return false;
+            }
+            return strtol(value, nullptr, 10) != 0;
+        }
     } // namespace MiscServices
 } // namespace OHOS
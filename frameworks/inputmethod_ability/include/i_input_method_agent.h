@@ -18,6 +18,7 @@
 
 #include "iremote_broker.h"
 #include "global.h"
+#include "text_delta.h"
 
 /**
  * brief Definition of interface IInputMethodAgent
@@ -32,6 +33,8 @@ namespace MiscServices {
             ON_CURSOR_UPDATE,
             ON_SELECTION_CHANGE,
             SET_CALLING_WINDOW_ID,
+            ON_TEXT_DELTA,
+            ATTACH_SHARED_RING,
         };
 
         DECLARE_INTERFACE_DESCRIPTOR(u"ohos.miscservices.inputmethod.IInputMethodAgent");
@@ -41,6 +44,8 @@ namespace MiscServices {
         virtual void OnSelectionChange(std::u16string text, int32_t oldBegin, int32_t oldEnd,
                                        int32_t newBegin, int32_t newEnd) = 0;
         virtual void SetCallingWindow(uint32_t windowId) = 0;
+        virtual void OnTextDelta(const TextDelta& delta) = 0;
+        virtual int32_t AttachSharedRing(int memFd, int readerFd, int writerFd) = 0;
     };
 } // namespace MiscServices
 } // namespace OHOS
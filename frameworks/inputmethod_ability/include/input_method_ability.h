@@ -23,6 +23,7 @@
 #include "i_input_control_channel.h"
 #include "i_input_method_core.h"
 #include "i_input_data_channel.h"
+#include "input_data_channel_proxy.h"
 #include "i_input_method_agent.h"
 #include "input_method_core_stub.h"
 #include "input_control_channel_proxy.h"
@@ -32,6 +33,7 @@
 #include "message.h"
 #include "utils.h"
 #include "input_method_system_ability_proxy.h"
+#include "editor_text_mirror.h"
 
 namespace OHOS {
 namespace MiscServices {
@@ -53,6 +55,7 @@ namespace MiscServices {
         std::u16string GetTextAfterCursor(int32_t number);
         void SendFunctionKey(int32_t funcKey);
         void MoveCursor(int32_t keyCode);
+        bool BatchEdit(const std::vector<EditOperation>& operations);
         bool DispatchKeyEvent(int32_t keyCode, int32_t keyStatus);
         void SetCallingWindow(uint32_t windowId);
         int32_t GetEnterKeyType();
@@ -77,7 +80,8 @@ namespace MiscServices {
         void SetCoreAndAgent();
 
         // communicating with IMC
-        sptr<IInputDataChannel> inputDataChannel;
+        sptr<InputDataChannelProxy> inputDataChannel;
+        EditorTextMirror textMirror_; // the text of the editor, serves GetTextBeforeCursor/GetTextAfterCursor
         sptr<JsInputMethodEngineListener> imeListener_;
         sptr<JsKeyboardDelegateListener> kdListener_;
         static std::mutex instanceLock_;
@@ -100,6 +104,7 @@ namespace MiscServices {
         // the message from IMC
         void OnCursorUpdate(Message *msg);
         void OnSelectionChange(Message *msg);
+        void OnTextDelta(Message *msg);
 
         // control inputwindow
         void InitialInputWindow();
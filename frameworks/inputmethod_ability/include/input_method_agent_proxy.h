@@ -16,8 +16,11 @@
 #ifndef FRAMEWORKS_INPUTMETHOD_ABILITY_INCLUDE_INPUT_METHOD_AGENT_PROXY_H
 #define FRAMEWORKS_INPUTMETHOD_ABILITY_INCLUDE_INPUT_METHOD_AGENT_PROXY_H
 
+#include <memory>
+#include <mutex>
 #include "iremote_proxy.h"
 #include "i_input_method_agent.h"
+#include "shared_ring.h"
 
 namespace OHOS {
 namespace MiscServices {
@@ -32,8 +35,16 @@ namespace MiscServices {
         void OnSelectionChange(std::u16string text, int32_t oldBegin, int32_t oldEnd,
                                int32_t newBegin, int32_t newEnd) override;
         void SetCallingWindow(uint32_t windowId) override;
+        void OnTextDelta(const TextDelta& delta) override;
+        int32_t AttachSharedRing(int memFd, int readerFd, int writerFd) override;
+        bool OpenSharedRing();
     private:
         static inline BrokerDelegator<InputMethodAgentProxy> delegator_;
+        static const int32_t RING_WRITE_TIMEOUT_MS = 100;
+        std::mutex ringLock_;
+        std::unique_ptr<SharedRing> ring_; // the one-way requests go through it once the input method attached it
+
+        int32_t SendOneWayRequest(uint32_t code, MessageParcel &data);
     };
 } // namespace MiscServices
 } // namespace OHOS
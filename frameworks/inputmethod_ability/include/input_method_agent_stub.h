@@ -16,11 +16,14 @@
 #ifndef FRAMEWORKS_INPUTMETHOD_ABILITY_INCLUDE_INPUT_METHOD_AGENT_STUB_H
 #define FRAMEWORKS_INPUTMETHOD_ABILITY_INCLUDE_INPUT_METHOD_AGENT_STUB_H
 
+#include <memory>
+#include <mutex>
 #include "iremote_stub.h"
 #include "message_parcel.h"
 #include "message_option.h"
 #include "i_input_method_agent.h"
 #include "message_handler.h"
+#include "shared_ring.h"
 
 namespace OHOS {
 namespace MiscServices {
@@ -37,9 +40,14 @@ namespace MiscServices {
         void OnSelectionChange(std::u16string text, int32_t oldBegin, int32_t oldEnd,
                                        int32_t newBegin, int32_t newEnd) override;
         void SetCallingWindow(uint32_t windowId) override;
+        void OnTextDelta(const TextDelta& delta) override;
+        int32_t AttachSharedRing(int memFd, int readerFd, int writerFd) override;
         void SetMessageHandler(MessageHandler *msgHandler);
+        static void MergeSelectionChange(Message &older, Message &newer);
     private:
         MessageHandler *msgHandler_;
+        std::mutex ringLock_;
+        std::unique_ptr<SharedRingReceiver> ringReceiver_;
     };
 } // namespace MiscServices
 } // namespace OHOS
@@ -20,9 +20,11 @@
 #include "system_ability_definition.h"
 #include "input_data_channel_proxy.h"
 #include "input_method_utils.h"
-#include "iservice_registry.h"
+#include "service_locator.h"
 #include "input_method_core_proxy.h"
 #include "input_method_core_stub.h"
+#include "para_handle.h"
+#include "trace_span.h"
 
 namespace OHOS {
 namespace MiscServices {
@@ -50,7 +52,7 @@ namespace MiscServices {
 
     sptr<InputMethodAbility> InputMethodAbility::GetInstance()
     {
-        IMSA_HILOGI("InputMethodAbility::GetInstance");
+        IMSA_HILOGD("InputMethodAbility::GetInstance");
         if (!instance_) {
             std::lock_guard<std::mutex> autoLock(instanceLock_);
             if (!instance_) {
@@ -64,14 +66,7 @@ namespace MiscServices {
     sptr<InputMethodSystemAbilityProxy> InputMethodAbility::GetImsaProxy()
     {
         IMSA_HILOGI("InputMethodAbility::GetImsaProxy");
-        sptr<ISystemAbilityManager> systemAbilityManager =
-            SystemAbilityManagerClient::GetInstance().GetSystemAbilityManager();
-        if (!systemAbilityManager) {
-            IMSA_HILOGI("InputMethodAbility::GetImsaProxy systemAbilityManager is nullptr");
-            return nullptr;
-        }
-
-        auto systemAbility = systemAbilityManager->GetSystemAbility(INPUT_METHOD_SYSTEM_ABILITY_ID, "");
+        sptr<IRemoteObject> systemAbility = ServiceLocator::GetSystemAbility(INPUT_METHOD_SYSTEM_ABILITY_ID);
         if (!systemAbility) {
             IMSA_HILOGI("InputMethodAbility::GetImsaProxy systemAbility is nullptr");
             return nullptr;
@@ -108,8 +103,14 @@ namespace MiscServices {
 
     void InputMethodAbility::Initialize()
     {
+        int32_t logLevel = ParaHandle::GetLogLevel();
+        if (logLevel) {
+            SetLogLevel(logLevel);
+        }
         IMSA_HILOGI("InputMethodAbility::Initialize");
-        msgHandler = new MessageHandler();
+        TraceRecorder::Instance()->SetEnabled(ParaHandle::IsTraceEnabled());
+        msgHandler = new MessageHandler(MessageHandler::QUEUE_MODE_LOCK_FREE, MessageHandler::FLAG_COALESCING);
+        msgHandler->SetMerger(MSG_ID_ON_SELECTION_CHANGE, InputMethodAgentStub::MergeSelectionChange);
         workThreadHandler = std::thread([this] {
             WorkThread();
         });
@@ -136,14 +137,14 @@ namespace MiscServices {
     void InputMethodAbility::WorkThread()
     {
         while (!stop_) {
-            Message *msg = msgHandler->GetMessage();
+            MessagePtr msg = msgHandler->GetMessage();
             switch (msg->msgId_) {
                 case MSG_ID_INITIALIZE_INPUT: {
-                    OnInitialInput(msg);
+                    OnInitialInput(msg.get());
                     break;
                 }
                 case MSG_ID_INIT_INPUT_CONTROL_CHANNEL: {
-                    OnInitInputControlChannel(msg);
+                    OnInitInputControlChannel(msg.get());
                     break;
                 }
                 case MSG_ID_SET_CLIENT_STATE: {
@@ -152,27 +153,31 @@ namespace MiscServices {
                     break;
                 }
                 case MSG_ID_START_INPUT: {
-                    OnStartInput(msg);
+                    OnStartInput(msg.get());
                     break;
                 }
                 case MSG_ID_STOP_INPUT: {
-                    OnStopInput(msg);
+                    OnStopInput(msg.get());
                     break;
                 }
                 case MSG_ID_SHOW_KEYBOARD: {
-                    OnShowKeyboard(msg);
+                    OnShowKeyboard(msg.get());
                     break;
                 }
                 case MSG_ID_HIDE_KEYBOARD: {
-                    OnHideKeyboard(msg);
+                    OnHideKeyboard(msg.get());
                     break;
                 }
                 case MSG_ID_ON_CURSOR_UPDATE: {
-                    OnCursorUpdate(msg);
+                    OnCursorUpdate(msg.get());
                     break;
                 }
                 case MSG_ID_ON_SELECTION_CHANGE: {
-                    OnSelectionChange(msg);
+                    OnSelectionChange(msg.get());
+                    break;
+                }
+                case MSG_ID_ON_TEXT_DELTA: {
+                    OnTextDelta(msg.get());
                     break;
                 }
                 case MSG_ID_STOP_INPUT_SERVICE:{
@@ -187,8 +192,6 @@ namespace MiscServices {
                     break;
                 }
             }
-            delete msg;
-            msg = nullptr;
         }
     }
 
@@ -232,10 +235,14 @@ namespace MiscServices {
         MessageParcel *data = msg->msgContent_;
         sptr<InputDataChannelProxy> channalProxy = new InputDataChannelProxy(data->ReadRemoteObject());
         inputDataChannel = channalProxy;
+        textMirror_.Reset();
         if (!inputDataChannel) {
             IMSA_HILOGI("InputMethodAbility::OnStartInput inputDataChannel is nullptr");
             return;
         }
+#ifdef INPUTMETHOD_SHARED_RING_ENABLE
+        channalProxy->OpenSharedRing();
+#endif
         editorAttribute = data->ReadParcelable<InputAttribute>();
         if (!editorAttribute) {
             IMSA_HILOGI("InputMethodAbility::OnStartInput editorAttribute is nullptr");
@@ -246,9 +253,11 @@ namespace MiscServices {
     void InputMethodAbility::OnShowKeyboard(Message *msg)
     {
         IMSA_HILOGI("InputMethodAbility::OnShowKeyboard");
+        TraceSpan span(msg->traceId_, "IMA::OnShowKeyboard");
         MessageParcel *data = msg->msgContent_;
         sptr<InputDataChannelProxy> channalProxy = new InputDataChannelProxy(data->ReadRemoteObject());
         inputDataChannel = channalProxy;
+        textMirror_.Reset();
         if (!inputDataChannel) {
             IMSA_HILOGI("InputMethodAbility::OnShowKeyboard inputDataChannel is nullptr");
         }
@@ -268,11 +277,15 @@ namespace MiscServices {
             delete writeInputChannel;
             writeInputChannel = nullptr;
         }
+        TraceRecorder *recorder = TraceRecorder::Instance();
+        if (recorder->IsEnabled() && !recorder->ExportToFile(TraceRecorder::EXPORT_DIR)) {
+            IMSA_HILOGW("InputMethodAbility::OnStopInput failed to export the trace");
+        }
     }
 
     bool InputMethodAbility::DispatchKeyEvent(int32_t keyCode, int32_t keyStatus)
     {
-        IMSA_HILOGI("InputMethodAbility::DispatchKeyEvent: key = %{public}d, status = %{public}d", keyCode, keyStatus);
+        IMSA_HILOGD("InputMethodAbility::DispatchKeyEvent: key = %{public}d, status = %{public}d", keyCode, keyStatus);
         if (!isBindClient) {
             IMSA_HILOGI("InputMethodAbility::DispatchKeyEvent abort. no client");
             return false;
@@ -299,7 +312,7 @@ namespace MiscServices {
  
     void InputMethodAbility::OnCursorUpdate(Message *msg)
     {
-        IMSA_HILOGI("InputMethodAbility::OnCursorUpdate");
+        IMSA_HILOGD("InputMethodAbility::OnCursorUpdate");
         MessageParcel *data = msg->msgContent_;
         int32_t positionX = data->ReadInt32();
         int32_t positionY = data->ReadInt32();
@@ -313,13 +326,15 @@ namespace MiscServices {
 
     void InputMethodAbility::OnSelectionChange(Message *msg)
     {
-        IMSA_HILOGI("InputMethodAbility::OnSelectionChange");
+        IMSA_HILOGD("InputMethodAbility::OnSelectionChange");
         MessageParcel *data = msg->msgContent_;
-        std::string text = Str16ToStr8(data->ReadString16());
+        std::u16string text16 = data->ReadString16();
         int32_t oldBegin = data->ReadInt32();
         int32_t oldEnd = data->ReadInt32();
         int32_t newBegin = data->ReadInt32();
         int32_t newEnd = data->ReadInt32();
+        textMirror_.Update(text16, newBegin, newEnd);
+        std::string text = Str16ToStr8(text16);
 
         if (!kdListener_) {
             IMSA_HILOGI("InputMethodAbility::OnSelectionChange kdListener_ is nullptr");
@@ -330,6 +345,35 @@ namespace MiscServices {
         kdListener_->OnSelectionChange(oldBegin, oldEnd, newBegin, newEnd);
     }
 
+    void InputMethodAbility::OnTextDelta(Message *msg)
+    {
+        IMSA_HILOGD("InputMethodAbility::OnTextDelta");
+        MessageParcel *data = msg->msgContent_;
+        TextDelta delta;
+        if (!delta.ReadFromParcel(*data)) {
+            IMSA_HILOGE("InputMethodAbility::OnTextDelta delta is malformed");
+            return;
+        }
+        bool applied = textMirror_.ApplyDelta(delta);
+        if (!applied) {
+            IMSA_HILOGE("InputMethodAbility::OnTextDelta delta %{public}d is out of order, wait for a full sync",
+                static_cast<int32_t>(delta.GetSequence()));
+        }
+
+        if (!kdListener_) {
+            IMSA_HILOGI("InputMethodAbility::OnTextDelta kdListener_ is nullptr");
+            return;
+        }
+        // the whole text is only built for the listeners of text change, and only when the text is changed
+        bool textChanged = delta.IsFullSync() || delta.GetReplaceBegin() != delta.GetReplaceEnd()
+            || !delta.GetText().empty();
+        if (applied && textChanged && kdListener_->IsListenerRegistered("textChange")) {
+            kdListener_->OnTextChange(Str16ToStr8(textMirror_.GetText()));
+        }
+        kdListener_->OnSelectionChange(delta.GetOldBegin(), delta.GetOldEnd(), delta.GetNewBegin(),
+                                       delta.GetNewEnd());
+    }
+
     void InputMethodAbility::ShowInputWindow()
     {
         IMSA_HILOGI("InputMethodAbility::ShowInputWindow");
@@ -337,9 +381,14 @@ namespace MiscServices {
             IMSA_HILOGI("InputMethodAbility::ShowInputWindow imeListener_ is nullptr");
             return;
         }
-        imeListener_->OnInputStart();
-        imeListener_->OnKeyboardStatus(true);
+        uint64_t traceId = TraceRecorder::GetCurrentTraceId();
+        {
+            TraceSpan span(traceId, "IMA::JsKeyboardCallbacks");
+            imeListener_->OnInputStart();
+            imeListener_->OnKeyboardStatus(true);
+        }
         if (inputDataChannel) {
+            TraceSpan span(traceId, "IMA::SendKeyboardStatus");
             inputDataChannel->SendKeyboardStatus(KEYBOARD_SHOW);
         }
     }
@@ -359,38 +408,42 @@ namespace MiscServices {
 
     bool InputMethodAbility::InsertText(const std::string text)
     {
-        IMSA_HILOGI("InputMethodAbility::InsertText");
+        IMSA_HILOGD("InputMethodAbility::InsertText");
         if (!inputDataChannel) {
             IMSA_HILOGI("InputMethodAbility::InsertText inputDataChanel is nullptr");
             return false;
         }
 
-        return inputDataChannel->InsertText(Utils::to_utf16(text));
+        bool ret = inputDataChannel->InsertText(Utils::to_utf16(text));
+        textMirror_.Invalidate(inputDataChannel->GetLastEditId());
+        return ret;
     }
 
     void InputMethodAbility::DeleteForward(int32_t length)
     {
-        IMSA_HILOGI("InputMethodAbility::DeleteForward");
+        IMSA_HILOGD("InputMethodAbility::DeleteForward");
         if (!inputDataChannel) {
             IMSA_HILOGI("InputMethodAbility::DeleteForward inputDataChanel is nullptr");
             return;
         }
         inputDataChannel->DeleteForward(length);
+        textMirror_.Invalidate(inputDataChannel->GetLastEditId());
     }
 
     void InputMethodAbility::DeleteBackward(int32_t length)
     {
-        IMSA_HILOGI("InputMethodAbility::DeleteBackward");
+        IMSA_HILOGD("InputMethodAbility::DeleteBackward");
         if (!inputDataChannel) {
             IMSA_HILOGI("InputMethodAbility::DeleteBackward inputDataChanel is nullptr");
             return;
         }
         inputDataChannel->DeleteBackward(length);
+        textMirror_.Invalidate(inputDataChannel->GetLastEditId());
     }
 
     void InputMethodAbility::SendFunctionKey(int32_t funcKey)
     {
-        IMSA_HILOGI("InputMethodAbility::SendFunctionKey");
+        IMSA_HILOGD("InputMethodAbility::SendFunctionKey");
         if (!inputDataChannel) {
             IMSA_HILOGI("InputMethodAbility::SendFunctionKey inputDataChanel is nullptr");
             return;
@@ -398,6 +451,18 @@ namespace MiscServices {
         inputDataChannel->SendFunctionKey(funcKey);
     }
 
+    bool InputMethodAbility::BatchEdit(const std::vector<EditOperation>& operations)
+    {
+        IMSA_HILOGD("InputMethodAbility::BatchEdit");
+        if (!inputDataChannel) {
+            IMSA_HILOGI("InputMethodAbility::BatchEdit inputDataChanel is nullptr");
+            return false;
+        }
+        bool ret = inputDataChannel->BatchEdit(operations);
+        textMirror_.Invalidate(inputDataChannel->GetLastEditId());
+        return ret;
+    }
+
     void InputMethodAbility::HideKeyboardSelf()
     {
         IMSA_HILOGI("InputMethodAbility::HideKeyboardSelf");
@@ -406,29 +471,37 @@ namespace MiscServices {
 
     std::u16string InputMethodAbility::GetTextBeforeCursor(int32_t number)
     {
-        IMSA_HILOGI("InputMethodAbility::GetTextBeforeCursor");
+        IMSA_HILOGD("InputMethodAbility::GetTextBeforeCursor");
 
         if (!inputDataChannel) {
             IMSA_HILOGI("InputMethodAbility::GetTextBeforeCursor inputDataChanel is nullptr");
             return u"";
         }
+        std::u16string text;
+        if (textMirror_.GetTextBeforeCursor(number, text)) {
+            return text;
+        }
         return inputDataChannel->GetTextBeforeCursor(number);
     }
 
     std::u16string InputMethodAbility::GetTextAfterCursor(int32_t number)
     {
-        IMSA_HILOGI("InputMethodAbility::GetTextAfterCursor");
+        IMSA_HILOGD("InputMethodAbility::GetTextAfterCursor");
 
         if (!inputDataChannel) {
             IMSA_HILOGI("InputMethodAbility::GetTextAfterCursor inputDataChanel is nullptr");
             return u"";
         }
+        std::u16string text;
+        if (textMirror_.GetTextAfterCursor(number, text)) {
+            return text;
+        }
         return inputDataChannel->GetTextAfterCursor(number);
     }
 
     void InputMethodAbility::MoveCursor(int32_t keyCode)
     {
-        IMSA_HILOGI("InputMethodAbility::MoveCursor");
+        IMSA_HILOGD("InputMethodAbility::MoveCursor");
 
         if (!inputDataChannel) {
             IMSA_HILOGI("InputMethodAbility::MoveCursor inputDataChanel is nullptr");
@@ -436,6 +509,7 @@ namespace MiscServices {
         }
 
         inputDataChannel->MoveCursor(keyCode);
+        textMirror_.Invalidate(inputDataChannel->GetLastEditId());
         return;
     }
 
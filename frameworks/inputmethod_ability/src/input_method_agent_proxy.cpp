@@ -25,7 +25,7 @@ namespace MiscServices {
 
     bool InputMethodAgentProxy::DispatchKeyEvent(MessageParcel& data)
     {
-        IMSA_HILOGI("InputMethodAgentProxy::DispatchKeyEvent");
+        IMSA_HILOGD("InputMethodAgentProxy::DispatchKeyEvent");
         MessageParcel reply;
         MessageOption option;
 
@@ -39,9 +39,8 @@ namespace MiscServices {
 
     void InputMethodAgentProxy::OnCursorUpdate(int32_t positionX, int32_t positionY, int32_t height)
     {
-        IMSA_HILOGI("InputMethodAgentProxy::OnCursorUpdate");
-        MessageParcel data, reply;
-        MessageOption option;
+        IMSA_HILOGD("InputMethodAgentProxy::OnCursorUpdate");
+        MessageParcel data;
         if (!data.WriteInterfaceToken(GetDescriptor())) {
             IMSA_HILOGI("InputMethodAgentProxy::OnCursorUpdate descriptor is not match");
             return;
@@ -51,15 +50,14 @@ namespace MiscServices {
         data.WriteInt32(positionY);
         data.WriteInt32(height);
 
-        Remote()->SendRequest(ON_CURSOR_UPDATE, data, reply, option);
+        SendOneWayRequest(ON_CURSOR_UPDATE, data);
     }
 
     void InputMethodAgentProxy::OnSelectionChange(std::u16string text, int32_t oldBegin, int32_t oldEnd,
                                                   int32_t newBegin, int32_t newEnd)
     {
-        IMSA_HILOGI("InputMethodAgentProxy::OnSelectionChange");
-        MessageParcel data, reply;
-        MessageOption option;
+        IMSA_HILOGD("InputMethodAgentProxy::OnSelectionChange");
+        MessageParcel data;
         if (!data.WriteInterfaceToken(GetDescriptor())) {
             IMSA_HILOGI("InputMethodAgentProxy::OnSelectionChange descriptor is not match");
             return;
@@ -71,21 +69,104 @@ namespace MiscServices {
         data.WriteInt32(newBegin);
         data.WriteInt32(newEnd);
 
-        Remote()->SendRequest(ON_SELECTION_CHANGE, data, reply, option);
+        SendOneWayRequest(ON_SELECTION_CHANGE, data);
     }
 
     void InputMethodAgentProxy::SetCallingWindow(uint32_t windowId)
     {
         IMSA_HILOGI("InputMethodAgentProxy::SetCallingWindow");
-        MessageParcel data, reply;
-        MessageOption option;
+        MessageParcel data;
         if (!data.WriteInterfaceToken(GetDescriptor())) {
             IMSA_HILOGI("InputMethodAgentProxy::SetCallingWindow descriptor is not match");
             return;
         }
 
         data.WriteUint32(windowId);
-        Remote()->SendRequest(SET_CALLING_WINDOW_ID, data, reply, option);
+        SendOneWayRequest(SET_CALLING_WINDOW_ID, data);
+    }
+
+    void InputMethodAgentProxy::OnTextDelta(const TextDelta& delta)
+    {
+        IMSA_HILOGD("InputMethodAgentProxy::OnTextDelta");
+        MessageParcel data;
+        if (!data.WriteInterfaceToken(GetDescriptor())) {
+            IMSA_HILOGI("InputMethodAgentProxy::OnTextDelta descriptor is not match");
+            return;
+        }
+
+        if (!delta.Marshalling(data)) {
+            IMSA_HILOGE("InputMethodAgentProxy::OnTextDelta write delta failed");
+            return;
+        }
+        SendOneWayRequest(ON_TEXT_DELTA, data);
+    }
+
+    int32_t InputMethodAgentProxy::AttachSharedRing(int memFd, int readerFd, int writerFd)
+    {
+        IMSA_HILOGI("InputMethodAgentProxy::AttachSharedRing");
+        MessageParcel data, reply;
+        MessageOption option;
+        if (!data.WriteInterfaceToken(GetDescriptor())) {
+            IMSA_HILOGI("InputMethodAgentProxy::AttachSharedRing descriptor is not match");
+            return ERROR_EX_ILLEGAL_ARGUMENT;
+        }
+        if (!(data.WriteFileDescriptor(memFd) && data.WriteFileDescriptor(readerFd)
+            && data.WriteFileDescriptor(writerFd))) {
+            return ERROR_BAD_PARAMETERS;
+        }
+
+        auto ret = Remote()->SendRequest(ATTACH_SHARED_RING, data, reply, option);
+        if (ret != NO_ERROR) {
+            return ret;
+        }
+        return reply.ReadInt32();
+    }
+
+    /*! Send the one-way requests of the agent through a shared ring instead of binder
+    \n It is negotiated when the agent is bound. The requests keep going through binder if the input method can not
+        attach the ring, and the requests with a reply always do.
+    \return true - the input method has attached the ring
+    */
+    bool InputMethodAgentProxy::OpenSharedRing()
+    {
+        IMSA_HILOGI("InputMethodAgentProxy::OpenSharedRing");
+        std::unique_ptr<SharedRing> ring(SharedRing::Create());
+        if (!ring) {
+            return false;
+        }
+        int32_t ret = AttachSharedRing(ring->GetMemFd(), ring->GetReaderFd(), ring->GetWriterFd());
+        if (ret != NO_ERROR) {
+            IMSA_HILOGE("InputMethodAgentProxy::OpenSharedRing input method refused the ring: %{public}d", ret);
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(ringLock_);
+        ring_ = std::move(ring);
+        return true;
+    }
+
+    /*! Send a one-way request through the shared ring if there is one, otherwise through binder
+    \n A request which does not fit in the ring waits until the input method has handled the ones in the ring.
+        It fails if the ring is not drained in time, rather than overtake the requests in the ring.
+    */
+    int32_t InputMethodAgentProxy::SendOneWayRequest(uint32_t code, MessageParcel &data)
+    {
+        {
+            std::lock_guard<std::mutex> lock(ringLock_);
+            if (ring_) {
+                if (ring_->Write(code, data, RING_WRITE_TIMEOUT_MS)) {
+                    return NO_ERROR;
+                }
+                if (!ring_->WaitEmpty(RING_WRITE_TIMEOUT_MS)) {
+                    // sending it through binder now could overtake the requests still in the ring
+                    IMSA_HILOGE("InputMethodAgentProxy::SendOneWayRequest the ring is not drained, "
+                        "drop request %{public}u", code);
+                    return ErrorCode::ERROR_STATUS_TIMED_OUT;
+                }
+            }
+        }
+        MessageParcel reply;
+        MessageOption option(MessageOption::TF_ASYNC);
+        return Remote()->SendRequest(code, data, reply, option);
     }
 } // namespace MiscServices
 } // namespace OHOS
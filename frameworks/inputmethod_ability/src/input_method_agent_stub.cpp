@@ -30,12 +30,13 @@ namespace MiscServices {
 
     InputMethodAgentStub::~InputMethodAgentStub()
     {
+        ringReceiver_.reset();
     }
 
     int32_t InputMethodAgentStub::OnRemoteRequest(uint32_t code, MessageParcel &data,
                                                   MessageParcel &reply, MessageOption &option)
     {
-        IMSA_HILOGI("InputMethodAgentStub::OnRemoteRequest code = %{public}d", code);
+        IMSA_HILOGD("InputMethodAgentStub::OnRemoteRequest code = %{public}d", code);
         auto descriptorToken = data.ReadInterfaceToken();
         if (descriptorToken != GetDescriptor()) {
             return ErrorCode::ERROR_STATUS_UNKNOWN_TRANSACTION;
@@ -50,6 +51,7 @@ namespace MiscServices {
             case SET_CALLING_WINDOW_ID: {
                 uint32_t windowId = data.ReadUint32();
                 SetCallingWindow(windowId);
+                break;
             }
             case ON_CURSOR_UPDATE: {
                 int32_t positionX = data.ReadInt32();
@@ -69,6 +71,23 @@ namespace MiscServices {
                 reply.WriteNoException();
                 return ErrorCode::NO_ERROR;
             }
+            case ON_TEXT_DELTA: {
+                TextDelta delta;
+                if (!delta.ReadFromParcel(data)) {
+                    return ErrorCode::ERROR_BAD_PARAMETERS;
+                }
+                OnTextDelta(delta);
+                break;
+            }
+#ifdef INPUTMETHOD_SHARED_RING_ENABLE
+            case ATTACH_SHARED_RING: {
+                int memFd = data.ReadFileDescriptor();
+                int readerFd = data.ReadFileDescriptor();
+                int writerFd = data.ReadFileDescriptor();
+                reply.WriteInt32(AttachSharedRing(memFd, readerFd, writerFd));
+                break;
+            }
+#endif
             default: {
                 return IRemoteStub::OnRemoteRequest(code, data, reply, option);
             }
@@ -78,7 +97,7 @@ namespace MiscServices {
 
     bool InputMethodAgentStub::DispatchKeyEvent(MessageParcel& data)
     {
-        IMSA_HILOGI("InputMethodAgentStub::DispatchKeyEvent");
+        IMSA_HILOGD("InputMethodAgentStub::DispatchKeyEvent");
         if (!msgHandler_) {
             return false;
         }
@@ -97,33 +116,101 @@ namespace MiscServices {
 
     void InputMethodAgentStub::OnCursorUpdate(int32_t positionX, int32_t positionY, int height)
     {
-        IMSA_HILOGI("InputMethodAgentStub::OnCursorUpdate");
+        IMSA_HILOGD("InputMethodAgentStub::OnCursorUpdate");
         if (!msgHandler_) {
             return;
         }
-        MessageParcel *data = new MessageParcel();
+        MessagePtr message = msgHandler_->ObtainMessage(MessageID::MSG_ID_ON_CURSOR_UPDATE);
+        MessageParcel *data = message->msgContent_;
         data->WriteInt32(positionX);
         data->WriteInt32(positionY);
         data->WriteInt32(height);
-        Message *message = new Message(MessageID::MSG_ID_ON_CURSOR_UPDATE, data);
-        msgHandler_->SendMessage(message);
+        message->coalesceKey_ = MessageHandler::MakeCoalesceKey(MessageID::MSG_ID_ON_CURSOR_UPDATE);
+        msgHandler_->SendMessage(std::move(message));
     }
 
     void InputMethodAgentStub::OnSelectionChange(std::u16string text, int32_t oldBegin, int32_t oldEnd,
                                                  int32_t newBegin, int32_t newEnd)
     {
-        IMSA_HILOGI("InputMethodAgentStub::OnSelectionChange");
+        IMSA_HILOGD("InputMethodAgentStub::OnSelectionChange");
         if (!msgHandler_) {
             return;
         }
-        MessageParcel *data = new MessageParcel();
+        MessagePtr message = msgHandler_->ObtainMessage(MessageID::MSG_ID_ON_SELECTION_CHANGE);
+        MessageParcel *data = message->msgContent_;
         data->WriteString16(text);
         data->WriteInt32(oldBegin);
         data->WriteInt32(oldEnd);
         data->WriteInt32(newBegin);
         data->WriteInt32(newEnd);
-        Message *message = new Message(MessageID::MSG_ID_ON_SELECTION_CHANGE, data);
-        msgHandler_->SendMessage(message);
+        message->coalesceKey_ = MessageHandler::MakeCoalesceKey(MessageID::MSG_ID_ON_SELECTION_CHANGE);
+        msgHandler_->SendMessage(std::move(message));
+    }
+
+    /*! Merge two selection changes of the editor into one
+      \param older the pending selection change, which is dropped
+      \param newer the selection change which replaces it, it keeps the selection older started from
+      \note Registered to the work queue of the IME by MessageHandler::SetMerger.
+    */
+    void InputMethodAgentStub::MergeSelectionChange(Message &older, Message &newer)
+    {
+        MessageParcel *from = older.msgContent_;
+        MessageParcel *to = newer.msgContent_;
+        from->RewindRead(0);
+        from->ReadString16();
+        int32_t oldBegin = from->ReadInt32();
+        int32_t oldEnd = from->ReadInt32();
+        to->RewindRead(0);
+        std::u16string text = to->ReadString16();
+        to->ReadInt32();
+        to->ReadInt32();
+        int32_t newBegin = to->ReadInt32();
+        int32_t newEnd = to->ReadInt32();
+        to->RewindWrite(0);
+        to->RewindRead(0);
+        to->WriteString16(text);
+        to->WriteInt32(oldBegin);
+        to->WriteInt32(oldEnd);
+        to->WriteInt32(newBegin);
+        to->WriteInt32(newEnd);
+    }
+
+    void InputMethodAgentStub::OnTextDelta(const TextDelta& delta)
+    {
+        IMSA_HILOGD("InputMethodAgentStub::OnTextDelta");
+        if (!msgHandler_) {
+            return;
+        }
+        // deltas are applied one on another, so they are never coalesced
+        MessagePtr message = msgHandler_->ObtainMessage(MessageID::MSG_ID_ON_TEXT_DELTA);
+        delta.Marshalling(*message->msgContent_);
+        msgHandler_->SendMessage(std::move(message));
+    }
+
+    /*! Receive the one-way requests of the input client from a shared ring as well as from binder
+      \param memFd the shared memory of the ring, the agent takes its ownership
+      \param readerFd the doorbell of the reader, the agent takes its ownership
+      \param writerFd the doorbell of the writer, the agent takes its ownership
+      \return ErrorCode::NO_ERROR - the ring replaces the previous one
+    */
+    int32_t InputMethodAgentStub::AttachSharedRing(int memFd, int readerFd, int writerFd)
+    {
+        IMSA_HILOGI("InputMethodAgentStub::AttachSharedRing");
+        SharedRing *ring = SharedRing::Attach(memFd, readerFd, writerFd);
+        if (!ring) {
+            return ErrorCode::ERROR_BAD_PARAMETERS;
+        }
+        auto receiver = std::make_unique<SharedRingReceiver>(ring, [this](uint32_t code, MessageParcel &data) {
+            if (code == ATTACH_SHARED_RING) {
+                return;
+            }
+            MessageParcel reply;
+            MessageOption option(MessageOption::TF_ASYNC);
+            OnRemoteRequest(code, data, reply, option);
+        });
+        std::lock_guard<std::mutex> lock(ringLock_);
+        ringReceiver_ = std::move(receiver);
+        return ErrorCode::NO_ERROR;
     }
 
     void InputMethodAgentStub::SetMessageHandler(MessageHandler *msgHandler)
@@ -17,6 +17,7 @@
 #include "message_parcel.h"
 #include "message_option.h"
 #include "input_attribute.h"
+#include "trace_span.h"
 #include <string_ex.h>
 
 namespace OHOS {
@@ -200,9 +201,14 @@ namespace MiscServices {
             return false;
         }
 
+        // the request being handled by this thread, e.g. a traced startInput
+        uint64_t traceId = TraceRecorder::GetCurrentTraceId();
+        TraceSpan span(traceId, "IMSA::showKeyboard");
         MessageParcel data;
         if (!(data.WriteInterfaceToken(GetDescriptor())
-            && data.WriteRemoteObject(inputDataChannel->AsObject()))) {
+            && data.WriteRemoteObject(inputDataChannel->AsObject())
+            && data.WriteUint64(traceId)
+            && data.WriteInt64(TraceRecorder::NowNs()))) {
             return false;
         }
         MessageParcel reply;
@@ -23,6 +23,7 @@
 #include "message_parcel.h"
 #include "input_control_channel_proxy.h"
 #include "input_method_ability.h"
+#include "trace_span.h"
 #include <string_ex.h>
 
 namespace OHOS {
@@ -108,6 +109,12 @@ namespace MiscServices {
             }
             case SHOW_KEYBOARD: {
                 sptr<IInputDataChannel> inputDataChannel = iface_cast<IInputDataChannel>(data.ReadRemoteObject());
+                uint64_t traceId = data.ReadUint64();
+                int64_t sentNs = data.ReadInt64();
+                if (traceId) {
+                    TraceRecorder::Instance()->Record(traceId, "IPC IMSA->IMA", sentNs, TraceRecorder::NowNs());
+                }
+                TraceSpan span(traceId, "IMA::showKeyboard");
                 showKeyboard(inputDataChannel);
                 reply.WriteNoException();
                 break;
@@ -209,9 +216,7 @@ namespace MiscServices {
         if (!msgHandler_) {
             return ErrorCode::ERROR_NULL_POINTER;
         }
-        MessageParcel *data = new MessageParcel();
-        Message *msg = new Message(MessageID::MSG_ID_STOP_INPUT, data);
-        msgHandler_->SendMessage(msg);
+        msgHandler_->SendMessage(msgHandler_->ObtainMessage(MessageID::MSG_ID_STOP_INPUT));
         return ErrorCode::NO_ERROR;
     }
 
@@ -221,11 +226,9 @@ namespace MiscServices {
         if (!msgHandler_) {
             return;
         }
-        MessageParcel *data = new MessageParcel();
-
-        data->WriteBool(state);
-        Message *msg = new Message(MessageID::MSG_ID_SET_CLIENT_STATE, data);
-        msgHandler_->SendMessage(msg);
+        MessagePtr msg = msgHandler_->ObtainMessage(MessageID::MSG_ID_SET_CLIENT_STATE);
+        msg->msgContent_->WriteBool(state);
+        msgHandler_->SendMessage(std::move(msg));
     }
 
     bool InputMethodCoreStub::showKeyboard(const sptr<IInputDataChannel>& inputDataChannel)
@@ -241,6 +244,7 @@ namespace MiscServices {
         }
 
         Message *msg = new Message(MessageID::MSG_ID_SHOW_KEYBOARD, data);
+        msg->traceId_ = TraceRecorder::GetCurrentTraceId();
         msgHandler_->SendMessage(msg);
         return true;
     }
@@ -251,12 +255,11 @@ namespace MiscServices {
         if (!msgHandler_) {
             return ErrorCode::ERROR_NULL_POINTER;
         }
-        MessageParcel *data = new MessageParcel();
+        MessagePtr msg = msgHandler_->ObtainMessage(MessageID::MSG_ID_HIDE_KEYBOARD);
+        MessageParcel *data = msg->msgContent_;
         data->WriteInt32(userId_);
         data->WriteInt32(flags);
-
-        Message *msg = new Message(MessageID::MSG_ID_HIDE_KEYBOARD, data);
-        msgHandler_->SendMessage(msg);
+        msgHandler_->SendMessage(std::move(msg));
         return true;
     }
 
@@ -16,9 +16,11 @@
 #ifndef FRAMEWORKS_INPUTMETHOD_CONTROLLER_INCLUDE_I_INPUT_DATA_CHANNEL_H
 #define FRAMEWORKS_INPUTMETHOD_CONTROLLER_INCLUDE_I_INPUT_DATA_CHANNEL_H
 #include <errors.h>
+#include <vector>
 #include "iremote_broker.h"
 #include "global.h"
 #include "input_method_utils.h"
+#include "edit_operation.h"
 
 /**
  * brief Definition of interface IInputDataChannel
@@ -41,6 +43,8 @@ namespace MiscServices {
             SEND_KEYBOARD_STATUS,
             SEND_FUNCTION_KEY,
             MOVE_CURSOR,
+            BATCH_EDIT,
+            ATTACH_SHARED_RING,
         };
 
         DECLARE_INTERFACE_DESCRIPTOR(u"ohos.miscservices.inputmethod.IInputDataChannel");
@@ -57,6 +61,8 @@ namespace MiscServices {
         virtual int32_t GetEnterKeyType() = 0;
         virtual int32_t GetInputPattern() = 0;
         virtual void StopInput() = 0;
+        virtual bool BatchEdit(const std::vector<EditOperation>& operations) = 0;
+        virtual int32_t AttachSharedRing(int memFd, int readerFd, int writerFd) = 0;
     };
 } // namespace MiscServices
 } // namespace OHOS
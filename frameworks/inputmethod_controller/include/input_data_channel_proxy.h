@@ -16,9 +16,13 @@
 #ifndef FRAMEWORKS_INPUTMETHOD_CONTROLLER_INCLUDE_INPUT_DATA_CHANNEL_PROXY_H
 #define FRAMEWORKS_INPUTMETHOD_CONTROLLER_INCLUDE_INPUT_DATA_CHANNEL_PROXY_H
 
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include "iremote_proxy.h"
 #include "i_input_data_channel.h"
 #include "input_method_utils.h"
+#include "shared_ring.h"
 
 namespace OHOS {
 namespace MiscServices {
@@ -40,9 +44,19 @@ namespace MiscServices {
         int32_t GetEnterKeyType() override;
         int32_t GetInputPattern() override;
         void StopInput() override;
+        bool BatchEdit(const std::vector<EditOperation>& operations) override;
+        int32_t AttachSharedRing(int memFd, int readerFd, int writerFd) override;
+        bool OpenSharedRing();
+        uint64_t GetLastEditId() const;
 
     private:
         static inline BrokerDelegator<InputDataChannelProxy> delegator_;
+        static const int32_t RING_WRITE_TIMEOUT_MS = 100;
+        std::mutex ringLock_;
+        std::unique_ptr<SharedRing> ring_; // the one-way requests go through it once the client attached it
+        std::atomic<uint64_t> editId_; // the id of the last edit sent, it starts at random for every channel
+
+        int32_t SendOneWayRequest(uint32_t code, MessageParcel &data);
     };
 } // namespace MiscServices
 } // namespace OHOS
@@ -17,11 +17,14 @@
 #ifndef FRAMEWORKS_INPUTMETHOD_CONTROLLER_INCLUDE_INPUT_DATA_CHANNEL_STUB_H
 #define FRAMEWORKS_INPUTMETHOD_CONTROLLER_INCLUDE_INPUT_DATA_CHANNEL_STUB_H
 
+#include <memory>
+#include <mutex>
 #include "i_input_data_channel.h"
 #include "iremote_stub.h"
 #include "message_handler.h"
 #include "input_method_utils.h"
 #include "input_method_controller.h"
+#include "shared_ring.h"
 
 namespace OHOS {
 namespace MiscServices {
@@ -48,9 +51,19 @@ namespace MiscServices {
         int32_t GetEnterKeyType() override;
         int32_t GetInputPattern() override;
         void StopInput() override;
+        bool BatchEdit(const std::vector<EditOperation>& operations) override;
+        int32_t AttachSharedRing(int memFd, int readerFd, int writerFd) override;
 
     private:
+        bool InsertText(const std::u16string& text, uint64_t editId);
+        bool DeleteForward(int32_t length, uint64_t editId);
+        bool DeleteBackward(int32_t length, uint64_t editId);
+        void MoveCursor(int32_t keyCode, uint64_t editId);
+        bool BatchEdit(const std::vector<EditOperation>& operations, uint64_t editId);
+
         MessageHandler *msgHandler;
+        std::mutex ringLock_;
+        std::unique_ptr<SharedRingReceiver> ringReceiver_;
     };
 } // namespace MiscServices
 } // namespace OHOS
@@ -17,8 +17,10 @@
 #ifndef FRAMEWORKS_INPUTMETHOD_CONTROLLER_INCLUDE_INPUT_METHOD_CONTROLLER_H
 #define FRAMEWORKS_INPUTMETHOD_CONTROLLER_INCLUDE_INPUT_METHOD_CONTROLLER_H
 
+#include <atomic>
 #include <mutex>
 #include <thread>
+#include <vector>
 #include "input_data_channel_stub.h"
 #include "input_client_stub.h"
 #include "input_method_system_ability_proxy.h"
@@ -42,6 +44,7 @@ namespace MiscServices {
         virtual void SendKeyboardInfo(const KeyboardInfo& info) = 0;
         virtual void SetKeyboardStatus(bool status) = 0;
         virtual void MoveCursor(const Direction direction) = 0;
+        virtual void BatchEdit(const std::vector<EditOperation>& operations);
     };
 
     class ImsaDeathRecipient : public IRemoteObject::DeathRecipient {
@@ -67,7 +70,7 @@ namespace MiscServices {
         void OnConfigurationChange(Configuration info);
         bool dispatchKeyEvent(std::shared_ptr<MMI::KeyEvent> keyEvent);
         void DisplayOptionalInputMethod();
-        std::vector<InputMethodProperty*> ListInputMethod();
+        std::vector<InputMethodPropertyPtr> ListInputMethod();
         int32_t GetEnterKeyType();
         int32_t GetInputPattern();
         void HideCurrentInput();
@@ -85,6 +88,7 @@ namespace MiscServices {
         void StopInput(sptr<InputClientStub> &client);
         void ReleaseInput(sptr<InputClientStub> &client);
         void WorkThread();
+        void AckEdit(uint64_t editId);
 
         sptr<InputDataChannelStub> mInputDataChannel;
         sptr<InputClientStub> mClient;
@@ -98,6 +102,11 @@ namespace MiscServices {
         int mSelectOldEnd = 0;
         int mSelectNewBegin = 0;
         int mSelectNewEnd = 0;
+        // the text deltas are built in the thread calling OnSelectionChange only
+        uint64_t textSequence_ = 0; // the sequence number of the last delta sent to mAgent, 0 - a full sync is due
+        uint32_t deltasSinceSync_ = 0;
+        std::atomic<bool> resyncRequested_ { false }; // set by the work thread when a new agent comes
+        std::atomic<uint64_t> ackedEdit_ { 0 }; // the id of the last edit of the input method applied to the editor
         CursorInfo cursorInfo_;
 
         static std::mutex instanceLock_;
@@ -105,6 +114,7 @@ namespace MiscServices {
         std::thread workThreadHandler;
         MessageHandler *msgHandler;
         bool stop_;
+        std::atomic<bool> prepared_ {false}; // the client is registered to the service
         int32_t enterKeyType_ = 0;
         int32_t inputPattern_ = 0;
     };
@@ -53,9 +53,9 @@ namespace MiscServices {
         int32_t getDisplayMode(int32_t retMode) override;
         int32_t getKeyboardWindowHeight(int32_t retHeight) override;
         int32_t getCurrentKeyboardType(KeyboardType *retType) override;
-        int32_t listInputMethodEnabled(std::vector<InputMethodProperty*> *properties) override;
-        int32_t listInputMethod(std::vector<InputMethodProperty*> *properties) override;
-        int32_t listKeyboardType(const std::u16string& imeId, std::vector<KeyboardType*> *types) override;
+        int32_t listInputMethodEnabled(std::vector<InputMethodPropertyPtr> *properties) override;
+        int32_t listInputMethod(std::vector<InputMethodPropertyPtr> *properties) override;
+        int32_t listKeyboardType(const std::u16string& imeId, std::vector<KeyboardTypePtr> *types) override;
 
     private:
         static inline BrokerDelegator<InputMethodSystemAbilityProxy> delegator_;
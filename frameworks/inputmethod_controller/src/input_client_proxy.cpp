@@ -22,11 +22,18 @@ using namespace ErrorCode;
     {
     }
 
+    /*! Send the agent of the input method service to the input client
+    \n It's a one-way call, so a slow or hung client doesn't hold the service broadcasting to all the clients.
+        All the calls to the client are one-way, so they are queued and handled in the order they are sent.
+    \param agent the agent of the current input method service
+    \return NO_ERROR the request is queued for the client
+    \n      ERROR_STATUS_FAILED_TRANSACTION the client can't be reached, e.g. it died
+    */
     int32_t InputClientProxy::onInputReady(const sptr<IInputMethodAgent>& agent)
     {
         IMSA_HILOGI("InputClientProxy::onInputReady");
         MessageParcel data, reply;
-        MessageOption option;
+        MessageOption option(MessageOption::TF_ASYNC);
         if (!data.WriteInterfaceToken(GetDescriptor())) {
             return ERROR_EX_PARCELABLE;
         }
@@ -42,26 +49,50 @@ using namespace ErrorCode;
         return NO_ERROR;
     }
 
+    /*! Tell the input client its input is released
+    \n It's a one-way call, like onInputReady, so it can't overtake an agent sent before it.
+    \param retValue the reason of the release
+    \return NO_ERROR the request is queued for the client
+    \n      ERROR_STATUS_FAILED_TRANSACTION the client can't be reached, e.g. it died
+    */
     int32_t InputClientProxy::onInputReleased(int32_t retValue)
     {
         MessageParcel data, reply;
-        MessageOption option;
-
-        data.WriteInterfaceToken(GetDescriptor());
+        MessageOption option(MessageOption::TF_ASYNC);
+        if (!data.WriteInterfaceToken(GetDescriptor())) {
+            return ERROR_EX_PARCELABLE;
+        }
         data.WriteInt32(retValue);
-        auto status = Remote()->SendRequest(ON_INPUT_RELEASED, data, reply, option);
-        return status;
+
+        auto ret = Remote()->SendRequest(ON_INPUT_RELEASED, data, reply, option);
+        if (ret != NO_ERROR) {
+            IMSA_HILOGI("InputClientProxy::onInputReleased SendRequest failed");
+            return ERROR_STATUS_FAILED_TRANSACTION;
+        }
+        return NO_ERROR;
     }
 
+    /*! Tell the input client the display mode of the keyboard
+    \n It's a one-way call, like onInputReady, so it can't overtake an agent sent before it.
+    \param mode 0 - part screen mode, 1 - full screen mode
+    \return NO_ERROR the request is queued for the client
+    \n      ERROR_STATUS_FAILED_TRANSACTION the client can't be reached, e.g. it died
+    */
     int32_t InputClientProxy::setDisplayMode(int32_t mode)
     {
         MessageParcel data, reply;
-        MessageOption option;
-
-        data.WriteInterfaceToken(GetDescriptor());
+        MessageOption option(MessageOption::TF_ASYNC);
+        if (!data.WriteInterfaceToken(GetDescriptor())) {
+            return ERROR_EX_PARCELABLE;
+        }
         data.WriteInt32(mode);
-        auto status = Remote()->SendRequest(SET_DISPLAY_MODE, data, reply, option);
-        return status;
+
+        auto ret = Remote()->SendRequest(SET_DISPLAY_MODE, data, reply, option);
+        if (ret != NO_ERROR) {
+            IMSA_HILOGI("InputClientProxy::setDisplayMode SendRequest failed");
+            return ERROR_STATUS_FAILED_TRANSACTION;
+        }
+        return NO_ERROR;
     }
 } // namespace MiscServices
 } // namespace OHOS
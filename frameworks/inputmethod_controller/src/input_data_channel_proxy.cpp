@@ -14,62 +14,59 @@
  */
 
 #include "input_data_channel_proxy.h"
+#include <random>
 #include "message_parcel.h"
 #include "utils.h"
 
 namespace OHOS {
 namespace MiscServices {
     InputDataChannelProxy::InputDataChannelProxy(const sptr<IRemoteObject> &object)
-        : IRemoteProxy<IInputDataChannel>(object)
+        : IRemoteProxy<IInputDataChannel>(object), editId_(static_cast<uint64_t>(std::random_device()()) << 32)
     {
     }
 
+    /*! Insert text into the editor
+    \n The edits and events sent to the channel are one-way calls. The binder driver delivers the one-way calls
+        to a remote object one by one in the order they are sent, so they are handled by the client in order.
+        Once a shared ring is open, all of them go through the ring instead, which keeps the order as well.
+        Each edit ends with its id, and the client reports the id of the last edit it applied with its text.
+    \param text the text to be inserted
+    \return true - the request is sent to the client
+    */
     bool InputDataChannelProxy::InsertText(const std::u16string& text)
     {
-        IMSA_HILOGI("InputDataChannelProxy::InsertText");
-        MessageParcel data, reply;
-        MessageOption option;
+        IMSA_HILOGD("InputDataChannelProxy::InsertText");
+        MessageParcel data;
         data.WriteInterfaceToken(GetDescriptor());
         data.WriteString16(text);
+        data.WriteUint64(++editId_);
 
-        auto ret = Remote()->SendRequest(INSERT_TEXT, data, reply, option);
-        if (ret != NO_ERROR) {
-            return false;
-        }
-        auto result = reply.ReadBool();
-        return result;
+        auto ret = SendOneWayRequest(INSERT_TEXT, data);
+        return ret == NO_ERROR;
     }
 
     bool InputDataChannelProxy::DeleteForward(int32_t length)
     {
-        IMSA_HILOGI("InputDataChannelProxy::DeleteForward");
-        MessageParcel data, reply;
-        MessageOption option;
+        IMSA_HILOGD("InputDataChannelProxy::DeleteForward");
+        MessageParcel data;
         data.WriteInterfaceToken(GetDescriptor());
         data.WriteInt32(length);
+        data.WriteUint64(++editId_);
 
-        auto ret = Remote()->SendRequest(DELETE_FORWARD, data, reply, option);
-        if (ret != NO_ERROR) {
-            return false;
-        }
-        auto result = reply.ReadBool();
-        return result;
+        auto ret = SendOneWayRequest(DELETE_FORWARD, data);
+        return ret == NO_ERROR;
     }
 
     bool InputDataChannelProxy::DeleteBackward(int32_t length)
     {
-        IMSA_HILOGI("InputDataChannelProxy::DeleteBackward");
-        MessageParcel data, reply;
-        MessageOption option;
+        IMSA_HILOGD("InputDataChannelProxy::DeleteBackward");
+        MessageParcel data;
         data.WriteInterfaceToken(GetDescriptor());
         data.WriteInt32(length);
+        data.WriteUint64(++editId_);
 
-        auto ret = Remote()->SendRequest(DELETE_BACKWARD, data, reply, option);
-        if (ret != NO_ERROR) {
-            return false;
-        }
-        auto result = reply.ReadBool();
-        return result;
+        auto ret = SendOneWayRequest(DELETE_BACKWARD, data);
+        return ret == NO_ERROR;
     }
 
     void InputDataChannelProxy::Close()
@@ -86,7 +83,7 @@ namespace MiscServices {
 
     std::u16string InputDataChannelProxy::GetTextBeforeCursor(int32_t number)
     {
-        IMSA_HILOGI("InputDataChannelProxy::GetTextBeforeCursor");
+        IMSA_HILOGD("InputDataChannelProxy::GetTextBeforeCursor");
         MessageParcel data, reply;
         MessageOption option;
         data.WriteInterfaceToken(GetDescriptor());
@@ -99,7 +96,7 @@ namespace MiscServices {
 
     std::u16string InputDataChannelProxy::GetTextAfterCursor(int32_t number)
     {
-        IMSA_HILOGI("InputDataChannelProxy::GetTextAfterCursor");
+        IMSA_HILOGD("InputDataChannelProxy::GetTextAfterCursor");
         MessageParcel data, reply;
         MessageOption option;
         data.WriteInterfaceToken(GetDescriptor());
@@ -113,35 +110,33 @@ namespace MiscServices {
     void InputDataChannelProxy::SendKeyboardStatus(int32_t status)
     {
         IMSA_HILOGI("InputDataChannelProxy::SendKeyboardStatus");
-        MessageParcel data, reply;
-        MessageOption option;
+        MessageParcel data;
         data.WriteInterfaceToken(GetDescriptor());
         data.WriteInt32(status);
 
-        Remote()->SendRequest(SEND_KEYBOARD_STATUS, data, reply, option);
+        SendOneWayRequest(SEND_KEYBOARD_STATUS, data);
     }
 
     void InputDataChannelProxy::SendFunctionKey(int32_t funcKey)
     {
-        IMSA_HILOGI("InputDataChannelProxy::SendFunctionKey");
-        MessageParcel data, reply;
-        MessageOption option;
+        IMSA_HILOGD("InputDataChannelProxy::SendFunctionKey");
+        MessageParcel data;
         data.WriteInterfaceToken(GetDescriptor());
         data.WriteInt32(funcKey);
 
-        Remote()->SendRequest(SEND_FUNCTION_KEY, data, reply, option);
+        SendOneWayRequest(SEND_FUNCTION_KEY, data);
     }
 
     void InputDataChannelProxy::MoveCursor(int32_t keyCode)
     {
-        IMSA_HILOGI("InputDataChannelProxy::MoveCursor");
+        IMSA_HILOGD("InputDataChannelProxy::MoveCursor");
 
-        MessageParcel data, reply;
-        MessageOption option;
+        MessageParcel data;
         data.WriteInterfaceToken(GetDescriptor());
         data.WriteInt32(keyCode);
+        data.WriteUint64(++editId_);
 
-        Remote()->SendRequest(MOVE_CURSOR, data, reply, option);
+        SendOneWayRequest(MOVE_CURSOR, data);
     }
 
     int32_t InputDataChannelProxy::GetEnterKeyType()
@@ -171,11 +166,105 @@ namespace MiscServices {
     void InputDataChannelProxy::StopInput()
     {
         IMSA_HILOGI("InputDataChannelProxy::StopInput");
+        MessageParcel data;
+        data.WriteInterfaceToken(GetDescriptor());
+
+        SendOneWayRequest(STOP_INPUT, data);
+    }
+
+    /*! Apply a batch of edits to the editor in one transaction
+    \n The client applies the edits together, no other request of the channel is handled in between.
+    \param operations the edits in the order they are applied, at most EditOperation::MAX_BATCH_SIZE
+    \return true - the request is sent to the client
+    */
+    bool InputDataChannelProxy::BatchEdit(const std::vector<EditOperation>& operations)
+    {
+        IMSA_HILOGD("InputDataChannelProxy::BatchEdit");
+        MessageParcel data;
+        data.WriteInterfaceToken(GetDescriptor());
+        if (!EditOperation::WriteBatch(data, operations)) {
+            IMSA_HILOGE("InputDataChannelProxy::BatchEdit too many edits: %{public}d",
+                static_cast<int32_t>(operations.size()));
+            return false;
+        }
+        data.WriteUint64(++editId_);
+
+        auto ret = SendOneWayRequest(BATCH_EDIT, data);
+        return ret == NO_ERROR;
+    }
+
+    int32_t InputDataChannelProxy::AttachSharedRing(int memFd, int readerFd, int writerFd)
+    {
+        IMSA_HILOGI("InputDataChannelProxy::AttachSharedRing");
         MessageParcel data, reply;
         MessageOption option;
         data.WriteInterfaceToken(GetDescriptor());
+        if (!(data.WriteFileDescriptor(memFd) && data.WriteFileDescriptor(readerFd)
+            && data.WriteFileDescriptor(writerFd))) {
+            return ErrorCode::ERROR_BAD_PARAMETERS;
+        }
+
+        auto ret = Remote()->SendRequest(ATTACH_SHARED_RING, data, reply, option);
+        if (ret != NO_ERROR) {
+            return ret;
+        }
+        return reply.ReadInt32();
+    }
 
-        Remote()->SendRequest(STOP_INPUT, data, reply, option);
+    /*! Send the one-way requests of the channel through a shared ring instead of binder
+    \n It is negotiated when the channel is bound. The requests keep going through binder if the client can not
+        attach the ring, and the requests with a reply always do.
+    \return true - the client has attached the ring
+    */
+    bool InputDataChannelProxy::OpenSharedRing()
+    {
+        IMSA_HILOGI("InputDataChannelProxy::OpenSharedRing");
+        std::unique_ptr<SharedRing> ring(SharedRing::Create());
+        if (!ring) {
+            return false;
+        }
+        int32_t ret = AttachSharedRing(ring->GetMemFd(), ring->GetReaderFd(), ring->GetWriterFd());
+        if (ret != ErrorCode::NO_ERROR) {
+            IMSA_HILOGE("InputDataChannelProxy::OpenSharedRing client refused the ring: %{public}d", ret);
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(ringLock_);
+        ring_ = std::move(ring);
+        return true;
+    }
+
+    /*! Get the id of the last edit sent to the client
+    \n The input method keeps its copy of the editor text stale until the client reports this id back.
+    */
+    uint64_t InputDataChannelProxy::GetLastEditId() const
+    {
+        return editId_.load();
+    }
+
+    /*! Send a one-way request through the shared ring if there is one, otherwise through binder
+    \n A request which does not fit in the ring waits until the client has handled the ones in the ring, so all
+        the one-way requests are still handled in the order they are sent. It fails if the ring is not drained in
+        time, rather than overtake the requests in the ring.
+    */
+    int32_t InputDataChannelProxy::SendOneWayRequest(uint32_t code, MessageParcel &data)
+    {
+        {
+            std::lock_guard<std::mutex> lock(ringLock_);
+            if (ring_) {
+                if (ring_->Write(code, data, RING_WRITE_TIMEOUT_MS)) {
+                    return NO_ERROR;
+                }
+                if (!ring_->WaitEmpty(RING_WRITE_TIMEOUT_MS)) {
+                    // sending it through binder now could overtake the requests still in the ring
+                    IMSA_HILOGE("InputDataChannelProxy::SendOneWayRequest the ring is not drained, "
+                        "drop request %{public}u", code);
+                    return ErrorCode::ERROR_STATUS_TIMED_OUT;
+                }
+            }
+        }
+        MessageParcel reply;
+        MessageOption option(MessageOption::TF_ASYNC);
+        return Remote()->SendRequest(code, data, reply, option);
     }
 } // namespace MiscServices
 } // namespace OHOS
@@ -24,6 +24,7 @@ namespace MiscServices {
 
     InputDataChannelStub::~InputDataChannelStub()
     {
+        ringReceiver_.reset();
         if (msgHandler) {
             delete msgHandler;
             msgHandler = nullptr;
@@ -33,7 +34,7 @@ namespace MiscServices {
     int32_t InputDataChannelStub::OnRemoteRequest(uint32_t code, MessageParcel &data, MessageParcel &reply,
         MessageOption &option)
     {
-        IMSA_HILOGI("InputDataChannelStub::OnRemoteRequest code = %{public}d", code);
+        IMSA_HILOGD("InputDataChannelStub::OnRemoteRequest code = %{public}d", code);
         auto descriptorToken = data.ReadInterfaceToken();
         if (descriptorToken != GetDescriptor()) {
             return ErrorCode::ERROR_STATUS_UNKNOWN_TRANSACTION;
@@ -41,17 +42,17 @@ namespace MiscServices {
         switch (code) {
             case INSERT_TEXT: {
                 auto text = data.ReadString16();
-                InsertText(text);
+                InsertText(text, data.ReadUint64());
                 break;
             }
             case DELETE_FORWARD: {
                 auto length = data.ReadInt32();
-                DeleteForward(length);
+                DeleteForward(length, data.ReadUint64());
                 break;
             }
             case DELETE_BACKWARD: {
                 auto length = data.ReadInt32();
-                DeleteBackward(length);
+                DeleteBackward(length, data.ReadUint64());
                 break;
             }
             case CLOSE: {
@@ -80,7 +81,8 @@ namespace MiscServices {
             }
             case MOVE_CURSOR: {
                 auto keyCode = data.ReadInt32();
-                MoveCursor(keyCode);
+                MoveCursor(keyCode, data.ReadUint64());
+                break;
             }
             case GET_ENTER_KEY_TYPE: {
                 reply.WriteInt32(GetEnterKeyType());
@@ -94,6 +96,23 @@ namespace MiscServices {
                 StopInput();
                 break;
             }
+            case BATCH_EDIT: {
+                std::vector<EditOperation> operations;
+                if (!EditOperation::ReadBatch(data, operations)) {
+                    return ErrorCode::ERROR_BAD_PARAMETERS;
+                }
+                BatchEdit(operations, data.ReadUint64());
+                break;
+            }
+#ifdef INPUTMETHOD_SHARED_RING_ENABLE
+            case ATTACH_SHARED_RING: {
+                int memFd = data.ReadFileDescriptor();
+                int readerFd = data.ReadFileDescriptor();
+                int writerFd = data.ReadFileDescriptor();
+                reply.WriteInt32(AttachSharedRing(memFd, readerFd, writerFd));
+                break;
+            }
+#endif
             default:
                 return IPCObjectStub::OnRemoteRequest(code, data, reply, option);
         }
@@ -102,13 +121,22 @@ namespace MiscServices {
 
     bool InputDataChannelStub::InsertText(const std::u16string& text)
     {
-        IMSA_HILOGI("InputDataChannelStub::InsertText");
+        return InsertText(text, 0);
+    }
+
+    /*! Pass an edit of the input method to the work thread of the controller
+    \n The edit id goes after the edit in the message. The controller reports the id of the last edit it applied
+        with the text of the editor, 0 - the edit is not from the input method and is not reported.
+    */
+    bool InputDataChannelStub::InsertText(const std::u16string& text, uint64_t editId)
+    {
+        IMSA_HILOGD("InputDataChannelStub::InsertText");
         if (msgHandler) {
-            MessageParcel *parcel = new MessageParcel;
-            parcel->WriteString16(text);
-            Message *msg = new Message(MessageID::MSG_ID_INSERT_CHAR, parcel);
-            msgHandler->SendMessage(msg);
-            IMSA_HILOGI("InputDataChannelStub::InsertText return true");
+            MessagePtr msg = msgHandler->ObtainMessage(MessageID::MSG_ID_INSERT_CHAR);
+            msg->msgContent_->WriteString16(text);
+            msg->msgContent_->WriteUint64(editId);
+            msgHandler->SendMessage(std::move(msg));
+            IMSA_HILOGD("InputDataChannelStub::InsertText return true");
             return true;
         }
         return false;
@@ -116,26 +144,36 @@ namespace MiscServices {
 
     bool InputDataChannelStub::DeleteForward(int32_t length)
     {
-        IMSA_HILOGI("InputDataChannelStub::DeleteForward");
+        return DeleteForward(length, 0);
+    }
+
+    bool InputDataChannelStub::DeleteForward(int32_t length, uint64_t editId)
+    {
+        IMSA_HILOGD("InputDataChannelStub::DeleteForward");
         if (!msgHandler) {
             return false;
         }
-        MessageParcel *parcel = new MessageParcel;
-        parcel->WriteInt32(length);
-        Message *msg = new Message(MessageID::MSG_ID_DELETE_FORWARD, parcel);
-        msgHandler->SendMessage(msg);
+        MessagePtr msg = msgHandler->ObtainMessage(MessageID::MSG_ID_DELETE_FORWARD);
+        msg->msgContent_->WriteInt32(length);
+        msg->msgContent_->WriteUint64(editId);
+        msgHandler->SendMessage(std::move(msg));
 
         return true;
     }
 
     bool InputDataChannelStub::DeleteBackward(int32_t length)
     {
-        IMSA_HILOGI("InputDataChannelStub::DeleteBackward");
+        return DeleteBackward(length, 0);
+    }
+
+    bool InputDataChannelStub::DeleteBackward(int32_t length, uint64_t editId)
+    {
+        IMSA_HILOGD("InputDataChannelStub::DeleteBackward");
         if (msgHandler) {
-            MessageParcel *parcel = new MessageParcel;
-            parcel->WriteInt32(length);
-            Message *msg = new Message(MessageID::MSG_ID_DELETE_BACKWARD, parcel);
-            msgHandler->SendMessage(msg);
+            MessagePtr msg = msgHandler->ObtainMessage(MessageID::MSG_ID_DELETE_BACKWARD);
+            msg->msgContent_->WriteInt32(length);
+            msg->msgContent_->WriteUint64(editId);
+            msgHandler->SendMessage(std::move(msg));
             return true;
         }
         return false;
@@ -147,13 +185,13 @@ namespace MiscServices {
 
     std::u16string InputDataChannelStub::GetTextBeforeCursor(int32_t number)
     {
-        IMSA_HILOGI("InputDataChannelStub::GetTextBeforeCursor");
+        IMSA_HILOGD("InputDataChannelStub::GetTextBeforeCursor");
         return InputMethodController::GetInstance()->GetTextBeforeCursor(number);
     }
 
     std::u16string InputDataChannelStub::GetTextAfterCursor(int32_t number)
     {
-        IMSA_HILOGI("InputDataChannelStub::GetTextAfterCursor");
+        IMSA_HILOGD("InputDataChannelStub::GetTextAfterCursor");
         return InputMethodController::GetInstance()->GetTextAfterCursor(number);
     }
 
@@ -179,33 +217,81 @@ namespace MiscServices {
     {
         IMSA_HILOGI("InputDataChannelStub::SendKeyboardStatus");
         if (msgHandler) {
-            MessageParcel *parcel = new MessageParcel;
-            parcel->WriteInt32(status);
-            Message *msg = new Message(MessageID::MSG_ID_SEND_KEYBOARD_STATUS, parcel);
-            msgHandler->SendMessage(msg);
+            MessagePtr msg = msgHandler->ObtainMessage(MessageID::MSG_ID_SEND_KEYBOARD_STATUS);
+            msg->msgContent_->WriteInt32(status);
+            msgHandler->SendMessage(std::move(msg));
         }
     }
 
     void InputDataChannelStub::SendFunctionKey(int32_t funcKey)
     {
-        IMSA_HILOGI("InputDataChannelStub::SendFunctionKey");
+        IMSA_HILOGD("InputDataChannelStub::SendFunctionKey");
         if (msgHandler) {
-            MessageParcel *parcel = new MessageParcel;
-            parcel->WriteInt32(funcKey);
-            Message *msg = new Message(MessageID::MSG_ID_SEND_FUNCTION_KEY, parcel);
-            msgHandler->SendMessage(msg);
+            MessagePtr msg = msgHandler->ObtainMessage(MessageID::MSG_ID_SEND_FUNCTION_KEY);
+            msg->msgContent_->WriteInt32(funcKey);
+            msgHandler->SendMessage(std::move(msg));
         }
     }
 
     void InputDataChannelStub::MoveCursor(int32_t keyCode)
     {
-        IMSA_HILOGI("InputDataChannelStub::MoveCursor");
+        MoveCursor(keyCode, 0);
+    }
+
+    void InputDataChannelStub::MoveCursor(int32_t keyCode, uint64_t editId)
+    {
+        IMSA_HILOGD("InputDataChannelStub::MoveCursor");
         if (msgHandler) {
-            MessageParcel *parcel = new MessageParcel;
-            parcel->WriteInt32(keyCode);
-            Message *msg = new Message(MessageID::MSG_ID_MOVE_CURSOR, parcel);
-            msgHandler->SendMessage(msg);
+            MessagePtr msg = msgHandler->ObtainMessage(MessageID::MSG_ID_MOVE_CURSOR);
+            msg->msgContent_->WriteInt32(keyCode);
+            msg->msgContent_->WriteUint64(editId);
+            msgHandler->SendMessage(std::move(msg));
+        }
+    }
+
+    bool InputDataChannelStub::BatchEdit(const std::vector<EditOperation>& operations)
+    {
+        return BatchEdit(operations, 0);
+    }
+
+    bool InputDataChannelStub::BatchEdit(const std::vector<EditOperation>& operations, uint64_t editId)
+    {
+        IMSA_HILOGD("InputDataChannelStub::BatchEdit");
+        if (!msgHandler) {
+            return false;
+        }
+        MessagePtr msg = msgHandler->ObtainMessage(MessageID::MSG_ID_BATCH_EDIT);
+        EditOperation::WriteBatch(*msg->msgContent_, operations);
+        msg->msgContent_->WriteUint64(editId);
+        msgHandler->SendMessage(std::move(msg));
+        return true;
+    }
+
+    /*! Receive the one-way requests of the input method from a shared ring as well as from binder
+    \n The requests from the ring are handled on the thread of the ring, the same way as the ones from binder.
+      \param memFd the shared memory of the ring, the channel takes its ownership
+      \param readerFd the doorbell of the reader, the channel takes its ownership
+      \param writerFd the doorbell of the writer, the channel takes its ownership
+      \return ErrorCode::NO_ERROR - the ring replaces the previous one
+    */
+    int32_t InputDataChannelStub::AttachSharedRing(int memFd, int readerFd, int writerFd)
+    {
+        IMSA_HILOGI("InputDataChannelStub::AttachSharedRing");
+        SharedRing *ring = SharedRing::Attach(memFd, readerFd, writerFd);
+        if (!ring) {
+            return ErrorCode::ERROR_BAD_PARAMETERS;
         }
+        auto receiver = std::make_unique<SharedRingReceiver>(ring, [this](uint32_t code, MessageParcel &data) {
+            if (code == ATTACH_SHARED_RING) {
+                return;
+            }
+            MessageParcel reply;
+            MessageOption option(MessageOption::TF_ASYNC);
+            OnRemoteRequest(code, data, reply, option);
+        });
+        std::lock_guard<std::mutex> lock(ringLock_);
+        ringReceiver_ = std::move(receiver);
+        return ErrorCode::NO_ERROR;
     }
 
     void InputDataChannelStub::SetHandler(MessageHandler *handler)
@@ -14,9 +14,12 @@
  */
 
 #include "input_method_controller.h"
-#include "iservice_registry.h"
+#include "editor_text_mirror.h"
+#include "service_locator.h"
 #include "system_ability_definition.h"
 #include "global.h"
+#include "para_handle.h"
+#include "trace_span.h"
 
 namespace OHOS {
 namespace MiscServices {
@@ -53,9 +56,14 @@ using namespace MessageID;
 
     bool InputMethodController::Initialize()
     {
+        int32_t logLevel = ParaHandle::GetLogLevel();
+        if (logLevel) {
+            SetLogLevel(logLevel);
+        }
+        TraceRecorder::Instance()->SetEnabled(ParaHandle::IsTraceEnabled());
         mImms = GetImsaProxy();
 
-        msgHandler = new MessageHandler();
+        msgHandler = new MessageHandler(MessageHandler::QUEUE_MODE_LOCK_FREE);
 
         mClient = new InputClientStub();
         mClient->SetHandler(msgHandler);
@@ -68,21 +76,18 @@ using namespace MessageID;
 
         textListener = nullptr;
         IMSA_HILOGI("InputMethodController::Initialize textListener is nullptr");
-        PrepareInput(0, mClient, mInputDataChannel, mAttribute);
+        // in lazy handshake mode, the client is registered to the service when an editor is attached or shows
+        // the keyboard, so a process which only touches the controller costs the service nothing
+        if (!ParaHandle::IsLazyHandshake()) {
+            PrepareInput(0, mClient, mInputDataChannel, mAttribute);
+        }
         return true;
     }
 
     sptr<InputMethodSystemAbilityProxy> InputMethodController::GetImsaProxy()
     {
         IMSA_HILOGI("InputMethodController::GetImsaProxy");
-        sptr<ISystemAbilityManager> systemAbilityManager =
-            SystemAbilityManagerClient::GetInstance().GetSystemAbilityManager();
-        if (!systemAbilityManager) {
-            IMSA_HILOGI("InputMethodController::GetImsaProxy systemAbilityManager is nullptr");
-            return nullptr;
-        }
-
-        auto systemAbility = systemAbilityManager->GetSystemAbility(INPUT_METHOD_SYSTEM_ABILITY_ID, "");
+        sptr<IRemoteObject> systemAbility = ServiceLocator::GetSystemAbility(INPUT_METHOD_SYSTEM_ABILITY_ID);
         if (!systemAbility) {
             IMSA_HILOGI("InputMethodController::GetImsaProxy systemAbility is nullptr");
             return nullptr;
@@ -100,34 +105,37 @@ using namespace MessageID;
     void InputMethodController::WorkThread()
     {
         while (!stop_) {
-            Message *msg = msgHandler->GetMessage();
+            MessagePtr msg = msgHandler->GetMessage();
             switch (msg->msgId_) {
                 case MSG_ID_INSERT_CHAR: {
                     MessageParcel *data = msg->msgContent_;
                     std::u16string text = data->ReadString16();
-                    IMSA_HILOGI("InputMethodController::WorkThread InsertText");
+                    IMSA_HILOGD("InputMethodController::WorkThread InsertText");
                     if (textListener) {
                         textListener->InsertText(text);
                     }
+                    AckEdit(data->ReadUint64());
                     break;
                 }
 
                 case MSG_ID_DELETE_FORWARD: {
                     MessageParcel *data = msg->msgContent_;
                     int32_t length = data->ReadInt32();
-                    IMSA_HILOGI("InputMethodController::WorkThread DeleteForward");
+                    IMSA_HILOGD("InputMethodController::WorkThread DeleteForward");
                     if (textListener) {
                         textListener->DeleteForward(length);
                     }
+                    AckEdit(data->ReadUint64());
                     break;
                 }
                 case MSG_ID_DELETE_BACKWARD: {
                     MessageParcel *data = msg->msgContent_;
                     int32_t length = data->ReadInt32();
-                    IMSA_HILOGI("InputMethodController::WorkThread DeleteBackward");
+                    IMSA_HILOGD("InputMethodController::WorkThread DeleteBackward");
                     if (textListener) {
                         textListener->DeleteBackward(length);
                     }
+                    AckEdit(data->ReadUint64());
                     break;
                 }
                 case MSG_ID_SET_DISPLAY_MODE: {
@@ -141,6 +149,12 @@ using namespace MessageID;
                     sptr<IRemoteObject> object = data->ReadRemoteObject();
                     if (object) {
                         mAgent = new InputMethodAgentProxy(object);
+                        // the delta sequence is owned by the thread calling OnSelectionChange, which does the
+                        // full sync the new agent needs when it takes the request
+                        resyncRequested_.store(true);
+#ifdef INPUTMETHOD_SHARED_RING_ENABLE
+                        mAgent->OpenSharedRing();
+#endif
                     }
                     break;
                 }
@@ -154,43 +168,85 @@ using namespace MessageID;
                 case MSG_ID_SEND_KEYBOARD_STATUS: {
                     MessageParcel *data = msg->msgContent_;
                     int32_t ret = data->ReadInt32();
-                    KeyboardInfo *info = new KeyboardInfo();
-                    info->SetKeyboardStatus(ret);
+                    KeyboardInfo info;
+                    info.SetKeyboardStatus(ret);
                     IMSA_HILOGI("InputMethodController::WorkThread SendKeyboardInfo");
                     if (textListener) {
-                        textListener->SendKeyboardInfo(*info);
+                        textListener->SendKeyboardInfo(info);
                     }
-                    delete info;
                     break;
                 }
                 case MSG_ID_SEND_FUNCTION_KEY: {
                     MessageParcel *data = msg->msgContent_;
                     int32_t ret = data->ReadInt32();
-                    KeyboardInfo *info = new KeyboardInfo();
-                    info->SetFunctionKey(ret);
+                    KeyboardInfo info;
+                    info.SetFunctionKey(ret);
                     IMSA_HILOGI("InputMethodController::WorkThread SendKeyboardInfo");
                     if (textListener) {
-                        textListener->SendKeyboardInfo(*info);
+                        textListener->SendKeyboardInfo(info);
                     }
-                    delete info;
                     break;
                 }
                 case MSG_ID_MOVE_CURSOR: {
                     MessageParcel *data = msg->msgContent_;
                     int32_t ret = data->ReadInt32();
-                    IMSA_HILOGI("InputMethodController::WorkThread MoveCursor");
+                    IMSA_HILOGD("InputMethodController::WorkThread MoveCursor");
                     if (textListener) {
                         Direction direction = static_cast<Direction>(ret);
                         textListener->MoveCursor(direction);
                     }
+                    AckEdit(data->ReadUint64());
+                    break;
+                }
+                case MSG_ID_BATCH_EDIT: {
+                    MessageParcel *data = msg->msgContent_;
+                    std::vector<EditOperation> operations;
+                    IMSA_HILOGD("InputMethodController::WorkThread BatchEdit");
+                    if (!EditOperation::ReadBatch(*data, operations)) {
+                        break;
+                    }
+                    if (textListener) {
+                        textListener->BatchEdit(operations);
+                    }
+                    AckEdit(data->ReadUint64());
+                    break;
+                }
+                default: {
+                    break;
+                }
+            }
+        }
+    }
+
+    /*! Apply a batch of edits made by the input method
+    \n The default implementation applies the edits one by one. An editor which can apply them at once, without
+        showing the intermediate states, should override it.
+    \param operations the edits in the order they are applied
+    */
+    void OnTextChangedListener::BatchEdit(const std::vector<EditOperation>& operations)
+    {
+        for (const auto &operation : operations) {
+            switch (operation.GetType()) {
+                case EditOperation::INSERT_TEXT: {
+                    InsertText(operation.GetText());
+                    break;
+                }
+                case EditOperation::DELETE_FORWARD: {
+                    DeleteForward(operation.GetValue());
+                    break;
+                }
+                case EditOperation::DELETE_BACKWARD: {
+                    DeleteBackward(operation.GetValue());
+                    break;
+                }
+                case EditOperation::MOVE_CURSOR: {
+                    MoveCursor(static_cast<Direction>(operation.GetValue()));
                     break;
                 }
                 default: {
                     break;
                 }
             }
-            delete msg;
-            msg = nullptr;
         }
     }
 
@@ -205,6 +261,9 @@ using namespace MessageID;
     void InputMethodController::ShowTextInput()
     {
         IMSA_HILOGI("InputMethodController::ShowTextInput");
+        if (!prepared_) {
+            PrepareInput(0, mClient, mInputDataChannel, mAttribute);
+        }
         StartInput(mClient);
     }
 
@@ -230,8 +289,13 @@ using namespace MessageID;
     void InputMethodController::Close()
     {
         ReleaseInput(mClient);
+        prepared_ = false;
         textListener = nullptr;
         IMSA_HILOGI("InputMethodController::Close");
+        TraceRecorder *recorder = TraceRecorder::Instance();
+        if (recorder->IsEnabled() && !recorder->ExportToFile(TraceRecorder::EXPORT_DIR)) {
+            IMSA_HILOGW("InputMethodController::Close failed to export the trace");
+        }
     }
 
     void InputMethodController::PrepareInput(int32_t displayId, sptr<InputClientStub> &client,
@@ -250,6 +314,7 @@ using namespace MessageID;
             return;
         }
         mImms->prepareInput(data);
+        prepared_ = true;
     }
 
     void InputMethodController::DisplayOptionalInputMethod()
@@ -265,10 +330,10 @@ using namespace MessageID;
         mImms->displayOptionalInputMethod(data);
     }
 
-    std::vector<InputMethodProperty*> InputMethodController::ListInputMethod()
+    std::vector<InputMethodPropertyPtr> InputMethodController::ListInputMethod()
     {
         IMSA_HILOGI("InputMethodController::listInputMethod");
-        std::vector<InputMethodProperty*> properties;
+        std::vector<InputMethodPropertyPtr> properties;
         if (!mImms) {
             return properties;
         }
@@ -282,9 +347,14 @@ using namespace MessageID;
         if (!mImms) {
             return;
         }
+        // the trace follows this request through IMSA and the IME until the keyboard is shown
+        uint64_t traceId = TraceRecorder::Instance()->IsEnabled() ? TraceRecorder::NewTraceId() : 0;
+        TraceSpan span(traceId, "IMC::StartInput");
         MessageParcel data;
         if (!(data.WriteInterfaceToken(mImms->GetDescriptor())
-            && data.WriteRemoteObject(client->AsObject()))) {
+            && data.WriteRemoteObject(client->AsObject())
+            && data.WriteUint64(traceId)
+            && data.WriteInt64(TraceRecorder::NowNs()))) {
             return;
         }
         mImms->startInput(data);
@@ -320,6 +390,8 @@ using namespace MessageID;
 
     void InputMethodController::OnRemoteSaDied(const wptr<IRemoteObject> &remote)
     {
+        // the restarted service doesn't know the client, it's registered again on the next show
+        prepared_ = false;
         mImms = GetImsaProxy();
     }
 
@@ -352,7 +424,11 @@ using namespace MessageID;
         if (mTextString == text && mSelectNewBegin == start && mSelectNewEnd == end) {
             return;
         }
-        IMSA_HILOGI("InputMethodController::OnSelectionChange");
+        IMSA_HILOGD("InputMethodController::OnSelectionChange");
+        // the input method gets only the changed part of the text, with the whole text once in a while
+        bool fullSync = resyncRequested_.exchange(false) || textSequence_ == 0 ||
+            deltasSinceSync_ >= TextDelta::RESYNC_INTERVAL;
+        TextDelta delta = fullSync ? TextDelta::FullSync(text) : TextDelta::Diff(mTextString, text);
         mTextString = text;
         mSelectOldBegin = mSelectNewBegin;
         mSelectOldEnd = mSelectNewEnd;
@@ -360,9 +436,26 @@ using namespace MessageID;
         mSelectNewEnd = end;
         if (!mAgent) {
             IMSA_HILOGI("InputMethodController::OnSelectionChange mAgent is nullptr");
+            textSequence_ = 0;
             return;
         }
-        mAgent->OnSelectionChange(mTextString, mSelectOldBegin, mSelectOldEnd, mSelectNewBegin, mSelectNewEnd);
+        delta.SetSequence(++textSequence_);
+        delta.SetAckedEdit(ackedEdit_.load());
+        delta.SetSelection(mSelectOldBegin, mSelectOldEnd, mSelectNewBegin, mSelectNewEnd);
+        deltasSinceSync_ = fullSync ? 0 : deltasSinceSync_ + 1;
+        mAgent->OnTextDelta(delta);
+    }
+
+    /*! Record the last edit of the input method which is applied to the editor
+    \n The edits are applied in the order the input method sends them, so the id of the last one tells the input
+        method whether the text it gets with the next selection change has all its edits.
+      \param editId the id the input method sent with the edit, 0 - the edit is not from the input method
+    */
+    void InputMethodController::AckEdit(uint64_t editId)
+    {
+        if (editId != 0) {
+            ackedEdit_.store(editId);
+        }
     }
 
     void InputMethodController::OnConfigurationChange(Configuration info)
@@ -374,27 +467,19 @@ using namespace MessageID;
 
     std::u16string InputMethodController::GetTextBeforeCursor(int32_t number)
     {
-        IMSA_HILOGI("InputMethodController::GetTextBeforeCursor");
-        if (!mTextString.empty()) {
-            int32_t startPos = (mSelectNewBegin >= number ? (mSelectNewBegin - number + 1) : 0);
-            return mTextString.substr(startPos, mSelectNewBegin);
-        }
-        return u"";
+        IMSA_HILOGD("InputMethodController::GetTextBeforeCursor");
+        return EditorTextMirror::GetTextBefore(mTextString, mSelectNewBegin, number);
     }
 
     std::u16string InputMethodController::GetTextAfterCursor(int32_t number)
     {
-        IMSA_HILOGI("InputMethodController::GetTextBeforeCursor");
-        if (!mTextString.empty()) {
-            int32_t endPos = (mSelectNewEnd+number<mTextString.size()) ? (mSelectNewEnd + number) : mTextString.size();
-            return mTextString.substr(mSelectNewEnd, endPos);
-        }
-        return u"";
+        IMSA_HILOGD("InputMethodController::GetTextAfterCursor");
+        return EditorTextMirror::GetTextAfter(mTextString, mSelectNewEnd, number);
     }
 
     bool InputMethodController::dispatchKeyEvent(std::shared_ptr<MMI::KeyEvent> keyEvent)
     {
-        IMSA_HILOGI("InputMethodController::dispatchKeyEvent");
+        IMSA_HILOGD("InputMethodController::dispatchKeyEvent");
         if (!mAgent) {
             IMSA_HILOGI("InputMethodController::dispatchKeyEvent mAgent is nullptr");
             return false;
@@ -338,7 +338,7 @@ namespace MiscServices {
         return NO_ERROR;
     }
 
-    int32_t InputMethodSystemAbilityProxy::listInputMethodEnabled(std::vector<InputMethodProperty*> *properties)
+    int32_t InputMethodSystemAbilityProxy::listInputMethodEnabled(std::vector<InputMethodPropertyPtr> *properties)
     {
         if (!properties) {
             return ERROR_NULL_POINTER;
@@ -361,17 +361,13 @@ namespace MiscServices {
             return ret;
         }
 
-        auto size = reply.ReadInt32();
-        while (size > 0) {
-            InputMethodProperty *imp = reply.ReadParcelable<InputMethodProperty>();
-            properties->push_back(imp);
-            size--;
+        if (!InputMethodProperty::UnmarshallingList(reply, properties)) {
+            return ERROR_EX_PARCELABLE;
         }
-
         return NO_ERROR;
     }
 
-    int32_t InputMethodSystemAbilityProxy::listInputMethod(std::vector<InputMethodProperty*> *properties)
+    int32_t InputMethodSystemAbilityProxy::listInputMethod(std::vector<InputMethodPropertyPtr> *properties)
     {
         if (!properties) {
             return ERROR_NULL_POINTER;
@@ -394,19 +390,14 @@ namespace MiscServices {
             return ret;
         }
 
-        auto size = reply.ReadInt32();
-
-        while (size > 0) {
-            InputMethodProperty *imp = reply.ReadParcelable<InputMethodProperty>();
-            properties->push_back(imp);
-            size--;
+        if (!InputMethodProperty::UnmarshallingList(reply, properties)) {
+            return ERROR_EX_PARCELABLE;
         }
-
         return NO_ERROR;
     }
 
     int32_t InputMethodSystemAbilityProxy::listKeyboardType(const std::u16string& imeId,
-        std::vector<KeyboardType*> *types)
+        std::vector<KeyboardTypePtr> *types)
     {
         if (!types) {
             return ERROR_NULL_POINTER;
@@ -429,11 +420,8 @@ namespace MiscServices {
             return ret;
         }
 
-        auto size = reply.ReadInt32();
-        while (size > 0) {
-            KeyboardType *kt = reply.ReadParcelable<KeyboardType>();
-            types->push_back(kt);
-            size--;
+        if (!KeyboardType::UnmarshallingList(reply, types)) {
+            return ERROR_EX_PARCELABLE;
         }
         return NO_ERROR;
     }
@@ -91,6 +91,20 @@ declare namespace inputMethodEngine {
 
         getEditorAttribute(lcallback: AsyncCallback<EditorAttribute>): void;
         getEditorAttribute(): Promise<EditorAttribute>;
+
+        batchEdit(operations: Array<EditOperation>, callback: AsyncCallback<boolean>): void;
+        batchEdit(operations: Array<EditOperation>): Promise<boolean>;
+    }
+
+    /**
+     * An edit of TextInputClient.batchEdit.
+     * type: 0 - insert text, 1 - delete forward, 2 - delete backward, 3 - move cursor
+     */
+    interface EditOperation {
+        type: number;
+        text?: string;
+        length?: number;
+        direction?: number;
     }
 
     interface KeyboardDelegate {
@@ -63,7 +63,7 @@ namespace MiscServices {
             return engine.CreateUndefined();
         }
 
-        std::vector<InputMethodProperty*> properties = InputMethodController::GetInstance()->ListInputMethod();
+        std::vector<InputMethodPropertyPtr> properties = InputMethodController::GetInstance()->ListInputMethod();
         if (!properties.size()) {
             IMSA_HILOGI("JsInputMethodSetting::ListInputMethod has no ime");
             return engine.CreateUndefined();
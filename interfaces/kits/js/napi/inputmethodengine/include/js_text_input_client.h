@@ -18,6 +18,7 @@
 #include "native_engine/native_engine.h"
 #include "native_engine/native_value.h"
 #include "js_runtime_utils.h"
+#include "edit_operation.h"
 namespace OHOS {
     namespace MiscServices {
         class JsTextInputClient {
@@ -32,6 +33,7 @@ namespace OHOS {
             static NativeValue* GetForward(NativeEngine* engine, NativeCallbackInfo* info);
             static NativeValue* GetBackward(NativeEngine* engine, NativeCallbackInfo* info);
             static NativeValue* GetEditorAttribute(NativeEngine* engine, NativeCallbackInfo* info);
+            static NativeValue* BatchEdit(NativeEngine* engine, NativeCallbackInfo* info);
 
         private:
             NativeValue* OnInsertText(NativeEngine& engine, NativeCallbackInfo& info);
@@ -41,6 +43,8 @@ namespace OHOS {
             NativeValue* OnGetForward(NativeEngine& engine, NativeCallbackInfo& info);
             NativeValue* OnGetBackward(NativeEngine& engine, NativeCallbackInfo& info);
             NativeValue* OnGetEditorAttribute(NativeEngine& engine, NativeCallbackInfo& info);
+            NativeValue* OnBatchEdit(NativeEngine& engine, NativeCallbackInfo& info);
+            bool ConvertEditOperation(NativeEngine& engine, NativeValue* value, EditOperation& operation);
         };
     } // namespace MiscServices
 } // namespace OHOS
@@ -105,7 +105,7 @@ namespace MiscServices {
 
     void JsInputMethodEngineListener::CallJsMethod(std::string methodName, NativeValue* const* argv, size_t argc)
     {
-        IMSA_HILOGI("JsInputMethodEngineListener::CallJsMethod");
+        IMSA_HILOGD("JsInputMethodEngineListener::CallJsMethod");
         if (!engine_) {
             IMSA_HILOGI("engine_ nullptr");
             return;
@@ -124,7 +124,7 @@ namespace MiscServices {
     bool JsInputMethodEngineListener::CallJsMethodReturnBool(std::string methodName,
                                                              NativeValue* const* argv, size_t argc)
     {
-        IMSA_HILOGI("JsInputMethodEngineListener::CallJsMethodReturnBool");
+        IMSA_HILOGD("JsInputMethodEngineListener::CallJsMethodReturnBool");
         if (!engine_) {
             IMSA_HILOGI("engine_ nullptr");
             return false;
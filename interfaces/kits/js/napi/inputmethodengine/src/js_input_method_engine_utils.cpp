@@ -83,6 +83,7 @@ namespace OHOS {
             BindNativeFunction(engine, *object, "getForward", JsTextInputClient::GetForward);
             BindNativeFunction(engine, *object, "getBackward", JsTextInputClient::GetBackward);
             BindNativeFunction(engine, *object, "getEditorAttribute", JsTextInputClient::GetEditorAttribute);
+            BindNativeFunction(engine, *object, "batchEdit", JsTextInputClient::BatchEdit);
             return objValue;
         }
 
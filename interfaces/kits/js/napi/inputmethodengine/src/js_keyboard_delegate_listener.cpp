@@ -101,9 +101,16 @@ namespace MiscServices {
         return false;
     }
 
+    bool JsKeyboardDelegateListener::IsListenerRegistered(std::string type)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto iter = jsCbMap_.find(type);
+        return iter != jsCbMap_.end() && !iter->second.empty();
+    }
+
     void JsKeyboardDelegateListener::CallJsMethod(std::string methodName, NativeValue* const* argv, size_t argc)
     {
-        IMSA_HILOGI("JsKeyboardDelegateListener::CallJsMethod");
+        IMSA_HILOGD("JsKeyboardDelegateListener::CallJsMethod");
         if (!engine_) {
             IMSA_HILOGI("engine_ nullptr");
             return;
@@ -122,7 +129,7 @@ namespace MiscServices {
     bool JsKeyboardDelegateListener::CallJsMethodReturnBool(std::string methodName,
         NativeValue* const* argv, size_t argc)
     {
-        IMSA_HILOGI("JsKeyboardDelegateListener::CallJsMethodReturnBool");
+        IMSA_HILOGD("JsKeyboardDelegateListener::CallJsMethodReturnBool");
         if (!engine_) {
             IMSA_HILOGI("engine_ nullptr");
             return false;
@@ -147,7 +154,7 @@ namespace MiscServices {
     bool JsKeyboardDelegateListener::OnKeyEvent(int32_t keyCode, int32_t keyStatus)
     {
         std::lock_guard<std::mutex> lock(mMutex);
-        IMSA_HILOGI("JsKeyboardDelegateListener::OnKeyEvent");
+        IMSA_HILOGD("JsKeyboardDelegateListener::OnKeyEvent");
 
         auto result = false;
         auto task = [this, keyCode, keyStatus, &result] () {
@@ -176,7 +183,7 @@ namespace MiscServices {
     void JsKeyboardDelegateListener::OnCursorUpdate(int32_t positionX, int32_t positionY, int height)
     {
         std::lock_guard<std::mutex> lock(mMutex);
-        IMSA_HILOGI("JsKeyboardDelegateListener::OnCursorUpdate");
+        IMSA_HILOGD("JsKeyboardDelegateListener::OnCursorUpdate");
 
         auto task = [this, positionX, positionY, height] () {
             NativeValue* nativeXValue = CreateJsValue(*engine_, static_cast<uint32_t>(positionX));
@@ -193,7 +200,7 @@ namespace MiscServices {
     void JsKeyboardDelegateListener::OnSelectionChange(int32_t oldBegin, int32_t oldEnd, int32_t newBegin, int32_t newEnd)
     {
         std::lock_guard<std::mutex> lock(mMutex);
-        IMSA_HILOGI("JsKeyboardDelegateListener::OnSelectionChange");
+        IMSA_HILOGD("JsKeyboardDelegateListener::OnSelectionChange");
 
         auto task = [this, oldBegin, oldEnd, newBegin, newEnd] () {
             NativeValue* nativeOBValue = CreateJsValue(*engine_, static_cast<uint32_t>(oldBegin));
@@ -212,7 +219,7 @@ namespace MiscServices {
     void JsKeyboardDelegateListener::OnTextChange(std::string text)
     {
         std::lock_guard<std::mutex> lock(mMutex);
-        IMSA_HILOGI("JsKeyboardDelegateListener::OnTextChange");
+        IMSA_HILOGD("JsKeyboardDelegateListener::OnTextChange");
         auto task = [this, text] () {
             NativeValue* nativeValue = CreateJsValue(*engine_, text);
 
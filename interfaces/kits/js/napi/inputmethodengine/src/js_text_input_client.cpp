@@ -75,9 +75,15 @@ namespace MiscServices {
         return (me) ? me->OnGetEditorAttribute(*engine, *info) : nullptr;
     }
 
+    NativeValue* JsTextInputClient::BatchEdit(NativeEngine* engine, NativeCallbackInfo* info)
+    {
+        JsTextInputClient* me = CheckParamsAndGetThis<JsTextInputClient>(engine, info);
+        return (me) ? me->OnBatchEdit(*engine, *info) : nullptr;
+    }
+
     NativeValue* JsTextInputClient::OnInsertText(NativeEngine& engine, NativeCallbackInfo& info)
     {
-        IMSA_HILOGI("JsTextInputClient::OnInsertText is called!");
+        IMSA_HILOGD("JsTextInputClient::OnInsertText is called!");
         if (info.argc < ARGC_ONE) {
             IMSA_HILOGI("JsTextInputClient::OnInsertText has no params!");
             return engine.CreateUndefined();
@@ -101,7 +107,7 @@ namespace MiscServices {
 
     NativeValue* JsTextInputClient::OnDeleteForward(NativeEngine& engine, NativeCallbackInfo& info)
     {
-        IMSA_HILOGI("JsTextInputClient::OnDeleteForward is called!");
+        IMSA_HILOGD("JsTextInputClient::OnDeleteForward is called!");
         if (info.argc < ARGC_ONE) {
             IMSA_HILOGI("JsTextInputClient::OnDeleteForward has no params!");
             return engine.CreateUndefined();
@@ -125,7 +131,7 @@ namespace MiscServices {
 
     NativeValue* JsTextInputClient::OnDeleteBackward(NativeEngine& engine, NativeCallbackInfo& info)
     {
-        IMSA_HILOGI("JsTextInputClient::OnDeleteBackward is called!");
+        IMSA_HILOGD("JsTextInputClient::OnDeleteBackward is called!");
         if (info.argc < ARGC_ONE) {
             IMSA_HILOGI("JsTextInputClient::OnDeleteBackward has no params!");
             return engine.CreateUndefined();
@@ -149,7 +155,7 @@ namespace MiscServices {
 
     NativeValue* JsTextInputClient::OnSendFunctionKey(NativeEngine& engine, NativeCallbackInfo& info)
     {
-        IMSA_HILOGI("JsTextInputClient::OnSendFunctionKey is called!");
+        IMSA_HILOGD("JsTextInputClient::OnSendFunctionKey is called!");
         if (info.argc < ARGC_ONE) {
             IMSA_HILOGI("JsTextInputClient::OnSendFunctionKey has no params!");
             return engine.CreateUndefined();
@@ -173,7 +179,7 @@ namespace MiscServices {
 
     NativeValue* JsTextInputClient::OnGetForward(NativeEngine& engine, NativeCallbackInfo& info)
     {
-        IMSA_HILOGI("JsTextInputClient::OnGetForward is called!");
+        IMSA_HILOGD("JsTextInputClient::OnGetForward is called!");
         if (info.argc != ARGC_ONE) {
             IMSA_HILOGI("JsTextInputClient::OnGetForward has not one params!");
             return engine.CreateUndefined();
@@ -197,7 +203,7 @@ namespace MiscServices {
 
     NativeValue* JsTextInputClient::OnGetBackward(NativeEngine& engine, NativeCallbackInfo& info)
     {
-        IMSA_HILOGI("JsTextInputClient::OnGetBackward is called!");
+        IMSA_HILOGD("JsTextInputClient::OnGetBackward is called!");
         if (info.argc != ARGC_ONE) {
             IMSA_HILOGI("JsTextInputClient::OnGetBackward has not one params!");
             return engine.CreateUndefined();
@@ -229,5 +235,78 @@ namespace MiscServices {
 
         return CreateEditorAttribute(engine);
     }
+
+    NativeValue* JsTextInputClient::OnBatchEdit(NativeEngine& engine, NativeCallbackInfo& info)
+    {
+        IMSA_HILOGD("JsTextInputClient::OnBatchEdit is called!");
+        if (info.argc < ARGC_ONE) {
+            IMSA_HILOGI("JsTextInputClient::OnBatchEdit has no params!");
+            return engine.CreateUndefined();
+        }
+
+        NativeArray* nativeArray = ConvertNativeValueTo<NativeArray>(info.argv[ARGC_ZERO]);
+        if (!nativeArray || nativeArray->GetLength() > EditOperation::MAX_BATCH_SIZE) {
+            IMSA_HILOGI("JsTextInputClient::OnBatchEdit Failed to convert parameter to array");
+            return engine.CreateUndefined();
+        }
+
+        std::vector<EditOperation> operations(nativeArray->GetLength());
+        for (uint32_t i = 0; i < nativeArray->GetLength(); i++) {
+            if (!ConvertEditOperation(engine, nativeArray->GetElement(i), operations[i])) {
+                IMSA_HILOGI("JsTextInputClient::OnBatchEdit Failed to convert edit %{public}u", i);
+                return engine.CreateUndefined();
+            }
+        }
+
+        bool ret = InputMethodAbility::GetInstance()->BatchEdit(operations);
+
+        NativeValue* result = CreateJsValue(engine, ret);
+
+        return result;
+    }
+
+    /*! Convert an edit of batchEdit, e.g. { type: 0, text: "abc" }, { type: 2, length: 5 } or { type: 3, direction: 4 }
+    */
+    bool JsTextInputClient::ConvertEditOperation(NativeEngine& engine, NativeValue* value, EditOperation& operation)
+    {
+        NativeObject* object = ConvertNativeValueTo<NativeObject>(value);
+        if (!object) {
+            return false;
+        }
+
+        int32_t type;
+        if (!ConvertFromJsValue(engine, object->GetProperty("type"), type)) {
+            return false;
+        }
+
+        std::string text;
+        int32_t number = 0;
+        switch (type) {
+            case EditOperation::INSERT_TEXT: {
+                if (!ConvertFromJsValue(engine, object->GetProperty("text"), text)) {
+                    return false;
+                }
+                break;
+            }
+            case EditOperation::DELETE_FORWARD:
+            case EditOperation::DELETE_BACKWARD: {
+                if (!ConvertFromJsValue(engine, object->GetProperty("length"), number)) {
+                    return false;
+                }
+                break;
+            }
+            case EditOperation::MOVE_CURSOR: {
+                if (!ConvertFromJsValue(engine, object->GetProperty("direction"), number)) {
+                    return false;
+                }
+                break;
+            }
+            default: {
+                return false;
+            }
+        }
+        operation = EditOperation(type, Str8ToStr16(text), number);
+        return true;
+    }
 } // namespace MiscServices
 } // namespace OHOS
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file client_registry.h */
+#ifndef SERVICES_INCLUDE_CLIENT_REGISTRY_H
+#define SERVICES_INCLUDE_CLIENT_REGISTRY_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "iremote_object.h"
+#include "i_input_client.h"
+#include "i_input_data_channel.h"
+#include "i_input_method_agent.h"
+#include "input_attribute.h"
+
+namespace OHOS {
+namespace MiscServices {
+    /*! \class ClientInfo
+    \brief The class defines the details of an input client.
+    */
+    class ClientInfo {
+    public:
+        int pid; // the process id of the process in which the input client is running
+        int uid; // the uid of the process in which the input client is running
+        int userId; // the user if of the user under which the input client is running
+        int displayId; // the display id on which the input client is showing
+        sptr<IInputClient> client; // the remote object handler for the service to callback to the input client
+        sptr<IInputDataChannel> channel; // the remote object handler for IMSA callback to input client
+        InputAttribute attribute; // the input attribute of the input client
+        sptr<IInputMethodAgent> agent; // the agent last sent to the input client, accessed in the work thread only
+
+        ClientInfo(int pid, int uid, int userId, int displayId, const sptr<IInputClient>& client,
+                   const sptr<IInputDataChannel>& channel, const InputAttribute& attribute)
+        {
+            this->pid = pid;
+            this->uid = uid;
+            this->userId = userId;
+            this->displayId = displayId;
+            this->client = client;
+            this->channel = channel;
+            this->attribute = attribute;
+        };
+
+        ~ClientInfo()
+        {
+            this->client = nullptr;
+            this->channel = nullptr;
+            this->agent = nullptr;
+        };
+    };
+
+    /*! \class ClientRegistry
+    \brief The input clients of a user, indexed by remote object and pid.
+
+    \n Lookups are hashed, so their cost doesn't grow with the number of windows attached.
+    \n A ClientInfo is handed out as a shared_ptr, it stays valid for the holder after the client is removed.
+    \n The whole list is published as an immutable snapshot, rebuilt on the first read after a change,
+        so a broadcast iterates it without lock while clients come and go.
+    */
+    class ClientRegistry {
+    public:
+        using ClientList = std::vector<std::shared_ptr<ClientInfo>>;
+
+        ClientRegistry();
+        ~ClientRegistry();
+        bool Add(const sptr<IRemoteObject>& object, const std::shared_ptr<ClientInfo>& info);
+        std::shared_ptr<ClientInfo> Remove(const sptr<IRemoteObject>& object);
+        std::shared_ptr<ClientInfo> Find(const sptr<IRemoteObject>& object) const;
+        ClientList FindByPid(int pid) const;
+        std::shared_ptr<const ClientList> GetAll() const;
+        int32_t GetCount(bool securityFlag) const;
+        int32_t GetSize() const;
+        ClientList Clear();
+
+    private:
+        struct Entry {
+            sptr<IRemoteObject> object; // keeps the key alive while the client is registered
+            std::shared_ptr<ClientInfo> info;
+        };
+
+        static void AddToIndex(std::unordered_map<int, ClientList>& index, int key,
+                               const std::shared_ptr<ClientInfo>& info);
+        static void RemoveFromIndex(std::unordered_map<int, ClientList>& index, int key,
+                                    const std::shared_ptr<ClientInfo>& info);
+
+        mutable std::mutex lock_;
+        std::unordered_map<IRemoteObject *, Entry> clients_;
+        std::unordered_map<int, ClientList> pidIndex_;
+        int32_t securityCount_ = 0; // the number of clients with the security flag
+        mutable std::shared_ptr<const ClientList> snapshot_; // null when the clients are changed since it was built
+
+        ClientRegistry(const ClientRegistry&);
+        ClientRegistry& operator =(const ClientRegistry&);
+        ClientRegistry(const ClientRegistry&&);
+        ClientRegistry& operator =(const ClientRegistry&&);
+    };
+} // namespace MiscServices
+} // namespace OHOS
+#endif // SERVICES_INCLUDE_CLIENT_REGISTRY_H
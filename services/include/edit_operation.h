@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SERVICES_INCLUDE_EDIT_OPERATION_H
+#define SERVICES_INCLUDE_EDIT_OPERATION_H
+
+#include <string>
+#include <vector>
+#include "parcel.h"
+
+namespace OHOS {
+namespace MiscServices {
+    /*! An edit made by the input method, one step of IInputDataChannel::BatchEdit
+    */
+    class EditOperation : public Parcelable {
+    public:
+        enum EditType {
+            INSERT_TEXT = 0, // insert text at the cursor
+            DELETE_FORWARD, // delete value characters after the cursor
+            DELETE_BACKWARD, // delete value characters before the cursor
+            MOVE_CURSOR, // move the cursor to the direction value
+            EDIT_TYPE_COUNT,
+        };
+        static const uint32_t MAX_BATCH_SIZE = 256;
+
+        EditOperation();
+        EditOperation(int32_t type, const std::u16string& text, int32_t value);
+        EditOperation(const EditOperation& operation);
+        EditOperation& operator =(const EditOperation& operation);
+        ~EditOperation();
+        bool Marshalling(Parcel &parcel) const override;
+        static EditOperation *Unmarshalling(Parcel &parcel);
+        static bool WriteBatch(Parcel &parcel, const std::vector<EditOperation>& operations);
+        static bool ReadBatch(Parcel &parcel, std::vector<EditOperation>& operations);
+        int32_t GetType() const;
+        std::u16string GetText() const;
+        int32_t GetValue() const;
+
+    private:
+        int32_t mType;
+        std::u16string mText;
+        int32_t mValue;
+
+        bool ReadFromParcel(Parcel &parcel);
+    };
+} // namespace MiscServices
+} // namespace OHOS
+#endif // SERVICES_INCLUDE_EDIT_OPERATION_H
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SERVICES_INCLUDE_EDITOR_TEXT_MIRROR_H
+#define SERVICES_INCLUDE_EDITOR_TEXT_MIRROR_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include "text_delta.h"
+#include "text_gap_buffer.h"
+
+namespace OHOS {
+namespace MiscServices {
+    /*! A local copy of the text and the selection of the editor.
+      \n The input method updates it on every selection change from the editor, and serves the surrounding text
+      \n queries from it as long as the editor has applied every edit sent to it. Each edit is tagged with an id,
+      \n and the editor reports the id of the last edit it applied with its text, so an update which is built
+      \n before an edit reaches the editor does not make the mirror fresh.
+      \n The text is kept in a gap buffer, so an incremental TextDelta is applied in the time of its own length.
+    */
+    class EditorTextMirror {
+    public:
+        EditorTextMirror();
+        ~EditorTextMirror();
+        void Update(const std::u16string& text, int32_t selectionBegin, int32_t selectionEnd);
+        bool ApplyDelta(const TextDelta& delta);
+        void Invalidate(uint64_t editId);
+        void Reset();
+        bool IsFresh() const;
+        uint64_t GetPendingEdit() const;
+        uint64_t GetSequence() const;
+        std::u16string GetText() const;
+        bool GetTextBeforeCursor(int32_t number, std::u16string& text) const;
+        bool GetTextAfterCursor(int32_t number, std::u16string& text) const;
+        static std::u16string GetTextBefore(const std::u16string& text, int32_t cursor, int32_t number);
+        static std::u16string GetTextAfter(const std::u16string& text, int32_t cursor, int32_t number);
+
+    private:
+        mutable std::mutex mutex_;
+        TextGapBuffer text_;
+        int32_t selectionBegin_;
+        int32_t selectionEnd_;
+        uint64_t pendingEdit_; // the id of the last edit sent to the editor, 0 - the editor has applied all of them
+        uint64_t sequence_; // the sequence number of the last applied delta
+        bool fresh_; // false - no update yet, or an edit has been sent after the last update
+        bool synced_; // true - the text is the one the last delta was built on, so the next delta can be applied
+
+        EditorTextMirror(const EditorTextMirror&);
+        EditorTextMirror& operator =(const EditorTextMirror&);
+    };
+} // namespace MiscServices
+} // namespace OHOS
+#endif // SERVICES_INCLUDE_EDITOR_TEXT_MIRROR_H
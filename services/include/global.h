@@ -16,6 +16,7 @@
 #ifndef SERVICES_INCLUDE_GLOBAL_H
 #define SERVICES_INCLUDE_GLOBAL_H
 
+#include <atomic>
 #include <errno.h>
 #include <time.h>
 #include <sys/time.h>
@@ -153,16 +154,48 @@ static constexpr HiviewDFX::HiLogLabel g_SMALL_SERVICES_LABEL = {
     "ImsaKit"
 };
 
-#define IMSA_HILOGD(fmt, ...) (void)OHOS::HiviewDFX::HiLog::Debug(OHOS::MiscServices::g_SMALL_SERVICES_LABEL, \
-    "line: %d, function: %s," fmt, __LINE__, __FUNCTION__, ##__VA_ARGS__)
-#define IMSA_HILOGE(fmt, ...) (void)OHOS::HiviewDFX::HiLog::Error(OHOS::MiscServices::g_SMALL_SERVICES_LABEL, \
-    "line: %d, function: %s," fmt, __LINE__, __FUNCTION__, ##__VA_ARGS__)
-#define IMSA_HILOGF(fmt, ...) (void)OHOS::HiviewDFX::HiLog::Fatal(OHOS::MiscServices::g_SMALL_SERVICES_LABEL, \
-    "line: %d, function: %s," fmt, __LINE__FILE__, __FUNCTION__, ##__VA_ARGS__)
-#define IMSA_HILOGI(fmt, ...) (void)OHOS::HiviewDFX::HiLog::Info(OHOS::MiscServices::g_SMALL_SERVICES_LABEL, \
-    "line: %d, function: %s," fmt, __LINE__, __FUNCTION__, ##__VA_ARGS__)
-#define IMSA_HILOGW(fmt, ...) (void)OHOS::HiviewDFX::HiLog::Warn(OHOS::MiscServices::g_SMALL_SERVICES_LABEL, \
-    "line: %d, function: %s," fmt, __LINE__, __FUNCTION__, ##__VA_ARGS__)
+// the log levels, with the values of the hilog ones
+#define IMSA_LOG_LEVEL_DEBUG 3
+#define IMSA_LOG_LEVEL_INFO 4
+#define IMSA_LOG_LEVEL_WARN 5
+#define IMSA_LOG_LEVEL_ERROR 6
+#define IMSA_LOG_LEVEL_FATAL 7
+
+// The logs below this level are compiled out, their arguments are never evaluated.
+// It's set by the gn arg inputmethod_log_level_min.
+#ifndef IMSA_LOG_LEVEL_MIN
+#define IMSA_LOG_LEVEL_MIN IMSA_LOG_LEVEL_DEBUG
+#endif
+
+/*! The logs below this level are skipped at runtime by a single branch, before formatting anything */
+inline std::atomic<int32_t> g_logLevel(IMSA_LOG_LEVEL_INFO);
+
+/*! Check if the logs of the given level are enabled at runtime
+\param level one of IMSA_LOG_LEVEL_*
+*/
+inline bool IsLogLevelEnabled(int32_t level)
+{
+    return level >= g_logLevel.load(std::memory_order_relaxed);
+}
+
+/*! Set the minimum runtime log level of this process
+\param level one of IMSA_LOG_LEVEL_*
+*/
+inline void SetLogLevel(int32_t level)
+{
+    g_logLevel.store(level, std::memory_order_relaxed);
+}
+
+#define IMSA_HILOG_LEVEL(level, func, fmt, ...) \
+    ((IMSA_LOG_LEVEL_MIN <= (level) && OHOS::MiscServices::IsLogLevelEnabled(level)) \
+    ? (void)OHOS::HiviewDFX::HiLog::func(OHOS::MiscServices::g_SMALL_SERVICES_LABEL, \
+    "line: %d, function: %s," fmt, __LINE__, __FUNCTION__, ##__VA_ARGS__) : (void)0)
+
+#define IMSA_HILOGD(fmt, ...) IMSA_HILOG_LEVEL(IMSA_LOG_LEVEL_DEBUG, Debug, fmt, ##__VA_ARGS__)
+#define IMSA_HILOGE(fmt, ...) IMSA_HILOG_LEVEL(IMSA_LOG_LEVEL_ERROR, Error, fmt, ##__VA_ARGS__)
+#define IMSA_HILOGF(fmt, ...) IMSA_HILOG_LEVEL(IMSA_LOG_LEVEL_FATAL, Fatal, fmt, ##__VA_ARGS__)
+#define IMSA_HILOGI(fmt, ...) IMSA_HILOG_LEVEL(IMSA_LOG_LEVEL_INFO, Info, fmt, ##__VA_ARGS__)
+#define IMSA_HILOGW(fmt, ...) IMSA_HILOG_LEVEL(IMSA_LOG_LEVEL_WARN, Warn, fmt, ##__VA_ARGS__)
 }
 }
 #endif // SERVICES_INCLUDE_GLOBAL_H
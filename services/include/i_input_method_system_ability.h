@@ -62,9 +62,9 @@ namespace MiscServices {
         virtual int32_t getDisplayMode(int32_t retMode) = 0;
         virtual int32_t getKeyboardWindowHeight(int32_t retHeight) = 0;
         virtual int32_t getCurrentKeyboardType(KeyboardType *retType) = 0;
-        virtual int32_t listInputMethodEnabled(std::vector<InputMethodProperty*> *properties) = 0;
-        virtual int32_t listInputMethod(std::vector<InputMethodProperty*> *properties) = 0;
-        virtual int32_t listKeyboardType(const std::u16string& imeId, std::vector<KeyboardType*> *types) = 0;
+        virtual int32_t listInputMethodEnabled(std::vector<InputMethodPropertyPtr> *properties) = 0;
+        virtual int32_t listInputMethod(std::vector<InputMethodPropertyPtr> *properties) = 0;
+        virtual int32_t listKeyboardType(const std::u16string& imeId, std::vector<KeyboardTypePtr> *types) = 0;
     };
 } // namespace MiscServices
 } // namespace OHOS
@@ -17,6 +17,8 @@
 #define SERVICES_INCLUDE_IM_COMMON_EVENT_MANAGER_H
 
 #include <mutex>
+#include <string>
+#include <vector>
 #include "common_event_subscriber.h"
 #include "common_event_subscribe_info.h"
 #include "common_event_data.h"
@@ -29,7 +31,7 @@ public:
     ImCommonEventManager();
     ~ImCommonEventManager();
     static sptr<ImCommonEventManager> GetInstance();
-    bool SubscribeEvent(const std::string &event);
+    bool SubscribeEvent(const std::vector<std::string> &events);
     bool UnsubscribeEvent();
 
     class EventSubscriber : public EventFwk::CommonEventSubscriber {
@@ -38,6 +40,8 @@ public:
             : EventFwk::CommonEventSubscriber(subscribeInfo) {}
         void OnReceiveEvent(const EventFwk::CommonEventData &data);
         void startUser(int32_t newUserId);
+        void unlockUser(int32_t userId);
+        void changePackage(int32_t msgId, const EventFwk::CommonEventData &data);
     };
 
 private:
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file ime_launcher.h */
+#ifndef SERVICES_INCLUDE_IME_LAUNCHER_H
+#define SERVICES_INCLUDE_IME_LAUNCHER_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+
+namespace OHOS {
+namespace MiscServices {
+    /*! Start pipeline of the default input method service.
+      \n It tracks the connection of the IME from the ability start until SetCoreAndAgent is received, retries a
+      \n failed start with an exponential backoff and jitter, and measures the time to the first keyboard shown.
+      \n An IME which died is restarted at once, and with the same backoff if it keeps crashing. A launch gives up
+      \n after MAX_START_ATTEMPTS failed starts, e.g. when the bundle of the IME is removed.
+      \n A standby IME is started in a task, and checked by the session after CONNECT_TIMEOUT_MS, then every
+      \n STANDBY_CHECK_MS while it's kept.
+      \n The ability start and the delayed tasks are done through handlers, so it runs on any event loop.
+    */
+    class ImeLauncher : public std::enable_shared_from_this<ImeLauncher> {
+    public:
+        enum ConnectionState {
+            STATE_IDLE = 0, // the IME is not started
+            STATE_STARTING, // the ability start is requested, waiting for SetCoreAndAgent
+            STATE_BACKOFF, // the last start failed, waiting to retry
+            STATE_CONNECTED, // the core and the agent of the IME are received
+        };
+
+        /*! The timings of the last launch */
+        struct LaunchMetrics {
+            std::string imeId;
+            int32_t attempts = 0; // the number of ability starts requested
+            int64_t connectMs = -1; // from the launch to SetCoreAndAgent, -1 if not connected yet
+            int64_t firstKeyboardMs = -1; // from the launch to the first keyboard shown, -1 if not shown yet
+        };
+
+        static constexpr int64_t BASE_RETRY_DELAY_MS = 200;
+        static constexpr int64_t MAX_RETRY_DELAY_MS = 30000;
+        static constexpr int64_t CONNECT_TIMEOUT_MS = 5000;
+        static constexpr int32_t MAX_START_ATTEMPTS = 8; // the backoff spreads the retries over 13 to 26 s
+        static constexpr int64_t STABLE_RUN_MS = 60000; // an IME dying after running this long is not crash looping
+        static constexpr int64_t STANDBY_CHECK_MS = 60000; // the memory of a standby IME is checked this often
+
+        using StartHandler = std::function<bool(const std::string &imeId)>;
+        using ScheduleHandler = std::function<void(std::function<void()> task, int64_t delayMs)>;
+        using StandbyHandler = std::function<void(const std::string &imeId, uint64_t launchId)>;
+
+        ImeLauncher(StartHandler start, ScheduleHandler schedule, StandbyHandler checkStandby = nullptr);
+        ~ImeLauncher();
+
+        bool Launch(const std::string &imeId);
+        int64_t Recover(const std::string &imeId);
+        void OnConnected();
+        void OnDisconnected();
+        void OnKeyboardShown();
+        void OnSwitched(const std::string &imeId);
+        bool StartStandby(const std::string &imeId, uint64_t launchId);
+        void ScheduleStandbyCheck(const std::string &imeId, uint64_t launchId, int64_t delayMs);
+        void Schedule(std::function<void()> task, int64_t delayMs);
+        std::string GetImeId();
+        int32_t GetState();
+        LaunchMetrics GetMetrics();
+        int64_t GetRetryDelay(int32_t attempt);
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        std::mutex launcherLock_;
+        StartHandler start_;
+        ScheduleHandler schedule_;
+        StandbyHandler checkStandby_;
+        int32_t state_ = STATE_IDLE;
+        uint64_t generation_ = 0; // increased on every launch and disconnection, so stale tasks are dropped
+        Clock::time_point launchTime_;
+        LaunchMetrics metrics_;
+        int32_t crashCount_ = 0; // the crashes in a row, each within STABLE_RUN_MS of the previous one
+        Clock::time_point crashTime_;
+        std::minstd_rand random_;
+
+        void TryStart(uint64_t generation);
+        void TryStartStandby(const std::string &imeId, uint64_t launchId);
+        void CheckConnected(uint64_t generation);
+        void ScheduleRetry(uint64_t generation);
+        void ScheduleStart(uint64_t generation, int64_t delayMs);
+        int64_t ElapsedMs() const;
+
+        ImeLauncher(const ImeLauncher&);
+        ImeLauncher& operator =(const ImeLauncher&);
+        ImeLauncher(const ImeLauncher&&);
+        ImeLauncher& operator =(const ImeLauncher&&);
+    };
+} // namespace MiscServices
+} // namespace OHOS
+#endif // SERVICES_INCLUDE_IME_LAUNCHER_H
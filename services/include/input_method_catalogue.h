@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file input_method_catalogue.h */
+#ifndef SERVICES_INCLUDE_INPUT_METHOD_CATALOGUE_H
+#define SERVICES_INCLUDE_INPUT_METHOD_CATALOGUE_H
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "input_method_property.h"
+
+namespace OHOS {
+namespace MiscServices {
+    /*! A per-user cache of the IME extensions installed in the system.
+      \n The list is built from the bundle manager the first time it's asked for, and handed out as shared
+      \n snapshots until a package is added or removed for that user. The label and description of an
+      \n extension are resolved from its resources only once for a given bundle version.
+    */
+    class InputMethodCatalogue {
+    public:
+        /*! An IME extension ability as reported by the bundle manager */
+        struct Extension {
+            std::string bundleName;
+            std::string abilityName;
+            uint32_t versionCode = 0;
+            int32_t labelId = 0;
+            int32_t descriptionId = 0;
+            std::string resourcePath;
+        };
+
+        /*! The strings of an extension resolved from its resources */
+        struct Resources {
+            std::string label;
+            std::string description;
+        };
+
+        using QueryHandler = std::function<bool(int32_t userId, std::vector<Extension> &extensions)>;
+        using ResolveHandler = std::function<bool(const Extension &extension, Resources &resources)>;
+
+        InputMethodCatalogue(QueryHandler query, ResolveHandler resolve);
+        ~InputMethodCatalogue();
+
+        int32_t List(int32_t userId, std::vector<InputMethodPropertyPtr> *properties);
+        void Invalidate(int32_t userId);
+        void RemoveUser(int32_t userId);
+
+    private:
+        struct ResolvedExtension {
+            uint32_t versionCode;
+            Resources resources;
+        };
+
+        using ResolvedMap = std::map<std::string, ResolvedExtension>; // "bundleName/abilityName" -> strings
+
+        struct UserCatalogue {
+            bool valid = false;
+            uint64_t generation = 0; // changed on each invalidation, a rebuild started before it is not kept
+            std::vector<InputMethodPropertyPtr> properties;
+            ResolvedMap resolved;
+        };
+
+        std::mutex catalogueLock_; // not held while the bundle manager and the resources are queried
+        std::map<int32_t, UserCatalogue> catalogues_;
+        uint64_t generation_ = 0;
+        QueryHandler query_;
+        ResolveHandler resolve_;
+
+        int32_t Build(int32_t userId, const ResolvedMap &cached, std::vector<InputMethodPropertyPtr> &properties,
+                      ResolvedMap &resolved, bool &complete);
+
+        InputMethodCatalogue(const InputMethodCatalogue&);
+        InputMethodCatalogue& operator =(const InputMethodCatalogue&);
+        InputMethodCatalogue(const InputMethodCatalogue&&);
+        InputMethodCatalogue& operator =(const InputMethodCatalogue&&);
+    };
+} // namespace MiscServices
+} // namespace OHOS
+#endif // SERVICES_INCLUDE_INPUT_METHOD_CATALOGUE_H
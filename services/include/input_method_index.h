@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SERVICES_INCLUDE_INPUT_METHOD_INDEX_H
+#define SERVICES_INCLUDE_INPUT_METHOD_INDEX_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "input_method_property.h"
+#include "keyboard_type.h"
+
+namespace OHOS {
+namespace MiscServices {
+    /*! Hash index over the input method engines installed for one user.
+      \n It maps imeId and packageName to the InputMethodProperty, and the hashCode of a keyboard type to its
+      \n position in InputMethodProperty::mTypes. The properties belong to PerUserSetting, the index shares them
+      \n so that a lookup can hand out a snapshot, and has to be updated whenever a property is added or removed.
+      \n It is updated on the IMSA thread and read on the session threads, so every method takes its lock.
+    */
+    class InputMethodIndex {
+    public:
+        InputMethodIndex();
+        ~InputMethodIndex();
+
+        void Add(const std::shared_ptr<InputMethodProperty>& property);
+        void Remove(const InputMethodProperty *property);
+        void Clear();
+        int32_t Size() const;
+
+        std::shared_ptr<InputMethodProperty> FindByImeId(const std::u16string& imeId) const;
+        std::shared_ptr<InputMethodProperty> FindByPackageName(const std::u16string& packageName) const;
+        int32_t GetKeyboardTypeIndex(const InputMethodProperty *property, int32_t hashCode) const;
+        KeyboardType *FindKeyboardType(const InputMethodProperty *property, int32_t hashCode) const;
+
+    private:
+        using PropertyList = std::vector<std::shared_ptr<InputMethodProperty>>; // in the order they are added
+
+        mutable std::mutex lock_;
+        std::unordered_map<std::u16string, PropertyList> imeIds; // imeId -> properties
+        std::unordered_map<std::u16string, PropertyList> packageNames; // packageName -> properties
+        // property -> (hashCode -> position in mTypes)
+        std::unordered_map<const InputMethodProperty*, std::unordered_map<int32_t, int32_t>> keyboardTypes;
+
+        static void Erase(std::unordered_map<std::u16string, PropertyList>& map, const std::u16string& key,
+                          const InputMethodProperty *property);
+        static std::shared_ptr<InputMethodProperty> Find(const std::unordered_map<std::u16string, PropertyList>& map,
+                                                         const std::u16string& key);
+        int32_t FindKeyboardTypeIndex(const InputMethodProperty *property, int32_t hashCode) const;
+        InputMethodIndex(const InputMethodIndex&);
+        InputMethodIndex& operator =(const InputMethodIndex&);
+        InputMethodIndex(const InputMethodIndex&&);
+        InputMethodIndex& operator =(const InputMethodIndex&&);
+    };
+} // namespace MiscServices
+} // namespace OHOS
+#endif // SERVICES_INCLUDE_INPUT_METHOD_INDEX_H
@@ -15,6 +15,7 @@
 
 #ifndef SERVICES_INCLUDE_INPUT_METHOD_PROPERTY_H
 #define SERVICES_INCLUDE_INPUT_METHOD_PROPERTY_H
+#include <memory>
 #include <vector>
 #include <string>
 #include "parcel.h"
@@ -22,6 +23,10 @@
 
 namespace OHOS {
 namespace MiscServices {
+    class InputMethodProperty;
+    /*! A shared, read-only snapshot of an input method engine */
+    using InputMethodPropertyPtr = std::shared_ptr<const InputMethodProperty>;
+
     class InputMethodProperty : public Parcelable {
     public:
         std::u16string mImeId;
@@ -42,6 +47,9 @@ namespace MiscServices {
         InputMethodProperty& operator =(const InputMethodProperty& property);
         bool Marshalling(Parcel &parcel) const override;
         static InputMethodProperty *Unmarshalling(Parcel &parcel);
+        static bool MarshallingList(Parcel &parcel, const std::vector<InputMethodPropertyPtr>& properties);
+        static bool UnmarshallingList(Parcel &parcel, std::vector<InputMethodPropertyPtr> *properties);
+        static std::vector<KeyboardTypePtr> ListKeyboardTypes(const InputMethodPropertyPtr& property);
     };
 } // namespace MiscServices
 } // namespace OHOS
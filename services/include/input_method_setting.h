@@ -16,6 +16,7 @@
 #ifndef SERVICES_INCLUDE_INPUT_METHOD_SETTING_H
 #define SERVICES_INCLUDE_INPUT_METHOD_SETTING_H
 #include <map>
+#include <unordered_map>
 #include <vector>
 #include "string.h"
 #include "global.h"
@@ -48,6 +49,9 @@ namespace MiscServices {
         bool RemoveEnabledInputMethod(const std::u16string& imdId);
 
         std::vector<int32_t> GetEnabledKeyboardTypes(const std::u16string& imeId);
+        int32_t GetEnabledKeyboardTypeCount(const std::u16string& imeId);
+        bool GetEnabledKeyboardType(const std::u16string& imeId, int32_t index, int32_t& hashCode);
+        int32_t GetKeyboardTypeIndex(const std::u16string& imeId, int32_t hashCode);
         int32_t GetCurrentKeyboardType();
         void SetCurrentKeyboardType(int32_t type);
         int32_t GetCurrentSysKeyboardType();
@@ -59,11 +63,32 @@ namespace MiscServices {
         static InputMethodSetting *Unmarshalling(Parcel &parcel);
 
     private:
+        /*! An enabled input method engine parsed from ENABLED_INPUT_METHODS_TAG */
+        struct EnabledIme {
+            std::u16string imeId;
+            std::vector<int32_t> types; // hashCodes of the enabled keyboard types, in setting order
+            std::unordered_map<int32_t, int32_t> typeIndex; // hashCode -> position in types
+        };
+
+        // the enabled ime list is kept parsed in enabledImes, and written back
+        // to its serialized form whenever it's changed.
         std::map<std::u16string, std::u16string> setting;
+        std::vector<EnabledIme> enabledImes;
+        std::unordered_map<std::u16string, int32_t> enabledImeIndex; // imeId -> position in enabledImes
+        bool enabledParsed = false;
+        int32_t currentKeyboardType = 0;
+        int32_t currentSysKeyboardType = 0;
+
         const char16_t DELIM_IME = ':';
         const char16_t DELIM_KBD_TYPE = ';';
-        std::vector<std::u16string> Split(const std::u16string& str, char16_t delim);
-        std::u16string BuildString(const std::vector<std::u16string>& vector, char16_t delim);
+        std::vector<std::u16string> Split(const std::u16string& str, char16_t delim) const;
+        std::u16string BuildString(const std::vector<std::u16string>& vector, char16_t delim) const;
+        void CopyFrom(const InputMethodSetting& inputMethodSetting);
+        void ParseEnabledInputMethods();
+        void FlushEnabledInputMethods();
+        void RebuildEnabledImeIndex();
+        const EnabledIme *FindEnabledIme(const std::u16string& imeId);
+        static int32_t ParseInt(const std::u16string& value);
     };
 } // namespace MiscServices
 } // namespace OHOS
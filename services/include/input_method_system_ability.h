@@ -18,10 +18,14 @@
 
 #include <thread>
 #include <map>
+#include <mutex>
 #include "system_ability.h"
 #include "input_method_system_ability_stub.h"
 #include "peruser_setting.h"
 #include "peruser_session.h"
+#include "ime_launcher.h"
+#include "input_method_catalogue.h"
+#include "user_message_router.h"
 #include "event_handler.h"
 #include "bundle_mgr_proxy.h"
 #include "ability_manager_interface.h"
@@ -50,36 +54,49 @@ namespace MiscServices {
         int32_t getDisplayMode(int32_t retMode) override;
         int32_t getKeyboardWindowHeight(int32_t retHeight) override;
         int32_t getCurrentKeyboardType(KeyboardType *retType) override;
-        int32_t listInputMethodEnabled(std::vector<InputMethodProperty*> *properties) override;
-        int32_t listInputMethod(std::vector<InputMethodProperty*> *properties) override;
-        int32_t listInputMethodByUserId(int32_t userId, std::vector<InputMethodProperty*> *properties) override;
-        int32_t listKeyboardType(const std::u16string& imeId, std::vector<KeyboardType*> *types) override;
+        int32_t listInputMethodEnabled(std::vector<InputMethodPropertyPtr> *properties) override;
+        int32_t listInputMethod(std::vector<InputMethodPropertyPtr> *properties) override;
+        int32_t listInputMethodByUserId(int32_t userId, std::vector<InputMethodPropertyPtr> *properties) override;
+        int32_t listKeyboardType(const std::u16string& imeId, std::vector<KeyboardTypePtr> *types) override;
+        int Dump(int fd, const std::vector<std::u16string> &args) override;
+        void SetCatalogue(std::unique_ptr<InputMethodCatalogue> catalogue);
 
     protected:
         void OnStart() override;
         void OnStop() override;
+        void DispatchUserMessage(int32_t userId, Message *msg) override;
+        std::string GetBundleNameByUid(int32_t uid) override;
 
     private:
         int32_t Init();
         void Initialize();
+        void InitCatalogue();
+        std::shared_ptr<ImeLauncher> CreateImeLauncher(int32_t userId);
         
         std::thread workThreadHandler; /*!< thread handler of the WorkThread */
 
         std::map<int32_t, PerUserSetting*> userSettings;
 
         std::map<int32_t, PerUserSession*> userSessions;
-        std::map<int32_t, MessageHandler*> msgHandlers;
+        std::mutex launchersLock_; /*!< guards launchers_, which Dump reads in a binder thread */
+        std::map<int32_t, std::shared_ptr<ImeLauncher>> launchers_; /*!< the IME launcher of each user session */
+        UserMessageRouter router_ { MessageHandler::Instance() }; /*!< the work threads of the user sessions */
+        std::unique_ptr<InputMethodCatalogue> catalogue_; /*!< the IME extensions installed for each user */
 
         void WorkThread();
         PerUserSetting *GetUserSetting(int32_t userId);
         PerUserSession *GetUserSession(int32_t userId);
         void StartInputService(std::string imeId);
         void StopInputService(std::string imeId);
+        bool StartImeAbility(const std::string &imeId);
+        bool SendSessionMessage(int32_t userId, Message *msg);
+        void SwitchInputService(const std::string &imeId);
+        void UpdateStandbyIme(int32_t userId);
         int32_t OnUserStarted(const Message *msg);
         int32_t OnUserStopped(const Message *msg);
         int32_t OnUserUnlocked(const Message *msg);
         int32_t OnUserLocked(const Message *msg);
-        int32_t OnHandleMessage(Message *msg);
+        int32_t OnHandleMessage(MessagePtr msg, bool fromClient);
         int32_t OnRemotePeerDied(const Message *msg);
         int32_t OnSettingChanged(const Message *msg);
         int32_t OnPackageRemoved(const Message *msg);
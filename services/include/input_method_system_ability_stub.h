@@ -21,6 +21,7 @@
 #include "iremote_stub.h"
 #include "global.h"
 #include "message_parcel.h"
+#include "message.h"
 
 namespace OHOS {
 namespace MiscServices {
@@ -36,10 +37,12 @@ namespace MiscServices {
         void SetCoreAndAgent(MessageParcel& data) override;
         void HideCurrentInput(MessageParcel& data) override;
         void displayOptionalInputMethod(MessageParcel& data) override;
-        virtual int32_t listInputMethodByUserId(int32_t userId, std::vector<InputMethodProperty*> *properties) = 0;
+        virtual int32_t listInputMethodByUserId(int32_t userId, std::vector<InputMethodPropertyPtr> *properties) = 0;
 
     protected:
         int32_t getUserId(int32_t uid);
+        virtual void DispatchUserMessage(int32_t userId, Message *msg);
+        virtual std::string GetBundleNameByUid(int32_t uid);
         int USER_ID_CHANGE_VALUE = 200000; // user range
     };
 } // namespace MiscServices
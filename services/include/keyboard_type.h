@@ -16,12 +16,17 @@
 #ifndef SERVICES_INCLUDE_KEYBOARD_TYPE_H
 #define SERVICES_INCLUDE_KEYBOARD_TYPE_H
 
+#include <memory>
 #include <vector>
 #include <string>
 #include "parcel.h"
 
 namespace OHOS {
 namespace MiscServices {
+    class KeyboardType;
+    /*! A shared, read-only snapshot of a keyboard type */
+    using KeyboardTypePtr = std::shared_ptr<const KeyboardType>;
+
     class KeyboardType : public Parcelable {
     public:
         KeyboardType();
@@ -30,6 +35,8 @@ namespace MiscServices {
         KeyboardType& operator =(const KeyboardType& type);
         bool Marshalling(Parcel &parcel) const override;
         static KeyboardType *Unmarshalling(Parcel &parcel);
+        static bool MarshallingList(Parcel &parcel, const std::vector<KeyboardTypePtr>& types);
+        static bool UnmarshallingList(Parcel &parcel, std::vector<KeyboardTypePtr> *types);
         void setId(int32_t typeId);
         void setLabelId(int32_t labelId);
         void setIconId(int32_t iconId);
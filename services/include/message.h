@@ -17,14 +17,22 @@
 #ifndef SERVICES_INCLUDE_MESSAGE_H
 #define SERVICES_INCLUDE_MESSAGE_H
 
+#include <memory>
 #include "global.h"
 #include "message_parcel.h"
 namespace OHOS {
 namespace MiscServices {
+    class MessagePool;
+
     class Message {
     public:
         int32_t msgId_; // message id
         MessageParcel *msgContent_ = nullptr; // message content
+        MessagePool *pool_ = nullptr; // the pool this message is returned to, nullptr if it is freed by delete
+        uint64_t coalesceKey_ = 0; // a pending message with the same non-zero key is replaced by this one
+        uint64_t traceId_ = 0; // the traced request this message belongs to, 0 if it's not traced
+        int64_t sentNs_ = 0; // when a traced message is sent, to measure its wait in the queue
+        bool superseded_ = false; // replaced by a later message with the same coalesce key, dropped when dequeued
         Message(int32_t msgId, MessageParcel *msgContent);
         explicit Message(const Message& msg);
         Message& operator =(const Message& msg);
@@ -34,6 +42,14 @@ namespace MiscServices {
         Message(const Message&&);
         Message& operator =(const Message&&);
     };
+
+    /*! Deleter of MessagePtr. A pooled message is given back to its pool, any other message is deleted.
+    */
+    struct MessageDeleter {
+        void operator()(Message *msg) const;
+    };
+
+    using MessagePtr = std::unique_ptr<Message, MessageDeleter>;
 } // namespace MiscServices
 } // namespace OHOS
 
@@ -17,12 +17,17 @@
 #ifndef SERVICES_INCLUDE_MESSAGE_HANDLER_H
 #define SERVICES_INCLUDE_MESSAGE_HANDLER_H
 
+#include <map>
 #include <queue>
 #include <mutex>
+#include <atomic>
+#include <unordered_map>
 #include <condition_variable>
 #include "global.h"
 #include "message_parcel.h"
 #include "message.h"
+#include "message_pool.h"
+#include "message_ring.h"
 
 namespace OHOS {
 namespace MiscServices {
@@ -56,6 +61,9 @@ namespace MessageID {
         MSG_ID_DISPLAY_OPTIONAL_INPUT_METHOD,
         MSG_ID_ADVANCE_TO_NEXT, // switch to next
         MSG_ID_SET_DISPLAY_MODE, // set display mode
+        MSG_ID_SWITCH_IME, // switch to an input method, through its standby if it's started
+        MSG_ID_SET_STANDBY_IME, // set the input method kept started in the background
+        MSG_ID_CHECK_STANDBY_IME, // check the standby input method connected, and its memory
 
         MSG_ID_SHELL_COMMAND, // shell command
         MSG_ID_EXIT_SERVICE, // exit service
@@ -69,6 +77,7 @@ namespace MessageID {
         MSG_ID_SEND_KEYBOARD_STATUS,
         MSG_ID_SEND_FUNCTION_KEY,
         MSG_ID_MOVE_CURSOR,
+        MSG_ID_BATCH_EDIT,
 
         // the request from IMSA to IMA
         MSG_ID_SET_CLIENT_STATE,
@@ -83,21 +92,87 @@ namespace MessageID {
         // the request from IMC to IMA
         MSG_ID_ON_CURSOR_UPDATE,
         MSG_ID_ON_SELECTION_CHANGE,
+        MSG_ID_ON_TEXT_DELTA,
+    };
+}
+
+namespace MessageLane {
+    // the priority lanes of a prioritized MessageHandler, a smaller value is served first
+    enum {
+        LANE_INTERACTIVE = 0, // show/hide keyboard, focus and typing, and the death of the clients and imes
+        LANE_LIFECYCLE, // input method service set up or disabled, not about a client or an ime instance
+        LANE_HOUSEKEEPING, // user, package and setting events
+        LANE_COUNT,
     };
 }
 
     class MessageHandler {
     public:
+        enum QueueMode {
+            QUEUE_MODE_MUTEX = 0, // std::queue guarded by mMutex
+            QUEUE_MODE_LOCK_FREE, // lock-free ring, the consumer parks on mCV after bounded spinning
+        };
+
+        enum HandlerFlag {
+            FLAG_PRIORITIZED = 1, // messages are served by the priority of their lanes, see GetLane
+            FLAG_COALESCING = 2, // a pending message is replaced by a new one with the same coalesce key
+        };
+
+        // folds what a superseded message carries into the message replacing it, e.g. where a selection started
+        using Merger = void (*)(Message &older, Message &newer);
+
         MessageHandler();
+        explicit MessageHandler(QueueMode mode, uint32_t flags = 0);
         ~MessageHandler();
         void SendMessage(Message *msg);
-        Message *GetMessage();
+        void SendMessage(MessagePtr msg);
+        MessagePtr GetMessage();
+        MessagePtr ObtainMessage(int32_t msgId);
+        MessagePool *GetMessagePool();
+        QueueMode GetQueueMode() const;
+        bool IsPrioritized() const;
+        uint64_t GetCoalescedCount() const;
+        uint64_t GetDeliveredCount() const;
+        void SetMerger(int32_t msgId, Merger merger);
+        static int32_t GetLane(int32_t msgId);
+        static uint64_t MakeCoalesceKey(int32_t msgId, const void *object = nullptr);
         static MessageHandler *Instance();
 
     private:
+        static const int32_t SPIN_COUNT = 128; // times to poll the ring before parking
+        static const int32_t SPIN_YIELD_THRESHOLD = 64; // start yielding the cpu after this many polls
+        static const int32_t STARVATION_LIMIT = 8; // a pending lane is served after being passed over this many times
+
+        struct Lane {
+            std::queue<Message*> queue; // Message queue, guarded by mMutex; the overflow of ring in lock-free mode
+            MessageRing *ring = nullptr; // lock-free message queue, only for QUEUE_MODE_LOCK_FREE
+            std::atomic<int32_t> overflowCount {0}; // the number of messages in queue when ring is full
+            int32_t waitCount = 0; // times this lane is passed over while not empty, used by the consumer only
+        };
+
+        QueueMode mMode;
+        bool mPrioritized; // false - all the messages go to LANE_INTERACTIVE and are served in FIFO order
+        bool mCoalescing;
         std::mutex mMutex; // a mutex to guard message queue
         std::condition_variable mCV; // condition variable to work with mMutex
-        std::queue<Message*> mQueue; // Message queue, guarded by mMutex;
+        Lane mLanes[MessageLane::LANE_COUNT];
+        std::atomic<bool> mSleeping; // true when the consumer is going to wait on mCV
+        MessagePool mPool; // messages obtained by ObtainMessage
+        std::mutex mPendingMutex; // a mutex to guard mPending
+        std::unordered_map<uint64_t, Message*> mPending; // queued messages which have a coalesce key
+        std::map<int32_t, Merger> mMergers; // set before any message is sent, read only afterwards
+        std::atomic<uint64_t> mCoalescedCount; // messages merged into a pending one
+        std::atomic<uint64_t> mDeliveredCount; // messages returned by GetMessage
+
+        int32_t LaneOf(const Message *msg) const;
+        bool IsLaneEmpty(int32_t lane);
+        bool IsEmpty();
+        int32_t PickLane();
+        void SendToRing(Message *msg);
+        Message *GetFromRing();
+        Message *TryGetFromRing();
+        void Coalesce(Message *msg);
+        Message *Deliver(Message *msg);
 
         MessageHandler(const MessageHandler&);
         MessageHandler& operator =(const MessageHandler&);
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file message_pool.h */
+#ifndef SERVICES_INCLUDE_MESSAGE_POOL_H
+#define SERVICES_INCLUDE_MESSAGE_POOL_H
+
+#include <atomic>
+#include <cstdint>
+#include "message.h"
+#include "message_ring.h"
+
+namespace OHOS {
+namespace MiscServices {
+    /*! A pool of messages together with their parcels.
+      \n A recycled parcel keeps its buffer, so a message obtained from the pool can be filled with
+      \n small payloads (a character, a cursor position) without any heap allocation.
+      \n Obtain and Recycle can be called from any thread.
+      \note The pool must outlive all the messages obtained from it.
+    */
+    class MessagePool {
+    public:
+        static const uint32_t DEFAULT_CAPACITY = 64;
+        static const size_t MAX_RETAINED_CAPACITY = 4096; // a bigger parcel buffer is freed instead of kept
+
+        explicit MessagePool(uint32_t capacity = DEFAULT_CAPACITY);
+        ~MessagePool();
+        MessagePtr Obtain(int32_t msgId);
+        void Recycle(Message *msg);
+        uint32_t GetCreatedCount() const;
+
+    private:
+        MessageRing freeList_;
+        std::atomic<uint32_t> createdCount_;
+
+        MessagePool(const MessagePool&);
+        MessagePool& operator =(const MessagePool&);
+        MessagePool(const MessagePool&&);
+        MessagePool& operator =(const MessagePool&&);
+    };
+} // namespace MiscServices
+} // namespace OHOS
+#endif // SERVICES_INCLUDE_MESSAGE_POOL_H
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file message_ring.h */
+#ifndef SERVICES_INCLUDE_MESSAGE_RING_H
+#define SERVICES_INCLUDE_MESSAGE_RING_H
+
+#include <atomic>
+#include <cstdint>
+#include "message.h"
+
+namespace OHOS {
+namespace MiscServices {
+    /*! A bounded lock-free ring of message pointers.
+      \n Every cell carries a sequence number, so producers claim a slot with a single CAS on the
+      \n enqueue position and consumers never touch the producers' cache line.
+      \n Push is safe from any number of threads, and so is Pop.
+    */
+    class MessageRing {
+    public:
+        static const uint32_t DEFAULT_CAPACITY = 1024;
+
+        explicit MessageRing(uint32_t capacity = DEFAULT_CAPACITY);
+        ~MessageRing();
+        bool Push(Message *msg);
+        Message *Pop();
+        bool IsEmpty() const;
+        bool IsDrained() const;
+        uint32_t GetCapacity() const;
+
+    private:
+        static const uint32_t CACHE_LINE_SIZE = 64;
+        struct Cell {
+            std::atomic<uint64_t> sequence;
+            Message *msg;
+        };
+
+        Cell *cells_ = nullptr;
+        uint64_t mask_ = 0;
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> enqueuePos_;
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> dequeuePos_;
+
+        MessageRing(const MessageRing&);
+        MessageRing& operator =(const MessageRing&);
+        MessageRing(const MessageRing&&);
+        MessageRing& operator =(const MessageRing&&);
+    };
+} // namespace MiscServices
+} // namespace OHOS
+#endif // SERVICES_INCLUDE_MESSAGE_RING_H
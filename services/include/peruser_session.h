@@ -16,10 +16,13 @@
 #ifndef SERVICES_INCLUDE_PERUSER_SESSION_H
 #define SERVICES_INCLUDE_PERUSER_SESSION_H
 
+#include <atomic>
+#include <chrono>
 #include <thread>
 #include <mutex>
 #include <map>
 #include <memory>
+#include <vector>
 
 #include "iremote_object.h"
 #include "i_input_control_channel.h"
@@ -28,6 +31,9 @@
 #include "i_input_data_channel.h"
 #include "i_input_method_agent.h"
 #include "input_attribute.h"
+#include "client_registry.h"
+#include "ime_launcher.h"
+#include "input_method_index.h"
 #include "input_method_property.h"
 #include "input_method_setting.h"
 #include "input_control_channel_stub.h"
@@ -52,42 +58,59 @@ namespace MiscServices {
         int msgId_; // the message id can be  MessageID::MSG_ID_CLIENT_DIED and MessageID::MSG_ID_IMS_DIED
     };
 
-    /*! \class ClientInfo
-    \brief The class defines the details of an input client.
+    /*! \class BroadcastReport
+    \brief The result of the last broadcast of the agent of the input method service to the input clients.
     */
-    class ClientInfo {
+    class BroadcastReport {
     public:
-        int pid; // the process id of the process in which the input client is running
-        int uid; // the uid of the process in which the input client is running
-        int userId; // the user if of the user under which the input client is running
-        int displayId; // the display id on which the input client is showing
-        sptr<IInputClient> client; // the remote object handler for the service to callback to the input client
-        sptr<IInputDataChannel> channel; // the remote object handler for IMSA callback to input client
-        InputAttribute attribute; // the input attribute of the input client
-
-        ClientInfo(int pid, int uid, int userId, int displayId, const sptr<IInputClient>& client,
-                   const sptr<IInputDataChannel>& channel, const InputAttribute& attribute)
-        {
-            this->pid = pid;
-            this->uid = uid;
-            this->userId = userId;
-            this->displayId = displayId;
-            this->client = client;
-            this->channel = channel;
-            this->attribute = attribute;
-        };
-
-        ~ClientInfo()
-        {
-            this->client = nullptr;
-            this->channel = nullptr;
-        };
+        uint64_t sequence = 0; // increased on every broadcast, 0 if none is done
+        int32_t clientCount = 0; // the clients registered when the broadcast starts
+        int32_t deferredCount = 0; // the clients left for their next start input, in lazy handshake mode
+        int32_t slowCount = 0; // the sends slower than SLOW_CLIENT_CALL_US
+        std::vector<int32_t> failedPids; // the pids of the clients which can't be reached
+        int64_t costUs = 0; // the time of all the sends
+    };
+
+    /*! \class SessionSnapshot
+    \brief The read-mostly state of a session published to the binder threads.
+
+    A snapshot is never changed once published. A new one replaces it, and the old one is freed when
+    the last reader drops its reference.
+    */
+    class SessionSnapshot {
+    public:
+        int displayMode = 0; // the display mode of the current keyboard
+        sptr<IInputMethodCore> core; // the input method service showing the keyboard
+        sptr<IInputMethodAgent> agent; // the agent sent to the input clients
+        KeyboardTypePtr keyboardType; // a copy of the current keyboard type of the default ime, null if none
+        BroadcastReport broadcast; // the last broadcast of the agent
+    };
+
+    /*! \class RecoveryJournal
+    \brief The input state of a session, replayed into the input method service restarted after it died.
+
+    It's kept by the work thread as the input clients start and stop input, so the restarted service shows
+    the keyboard again for the same client, with the same attribute and keyboard type, without the client
+    focusing again.
+    */
+    class RecoveryJournal {
+    public:
+        sptr<IInputClient> client; // the client which started input last, null if none
+        InputAttribute attribute; // the input attribute of the client
+        int kbdIndex = 0; // the keyboard type index of the default ime when it died
+        bool shown = false; // the keyboard is shown for the client
+        bool pending = false; // the ime died, the state is replayed once it's connected again
+        std::chrono::steady_clock::time_point diedTime; // when the ime died
     };
 
     /*! \class PerUserSession
         \brief The class provides session management in input method management service
 
         This class manages the sessions between input clients and input method engines for each unlocked user.
+        \n The session state is guarded in three parts:
+        \n imeLock - the ime slots, taken by the work thread and the setting callbacks of the service.
+        \n clients - the client registry, locked inside for the lookup or the change of the registry itself.
+        \n sessionSnapshot - the state read by binder threads, swapped atomically and read without lock.
     */
     class PerUserSession {
     enum {
@@ -103,29 +126,34 @@ namespace MiscServices {
         void SetCurrentIme(InputMethodProperty *ime);
         void SetSecurityIme(InputMethodProperty *ime);
         void SetInputMethodSetting(InputMethodSetting *setting);
+        void SetInputMethodIndex(InputMethodIndex *index);
+        void SetImeLauncher(std::shared_ptr<ImeLauncher> launcher);
+        std::shared_ptr<ImeLauncher> GetImeLauncher();
+        void SetLazyHandshake(bool lazy);
         void ResetIme(InputMethodProperty *defaultIme, InputMethodProperty *securityIme);
         void OnPackageRemoved(const std::u16string& packageName);
 
         int GetDisplayMode();
         int GetKeyboardWindowHeight(int retHeight);
-        KeyboardType *GetCurrentKeyboardType();
+        KeyboardTypePtr GetCurrentKeyboardType();
+        BroadcastReport GetLastBroadcast();
 
         int OnSettingChanged(const std::u16string& key, const std::u16string& value);
         void CreateWorkThread(MessageHandler& handler);
         void JoinWorkThread();
         void StopInputService(std::string imeId);
-        static bool StartInputService();
 
     private:
         int userId_; // the id of the user to whom the object is linking
         int userState; // the state of the user to whom the object is linking
         int displayId; // the id of the display screen on which the user is
         int currentIndex;
-        std::map<sptr<IRemoteObject>, ClientInfo*> mapClients;
+        ClientRegistry clients; // the input clients of this user, guarded by its own lock
         int MIN_IME = 2;
         int IME_ERROR_CODE = 3;
         int COMMON_COUNT_THREE_HUNDRED = 300;
-        int SLEEP_TIME = 300000;
+        int SLOW_CLIENT_CALL_US = 10000; // a call to an input client longer than this is reported
+        int RESTART_IMS_DELAY_MS = 1600; // the time for PACKAGE_REMOVED to come if a died ime is removed
 
         InputMethodProperty *currentIme[MAX_IME]; // 0 - the default ime. 1 - security ime
 
@@ -134,11 +162,24 @@ namespace MiscServices {
         sptr<IInputMethodCore> imsCore[MAX_IME]; // the remote handlers of input method service
         sptr<IRemoteObject> inputMethodToken[MAX_IME]; // the window token of keyboard
         int currentKbdIndex[MAX_IME]; // current keyboard index
-        int lastImeIndex; // The last ime which showed keyboard
-        InputMethodSetting *inputMethodSetting; // The pointer referred to the object in PerUserSetting
-        int currentDisplayMode; // the display mode of the current keyboard
+        InputMethodSetting *inputMethodSetting = nullptr; // The pointer referred to the object in PerUserSetting
+        InputMethodIndex *inputMethodIndex = nullptr; // The pointer referred to the object in PerUserSetting
+        std::shared_ptr<ImeLauncher> imeLauncher; // the start pipeline of the default IME of this user
+        int currentDisplayMode = 0; // the display mode of the current keyboard
+        std::atomic<bool> lazyHandshake {false}; // the agent is sent to the input client with the input focus only
 
         sptr<IInputMethodAgent> imsAgent;
+        std::string imsBundleName; // the bundle of the default input method service connected
+
+        std::string standbyImeId; // the ime kept started in the background, empty if standby is disabled
+        int64_t standbyBudgetKb = 0; // the resident memory the standby ime may use
+        std::string standbyLaunchedId; // the standby ime whose ability start is requested, not connected yet
+        uint64_t standbyLaunchId = 0; // the id of the last standby start, matched by its check
+        std::map<std::string, uint64_t> standbyAbandoned; // the starts of replaced standby imes -> their launch ids
+        std::string standbyRejectedId; // the standby ime which failed to connect, or used more memory than the budget
+        int standbyPid = 0; // the pid of the process of the standby ime
+        sptr<IInputMethodCore> standbyCore; // the remote handlers of the standby ime, bound but hidden
+        sptr<IInputMethodAgent> standbyAgent;
         InputChannel *imsChannel; // the write channel created by input method service
         sptr<IInputClient> currentClient; // the current input client
         sptr<IInputClient> needReshowClient; // the input client for which keyboard need to re-show
@@ -147,7 +188,10 @@ namespace MiscServices {
         sptr<RemoteObjectDeathRecipient> imsDeathRecipient;
         MessageHandler *msgHandler = nullptr; // message handler working with Work Thread
         std::thread workThreadHandler; // work thread handler
-        std::mutex mtx; // mutex to lock the operations among multi work threads
+        std::mutex imeLock; // guards the ime slots, the standby ime and the current client
+        std::shared_ptr<const SessionSnapshot> sessionSnapshot; // accessed with std::atomic_load/atomic_store only
+        RecoveryJournal journal; // the input state to replay after the ime died, accessed in the work thread only
+        BroadcastReport lastBroadcast; // published in the snapshot, accessed in the work thread only
         sptr<AAFwk::AbilityConnectionProxy> connCallback;
 
         PerUserSession(const PerUserSession&);
@@ -156,22 +200,36 @@ namespace MiscServices {
         PerUserSession& operator =(const PerUserSession&&);
         int IncreaseOrResetImeError(bool resetFlag, int imeIndex);
         KeyboardType *GetKeyboardType(int imeIndex, int typeIndex);
+        int FindKeyboardTypeIndex(const InputMethodProperty *ime, int hashCode);
         void ResetCurrentKeyboardType(int imeIndex);
         int OnCurrentKeyboardTypeChanged(int index, const std::u16string& value);
+        int UpdateSetting(const std::u16string& key, const std::u16string& value);
         void CopyInputMethodService(int imeIndex);
-        ClientInfo *GetClientInfo(const sptr<IInputClient>& inputClient);
+        std::shared_ptr<ClientInfo> GetClientInfo(const sptr<IInputClient>& inputClient);
+        bool HasInputFocus(const sptr<IRemoteObject>& clientObject);
+        KeyboardType *FindCurrentKeyboardType();
+        void PublishSnapshot();
         void WorkThread();
         void OnPrepareInput(Message *msg);
         void OnReleaseInput(Message *msg);
         void OnStartInput(Message *msg);
         void OnStopInput(Message *msg);
         void SetCoreAndAgent(Message *msg);
+        void OnSwitchIme(Message *msg);
+        void OnSetStandbyIme(Message *msg);
+        void OnCheckStandbyIme(Message *msg);
+        void OnStandbyConnected(const sptr<IInputMethodCore>& core, const sptr<IInputMethodAgent>& agent, int pid);
+        bool StopAbandonedStandby(const std::string &bundleName, const sptr<IInputMethodCore>& core);
+        void LaunchStandbyIme();
+        void DropStandbyIme();
+        static int64_t GetResidentKb(int pid);
         void OnClientDied(const wptr<IRemoteObject>& who);
         void OnImsDied(const wptr<IRemoteObject>& who);
         void OnHideKeyboardSelf(int flags);
         void OnAdvanceToNext();
         void OnSetDisplayMode(int mode);
         void OnRestartIms(int index, const std::u16string& imeId);
+        void ReplayJournal();
         void OnUserLocked();
         int AddClient(int pid, int uid, int displayId, const sptr<IInputClient>& inputClient,
                   const sptr<IInputDataChannel>& channel,
@@ -183,8 +241,7 @@ namespace MiscServices {
         int HideKeyboard(const sptr<IInputClient>& inputClient);
         void SetDisplayId(int displayId);
         int GetImeIndex(const sptr<IInputClient>& inputClient);
-        static sptr<AAFwk::IAbilityManager> GetAbilityManagerService();
-        void SendAgentToSingleClient(const sptr<IInputClient>& inputClient);
+        void SendAgentToSingleClient(const sptr<IInputClient>& inputClient, const sptr<IInputMethodAgent>& agent);
         void InitInputControlChannel();
         void SendAgentToAllClients();
     };
@@ -17,8 +17,10 @@
 #define SERVICES_INCLUDE_PERUSER_SETTING_H
 
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
+#include "input_method_index.h"
 #include "input_method_property.h"
 #include "input_method_setting.h"
 #include "global.h"
@@ -37,6 +39,7 @@ namespace MiscServices {
         InputMethodProperty *GetSecurityInputMethod();
         InputMethodProperty *GetNextInputMethod();
         InputMethodSetting *GetInputMethodSetting();
+        InputMethodIndex *GetInputMethodIndex();
         InputMethodProperty *GetInputMethodProperty(const std::u16string& imeId);
 
         int32_t OnPackageAdded(std::u16string& packageName, bool isSecurityIme);
@@ -46,16 +49,18 @@ namespace MiscServices {
         void OnUserLocked();
         void Dump(int32_t fd);
 
-        int32_t ListInputMethodEnabled(std::vector<InputMethodProperty*> *properties);
-        int32_t ListInputMethod(std::vector<InputMethodProperty*> *properties);
-        int32_t ListKeyboardType(const std::u16string& imeId, std::vector<KeyboardType*> *types);
+        int32_t ListInputMethodEnabled(std::vector<InputMethodPropertyPtr> *properties);
+        int32_t ListInputMethod(std::vector<InputMethodPropertyPtr> *properties);
+        int32_t ListKeyboardType(const std::u16string& imeId, std::vector<KeyboardTypePtr> *types);
 
         static bool CheckIfSecurityIme(const InputMethodProperty& property);
 
     private:
         int32_t userId_; // the id of the user to whom the object is linking
         int32_t userState; // the state of the user to whom the object is linking
-        std::vector<InputMethodProperty*> inputMethodProperties; // a vector to save all IME installed for this user
+        // all IME installed for this user, shared with the snapshots handed out by the List* methods
+        std::vector<std::shared_ptr<InputMethodProperty>> inputMethodProperties;
+        InputMethodIndex inputMethodIndex; // the index over inputMethodProperties
         std::u16string currentImeId; // the id of the default input method engine.
         InputMethodSetting inputMethodSetting; // the object to manage the setting data for this user
         int COMMON_COUNT_ONE_HUNDRED_THOUSAND = 100000;
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file service_locator.h */
+#ifndef SERVICES_INCLUDE_SERVICE_LOCATOR_H
+#define SERVICES_INCLUDE_SERVICE_LOCATOR_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include "iremote_object.h"
+#include "refbase.h"
+
+namespace OHOS {
+namespace MiscServices {
+    /*! The single place where the input method framework looks up the system abilities it depends on.
+      \n By default it asks samgr. A test can put local objects in place of some abilities, e.g. a stub of
+      \n the input method service, the bundle manager or the ability manager. The proxies then call the
+      \n local stubs directly, so the editor, the service and the IME can run in one process.
+      \n In the isolated mode samgr is never asked, and an ability without a local object is not found.
+    */
+    class ServiceLocator {
+    public:
+        static sptr<IRemoteObject> GetSystemAbility(int32_t systemAbilityId);
+        static void SetLocalAbility(int32_t systemAbilityId, const sptr<IRemoteObject> &object);
+        static void SetIsolated(bool isolated);
+        static void Reset();
+
+    private:
+        static std::mutex lock_;
+        static std::map<int32_t, sptr<IRemoteObject>> localAbilities_;
+        static bool isolated_;
+
+        ServiceLocator() = delete;
+    };
+} // namespace MiscServices
+} // namespace OHOS
+#endif // SERVICES_INCLUDE_SERVICE_LOCATOR_H
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file shared_ring.h */
+#ifndef SERVICES_INCLUDE_SHARED_RING_H
+#define SERVICES_INCLUDE_SHARED_RING_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include "message_parcel.h"
+
+namespace OHOS {
+namespace MiscServices {
+    /*! A single-producer single-consumer ring of requests in memory shared by two processes.
+      \n The memory is a memfd mapped by both sides. One eventfd wakes up the reader and another one wakes up the
+      \n writer waiting for room, each only when that side is asleep, so a busy stream of requests does not enter
+      \n the kernel at all. Each record is the code and the flat data
+      \n of a MessageParcel, and it never wraps around the end of the ring, so the reader copies it in one go.
+      \n The data must not carry remote objects or file descriptors, these still go through binder.
+    */
+    class SharedRing {
+    public:
+        static const uint32_t DEFAULT_CAPACITY = 64 * 1024;
+        static const uint32_t MAX_RECORD_SIZE = 8 * 1024; // a larger request is sent through binder
+
+        static SharedRing *Create(uint32_t capacity = DEFAULT_CAPACITY);
+        static SharedRing *Attach(int memFd, int readerFd, int writerFd);
+        ~SharedRing();
+        bool Write(uint32_t code, MessageParcel &data, int32_t timeoutMs);
+        bool Read(uint32_t &code, MessageParcel &data, int32_t timeoutMs);
+        void Acknowledge();
+        bool WaitEmpty(int32_t timeoutMs);
+        void Wakeup();
+        int GetMemFd() const;
+        int GetReaderFd() const;
+        int GetWriterFd() const;
+        uint32_t GetCapacity() const;
+
+    private:
+        static const uint32_t MAGIC = 0x494d4652; // "IMFR"
+        static const uint32_t HEADER_SIZE = 256;
+        static const uint32_t CACHE_LINE_SIZE = 64;
+        static const uint32_t PADDING_CODE = UINT32_MAX; // fills the tail of the ring when a record does not fit
+
+        struct RingHeader {
+            uint32_t magic;
+            uint32_t capacity;
+            alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> writePos; // only the writer changes it
+            alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> readPos; // only the reader changes it
+            std::atomic<uint64_t> handledPos; // the reader has handled all the records before it
+            std::atomic<uint32_t> readerWaiting; // 1 - the reader is going to sleep on readerFd
+            std::atomic<uint32_t> writerWaiting; // 1 - the writer is going to sleep on writerFd
+        };
+        struct RecordHeader {
+            uint32_t size;
+            uint32_t code;
+        };
+
+        int memFd_;
+        int readerFd_;
+        int writerFd_;
+        RingHeader *header_;
+        uint8_t *records_;
+        uint32_t capacity_;
+        size_t mapSize_;
+        std::atomic<bool> woken_; // Wakeup is called, it is local to the process
+
+        SharedRing(int memFd, int readerFd, int writerFd, void *address, size_t mapSize);
+        bool WaitReadable(uint64_t readPos, int32_t timeoutMs);
+        bool WaitReader(const std::atomic<uint64_t> &readerPos, uint64_t target, int32_t timeoutMs);
+        void WakeupWriter();
+        SharedRing(const SharedRing&);
+        SharedRing& operator =(const SharedRing&);
+    };
+
+    /*! A thread which reads the requests from a SharedRing and hands them to a handler one by one
+    */
+    class SharedRingReceiver {
+    public:
+        using Handler = std::function<void(uint32_t code, MessageParcel &data)>;
+
+        SharedRingReceiver(SharedRing *ring, const Handler &handler);
+        ~SharedRingReceiver();
+
+    private:
+        static const int32_t POLL_INTERVAL_MS = 500;
+        std::unique_ptr<SharedRing> ring_;
+        Handler handler_;
+        std::atomic<bool> stop_;
+        std::thread thread_;
+
+        void Run();
+        SharedRingReceiver(const SharedRingReceiver&);
+        SharedRingReceiver& operator =(const SharedRingReceiver&);
+    };
+} // namespace MiscServices
+} // namespace OHOS
+#endif // SERVICES_INCLUDE_SHARED_RING_H
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file text_delta.h */
+#ifndef SERVICES_INCLUDE_TEXT_DELTA_H
+#define SERVICES_INCLUDE_TEXT_DELTA_H
+
+#include <string>
+#include "parcel.h"
+
+namespace OHOS {
+namespace MiscServices {
+    /*! A change of the editor text and selection, sent from the input client to the input method.
+      \n An incremental delta replaces [replaceBegin, replaceEnd) of the previous text with text, and must be applied
+      \n to the text of the previous delta, whose sequence number is one less. A full sync carries the whole text and
+      \n can be applied to anything, so the input method can recover from a lost or reordered delta.
+      \n Every delta carries the id of the last edit of the input method which the editor had applied when the delta
+      \n was built, so the input method knows whether the text has its edits.
+    */
+    class TextDelta : public Parcelable {
+    public:
+        static const uint32_t RESYNC_INTERVAL = 64; // the max number of incremental deltas between two full syncs
+
+        TextDelta();
+        TextDelta(bool fullSync, int32_t replaceBegin, int32_t replaceEnd, const std::u16string& text);
+        TextDelta(const TextDelta& delta);
+        TextDelta& operator =(const TextDelta& delta);
+        ~TextDelta();
+        bool Marshalling(Parcel &parcel) const override;
+        static TextDelta *Unmarshalling(Parcel &parcel);
+        bool ReadFromParcel(Parcel &parcel);
+        static TextDelta Diff(const std::u16string& oldText, const std::u16string& newText);
+        static TextDelta FullSync(const std::u16string& text);
+        bool ApplyTo(std::u16string& text) const;
+        void SetSequence(uint64_t sequence);
+        void SetAckedEdit(uint64_t editId);
+        void SetSelection(int32_t oldBegin, int32_t oldEnd, int32_t newBegin, int32_t newEnd);
+        uint64_t GetSequence() const;
+        uint64_t GetAckedEdit() const;
+        bool IsFullSync() const;
+        int32_t GetReplaceBegin() const;
+        int32_t GetReplaceEnd() const;
+        const std::u16string& GetText() const;
+        int32_t GetOldBegin() const;
+        int32_t GetOldEnd() const;
+        int32_t GetNewBegin() const;
+        int32_t GetNewEnd() const;
+
+    private:
+        uint64_t mSequence;
+        uint64_t mAckedEdit;
+        bool mFullSync;
+        int32_t mReplaceBegin;
+        int32_t mReplaceEnd;
+        std::u16string mText;
+        int32_t mOldBegin;
+        int32_t mOldEnd;
+        int32_t mNewBegin;
+        int32_t mNewEnd;
+    };
+} // namespace MiscServices
+} // namespace OHOS
+#endif // SERVICES_INCLUDE_TEXT_DELTA_H
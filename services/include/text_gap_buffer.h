@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file text_gap_buffer.h */
+#ifndef SERVICES_INCLUDE_TEXT_GAP_BUFFER_H
+#define SERVICES_INCLUDE_TEXT_GAP_BUFFER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace OHOS {
+namespace MiscServices {
+    /*! A UTF-16 text buffer with a movable gap.
+      \n Edits near the previous edit only move the characters between the two positions, so typing at the cursor
+      \n costs the length of the typed text, not the length of the document.
+    */
+    class TextGapBuffer {
+    public:
+        TextGapBuffer();
+        ~TextGapBuffer();
+        void Assign(const std::u16string& text);
+        bool Replace(size_t begin, size_t end, const std::u16string& text);
+        std::u16string Substr(size_t pos, size_t length) const;
+        std::u16string ToString() const;
+        size_t Size() const;
+        void Clear();
+
+    private:
+        static const size_t MIN_GAP_SIZE = 64;
+        std::vector<char16_t> buffer_;
+        size_t gapBegin_;
+        size_t gapEnd_;
+
+        void MoveGap(size_t pos);
+        void GrowGap(size_t length);
+    };
+} // namespace MiscServices
+} // namespace OHOS
+#endif // SERVICES_INCLUDE_TEXT_GAP_BUFFER_H
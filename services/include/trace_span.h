@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file trace_span.h */
+#ifndef SERVICES_INCLUDE_TRACE_SPAN_H
+#define SERVICES_INCLUDE_TRACE_SPAN_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace OHOS {
+namespace MiscServices {
+    /*! A timed step of a traced request */
+    struct TraceEvent {
+        uint64_t traceId = 0; // the request the step belongs to
+        const char *name = nullptr; // a string literal naming the step
+        int64_t beginNs = 0; // CLOCK_MONOTONIC, the same clock in every process of the device
+        int64_t endNs = 0;
+        int32_t arg = 0; // the message id of a queue wait, 0 otherwise
+        int32_t tid = 0;
+    };
+
+    /*! Recorder of the trace events of this process
+      \n A request gets a trace id where it starts, such as InputMethodController::StartInput, and the id
+      \n travels with it in the parcels and the messages. Every hop records its steps: the IPC time from the
+      \n sender, the wait in a message queue and the handler time.
+      \n Each thread records into its own ring of events, overwriting the oldest one, without any lock. The
+      \n rings can be dumped as text or exported as a Chrome trace (chrome://tracing, Perfetto).
+      \n The recording is disabled by default, the processes enable it by the parameter persist.sys.ime_trace.
+      \n The service exports its trace by its dump, the controller and the ability ones write it into a file
+      \n of EXPORT_DIR at the end of each input session.
+    */
+    class TraceRecorder {
+    public:
+        static constexpr uint32_t RING_CAPACITY = 1024; // the events kept for each thread
+        static constexpr const char *EXPORT_DIR = "/data/local/tmp";
+
+        static TraceRecorder *Instance();
+        static uint64_t NewTraceId();
+        static int64_t NowNs();
+        static uint64_t GetCurrentTraceId();
+        static void SetCurrentTraceId(uint64_t traceId);
+
+        void Record(uint64_t traceId, const char *name, int64_t beginNs, int64_t endNs, int32_t arg = 0);
+        void SetEnabled(bool enabled);
+        bool IsEnabled() const;
+        void Snapshot(std::vector<TraceEvent> &events);
+        void Clear();
+        void Dump(int fd);
+        std::string ExportChromeTrace();
+        bool ExportToFile(const std::string &dir);
+
+    private:
+        struct Slot {
+            std::atomic<uint32_t> sequence; // odd while the slot is being written
+            std::atomic<uint64_t> traceId;
+            std::atomic<const char*> name;
+            std::atomic<int64_t> beginNs;
+            std::atomic<int64_t> endNs;
+            std::atomic<int32_t> arg;
+            std::atomic<int32_t> tid;
+        };
+        struct ThreadRing {
+            Slot slots[RING_CAPACITY];
+            std::atomic<uint64_t> head; // the number of events recorded, only written by the owner thread
+            std::atomic<bool> owned; // a ring whose thread exited is reused by the next new thread
+            int32_t tid; // the owner thread
+        };
+        friend struct ThreadRingHolder;
+
+        std::mutex ringsLock_; // guards rings_, it's only taken by the first record of a thread and the readers
+        std::vector<ThreadRing*> rings_;
+        std::atomic<bool> enabled_;
+        std::atomic<int64_t> clearedNs_; // the events which began before it are not reported
+
+        TraceRecorder();
+        ~TraceRecorder();
+        ThreadRing *GetThreadRing();
+        ThreadRing *AcquireRing();
+
+        TraceRecorder(const TraceRecorder&);
+        TraceRecorder& operator =(const TraceRecorder&);
+        TraceRecorder(const TraceRecorder&&);
+        TraceRecorder& operator =(const TraceRecorder&&);
+    };
+
+    /*! A step of a traced request, recorded when it goes out of scope
+      \n The trace id is the current one of the thread during the scope, so the proxies called in it carry
+      \n it to the next hop. A span with trace id 0 records nothing.
+    */
+    class TraceSpan {
+    public:
+        TraceSpan(uint64_t traceId, const char *name);
+        ~TraceSpan();
+
+    private:
+        uint64_t traceId_;
+        uint64_t parentTraceId_;
+        const char *name_;
+        int64_t beginNs_ = 0;
+
+        TraceSpan(const TraceSpan&);
+        TraceSpan& operator =(const TraceSpan&);
+        TraceSpan(const TraceSpan&&);
+        TraceSpan& operator =(const TraceSpan&&);
+    };
+} // namespace MiscServices
+} // namespace OHOS
+#endif // SERVICES_INCLUDE_TRACE_SPAN_H
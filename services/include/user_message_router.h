@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file user_message_router.h */
+#ifndef SERVICES_INCLUDE_USER_MESSAGE_ROUTER_H
+#define SERVICES_INCLUDE_USER_MESSAGE_ROUTER_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+
+#include "message.h"
+#include "message_handler.h"
+
+namespace OHOS {
+namespace MiscServices {
+    /*! \class UserMessageRouter
+    \brief The work threads of the user sessions, and the route of the client messages to them.
+
+    \n A client message goes to the work thread of its user directly when the user has one, otherwise it goes
+        through the work thread of the service, which hands it over once the user has a thread.
+    \n While a message of a user is on the way through the service thread, the following messages of the
+        user take the same way, so the requests of a client are never reordered by taking different ways.
+    */
+    class UserMessageRouter {
+    public:
+        using HandlerFactory = std::function<MessageHandler *()>;
+
+        explicit UserMessageRouter(MessageHandler *serviceHandler);
+        ~UserMessageRouter();
+        bool AddHandler(int32_t userId, const HandlerFactory &factory);
+        MessageHandler *RemoveHandler(int32_t userId);
+        std::map<int32_t, MessageHandler *> RemoveAll();
+        bool HasHandler(int32_t userId);
+        void Dispatch(int32_t userId, Message *msg);
+        bool HandOver(int32_t userId, MessagePtr msg);
+        bool Send(int32_t userId, MessagePtr msg);
+        int32_t GetForwardingCount(int32_t userId);
+
+    private:
+        MessageHandler *serviceHandler_;
+        std::mutex lock_;
+        std::map<int32_t, MessageHandler *> handlers_; // the work thread of each user session
+        std::map<int32_t, int32_t> forwarding_; // client messages of each user queued in the service thread
+
+        UserMessageRouter(const UserMessageRouter&);
+        UserMessageRouter& operator =(const UserMessageRouter&);
+        UserMessageRouter(const UserMessageRouter&&);
+        UserMessageRouter& operator =(const UserMessageRouter&&);
+    };
+} // namespace MiscServices
+} // namespace OHOS
+#endif // SERVICES_INCLUDE_USER_MESSAGE_ROUTER_H
@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "client_registry.h"
+#include <algorithm>
+
+namespace OHOS {
+namespace MiscServices {
+    /*! Constructor
+    */
+    ClientRegistry::ClientRegistry() : snapshot_(std::make_shared<const ClientList>())
+    {
+    }
+
+    /*! Destructor
+    */
+    ClientRegistry::~ClientRegistry()
+    {
+    }
+
+    /*! Add an input client
+    \param object the remote object of the input client, used as the key
+    \param info the details of the input client
+    \return true - the client is added
+    \n      false - the client is already registered, or the parameters are null
+    */
+    bool ClientRegistry::Add(const sptr<IRemoteObject>& object, const std::shared_ptr<ClientInfo>& info)
+    {
+        if (!object || !info) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(lock_);
+        if (!clients_.emplace(object.GetRefPtr(), Entry { object, info }).second) {
+            return false;
+        }
+        AddToIndex(pidIndex_, info->pid, info);
+        if (info->attribute.GetSecurityFlag()) {
+            securityCount_++;
+        }
+        snapshot_ = nullptr;
+        return true;
+    }
+
+    /*! Remove an input client
+    \param object the remote object of the input client
+    \return the details of the client removed, null if it's not found
+    */
+    std::shared_ptr<ClientInfo> ClientRegistry::Remove(const sptr<IRemoteObject>& object)
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        auto it = clients_.find(object.GetRefPtr());
+        if (it == clients_.end()) {
+            return nullptr;
+        }
+        std::shared_ptr<ClientInfo> info = it->second.info;
+        clients_.erase(it);
+        RemoveFromIndex(pidIndex_, info->pid, info);
+        if (info->attribute.GetSecurityFlag()) {
+            securityCount_--;
+        }
+        snapshot_ = nullptr;
+        return info;
+    }
+
+    /*! Find an input client by its remote object
+    \param object the remote object of the input client
+    \return the details of the client, null if it's not found
+    */
+    std::shared_ptr<ClientInfo> ClientRegistry::Find(const sptr<IRemoteObject>& object) const
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        auto it = clients_.find(object.GetRefPtr());
+        if (it == clients_.end()) {
+            return nullptr;
+        }
+        return it->second.info;
+    }
+
+    /*! Find the input clients of a process
+    \param pid the process id
+    \return the clients running in the process
+    */
+    ClientRegistry::ClientList ClientRegistry::FindByPid(int pid) const
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        auto it = pidIndex_.find(pid);
+        return it == pidIndex_.end() ? ClientList() : it->second;
+    }
+
+    /*! Get all the input clients
+    \return an immutable list of the clients, it can be iterated without lock while clients are added or removed
+    */
+    std::shared_ptr<const ClientRegistry::ClientList> ClientRegistry::GetAll() const
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        if (!snapshot_) {
+            std::shared_ptr<ClientList> list = std::make_shared<ClientList>();
+            list->reserve(clients_.size());
+            for (auto it = clients_.begin(); it != clients_.end(); ++it) {
+                list->push_back(it->second.info);
+            }
+            snapshot_ = list;
+        }
+        return snapshot_;
+    }
+
+    /*! Get the number of the clients of one kind
+    \param securityFlag true - count the security clients, false - count the normal clients
+    */
+    int32_t ClientRegistry::GetCount(bool securityFlag) const
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        return securityFlag ? securityCount_ : static_cast<int32_t>(clients_.size()) - securityCount_;
+    }
+
+    /*! Get the number of all the clients
+    */
+    int32_t ClientRegistry::GetSize() const
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        return static_cast<int32_t>(clients_.size());
+    }
+
+    /*! Remove all the input clients
+    \return the clients removed
+    */
+    ClientRegistry::ClientList ClientRegistry::Clear()
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        ClientList list;
+        list.reserve(clients_.size());
+        for (auto it = clients_.begin(); it != clients_.end(); ++it) {
+            list.push_back(it->second.info);
+        }
+        clients_.clear();
+        pidIndex_.clear();
+        securityCount_ = 0;
+        snapshot_ = std::make_shared<const ClientList>();
+        return list;
+    }
+
+    /*! Add a client to a secondary index
+    \param index the index by pid
+    \param key the pid of the client
+    \param info the client
+    */
+    void ClientRegistry::AddToIndex(std::unordered_map<int, ClientList>& index, int key,
+                                    const std::shared_ptr<ClientInfo>& info)
+    {
+        index[key].push_back(info);
+    }
+
+    /*! Remove a client from a secondary index
+    \param index the index by pid
+    \param key the pid of the client
+    \param info the client
+    */
+    void ClientRegistry::RemoveFromIndex(std::unordered_map<int, ClientList>& index, int key,
+                                         const std::shared_ptr<ClientInfo>& info)
+    {
+        auto it = index.find(key);
+        if (it == index.end()) {
+            return;
+        }
+        ClientList &list = it->second;
+        list.erase(std::remove(list.begin(), list.end(), info), list.end());
+        if (list.empty()) {
+            index.erase(it);
+        }
+    }
+} // namespace MiscServices
+} // namespace OHOS
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "edit_operation.h"
+
+namespace OHOS {
+namespace MiscServices {
+    /*! Constructor
+    */
+    EditOperation::EditOperation() : mType(INSERT_TEXT), mValue(0)
+    {
+    }
+
+    /*! Constructor
+      \param type the type of the edit, see EditType
+      \param text the text to be inserted, used by INSERT_TEXT
+      \param value the length of DELETE_FORWARD and DELETE_BACKWARD, or the direction of MOVE_CURSOR
+    */
+    EditOperation::EditOperation(int32_t type, const std::u16string& text, int32_t value)
+        : mType(type), mText(text), mValue(value)
+    {
+    }
+
+    /*! Constructor from another instance
+      \param operation the source instance
+    */
+    EditOperation::EditOperation(const EditOperation& operation)
+    {
+        mType = operation.mType;
+        mText = operation.mText;
+        mValue = operation.mValue;
+    }
+
+    /*! Get value from another instance
+      \param operation source instance
+      \return return this
+    */
+    EditOperation& EditOperation::operator =(const EditOperation& operation)
+    {
+        if (this == &operation) {
+            return *this;
+        }
+        mType = operation.mType;
+        mText = operation.mText;
+        mValue = operation.mValue;
+        return *this;
+    }
+
+    /*! Destructor
+    */
+    EditOperation::~EditOperation()
+    {
+    }
+
+    /*! Write the details of object to parcel
+    */
+    bool EditOperation::Marshalling(Parcel &parcel) const
+    {
+        if (!(parcel.WriteInt32(mType)
+            && parcel.WriteString16(mText)
+            && parcel.WriteInt32(mValue)))
+            return false;
+        return true;
+    }
+
+    /*! Read the details of object from parcel
+      \param parcel read the details of object from this parcel
+      \return the object, or nullptr if its type is unknown
+    */
+    EditOperation *EditOperation::Unmarshalling(Parcel &parcel)
+    {
+        auto operation = new EditOperation();
+        if (!operation->ReadFromParcel(parcel)) {
+            delete operation;
+            return nullptr;
+        }
+        return operation;
+    }
+
+    /*! Write a batch of edits to parcel
+      \param parcel the parcel to write to
+      \param operations the edits in the order they are applied
+      \return false - there are more than MAX_BATCH_SIZE edits, or the parcel can not be written
+    */
+    bool EditOperation::WriteBatch(Parcel &parcel, const std::vector<EditOperation>& operations)
+    {
+        if (operations.size() > MAX_BATCH_SIZE || !parcel.WriteUint32(operations.size())) {
+            return false;
+        }
+        for (const auto &operation : operations) {
+            if (!operation.Marshalling(parcel)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /*! Read a batch of edits from parcel
+      \param parcel the parcel to read from
+      \param[out] operations the edits in the order they are applied
+      \return false - the batch is malformed, operations is cleared
+    */
+    bool EditOperation::ReadBatch(Parcel &parcel, std::vector<EditOperation>& operations)
+    {
+        operations.clear();
+        uint32_t size = parcel.ReadUint32();
+        if (size > MAX_BATCH_SIZE) {
+            return false;
+        }
+        operations.resize(size);
+        for (uint32_t i = 0; i < size; i++) {
+            if (!operations[i].ReadFromParcel(parcel)) {
+                operations.clear();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    int32_t EditOperation::GetType() const
+    {
+        return mType;
+    }
+
+    std::u16string EditOperation::GetText() const
+    {
+        return mText;
+    }
+
+    int32_t EditOperation::GetValue() const
+    {
+        return mValue;
+    }
+
+    bool EditOperation::ReadFromParcel(Parcel &parcel)
+    {
+        mType = parcel.ReadInt32();
+        mText = parcel.ReadString16();
+        mValue = parcel.ReadInt32();
+        return mType >= INSERT_TEXT && mType < EDIT_TYPE_COUNT;
+    }
+} // namespace MiscServices
+} // namespace OHOS
@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "editor_text_mirror.h"
+#include <algorithm>
+
+namespace OHOS {
+namespace MiscServices {
+    /*! Constructor
+    */
+    EditorTextMirror::EditorTextMirror()
+        : selectionBegin_(0), selectionEnd_(0), pendingEdit_(0), sequence_(0), fresh_(false), synced_(false)
+    {
+    }
+
+    /*! Destructor
+    */
+    EditorTextMirror::~EditorTextMirror()
+    {
+    }
+
+    /*! Replace the mirror with the latest text and selection of the editor
+    \n The text does not tell which edits it has, so the mirror keeps stale if an edit is still pending.
+      \param text the whole text of the editor
+      \param selectionBegin the begin of the selection, it is the cursor if nothing is selected
+      \param selectionEnd the end of the selection
+    */
+    void EditorTextMirror::Update(const std::u16string& text, int32_t selectionBegin, int32_t selectionEnd)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        text_.Assign(text);
+        selectionBegin_ = selectionBegin;
+        selectionEnd_ = selectionEnd;
+        fresh_ = pendingEdit_ == 0;
+        synced_ = false;
+    }
+
+    /*! Apply a change of the editor text and selection
+      \param delta the change reported by the editor
+      \return true - the delta is applied, the mirror is fresh if the editor has applied the last edit sent to it
+      \n      false - the delta does not follow the last applied one, the mirror keeps stale until the next full sync
+    */
+    bool EditorTextMirror::ApplyDelta(const TextDelta& delta)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (delta.IsFullSync()) {
+            text_.Assign(delta.GetText());
+        } else if (!synced_ || delta.GetSequence() != sequence_ + 1
+            || !text_.Replace(delta.GetReplaceBegin(), delta.GetReplaceEnd(), delta.GetText())) {
+            fresh_ = false;
+            synced_ = false;
+            return false;
+        }
+        selectionBegin_ = delta.GetNewBegin();
+        selectionEnd_ = delta.GetNewEnd();
+        sequence_ = delta.GetSequence();
+        if (delta.GetAckedEdit() == pendingEdit_) {
+            pendingEdit_ = 0;
+        }
+        fresh_ = pendingEdit_ == 0;
+        synced_ = true;
+        return true;
+    }
+
+    /*! Mark the mirror stale, because an edit is sent to the editor
+    \n It keeps stale until a delta reports that the editor has applied the edit. The edits reach the editor in the
+        order they are sent, so it is enough to wait for the last one.
+      \param editId the id of the edit, as it is sent with the edit
+    */
+    void EditorTextMirror::Invalidate(uint64_t editId)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        pendingEdit_ = editId;
+        fresh_ = false;
+    }
+
+    /*! Clear the mirror when the input method is bound to another editor
+    */
+    void EditorTextMirror::Reset()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        text_.Clear();
+        selectionBegin_ = 0;
+        selectionEnd_ = 0;
+        pendingEdit_ = 0;
+        sequence_ = 0;
+        fresh_ = false;
+        synced_ = false;
+    }
+
+    /*! Check if the mirror has the same text as the editor
+    */
+    bool EditorTextMirror::IsFresh() const
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return fresh_;
+    }
+
+    /*! Get the id of the last edit which the editor has not applied yet
+      \return 0 - the editor has applied all the edits sent to it
+    */
+    uint64_t EditorTextMirror::GetPendingEdit() const
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return pendingEdit_;
+    }
+
+    /*! Get the sequence number of the last applied delta
+    */
+    uint64_t EditorTextMirror::GetSequence() const
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return sequence_;
+    }
+
+    /*! Get the whole text of the mirror
+    */
+    std::u16string EditorTextMirror::GetText() const
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return text_.ToString();
+    }
+
+    /*! Get the text before the cursor from the mirror
+      \param number the max number of characters to get
+      \param[out] text the text before the cursor
+      \return false - the mirror is stale, the text should be got from the editor
+    */
+    bool EditorTextMirror::GetTextBeforeCursor(int32_t number, std::u16string& text) const
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!fresh_) {
+            return false;
+        }
+        if (selectionBegin_ <= 0 || number <= 0) {
+            text = u"";
+            return true;
+        }
+        size_t end = std::min(static_cast<size_t>(selectionBegin_), text_.Size());
+        size_t begin = (end > static_cast<size_t>(number)) ? (end - number) : 0;
+        text = text_.Substr(begin, end - begin);
+        return true;
+    }
+
+    /*! Get the text after the cursor from the mirror
+      \param number the max number of characters to get
+      \param[out] text the text after the cursor
+      \return false - the mirror is stale, the text should be got from the editor
+    */
+    bool EditorTextMirror::GetTextAfterCursor(int32_t number, std::u16string& text) const
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!fresh_) {
+            return false;
+        }
+        text = (selectionEnd_ < 0 || number <= 0) ? u"" : text_.Substr(selectionEnd_, number);
+        return true;
+    }
+
+    /*! Get at most number characters before cursor
+    \n The editor side and the input method side share it, so both of them answer the same query the same way.
+    */
+    std::u16string EditorTextMirror::GetTextBefore(const std::u16string& text, int32_t cursor, int32_t number)
+    {
+        if (cursor <= 0 || number <= 0) {
+            return u"";
+        }
+        size_t end = std::min(static_cast<size_t>(cursor), text.size());
+        size_t begin = (end > static_cast<size_t>(number)) ? (end - number) : 0;
+        return text.substr(begin, end - begin);
+    }
+
+    /*! Get at most number characters after cursor
+    */
+    std::u16string EditorTextMirror::GetTextAfter(const std::u16string& text, int32_t cursor, int32_t number)
+    {
+        if (cursor < 0 || number <= 0 || static_cast<size_t>(cursor) >= text.size()) {
+            return u"";
+        }
+        return text.substr(cursor, number);
+    }
+} // namespace MiscServices
+} // namespace OHOS
@@ -20,10 +20,15 @@
 #include "ipc_skeleton.h"
 #include "message_handler.h"
 #include "input_method_system_ability_stub.h"
+#include "string_ex.h"
 
 namespace OHOS {
 namespace MiscServices {
     using namespace MessageID;
+    namespace {
+        const std::string USER_ID_PARAM = "userId"; // the user a package event of the bundle manager is for
+        const int32_t MAIN_USER_ID = 100;
+    }
     sptr<ImCommonEventManager> ImCommonEventManager::instance_;
     std::mutex ImCommonEventManager::instanceLock_;
 
@@ -49,10 +54,16 @@ namespace MiscServices {
         return instance_;
     }
 
-    bool ImCommonEventManager::SubscribeEvent(const std::string &event)
+    /*! Subscribe to the common events the service handles
+    \param events the actions of the events, all received by one subscriber
+    \return true the events are subscribed
+    */
+    bool ImCommonEventManager::SubscribeEvent(const std::vector<std::string> &events)
     {
         EventFwk::MatchingSkills matchingSkills;
-        matchingSkills.AddEvent(event);
+        for (const auto &event : events) {
+            matchingSkills.AddEvent(event);
+        }
 
         EventFwk::CommonEventSubscribeInfo subscriberInfo(matchingSkills);
 
@@ -84,9 +95,50 @@ namespace MiscServices {
             // do something
             IMSA_HILOGI("ImCommonEventManager::EventSubscriber user switched!!!");
             startUser(data.GetCode());
+        } else if (action == EventFwk::CommonEventSupport::COMMON_EVENT_USER_UNLOCKED) {
+            unlockUser(data.GetCode());
+        } else if (action == EventFwk::CommonEventSupport::COMMON_EVENT_PACKAGE_ADDED ||
+            action == EventFwk::CommonEventSupport::COMMON_EVENT_PACKAGE_CHANGED) {
+            changePackage(MSG_ID_PACKAGE_ADDED, data);
+        } else if (action == EventFwk::CommonEventSupport::COMMON_EVENT_PACKAGE_REMOVED) {
+            changePackage(MSG_ID_PACKAGE_REMOVED, data);
         }
     }
 
+    /*! Send the unlock of a user to the work thread of the service, which pre-launches the default IME
+    \param userId the id of the unlocked user
+    */
+    void ImCommonEventManager::EventSubscriber::unlockUser(int32_t userId)
+    {
+        IMSA_HILOGI("ImCommonEventManager::unlockUser %{public}d", userId);
+        MessageParcel *parcel = new MessageParcel();
+        parcel->WriteInt32(userId);
+        Message *msg = new Message(MessageID::MSG_ID_USER_UNLOCK, parcel);
+        MessageHandler::Instance()->SendMessage(msg);
+    }
+
+    /*! Send a package event of the bundle manager to the work thread of the service, as the platform does
+    \n An updated package is handled as an added one: the IME list of the user is built again, and the
+    \n package is skipped by PerUserSetting if it's already known.
+    \param msgId MSG_ID_PACKAGE_ADDED or MSG_ID_PACKAGE_REMOVED
+    \param data the event, whose want has the bundle name and the user id
+    */
+    void ImCommonEventManager::EventSubscriber::changePackage(int32_t msgId, const EventFwk::CommonEventData &data)
+    {
+        auto want = data.GetWant();
+        std::string bundleName = want.GetElement().GetBundleName();
+        int32_t userId = want.GetIntParam(USER_ID_PARAM, MAIN_USER_ID);
+        IMSA_HILOGI("ImCommonEventManager::changePackage %{public}d %{public}s [%{public}d]", msgId,
+            bundleName.c_str(), userId);
+
+        MessageParcel *parcel = new MessageParcel();
+        parcel->WriteInt32(userId);
+        parcel->WriteInt32(1);
+        parcel->WriteString16(Str8ToStr16(bundleName));
+        Message *msg = new Message(msgId, parcel);
+        MessageHandler::Instance()->SendMessage(msg);
+    }
+
     void ImCommonEventManager::EventSubscriber::startUser(int newUserId)
     {
         IMSA_HILOGI("ImCommonEventManager::startUser 1");
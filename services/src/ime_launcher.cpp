@@ -0,0 +1,366 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ime_launcher.h"
+#include "global.h"
+
+namespace OHOS {
+namespace MiscServices {
+    /*! Constructor
+    \param start the handler requesting the ability start of an IME. It returns false if the request fails.
+    \param schedule the handler running a task after a delay
+    \param checkStandby the handler asking the session to check a standby IME, e.g. if it connected in time
+    */
+    ImeLauncher::ImeLauncher(StartHandler start, ScheduleHandler schedule, StandbyHandler checkStandby)
+        : start_(std::move(start)), schedule_(std::move(schedule)), checkStandby_(std::move(checkStandby)),
+          random_(std::random_device()())
+    {
+    }
+
+    /*! Destructor
+    */
+    ImeLauncher::~ImeLauncher()
+    {
+    }
+
+    /*! Launch an IME, unless it's already started or being started
+    \param imeId the id of the IME, as "bundleName/abilityName"
+    \return true - a new launch is started
+    \n      false - the IME is already connected or being started
+    */
+    bool ImeLauncher::Launch(const std::string &imeId)
+    {
+        std::unique_lock<std::mutex> lock(launcherLock_);
+        if (metrics_.imeId == imeId && state_ != STATE_IDLE) {
+            IMSA_HILOGI("ImeLauncher::Launch %{public}s already in state %{public}d", imeId.c_str(), state_);
+            return false;
+        }
+        uint64_t generation = ++generation_;
+        state_ = STATE_STARTING;
+        launchTime_ = Clock::now();
+        metrics_ = LaunchMetrics();
+        metrics_.imeId = imeId;
+        lock.unlock();
+
+        TryStart(generation);
+        return true;
+    }
+
+    /*! Restart an IME which died
+    \n The first crash is recovered at once. An IME crashing again within STABLE_RUN_MS is restarted after
+        GetRetryDelay of its crash count, so a crash loop doesn't keep the system busy.
+    \param imeId the id of the IME, as "bundleName/abilityName"
+    \return the delay in ms before the ability start is requested
+    */
+    int64_t ImeLauncher::Recover(const std::string &imeId)
+    {
+        std::unique_lock<std::mutex> lock(launcherLock_);
+        Clock::time_point now = Clock::now();
+        if (now - crashTime_ > std::chrono::milliseconds(STABLE_RUN_MS)) {
+            crashCount_ = 0;
+        }
+        crashCount_++;
+        crashTime_ = now;
+        int32_t crashes = crashCount_;
+        uint64_t generation = ++generation_;
+        state_ = STATE_BACKOFF;
+        launchTime_ = now;
+        metrics_ = LaunchMetrics();
+        metrics_.imeId = imeId;
+        lock.unlock();
+
+        if (crashes == 1) {
+            TryStart(generation);
+            return 0;
+        }
+        int64_t delay = GetRetryDelay(crashes - 1);
+        IMSA_HILOGW("ImeLauncher::Recover %{public}s crashed %{public}d times, restart in %{public}lld ms",
+            imeId.c_str(), crashes, (long long)delay);
+        ScheduleStart(generation, delay);
+        return delay;
+    }
+
+    /*! Called when the core and the agent of the IME are received
+    */
+    void ImeLauncher::OnConnected()
+    {
+        std::unique_lock<std::mutex> lock(launcherLock_);
+        if (state_ == STATE_CONNECTED) {
+            return;
+        }
+        bool launched = state_ != STATE_IDLE;
+        state_ = STATE_CONNECTED;
+        if (launched) {
+            metrics_.connectMs = ElapsedMs();
+            IMSA_HILOGI("ImeLauncher::OnConnected %{public}s in %{public}lld ms, %{public}d attempts",
+                metrics_.imeId.c_str(), (long long)metrics_.connectMs, metrics_.attempts);
+        }
+    }
+
+    /*! Called when the IME is stopped or died. The pending retries are cancelled.
+    */
+    void ImeLauncher::OnDisconnected()
+    {
+        std::unique_lock<std::mutex> lock(launcherLock_);
+        generation_++;
+        state_ = STATE_IDLE;
+    }
+
+    /*! Called when the keyboard is shown. The first one after a launch gives the time to the first keyboard.
+    */
+    void ImeLauncher::OnKeyboardShown()
+    {
+        std::unique_lock<std::mutex> lock(launcherLock_);
+        if (state_ != STATE_CONNECTED || metrics_.connectMs < 0 || metrics_.firstKeyboardMs >= 0) {
+            return;
+        }
+        metrics_.firstKeyboardMs = ElapsedMs();
+        IMSA_HILOGI("ImeLauncher::OnKeyboardShown %{public}s first keyboard in %{public}lld ms",
+            metrics_.imeId.c_str(), (long long)metrics_.firstKeyboardMs);
+    }
+
+    /*! Called when the IME is switched to one already connected, such as a standby IME
+    \param imeId the id of the IME switched to
+    */
+    void ImeLauncher::OnSwitched(const std::string &imeId)
+    {
+        std::unique_lock<std::mutex> lock(launcherLock_);
+        generation_++;
+        state_ = STATE_CONNECTED;
+        launchTime_ = Clock::now();
+        metrics_ = LaunchMetrics();
+        metrics_.imeId = imeId;
+        metrics_.connectMs = 0;
+    }
+
+    /*! Start an IME kept in the background. It's not retried.
+    \n The ability start is requested in a task, not in the caller's thread. The session is asked to check the
+        IME at once if the request fails, otherwise after CONNECT_TIMEOUT_MS.
+    \param imeId the id of the IME, as "bundleName/abilityName"
+    \param launchId the id the session gives to this start, passed back to its check
+    \return true - the start is scheduled
+    */
+    bool ImeLauncher::StartStandby(const std::string &imeId, uint64_t launchId)
+    {
+        std::unique_lock<std::mutex> lock(launcherLock_);
+        if (imeId.empty() || imeId == metrics_.imeId || !schedule_) {
+            return false;
+        }
+        lock.unlock();
+        std::weak_ptr<ImeLauncher> weak = weak_from_this();
+        schedule_([weak, imeId, launchId]() {
+            auto launcher = weak.lock();
+            if (launcher) {
+                launcher->TryStartStandby(imeId, launchId);
+            }
+        }, 0);
+        return true;
+    }
+
+    /*! Ask the session to check a standby IME after a delay
+    \param imeId the id of the standby IME
+    \param launchId the id the session gave to its start
+    \param delayMs the delay in milliseconds
+    */
+    void ImeLauncher::ScheduleStandbyCheck(const std::string &imeId, uint64_t launchId, int64_t delayMs)
+    {
+        if (!schedule_ || !checkStandby_) {
+            return;
+        }
+        std::weak_ptr<ImeLauncher> weak = weak_from_this();
+        schedule_([weak, imeId, launchId]() {
+            auto launcher = weak.lock();
+            if (launcher) {
+                launcher->checkStandby_(imeId, launchId);
+            }
+        }, delayMs);
+    }
+
+    /*! Run a task after a delay, in the event loop of the launcher
+    \n The task is run at once if the launcher has no schedule handler.
+    \param task the task
+    \param delayMs the delay in milliseconds
+    */
+    void ImeLauncher::Schedule(std::function<void()> task, int64_t delayMs)
+    {
+        if (!schedule_) {
+            task();
+            return;
+        }
+        schedule_(std::move(task), delayMs);
+    }
+
+    /*! Get the id of the IME launched last
+    */
+    std::string ImeLauncher::GetImeId()
+    {
+        std::unique_lock<std::mutex> lock(launcherLock_);
+        return metrics_.imeId;
+    }
+
+    /*! Get the connection state of the IME
+    \return one of ConnectionState
+    */
+    int32_t ImeLauncher::GetState()
+    {
+        std::unique_lock<std::mutex> lock(launcherLock_);
+        return state_;
+    }
+
+    /*! Get the timings of the last launch
+    */
+    ImeLauncher::LaunchMetrics ImeLauncher::GetMetrics()
+    {
+        std::unique_lock<std::mutex> lock(launcherLock_);
+        return metrics_;
+    }
+
+    /*! Get the delay before retrying a failed start
+    \param attempt the number of starts failed so far, from 1
+    \return a random delay in [d/2, d], where d doubles on every attempt from BASE_RETRY_DELAY_MS
+    \n      up to MAX_RETRY_DELAY_MS
+    */
+    int64_t ImeLauncher::GetRetryDelay(int32_t attempt)
+    {
+        int64_t delay = BASE_RETRY_DELAY_MS;
+        for (int32_t i = 1; i < attempt && delay < MAX_RETRY_DELAY_MS; i++) {
+            delay <<= 1;
+        }
+        if (delay > MAX_RETRY_DELAY_MS) {
+            delay = MAX_RETRY_DELAY_MS;
+        }
+        std::uniform_int_distribution<int64_t> jitter(0, delay / 2);
+        std::unique_lock<std::mutex> lock(launcherLock_);
+        return delay - delay / 2 + jitter(random_);
+    }
+
+    /*! Request the ability start of the IME
+    \param generation the launch the request belongs to
+    */
+    void ImeLauncher::TryStart(uint64_t generation)
+    {
+        std::unique_lock<std::mutex> lock(launcherLock_);
+        if (generation != generation_ || state_ == STATE_CONNECTED || state_ == STATE_IDLE) {
+            return;
+        }
+        state_ = STATE_STARTING;
+        metrics_.attempts++;
+        std::string imeId = metrics_.imeId;
+        lock.unlock();
+
+        // the ability manager is called without the lock, SetCoreAndAgent may come before it returns
+        bool ret = start_ && start_(imeId);
+
+        lock.lock();
+        if (generation != generation_ || state_ != STATE_STARTING) {
+            return;
+        }
+        if (!ret) {
+            IMSA_HILOGE("ImeLauncher::TryStart %{public}s failed, attempt %{public}d", imeId.c_str(),
+                metrics_.attempts);
+            state_ = STATE_BACKOFF;
+            lock.unlock();
+            ScheduleRetry(generation);
+            return;
+        }
+        lock.unlock();
+
+        std::weak_ptr<ImeLauncher> weak = weak_from_this();
+        if (schedule_) {
+            schedule_([weak, generation]() {
+                auto launcher = weak.lock();
+                if (launcher) {
+                    launcher->CheckConnected(generation);
+                }
+            }, CONNECT_TIMEOUT_MS);
+        }
+    }
+
+    /*! Request the ability start of a standby IME
+    \param imeId the id of the standby IME
+    \param launchId the id the session gave to this start
+    */
+    void ImeLauncher::TryStartStandby(const std::string &imeId, uint64_t launchId)
+    {
+        if (!start_ || !start_(imeId)) {
+            IMSA_HILOGE("ImeLauncher::TryStartStandby %{public}s failed", imeId.c_str());
+            ScheduleStandbyCheck(imeId, launchId, 0);
+            return;
+        }
+        ScheduleStandbyCheck(imeId, launchId, CONNECT_TIMEOUT_MS);
+    }
+
+    /*! Retry the start if the IME has not connected in CONNECT_TIMEOUT_MS
+    \param generation the launch the check belongs to
+    */
+    void ImeLauncher::CheckConnected(uint64_t generation)
+    {
+        std::unique_lock<std::mutex> lock(launcherLock_);
+        if (generation != generation_ || state_ != STATE_STARTING) {
+            return;
+        }
+        IMSA_HILOGE("ImeLauncher::CheckConnected %{public}s not connected in %{public}lld ms",
+            metrics_.imeId.c_str(), (long long)CONNECT_TIMEOUT_MS);
+        state_ = STATE_BACKOFF;
+        lock.unlock();
+        ScheduleRetry(generation);
+    }
+
+    /*! Schedule the next start after the backoff delay
+    \n The launch is given up after MAX_START_ATTEMPTS, the launcher goes back to STATE_IDLE.
+    \param generation the launch the retry belongs to
+    */
+    void ImeLauncher::ScheduleRetry(uint64_t generation)
+    {
+        std::unique_lock<std::mutex> lock(launcherLock_);
+        int32_t attempts = metrics_.attempts;
+        if (attempts >= MAX_START_ATTEMPTS) {
+            IMSA_HILOGE("ImeLauncher::ScheduleRetry %{public}s not started in %{public}d attempts, given up",
+                metrics_.imeId.c_str(), attempts);
+            generation_++;
+            state_ = STATE_IDLE;
+            return;
+        }
+        lock.unlock();
+        ScheduleStart(generation, GetRetryDelay(attempts));
+    }
+
+    /*! Schedule a start after a delay
+    \param generation the launch the start belongs to
+    \param delayMs the delay in milliseconds
+    */
+    void ImeLauncher::ScheduleStart(uint64_t generation, int64_t delayMs)
+    {
+        if (!schedule_) {
+            return;
+        }
+        std::weak_ptr<ImeLauncher> weak = weak_from_this();
+        schedule_([weak, generation]() {
+            auto launcher = weak.lock();
+            if (launcher) {
+                launcher->TryStart(generation);
+            }
+        }, delayMs);
+    }
+
+    /*! Get the time since the launch in milliseconds
+    \note launcherLock_ is held by the caller.
+    */
+    int64_t ImeLauncher::ElapsedMs() const
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - launchTime_).count();
+    }
+} // namespace MiscServices
+} // namespace OHOS
@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "input_method_catalogue.h"
+#include "global.h"
+#include "utils.h"
+
+namespace OHOS {
+namespace MiscServices {
+    /*! Constructor
+    \param query the handler listing the IME extensions of a user from the bundle manager
+    \param resolve the handler resolving the label and description of an extension from its resources
+    */
+    InputMethodCatalogue::InputMethodCatalogue(QueryHandler query, ResolveHandler resolve)
+        : query_(std::move(query)), resolve_(std::move(resolve))
+    {
+    }
+
+    /*! Destructor
+    */
+    InputMethodCatalogue::~InputMethodCatalogue()
+    {
+        std::unique_lock<std::mutex> lock(catalogueLock_);
+        catalogues_.clear();
+    }
+
+    /*! List the IME extensions installed for a user
+    \param userId the id of the given user
+    \param[out] properties the IME extensions are appended to it. They are shared with the cache, not copied.
+    \return ErrorCode::NO_ERROR no error
+    \return ErrorCode::ERROR_STATUS_UNKNOWN_ERROR the bundle manager can't be queried
+    */
+    int32_t InputMethodCatalogue::List(int32_t userId, std::vector<InputMethodPropertyPtr> *properties)
+    {
+        ResolvedMap cached;
+        uint64_t generation = 0;
+        {
+            std::unique_lock<std::mutex> lock(catalogueLock_);
+            auto it = catalogues_.find(userId);
+            if (it == catalogues_.end()) {
+                it = catalogues_.emplace(userId, UserCatalogue()).first;
+                it->second.generation = ++generation_;
+            }
+            if (it->second.valid) {
+                properties->insert(properties->end(), it->second.properties.begin(), it->second.properties.end());
+                return ErrorCode::NO_ERROR;
+            }
+            cached = it->second.resolved;
+            generation = it->second.generation;
+        }
+
+        std::vector<InputMethodPropertyPtr> built;
+        ResolvedMap resolved;
+        bool complete = true;
+        int32_t ret = Build(userId, cached, built, resolved, complete);
+        if (ret != ErrorCode::NO_ERROR) {
+            return ret;
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(catalogueLock_);
+            auto it = catalogues_.find(userId);
+            // the list is kept only if no package event and no user removal came during the build
+            if (it != catalogues_.end() && it->second.generation == generation) {
+                it->second.properties = built;
+                it->second.resolved.swap(resolved);
+                // a partial list is still returned, but it's built again on the next query
+                it->second.valid = complete;
+            }
+        }
+        properties->insert(properties->end(), built.begin(), built.end());
+        return ErrorCode::NO_ERROR;
+    }
+
+    /*! Drop the cached list of a user, so that it's built again on the next query
+    \param userId the id of the given user
+    \note The resolved strings are kept, they are reused for the bundles whose version did not change.
+    */
+    void InputMethodCatalogue::Invalidate(int32_t userId)
+    {
+        std::unique_lock<std::mutex> lock(catalogueLock_);
+        auto it = catalogues_.find(userId);
+        if (it != catalogues_.end()) {
+            it->second.valid = false;
+            it->second.generation = ++generation_;
+        }
+    }
+
+    /*! Drop everything cached for a user
+    \param userId the id of the given user
+    */
+    void InputMethodCatalogue::RemoveUser(int32_t userId)
+    {
+        std::unique_lock<std::mutex> lock(catalogueLock_);
+        catalogues_.erase(userId);
+    }
+
+    /*! Build the list of a user from the bundle manager
+    \param userId the id of the given user
+    \param cached the strings resolved by the previous build
+    \param[out] properties the IME extensions of the user
+    \param[out] resolved the strings of the listed extensions
+    \param[out] complete false if the strings of an extension can't be resolved, the list is partial
+    \return ErrorCode::NO_ERROR no error
+    \return ErrorCode::ERROR_STATUS_UNKNOWN_ERROR the bundle manager can't be queried
+    \note catalogueLock_ is not held, the queries may take long.
+    */
+    int32_t InputMethodCatalogue::Build(int32_t userId, const ResolvedMap &cached,
+                                        std::vector<InputMethodPropertyPtr> &properties, ResolvedMap &resolved,
+                                        bool &complete)
+    {
+        std::vector<Extension> extensions;
+        if (!query_ || !query_(userId, extensions)) {
+            IMSA_HILOGE("InputMethodCatalogue::Build query failed [%{public}d]", userId);
+            return ErrorCode::ERROR_STATUS_UNKNOWN_ERROR;
+        }
+
+        for (const auto &extension : extensions) {
+            std::string key = extension.bundleName + "/" + extension.abilityName;
+            auto it = cached.find(key);
+            if (it != cached.end() && it->second.versionCode == extension.versionCode) {
+                resolved.emplace(key, it->second);
+            } else {
+                ResolvedExtension entry = { extension.versionCode, Resources() };
+                if (!resolve_ || !resolve_(extension, entry.resources)) {
+                    IMSA_HILOGE("InputMethodCatalogue::Build cannot resolve %{public}s", key.c_str());
+                    complete = false;
+                    break;
+                }
+                resolved.emplace(key, entry);
+            }
+            const Resources &resources = resolved[key].resources;
+
+            auto property = std::make_shared<InputMethodProperty>();
+            property->mPackageName = Utils::to_utf16(extension.bundleName);
+            property->mAbilityName = Utils::to_utf16(extension.abilityName);
+            property->labelId = extension.labelId;
+            property->descriptionId = extension.descriptionId;
+            property->label = Utils::to_utf16(resources.label);
+            property->description = Utils::to_utf16(resources.description);
+            properties.push_back(property);
+        }
+        return ErrorCode::NO_ERROR;
+    }
+} // namespace MiscServices
+} // namespace OHOS
@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "input_method_index.h"
+
+namespace OHOS {
+namespace MiscServices {
+    /*! Constructor
+    */
+    InputMethodIndex::InputMethodIndex()
+    {
+    }
+
+    /*! Destructor
+    */
+    InputMethodIndex::~InputMethodIndex()
+    {
+        Clear();
+    }
+
+    /*! Add an input method engine to the index
+    \param property the added input method engine
+    \note If the imeId or packageName is already indexed, the engine added first is found for it,
+    \n the same as a scan from the front of the installed engine list. The other one takes its place once it's
+    \n removed.
+    */
+    void InputMethodIndex::Add(const std::shared_ptr<InputMethodProperty>& property)
+    {
+        if (!property) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(lock_);
+        if (keyboardTypes.find(property.get()) == keyboardTypes.end()) {
+            imeIds[property->mImeId].push_back(property);
+            packageNames[property->mPackageName].push_back(property);
+        }
+        std::unordered_map<int32_t, int32_t>& types = keyboardTypes[property.get()];
+        types.clear();
+        for (int i = 0; i < (int)property->mTypes.size(); i++) {
+            if (property->mTypes[i]) {
+                types.emplace(property->mTypes[i]->getHashCode(), i);
+            }
+        }
+    }
+
+    /*! Remove an input method engine from the index
+    \param property the removed input method engine
+    \note It has to be called before the property is dropped by PerUserSetting.
+    */
+    void InputMethodIndex::Remove(const InputMethodProperty *property)
+    {
+        if (!property) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(lock_);
+        Erase(imeIds, property->mImeId, property);
+        Erase(packageNames, property->mPackageName, property);
+        keyboardTypes.erase(property);
+    }
+
+    /*! Remove all the input method engines from the index
+    */
+    void InputMethodIndex::Clear()
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        imeIds.clear();
+        packageNames.clear();
+        keyboardTypes.clear();
+    }
+
+    /*! Get the number of indexed input method engines
+    */
+    int32_t InputMethodIndex::Size() const
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        return keyboardTypes.size();
+    }
+
+    /*! Find an input method engine by its imeId
+    \param imeId the id of the given IME
+    \return a pointer of InputMethodProperty, null when the given IME is not found
+    */
+    std::shared_ptr<InputMethodProperty> InputMethodIndex::FindByImeId(const std::u16string& imeId) const
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        return Find(imeIds, imeId);
+    }
+
+    /*! Find an input method engine by its packageName
+    \param packageName the packageName of the given IME
+    \return a pointer of InputMethodProperty, null when the given IME is not found
+    */
+    std::shared_ptr<InputMethodProperty> InputMethodIndex::FindByPackageName(const std::u16string& packageName) const
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        return Find(packageNames, packageName);
+    }
+
+    /*! Get the position of a keyboard type in the type list of the given input method engine
+    \param property the given input method engine
+    \param hashCode the hashCode of the keyboard type
+    \return the position in property->mTypes, -1 when the keyboard type is not found
+    */
+    int32_t InputMethodIndex::GetKeyboardTypeIndex(const InputMethodProperty *property, int32_t hashCode) const
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        return FindKeyboardTypeIndex(property, hashCode);
+    }
+
+    /*! Find a keyboard type of the given input method engine by its hashCode
+    \param property the given input method engine
+    \param hashCode the hashCode of the keyboard type
+    \return a pointer of KeyboardType, null when the keyboard type is not found
+    */
+    KeyboardType *InputMethodIndex::FindKeyboardType(const InputMethodProperty *property, int32_t hashCode) const
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        int32_t index = FindKeyboardTypeIndex(property, hashCode);
+        if (index == -1) {
+            return nullptr;
+        }
+        return property->mTypes[index];
+    }
+
+    /*! Remove a property from the list of a key, and the key once its list is empty
+    */
+    void InputMethodIndex::Erase(std::unordered_map<std::u16string, PropertyList>& map, const std::u16string& key,
+                                 const InputMethodProperty *property)
+    {
+        auto it = map.find(key);
+        if (it == map.end()) {
+            return;
+        }
+        PropertyList& list = it->second;
+        for (auto item = list.begin(); item != list.end(); ++item) {
+            if (item->get() == property) {
+                list.erase(item);
+                break;
+            }
+        }
+        if (list.empty()) {
+            map.erase(it);
+        }
+    }
+
+    /*! Get the first added property of a key
+    */
+    std::shared_ptr<InputMethodProperty> InputMethodIndex::Find(
+        const std::unordered_map<std::u16string, PropertyList>& map, const std::u16string& key)
+    {
+        auto it = map.find(key);
+        if (it == map.end()) {
+            return nullptr;
+        }
+        return it->second.front();
+    }
+
+    /*! Get the position of a keyboard type, the caller holds lock_
+    */
+    int32_t InputMethodIndex::FindKeyboardTypeIndex(const InputMethodProperty *property, int32_t hashCode) const
+    {
+        auto it = keyboardTypes.find(property);
+        if (it == keyboardTypes.end()) {
+            return -1;
+        }
+        auto type = it->second.find(hashCode);
+        if (type == it->second.end()) {
+            return -1;
+        }
+        return type->second;
+    }
+} // namespace MiscServices
+} // namespace OHOS
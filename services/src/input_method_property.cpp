@@ -50,7 +50,7 @@ namespace MiscServices {
         label = property.label;
         description = property.description;
 
-        for (int i = 0; i < (int)mTypes.size(); i++) {
+        for (int i = 0; i < (int)property.mTypes.size(); i++) {
             KeyboardType *type = new KeyboardType(*property.mTypes[i]);
             mTypes.push_back(type);
         }
@@ -77,6 +77,10 @@ namespace MiscServices {
         description = property.description;
 
         for (int i = 0; i < (int)mTypes.size(); i++) {
+            delete mTypes[i];
+        }
+        mTypes.clear();
+        for (int i = 0; i < (int)property.mTypes.size(); i++) {
             KeyboardType *type = new KeyboardType(*property.mTypes[i]);
             mTypes.push_back(type);
         }
@@ -135,9 +139,65 @@ namespace MiscServices {
         if (!size)
             return info;
         for (int i = 0; i < size; i++) {
-            info->mTypes.push_back(parcel.ReadParcelable<KeyboardType>());
+            KeyboardType *type = parcel.ReadParcelable<KeyboardType>();
+            if (type) {
+                info->mTypes.push_back(type);
+            }
         }
         return info;
     }
+
+    /*! Write a list of InputMethodProperty to parcel
+    \param[out] parcel the list is written to this parcel, the size first
+    \param properties the list to be written
+    \return true - the list is written
+    */
+    bool InputMethodProperty::MarshallingList(Parcel &parcel, const std::vector<InputMethodPropertyPtr>& properties)
+    {
+        if (!parcel.WriteInt32((int32_t)properties.size())) {
+            return false;
+        }
+        for (const auto &property : properties) {
+            if (!parcel.WriteParcelable(property.get())) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /*! Read a list of InputMethodProperty from parcel
+    \param parcel read the list written by MarshallingList from this parcel
+    \param[out] properties the list read is appended to it, each element owned by its shared pointer
+    \return true - the whole list is read
+    */
+    bool InputMethodProperty::UnmarshallingList(Parcel &parcel, std::vector<InputMethodPropertyPtr> *properties)
+    {
+        int32_t size = parcel.ReadInt32();
+        for (int32_t i = 0; i < size; i++) {
+            InputMethodProperty *property = parcel.ReadParcelable<InputMethodProperty>();
+            if (!property) {
+                return false;
+            }
+            properties->push_back(InputMethodPropertyPtr(property));
+        }
+        return true;
+    }
+
+    /*! List the keyboard types of an input method engine
+    \param property the input method engine
+    \return the keyboard types. They share the ownership of property, no keyboard type is copied.
+    */
+    std::vector<KeyboardTypePtr> InputMethodProperty::ListKeyboardTypes(const InputMethodPropertyPtr& property)
+    {
+        std::vector<KeyboardTypePtr> types;
+        if (!property) {
+            return types;
+        }
+        types.reserve(property->mTypes.size());
+        for (int i = 0; i < (int)property->mTypes.size(); i++) {
+            types.push_back(KeyboardTypePtr(property, property->mTypes[i]));
+        }
+        return types;
+    }
 } // namespace MiscServices
 } // namespace OHOS
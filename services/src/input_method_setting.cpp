@@ -35,6 +35,8 @@ namespace MiscServices {
     InputMethodSetting::~InputMethodSetting()
     {
         setting.clear();
+        enabledImes.clear();
+        enabledImeIndex.clear();
     }
 
     /*! Constructor
@@ -42,7 +44,7 @@ namespace MiscServices {
     */
     InputMethodSetting::InputMethodSetting(const InputMethodSetting& inputMethodSetting)
     {
-        setting = inputMethodSetting.setting;
+        CopyFrom(inputMethodSetting);
     }
 
     /*! operator=
@@ -54,7 +56,7 @@ namespace MiscServices {
         if (this == &inputMethodSetting) {
             return *this;
         }
-        setting = inputMethodSetting.setting;
+        CopyFrom(inputMethodSetting);
         return *this;
     }
 
@@ -85,7 +87,7 @@ namespace MiscServices {
         for (int i = 0; i < size; i++) {
             std::u16string key = parcel.ReadString16();
             std::u16string value = parcel.ReadString16();
-            ims->setting.insert(std::pair<std::u16string, std::u16string>(key, value));
+            ims->SetValue(key, value);
         }
         return ims;
     }
@@ -97,6 +99,14 @@ namespace MiscServices {
     void InputMethodSetting::SetValue(const std::u16string& key, const std::u16string& value)
     {
         setting.insert_or_assign(key, value);
+        if (key == ENABLED_INPUT_METHODS_TAG) {
+            // the raw value replaces whatever was parsed, it's parsed again on the next query
+            enabledParsed = false;
+        } else if (key == CURRENT_KEYBOARD_TYPE_TAG) {
+            currentKeyboardType = ParseInt(value);
+        } else if (key == CURRENT_SYS_KEYBOARD_TYPE_TAG) {
+            currentSysKeyboardType = ParseInt(value);
+        }
     }
 
     /*! Get setting data for an item
@@ -134,13 +144,11 @@ namespace MiscServices {
     */
     std::vector<std::u16string> InputMethodSetting::GetEnabledInputMethodList()
     {
-        std::u16string value = GetValue(ENABLED_INPUT_METHODS_TAG);
-        std::vector<std::u16string> tmp1 = Split(value, DELIM_IME);
+        ParseEnabledInputMethods();
         std::vector<std::u16string> imeList;
-        for (int i = 0; i < (int)tmp1.size(); i++) {
-            std::vector<std::u16string> tmp2 = Split(tmp1[i], DELIM_KBD_TYPE);
-            imeList.push_back(tmp2[0]);
-            tmp2.clear();
+        imeList.reserve(enabledImes.size());
+        for (int i = 0; i < (int)enabledImes.size(); i++) {
+            imeList.push_back(enabledImes[i].imeId);
         }
         return imeList;
     }
@@ -153,32 +161,26 @@ namespace MiscServices {
     */
     bool InputMethodSetting::AddEnabledInputMethod(const std::u16string& imeId, const std::vector<int32_t>& types)
     {
-        std::u16string str = GetValue(ENABLED_INPUT_METHODS_TAG);
-        std::vector<std::u16string> imeList = Split(str, DELIM_IME);
-
-        std::u16string typeStr;
-        for (int i = 0; i < (int)types.size(); i++) {
-            typeStr = typeStr + u";" + Utils::to_utf16(std::to_string(types[i]));
-        }
-        std::u16string imeStr = imeId + typeStr;
-        bool flag = false;
-        for (int i = 0; i < (int)imeList.size(); i++) {
-            if (imeList[i] == imeStr) {
+        ParseEnabledInputMethods();
+        EnabledIme *ime = nullptr;
+        auto it = enabledImeIndex.find(imeId);
+        if (it != enabledImeIndex.end()) {
+            ime = &enabledImes[it->second];
+            if (ime->types == types) {
                 return false;
             }
-            if (imeList[i].find_first_of(imeId)) {
-                imeList[i] = imeStr;
-                flag = true;
-                break;
-            }
+        } else {
+            enabledImeIndex[imeId] = enabledImes.size();
+            enabledImes.emplace_back();
+            ime = &enabledImes.back();
+            ime->imeId = imeId;
         }
-        if (!flag) {
-            imeList.push_back(imeStr);
+        ime->types = types;
+        ime->typeIndex.clear();
+        for (int i = 0; i < (int)types.size(); i++) {
+            ime->typeIndex.emplace(types[i], i);
         }
-
-        std::u16string value = BuildString(imeList, DELIM_IME);
-        SetValue(ENABLED_INPUT_METHODS_TAG, value);
-        imeList.clear();
+        FlushEnabledInputMethods();
         return true;
     }
 
@@ -189,23 +191,15 @@ namespace MiscServices {
     */
     bool InputMethodSetting::RemoveEnabledInputMethod(const std::u16string& imeId)
     {
-        std::u16string str = GetValue(ENABLED_INPUT_METHODS_TAG);
-        std::vector<std::u16string> imeList = Split(str, DELIM_IME);
-        bool flag = false;
-        std::vector<std::u16string>::iterator it;
-        for (it = imeList.begin(); it < imeList.end(); ++it) {
-            if (it->find_first_of(imeId)) {
-                imeList.erase(it);
-                flag = true;
-                break;
-            }
-        }
-        if (flag) {
-            std::u16string value = BuildString(imeList, DELIM_IME);
-            SetValue(ENABLED_INPUT_METHODS_TAG, value);
+        ParseEnabledInputMethods();
+        auto it = enabledImeIndex.find(imeId);
+        if (it == enabledImeIndex.end()) {
+            return false;
         }
-        imeList.clear();
-        return flag;
+        enabledImes.erase(enabledImes.begin() + it->second);
+        RebuildEnabledImeIndex();
+        FlushEnabledInputMethods();
+        return true;
     }
 
     /*! Get the keyboard type list of the given input method engine
@@ -214,31 +208,59 @@ namespace MiscServices {
     */
     std::vector<int32_t> InputMethodSetting::GetEnabledKeyboardTypes(const std::u16string& imeId)
     {
-        std::vector<int32_t> retValue;
-        std::u16string value = GetValue(ENABLED_INPUT_METHODS_TAG);
-        std::vector<std::u16string> tmpVector = Split(value, DELIM_IME);
-        bool flag = false;
-        std::u16string imeStr;
-        for (int i = 0; i < (int)tmpVector.size(); i++) {
-            if (tmpVector[i].find_first_of(imeId) != std::u16string::npos) {
-                flag = true;
-                imeStr = tmpVector[i];
-                break;
-            }
+        const EnabledIme *ime = FindEnabledIme(imeId);
+        if (!ime) {
+            return std::vector<int32_t>();
         }
-        tmpVector.clear();
-        if (!flag) {
-            return retValue;
+        return ime->types;
+    }
+
+    /*! Get the number of enabled keyboard types of the given input method engine
+    \param imeId the ime id of the given input method engine
+    \return the number of keyboard types, 0 if the ime is not enabled
+    */
+    int32_t InputMethodSetting::GetEnabledKeyboardTypeCount(const std::u16string& imeId)
+    {
+        const EnabledIme *ime = FindEnabledIme(imeId);
+        if (!ime) {
+            return 0;
         }
+        return ime->types.size();
+    }
 
-        std::vector<std::u16string> tmp2 = Split(imeStr, DELIM_KBD_TYPE);
-        for (int i = 1; i < (int)tmp2.size(); i++) {
-            std::u16string str = tmp2[i];
-            retValue.push_back(std::atoi(Utils::to_utf8(str).c_str()));
+    /*! Get an enabled keyboard type of the given input method engine by its position
+    \param imeId the ime id of the given input method engine
+    \param index the position of the keyboard type in the enabled list
+    \param[out] hashCode the hashCode of the keyboard type
+    \return true - the keyboard type is found
+    \return false - the ime is not enabled or index is out of range
+    */
+    bool InputMethodSetting::GetEnabledKeyboardType(const std::u16string& imeId, int32_t index, int32_t& hashCode)
+    {
+        const EnabledIme *ime = FindEnabledIme(imeId);
+        if (!ime || index < 0 || index >= (int32_t)ime->types.size()) {
+            return false;
         }
-        tmp2.clear();
+        hashCode = ime->types[index];
+        return true;
+    }
 
-        return retValue;
+    /*! Get the position of a keyboard type in the enabled list of the given input method engine
+    \param imeId the ime id of the given input method engine
+    \param hashCode the hashCode of the keyboard type
+    \return the position of the keyboard type, -1 if it's not found
+    */
+    int32_t InputMethodSetting::GetKeyboardTypeIndex(const std::u16string& imeId, int32_t hashCode)
+    {
+        const EnabledIme *ime = FindEnabledIme(imeId);
+        if (!ime) {
+            return -1;
+        }
+        auto it = ime->typeIndex.find(hashCode);
+        if (it == ime->typeIndex.end()) {
+            return -1;
+        }
+        return it->second;
     }
 
     /*! Get the default keyboard type
@@ -246,8 +268,7 @@ namespace MiscServices {
     */
     int32_t InputMethodSetting::GetCurrentKeyboardType()
     {
-        std::u16string value = GetValue(CURRENT_KEYBOARD_TYPE_TAG);
-        return std::atoi(Utils::to_utf8(value).c_str());
+        return currentKeyboardType;
     }
 
     /*! Set the default keyboard type
@@ -264,8 +285,7 @@ namespace MiscServices {
     */
     int32_t InputMethodSetting::GetCurrentSysKeyboardType()
     {
-        std::u16string value = GetValue(CURRENT_SYS_KEYBOARD_TYPE_TAG);
-        return std::atoi(Utils::to_utf8(value).c_str());
+        return currentSysKeyboardType;
     }
 
     /*! Set the default keyboard type for security IME
@@ -282,6 +302,11 @@ namespace MiscServices {
     void InputMethodSetting::ClearData()
     {
         setting.clear();
+        enabledImes.clear();
+        enabledImeIndex.clear();
+        enabledParsed = false;
+        currentKeyboardType = 0;
+        currentSysKeyboardType = 0;
     }
 
     /*! Find if the key is in the setting
@@ -298,12 +323,108 @@ namespace MiscServices {
         return true;
     }
 
+    /*! Copy all the setting data, including the parsed enabled ime list
+    \param inputMethodSetting the source InputMethodSetting
+    */
+    void InputMethodSetting::CopyFrom(const InputMethodSetting& inputMethodSetting)
+    {
+        setting = inputMethodSetting.setting;
+        enabledImes = inputMethodSetting.enabledImes;
+        enabledImeIndex = inputMethodSetting.enabledImeIndex;
+        enabledParsed = inputMethodSetting.enabledParsed;
+        currentKeyboardType = inputMethodSetting.currentKeyboardType;
+        currentSysKeyboardType = inputMethodSetting.currentSysKeyboardType;
+    }
+
+    /*! Parse the enabled ime list from its serialized value if it's not parsed yet
+    */
+    void InputMethodSetting::ParseEnabledInputMethods()
+    {
+        if (enabledParsed) {
+            return;
+        }
+        enabledImes.clear();
+        std::map<std::u16string, std::u16string>::const_iterator it = setting.find(ENABLED_INPUT_METHODS_TAG);
+        if (it != setting.end()) {
+            std::vector<std::u16string> imeList = Split(it->second, DELIM_IME);
+            enabledImes.reserve(imeList.size());
+            for (int i = 0; i < (int)imeList.size(); i++) {
+                std::vector<std::u16string> tmp = Split(imeList[i], DELIM_KBD_TYPE);
+                if (tmp.empty()) {
+                    continue;
+                }
+                EnabledIme ime;
+                ime.imeId = tmp[0];
+                for (int j = 1; j < (int)tmp.size(); j++) {
+                    int32_t hashCode = ParseInt(tmp[j]);
+                    ime.typeIndex.emplace(hashCode, ime.types.size());
+                    ime.types.push_back(hashCode);
+                }
+                enabledImes.push_back(std::move(ime));
+            }
+        }
+        RebuildEnabledImeIndex();
+        enabledParsed = true;
+    }
+
+    /*! Write the parsed enabled ime list back to its serialized value
+    \n It's called by the methods which change the list, so the const readers of the raw value never write.
+    */
+    void InputMethodSetting::FlushEnabledInputMethods()
+    {
+        std::vector<std::u16string> imeList;
+        imeList.reserve(enabledImes.size());
+        for (int i = 0; i < (int)enabledImes.size(); i++) {
+            std::u16string imeStr = enabledImes[i].imeId;
+            for (int j = 0; j < (int)enabledImes[i].types.size(); j++) {
+                imeStr = imeStr + u";" + Utils::to_utf16(std::to_string(enabledImes[i].types[j]));
+            }
+            imeList.push_back(imeStr);
+        }
+        setting.insert_or_assign(ENABLED_INPUT_METHODS_TAG, BuildString(imeList, DELIM_IME));
+    }
+
+    /*! Rebuild the imeId index of the parsed enabled ime list
+    \note if an ime id is listed more than once, the first one wins.
+    */
+    void InputMethodSetting::RebuildEnabledImeIndex()
+    {
+        enabledImeIndex.clear();
+        for (int i = 0; i < (int)enabledImes.size(); i++) {
+            enabledImeIndex.emplace(enabledImes[i].imeId, i);
+        }
+    }
+
+    /*! Find an input method engine in the parsed enabled ime list
+    \param imeId the ime id of the given input method engine
+    \return the enabled ime, nullptr if it's not enabled
+    \note The returned pointer is only valid until the enabled ime list is changed.
+    */
+    const InputMethodSetting::EnabledIme *InputMethodSetting::FindEnabledIme(const std::u16string& imeId)
+    {
+        ParseEnabledInputMethods();
+        auto it = enabledImeIndex.find(imeId);
+        if (it == enabledImeIndex.end()) {
+            return nullptr;
+        }
+        return &enabledImes[it->second];
+    }
+
+    /*! Convert a setting value to an integer
+    \param value the setting value
+    \return the integer value, 0 if the value is not a number
+    */
+    int32_t InputMethodSetting::ParseInt(const std::u16string& value)
+    {
+        return std::atoi(Utils::to_utf8(value).c_str());
+    }
+
     /*! Split a string into a vector
     \param str the string to be split
     \param delim the alphabet to split the string.
     \return a vector of string
     */
-    std::vector<std::u16string> InputMethodSetting::Split(const std::u16string& str, char16_t delim)
+    std::vector<std::u16string> InputMethodSetting::Split(const std::u16string& str, char16_t delim) const
     {
         std::vector<std::u16string> retValue;
         std::u16string::size_type left, right;
@@ -328,7 +449,7 @@ namespace MiscServices {
     \delim a separator
     \return return a string
     */
-    std::u16string InputMethodSetting::BuildString(const std::vector<std::u16string>& vector, char16_t delim)
+    std::u16string InputMethodSetting::BuildString(const std::vector<std::u16string>& vector, char16_t delim) const
     {
         std::u16string retValue = u"";
         char16_t delimStr[] = {delim, 0};
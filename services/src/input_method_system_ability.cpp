@@ -24,6 +24,8 @@
 #include "ui_service_mgr_client.h"
 #include "bundle_mgr_proxy.h"
 #include "para_handle.h"
+#include "service_locator.h"
+#include "trace_span.h"
 #include "ability_manager_interface.h"
 #include "ability_connect_callback_proxy.h"
 #include "sa_mgr_client.h"
@@ -85,14 +87,11 @@ namespace MiscServices {
             setting = nullptr;
         }
         userSettings.clear();
-        std::map<int32_t, MessageHandler*>::const_iterator it2;
-        for (it2 = msgHandlers.cbegin(); it2 != msgHandlers.cend();) {
-            MessageHandler *handler = it2->second;
-            it2 = msgHandlers.erase(it2);
-            delete handler;
-            handler = nullptr;
+        std::map<int32_t, MessageHandler*> handlers = router_.RemoveAll();
+        for (auto &it2 : handlers) {
+            delete it2.second;
+            it2.second = nullptr;
         }
-        msgHandlers.clear();
     }
 
     sptr<InputMethodSystemAbility> InputMethodSystemAbility::GetInstance()
@@ -153,6 +152,37 @@ namespace MiscServices {
         IMSA_HILOGI("OnStop end.");
     }
 
+    /*! Dump the state of the service, e.g. by hidumper
+    \param fd the raw file descriptor that the dump is being sent to
+    \param args "-trace" dumps the recorded trace events in the Chrome trace event format,
+    \n which can be merged with the ones of IMC and IMA, as they share the monotonic clock.
+    \n Otherwise the recorded events and the last launch of the default IME of each user are dumped.
+    \return ErrorCode::NO_ERROR
+    */
+    int InputMethodSystemAbility::Dump(int fd, const std::vector<std::u16string> &args)
+    {
+        if (!args.empty() && args[0] == u"-trace") {
+            std::string json = TraceRecorder::Instance()->ExportChromeTrace();
+            dprintf(fd, "%s\n", json.c_str());
+            return ErrorCode::NO_ERROR;
+        }
+        TraceRecorder::Instance()->Dump(fd);
+        // the sessions are created and freed in the work thread, only their launchers are read here
+        std::map<int32_t, std::shared_ptr<ImeLauncher>> launchers;
+        {
+            std::lock_guard<std::mutex> lock(launchersLock_);
+            launchers = launchers_;
+        }
+        for (const auto &it : launchers) {
+            const std::shared_ptr<ImeLauncher> &launcher = it.second;
+            ImeLauncher::LaunchMetrics metrics = launcher->GetMetrics();
+            dprintf(fd, "user %d ime %s: state %d, %d starts, connected in %lld ms, first keyboard in %lld ms\n",
+                it.first, metrics.imeId.c_str(), launcher->GetState(), metrics.attempts,
+                (long long)metrics.connectMs, (long long)metrics.firstKeyboardMs);
+        }
+        return ErrorCode::NO_ERROR;
+    }
+
     void InputMethodSystemAbility::InitServiceHandler()
     {
         IMSA_HILOGI("InitServiceHandler started.");
@@ -171,13 +201,21 @@ namespace MiscServices {
     */
     void InputMethodSystemAbility::Initialize()
     {
+        int32_t logLevel = ParaHandle::GetLogLevel();
+        if (logLevel) {
+            SetLogLevel(logLevel);
+        }
+        TraceRecorder::Instance()->SetEnabled(ParaHandle::IsTraceEnabled());
         IMSA_HILOGI("InputMethodSystemAbility::Initialize");
+        InitCatalogue();
         // init work thread to handle the messages
         workThreadHandler = std::thread([this] {
             WorkThread();
         });
         PerUserSetting *setting = new PerUserSetting(MAIN_USER_ID);
         PerUserSession *session = new PerUserSession(MAIN_USER_ID);
+        session->SetImeLauncher(CreateImeLauncher(MAIN_USER_ID));
+        session->SetLazyHandshake(ParaHandle::IsLazyHandshake());
         userSettings.insert(std::pair<int32_t, PerUserSetting*>(MAIN_USER_ID, setting));
         userSessions.insert(std::pair<int32_t, PerUserSession*>(MAIN_USER_ID, session));
 
@@ -185,10 +223,89 @@ namespace MiscServices {
         setting->Initialize();
     }
 
+    /*! Create the cache of the IME extensions, backed by the bundle manager and the resource manager
+    */
+    void InputMethodSystemAbility::InitCatalogue()
+    {
+        auto query = [this](int32_t userId, std::vector<InputMethodCatalogue::Extension> &extensions) {
+            sptr<AppExecFwk::IBundleMgr> bundleMgr = GetBundleMgr();
+            if (!bundleMgr) {
+                return false;
+            }
+            std::vector<AppExecFwk::ExtensionAbilityInfo> extensionInfos;
+            if (!bundleMgr->QueryExtensionAbilityInfos(AppExecFwk::ExtensionAbilityType::SERVICE, userId,
+                extensionInfos)) {
+                IMSA_HILOGI("InputMethodSystemAbility::InitCatalogue QueryExtensionAbilityInfos error");
+                return false;
+            }
+            for (const auto &info : extensionInfos) {
+                InputMethodCatalogue::Extension extension;
+                extension.bundleName = info.bundleName;
+                extension.abilityName = info.name;
+                extension.versionCode = info.applicationInfo.versionCode;
+                extension.labelId = info.applicationInfo.labelId;
+                extension.descriptionId = info.applicationInfo.descriptionId;
+                extension.resourcePath = info.resourcePath;
+                extensions.push_back(extension);
+            }
+            return true;
+        };
+        auto resolve = [](const InputMethodCatalogue::Extension &extension,
+            InputMethodCatalogue::Resources &resources) {
+            std::shared_ptr<Global::Resource::ResourceManager> resourceManager(
+                Global::Resource::CreateResourceManager());
+            if (!resourceManager) {
+                IMSA_HILOGI("InputMethodSystemAbility::InitCatalogue resourcemanager is nullptr");
+                return false;
+            }
+            resourceManager->AddResource(extension.resourcePath.c_str());
+            resourceManager->GetStringById(extension.labelId, resources.label);
+            resourceManager->GetStringById(extension.descriptionId, resources.description);
+            return true;
+        };
+        catalogue_ = std::make_unique<InputMethodCatalogue>(query, resolve);
+    }
+
+    /*! Create the start pipeline of the default IME of a user session. The retries run in the service handler.
+    The launcher is listed for Dump until the user is stopped.
+    \param userId the id of the user
+    \return the launcher, shared with the session
+    */
+    std::shared_ptr<ImeLauncher> InputMethodSystemAbility::CreateImeLauncher(int32_t userId)
+    {
+        auto start = [this](const std::string &imeId) {
+            return StartImeAbility(imeId);
+        };
+        auto schedule = [this](std::function<void()> task, int64_t delayMs) {
+            if (serviceHandler_) {
+                serviceHandler_->PostTask(task, delayMs);
+            }
+        };
+        auto checkStandby = [this](const std::string &imeId, uint64_t launchId) {
+            MessageParcel *parcel = new MessageParcel();
+            parcel->WriteString16(Str8ToStr16(imeId));
+            parcel->WriteUint64(launchId);
+            SendSessionMessage(MAIN_USER_ID, new Message(MSG_ID_CHECK_STANDBY_IME, parcel));
+        };
+        std::shared_ptr<ImeLauncher> launcher = std::make_shared<ImeLauncher>(start, schedule, checkStandby);
+        std::lock_guard<std::mutex> lock(launchersLock_);
+        launchers_[userId] = launcher;
+        return launcher;
+    }
+
+    /*! Subscribe to the user switch and unlock, and to the package events of the bundle manager
+    \n The package events drop the cached IME list of the user, see OnPackageAdded and OnPackageRemoved.
+    */
     void InputMethodSystemAbility::StartUserIdListener()
     {
         sptr<ImCommonEventManager> imCommonEventManager = ImCommonEventManager::GetInstance();
-        bool isSuccess = imCommonEventManager->SubscribeEvent(EventFwk::CommonEventSupport::COMMON_EVENT_USER_SWITCHED);
+        bool isSuccess = imCommonEventManager->SubscribeEvent({
+            EventFwk::CommonEventSupport::COMMON_EVENT_USER_SWITCHED,
+            EventFwk::CommonEventSupport::COMMON_EVENT_USER_UNLOCKED,
+            EventFwk::CommonEventSupport::COMMON_EVENT_PACKAGE_ADDED,
+            EventFwk::CommonEventSupport::COMMON_EVENT_PACKAGE_CHANGED,
+            EventFwk::CommonEventSupport::COMMON_EVENT_PACKAGE_REMOVED,
+        });
         if (isSuccess) {
             IMSA_HILOGI("InputMethodSystemAbility::Initialize subscribe service event success");
             return;
@@ -205,38 +322,93 @@ namespace MiscServices {
 
         PerUserSession *session = GetUserSession(MAIN_USER_ID);
 
-        std::map<int32_t, MessageHandler*>::const_iterator it = msgHandlers.find(MAIN_USER_ID);
-        if (it == msgHandlers.end()) {
+        router_.AddHandler(MAIN_USER_ID, [session]() -> MessageHandler * {
             IMSA_HILOGE("InputMethodSystemAbility::StartInputService() need start handler");
-            MessageHandler *handler = new MessageHandler();
-            if (session) {
-                IMSA_HILOGE("InputMethodSystemAbility::OnPrepareInput session is not nullptr");
-                session->CreateWorkThread(*handler);
-                msgHandlers.insert(std::pair<int32_t, MessageHandler*>(MAIN_USER_ID, handler));
+            if (!session) {
+                return nullptr;
             }
+            MessageHandler *handler = new MessageHandler(MessageHandler::QUEUE_MODE_LOCK_FREE,
+                MessageHandler::FLAG_PRIORITIZED | MessageHandler::FLAG_COALESCING);
+            IMSA_HILOGE("InputMethodSystemAbility::OnPrepareInput session is not nullptr");
+            session->CreateWorkThread(*handler);
+            return handler;
+        });
+
+        // failed starts are retried by the launcher with a backoff
+        std::shared_ptr<ImeLauncher> launcher = session ? session->GetImeLauncher() : nullptr;
+        if (launcher) {
+            launcher->Launch(imeId);
         }
+    }
 
-        bool isStartSuccess = false;
+    /*! Request the ability manager to start an IME
+    \param imeId the id of the IME, as "bundleName/abilityName"
+    \return true - the start is requested
+    \n      false - the ability manager is not available, or the start is refused
+    */
+    bool InputMethodSystemAbility::StartImeAbility(const std::string &imeId)
+    {
         sptr<AAFwk::IAbilityManager> abms = GetAbilityManagerService();
-        if (abms) {
-            AAFwk::Want want;
-            want.SetAction("action.system.inputmethod");
-            std::string::size_type pos = imeId.find("/");
-            want.SetElementName(imeId.substr(0, pos), imeId.substr(pos + 1));
-            int32_t result = abms->StartAbility(want);
-            if (result) {
-                IMSA_HILOGE("InputMethodSystemAbility::StartInputService fail. result = %{public}d", result);
-                isStartSuccess = false;
-            } else {
-                isStartSuccess = true;
-            }
+        if (!abms) {
+            return false;
+        }
+        AAFwk::Want want;
+        want.SetAction("action.system.inputmethod");
+        std::string::size_type pos = imeId.find("/");
+        want.SetElementName(imeId.substr(0, pos), imeId.substr(pos + 1));
+        int32_t result = abms->StartAbility(want);
+        if (result) {
+            IMSA_HILOGE("InputMethodSystemAbility::StartImeAbility fail. result = %{public}d", result);
+            return false;
+        }
+        return true;
+    }
+
+    /*! Switch the default IME
+    \n The session swaps in the standby IME if it's the one switched to, otherwise it stops the current IME
+        and launches the new one.
+    \param imeId the id of the IME switched to, as "bundleName/abilityName"
+    */
+    void InputMethodSystemAbility::SwitchInputService(const std::string &imeId)
+    {
+        IMSA_HILOGI("InputMethodSystemAbility::SwitchInputService(%{public}s)", imeId.c_str());
+        MessageParcel *parcel = new MessageParcel();
+        parcel->WriteString16(Str8ToStr16(imeId));
+        if (!SendSessionMessage(MAIN_USER_ID, new Message(MSG_ID_SWITCH_IME, parcel))) {
+            StopInputService(ParaHandle::GetDefaultIme(userId_));
+            StartInputService(imeId);
         }
+    }
 
-        if (!isStartSuccess) {
-            IMSA_HILOGE("StartInputService failed. Try again 10s later");
-            auto callback = [this, imeId]() { StartInputService(imeId); };
-            serviceHandler_->PostTask(callback, INIT_INTERVAL);
+    /*! Ask the session to keep the next IME in the switch order started in the background
+    \n No IME is kept in standby unless a memory budget is set for it.
+    \param userId the id of the given user
+    */
+    void InputMethodSystemAbility::UpdateStandbyIme(int32_t userId)
+    {
+        int64_t budgetKb = ParaHandle::GetStandbyBudgetKb();
+        std::string imeId;
+        PerUserSetting *setting = GetUserSetting(userId);
+        if (budgetKb > 0 && setting) {
+            InputMethodProperty *next = setting->GetNextInputMethod();
+            if (next) {
+                imeId = Str16ToStr8(next->mPackageName) + "/" + Str16ToStr8(next->mAbilityName);
+            }
         }
+        MessageParcel *parcel = new MessageParcel();
+        parcel->WriteString16(Str8ToStr16(imeId));
+        parcel->WriteInt64(budgetKb);
+        SendSessionMessage(MAIN_USER_ID, new Message(MSG_ID_SET_STANDBY_IME, parcel));
+    }
+
+    /*! Send a message to the work thread of a user session
+    \param userId the id of the given user
+    \param msg the message to be sent. It's freed here if the user has no work thread.
+    \return true - the message is sent
+    */
+    bool InputMethodSystemAbility::SendSessionMessage(int32_t userId, Message *msg)
+    {
+        return router_.Send(userId, MessagePtr(msg));
     }
 
     void InputMethodSystemAbility::StopInputService(std::string imeId)
@@ -247,6 +419,10 @@ namespace MiscServices {
             IMSA_HILOGE("InputMethodSystemAbility::StopInputService abort session is nullptr");
             return;
         }
+        std::shared_ptr<ImeLauncher> launcher = session->GetImeLauncher();
+        if (launcher) {
+            launcher->OnDisconnected();
+        }
 
         session->StopInputService(imeId);
     }
@@ -352,7 +528,7 @@ namespace MiscServices {
         if (!userSession) {
             return ErrorCode::ERROR_NULL_POINTER;
         }
-        KeyboardType *type = userSession->GetCurrentKeyboardType();
+        KeyboardTypePtr type = userSession->GetCurrentKeyboardType();
         if (!type) {
             return ErrorCode::ERROR_NULL_POINTER;
         }
@@ -366,7 +542,7 @@ namespace MiscServices {
     \return ErrorCode::NO_ERROR no error
     \return ErrorCode::ERROR_USER_NOT_UNLOCKED user not unlocked
     */
-    int32_t InputMethodSystemAbility::listInputMethodEnabled(std::vector<InputMethodProperty*> *properties)
+    int32_t InputMethodSystemAbility::listInputMethodEnabled(std::vector<InputMethodPropertyPtr> *properties)
     {
         int32_t uid = IPCSkeleton::GetCallingUid();
         int32_t userId = getUserId(uid);
@@ -377,7 +553,7 @@ namespace MiscServices {
         }
         setting->ListInputMethodEnabled(properties);
 
-        std::vector<InputMethodProperty*>::iterator it;
+        std::vector<InputMethodPropertyPtr>::iterator it;
         for (it = properties->begin(); it != properties->end();) {
             if (*it && (*it)->isSystemIme) {
                 it = properties->erase(it);
@@ -388,7 +564,7 @@ namespace MiscServices {
         return ErrorCode::NO_ERROR;
     }
 
-    int32_t InputMethodSystemAbility::listInputMethod(std::vector<InputMethodProperty*> *properties)
+    int32_t InputMethodSystemAbility::listInputMethod(std::vector<InputMethodPropertyPtr> *properties)
     {
         return ErrorCode::NO_ERROR;
     }
@@ -399,37 +575,23 @@ namespace MiscServices {
     \return ErrorCode::NO_ERROR no error
     \return ErrorCode::ERROR_USER_NOT_UNLOCKED user not unlocked
     */
-    int32_t InputMethodSystemAbility::listInputMethodByUserId(int32_t userId, std::vector<InputMethodProperty*> *properties)
+    int32_t InputMethodSystemAbility::listInputMethodByUserId(int32_t userId,
+        std::vector<InputMethodPropertyPtr> *properties)
     {
         IMSA_HILOGI("InputMethodSystemAbility::listInputMethodByUserId");
-        std::vector<AppExecFwk::ExtensionAbilityInfo> extensionInfos;
-        bool ret = GetBundleMgr()->QueryExtensionAbilityInfos(AppExecFwk::ExtensionAbilityType::SERVICE, userId, extensionInfos);
-        if (!ret) {
-            IMSA_HILOGI("InputMethodSystemAbility::listInputMethodByUserId QueryExtensionAbilityInfos error");
+        if (!catalogue_) {
             return ErrorCode::ERROR_STATUS_UNKNOWN_ERROR;
         }
-        for (auto extension : extensionInfos) {
-            std::shared_ptr<Global::Resource::ResourceManager> resourceManager(Global::Resource::CreateResourceManager());
-            if (!resourceManager) {
-                IMSA_HILOGI("InputMethodSystemAbility::listInputMethodByUserId resourcemanager is nullptr");
-                break;
-            }
-            AppExecFwk::ApplicationInfo applicationInfo = extension.applicationInfo;
-            InputMethodProperty *property = new InputMethodProperty();
-            property->mPackageName = Str8ToStr16(extension.bundleName);
-            property->mAbilityName = Str8ToStr16(extension.name);
-            property->labelId = applicationInfo.labelId;
-            property->descriptionId = applicationInfo.descriptionId;
-            resourceManager->AddResource(extension.resourcePath.c_str());
-            std::string labelString;
-            resourceManager->GetStringById(applicationInfo.labelId, labelString);
-            property->label = Str8ToStr16(labelString);
-            std::string descriptionString;
-            resourceManager->GetStringById(applicationInfo.descriptionId, descriptionString);
-            property->description = Str8ToStr16(descriptionString);
-            properties->push_back(property);
-        }
-        return ErrorCode::NO_ERROR;
+        return catalogue_->List(userId, properties);
+    }
+
+    /*! Replace the catalogue the installed IMEs are listed from
+    \n It's set by OnStart, from the bundle manager. Another one can be set where no bundle manager runs.
+    \param catalogue the catalogue to list from
+    */
+    void InputMethodSystemAbility::SetCatalogue(std::unique_ptr<InputMethodCatalogue> catalogue)
+    {
+        catalogue_ = std::move(catalogue);
     }
 
     /*! Get the keyboard type list for the given input method engine
@@ -439,7 +601,7 @@ namespace MiscServices {
     \return ErrorCode::NO_ERROR no error
     \return ErrorCode::ERROR_USER_NOT_UNLOCKED user not unlocked
     */
-    int32_t InputMethodSystemAbility::listKeyboardType(const std::u16string& imeId, std::vector<KeyboardType*> *types)
+    int32_t InputMethodSystemAbility::listKeyboardType(const std::u16string& imeId, std::vector<KeyboardTypePtr> *types)
     {
         int32_t uid = IPCSkeleton::GetCallingUid();
         int32_t userId = getUserId(uid);
@@ -485,34 +647,34 @@ namespace MiscServices {
     void InputMethodSystemAbility::WorkThread()
     {
         while (1) {
-            Message *msg = MessageHandler::Instance()->GetMessage();
+            MessagePtr msg = MessageHandler::Instance()->GetMessage();
             switch (msg->msgId_) {
                 case MSG_ID_USER_START : {
-                    OnUserStarted(msg);
+                    OnUserStarted(msg.get());
                     break;
                 }
                 case MSG_ID_USER_STOP: {
-                    OnUserStopped(msg);
+                    OnUserStopped(msg.get());
                     break;
                 }
                 case MSG_ID_USER_UNLOCK: {
-                    OnUserUnlocked(msg);
+                    OnUserUnlocked(msg.get());
                     break;
                 }
                 case MSG_ID_USER_LOCK : {
-                    OnUserLocked(msg);
+                    OnUserLocked(msg.get());
                     break;
                 }
                 case MSG_ID_PACKAGE_ADDED: {
-                    OnPackageAdded(msg);
+                    OnPackageAdded(msg.get());
                     break;
                 }
                 case MSG_ID_PACKAGE_REMOVED: {
-                    OnPackageRemoved(msg);
+                    OnPackageRemoved(msg.get());
                     break;
                 }
                 case MSG_ID_SETTING_CHANGED: {
-                    OnSettingChanged(msg);
+                    OnSettingChanged(msg.get());
                     break;
                 }
                 case MSG_ID_DISPLAY_OPTIONAL_INPUT_METHOD: {
@@ -521,46 +683,47 @@ namespace MiscServices {
                     OnDisplayOptionalInputMethod(userId);
                     break;
                 }
+                // the client messages queued by DispatchUserMessage
                 case MSG_ID_PREPARE_INPUT:
                 case MSG_ID_RELEASE_INPUT:
                 case MSG_ID_START_INPUT:
                 case MSG_ID_STOP_INPUT:
                 case MSG_HIDE_CURRENT_INPUT:
-                case MSG_ID_SET_CORE_AND_AGENT:
+                case MSG_ID_SET_CORE_AND_AGENT: {
+                    OnHandleMessage(std::move(msg), true);
+                    break;
+                }
                 case MSG_ID_HIDE_KEYBOARD_SELF:
                 case MSG_ID_SET_DISPLAY_MODE:
                 case MSG_ID_CLIENT_DIED:
                 case MSG_ID_IMS_DIED:
                 case MSG_ID_RESTART_IMS: {
-                    OnHandleMessage(msg);
+                    OnHandleMessage(std::move(msg), false);
                     break;
                 }
                 case MSG_ID_DISABLE_IMS: {
-                    OnDisableIms(msg);
+                    OnDisableIms(msg.get());
                     break;
                 }
                 case MSG_ID_ADVANCE_TO_NEXT: {
-                    OnAdvanceToNext(msg);
+                    OnAdvanceToNext(msg.get());
                     break;
                 }
                 case MSG_ID_EXIT_SERVICE: {
-                    std::map<int32_t, MessageHandler*>::const_iterator it;
-                    for (it = msgHandlers.cbegin(); it != msgHandlers.cend();) {
-                        MessageHandler *handler = it->second;
+                    std::map<int32_t, MessageHandler*> handlers = router_.RemoveAll();
+                    for (auto &it : handlers) {
+                        MessageHandler *handler = it.second;
                         Message *destMsg = new Message(MSG_ID_EXIT_SERVICE, nullptr);
                         handler->SendMessage(destMsg);
-                        PerUserSession *userSession = GetUserSession(it->first);
+                        PerUserSession *userSession = GetUserSession(it.first);
                         if (!userSession) {
                             IMSA_HILOGE("getUserSession fail.");
                             return;
                         }
                         userSession->JoinWorkThread();
-                        it = msgHandlers.erase(it);
                         delete handler;
                         handler = nullptr;
                     }
-                    delete msg;
-                    msg = nullptr;
                     return;
                 }
                 default: {
@@ -603,6 +766,8 @@ namespace MiscServices {
         setting = new PerUserSetting(userId);
         setting->Initialize();
         PerUserSession *session = new PerUserSession(userId);
+        session->SetImeLauncher(CreateImeLauncher(userId));
+        session->SetLazyHandshake(ParaHandle::IsLazyHandshake());
 
         userSettings.insert(std::pair<int32_t, PerUserSetting*>(userId, setting));
         userSessions.insert(std::pair<int32_t, PerUserSession*>(userId, session));
@@ -622,6 +787,9 @@ namespace MiscServices {
             return ErrorCode::ERROR_BAD_PARAMETERS;
         }
         int32_t userId = msg->msgContent_->ReadInt32();
+        if (catalogue_) {
+            catalogue_->RemoveUser(userId);
+        }
         PerUserSetting *setting = GetUserSetting(userId);
         PerUserSession *session = GetUserSession(userId);
         if (!setting || !session) {
@@ -636,6 +804,10 @@ namespace MiscServices {
         userSessions.erase(itSession);
         delete session;
         session = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(launchersLock_);
+            launchers_.erase(userId);
+        }
 
         std::map<int32_t, PerUserSetting*>::iterator itSetting = userSettings.find(userId);
         userSettings.erase(itSetting);
@@ -664,18 +836,21 @@ namespace MiscServices {
             IMSA_HILOGE("Aborted! %s %d\n", ErrorCode::ToString(ErrorCode::ERROR_USER_NOT_STARTED), userId);
             return ErrorCode::ERROR_USER_NOT_STARTED;
         }
-        if (setting->GetUserState() == UserState::USER_STATE_UNLOCKED) {
-            IMSA_HILOGE("Aborted! %s %d\n", ErrorCode::ToString(ErrorCode::ERROR_USER_ALREADY_UNLOCKED), userId);
-            return ErrorCode::ERROR_USER_ALREADY_UNLOCKED;
-        }
-
-        setting->Initialize();
-
-        InputMethodProperty *ime = setting->GetSecurityInputMethod();
-        session->SetSecurityIme(ime);
-        ime = setting->GetCurrentInputMethod();
-        session->SetCurrentIme(ime);
-        session->SetInputMethodSetting(setting->GetInputMethodSetting());
+        // the setting is already loaded when the user is started by a user switch, only the launch is left
+        if (setting->GetUserState() != UserState::USER_STATE_UNLOCKED) {
+            setting->Initialize();
+
+            InputMethodProperty *ime = setting->GetSecurityInputMethod();
+            session->SetSecurityIme(ime);
+            ime = setting->GetCurrentInputMethod();
+            session->SetCurrentIme(ime);
+            session->SetInputMethodSetting(setting->GetInputMethodSetting());
+            session->SetInputMethodIndex(setting->GetInputMethodIndex());
+        }
+        // pre-launch the default IME, so the first keyboard does not wait for the ability start.
+        // It's not started again if the launcher already has it.
+        StartInputService(ParaHandle::GetDefaultIme(userId));
+        UpdateStandbyIme(userId);
         IMSA_HILOGI("End...[%d]\n", userId);
         return ErrorCode::NO_ERROR;
     }
@@ -698,20 +873,16 @@ namespace MiscServices {
             IMSA_HILOGE("Aborted! %s %d\n", ErrorCode::ToString(ErrorCode::ERROR_USER_NOT_UNLOCKED), userId);
             return ErrorCode::ERROR_USER_NOT_UNLOCKED;
         }
-        std::map<int32_t, MessageHandler*>::iterator it = msgHandlers.find(userId);
-        if (it != msgHandlers.end()) {
-            MessageHandler *handler = it->second;
+        MessageHandler *handler = router_.RemoveHandler(userId);
+        if (handler) {
             Message *destMsg = new Message(MSG_ID_USER_LOCK, nullptr);
-            if (destMsg) {
-                handler->SendMessage(destMsg);
-                PerUserSession *userSession = GetUserSession(userId);
-                if (userSession) {
-                    userSession->JoinWorkThread();
-                }
-                msgHandlers.erase(it);
-                delete handler;
-                handler = nullptr;
+            handler->SendMessage(destMsg);
+            PerUserSession *userSession = GetUserSession(userId);
+            if (userSession) {
+                userSession->JoinWorkThread();
             }
+            delete handler;
+            handler = nullptr;
         }
         setting->OnUserLocked();
         IMSA_HILOGI("End...[%d]\n", userId);
@@ -721,10 +892,11 @@ namespace MiscServices {
     /*! Handle message
     \param msgId the id of message to run
     \msg the parameters are saved in msg->msgContent_
+    \param fromClient true - msg is a client message queued by DispatchUserMessage
     \return ErrorCode::NO_ERROR
     \return ErrorCode::ERROR_USER_NOT_UNLOCKED user not unlocked
     */
-    int32_t InputMethodSystemAbility::OnHandleMessage(Message *msg)
+    int32_t InputMethodSystemAbility::OnHandleMessage(MessagePtr msg, bool fromClient)
     {
         MessageParcel *data = msg->msgContent_;
         int32_t userId = data->ReadInt32();
@@ -734,15 +906,27 @@ namespace MiscServices {
         }
         if (!setting || setting->GetUserState() != UserState::USER_STATE_UNLOCKED) {
             IMSA_HILOGE("InputMethodSystemAbility::OnHandleMessage Aborted! userId = %{public}d,", userId);
-            return ErrorCode::ERROR_USER_NOT_UNLOCKED;
+            msg.reset(); // a client message is still handed over to the router, which accounts it
         }
 
-        std::map<int32_t, MessageHandler*>::const_iterator it = msgHandlers.find(MAIN_USER_ID);
-        if (it != msgHandlers.end()) {
-            MessageHandler *handler = it->second;
-            handler->SendMessage(msg);
-        }
-        return ErrorCode::NO_ERROR;
+        bool sent = fromClient ? router_.HandOver(MAIN_USER_ID, std::move(msg))
+            : (msg && router_.Send(MAIN_USER_ID, std::move(msg)));
+        return sent ? ErrorCode::NO_ERROR : ErrorCode::ERROR_USER_NOT_UNLOCKED;
+    }
+
+    /*! Send a message of a client to the work thread of the user
+    \n Run in binder thread
+    \n The message skips the work thread of the service when the user has a running session, so the requests
+        of different users are handled in parallel.
+    \param userId the user id of the client
+    \param msg the message whose parcel starts with userId
+    \note The clients of all the users are served by the session of MAIN_USER_ID, as OnHandleMessage does.
+    \see UserMessageRouter::Dispatch
+    */
+    void InputMethodSystemAbility::DispatchUserMessage(int32_t userId, Message *msg)
+    {
+        (void)userId;
+        router_.Dispatch(MAIN_USER_ID, msg);
     }
 
     /*! Called when a package is installed.
@@ -758,6 +942,9 @@ namespace MiscServices {
         MessageParcel *data = msg->msgContent_;
         int32_t userId = data->ReadInt32();
         int32_t size = data->ReadInt32();
+        if (catalogue_) {
+            catalogue_->Invalidate(userId);
+        }
 
         if (size <= 0) {
             IMSA_HILOGE("Aborted! %s\n", ErrorCode::ToString(ErrorCode::ERROR_BAD_PARAMETERS));
@@ -807,6 +994,9 @@ namespace MiscServices {
         }
         int32_t userId = data->ReadInt32();
         int32_t size = data->ReadInt32();
+        if (catalogue_) {
+            catalogue_->Invalidate(userId);
+        }
 
         if (size <= 0) {
             IMSA_HILOGE("Aborted! %s\n", ErrorCode::ToString(ErrorCode::ERROR_BAD_PARAMETERS));
@@ -895,7 +1085,7 @@ namespace MiscServices {
     void InputMethodSystemAbility::OnDisplayOptionalInputMethod(int32_t userId)
     {
         IMSA_HILOGI("InputMethodSystemAbility::OnDisplayOptionalInputMethod");
-        std::vector<InputMethodProperty*> properties;
+        std::vector<InputMethodPropertyPtr> properties;
         listInputMethodByUserId(userId, &properties);
         if (!properties.size()) {
             IMSA_HILOGI("InputMethodSystemAbility::OnDisplayOptionalInputMethod has no ime");
@@ -904,14 +1094,14 @@ namespace MiscServices {
 
         std::string defaultIme = ParaHandle::GetDefaultIme(userId_);
         std::string params = "";
-        std::vector<InputMethodProperty*>::iterator it;
+        std::vector<InputMethodPropertyPtr>::iterator it;
         for (it = properties.begin(); it < properties.end(); ++it) {
             if (it == properties.begin()) {
                 params += "{\"imeList\":[";
             } else {
                 params += "},";
             }
-            InputMethodProperty *property = (InputMethodProperty*)*it;
+            const InputMethodProperty *property = it->get();
             std::string imeId = Str16ToStr8(property->mPackageName) + "/" + Str16ToStr8(property->mAbilityName);
             params += "{\"ime\": \"" + imeId + "\",";
             params += "\"labelId\": \"" + std::to_string(property->labelId) + "\",";
@@ -943,9 +1133,9 @@ namespace MiscServices {
                 if (event == "EVENT_CHANGE_IME") {
                     std::string defaultIme = ParaHandle::GetDefaultIme(userId_);
                     if (defaultIme != params) {
-                        StopInputService(defaultIme);
-                        StartInputService(params);
+                        SwitchInputService(params);
                         ParaHandle::SetDefaultIme(userId_, params);
+                        UpdateStandbyIme(userId_);
                     }
                     Ace::UIServiceMgrClient::GetInstance()->CancelDialog(id);
                 } else if (event == "EVENT_START_IME_SETTING") {
@@ -998,11 +1188,7 @@ namespace MiscServices {
             return ErrorCode::ERROR_USER_NOT_UNLOCKED;
         }
         if (isCurrentIme) {
-            std::map<int32_t, MessageHandler*>::const_iterator it = msgHandlers.find(userId);
-            if (it != msgHandlers.end()) {
-                Message *destMsg = new Message(msg->msgId_, nullptr);
-                it->second->SendMessage(destMsg);
-            }
+            router_.Send(userId, MessagePtr(new Message(msg->msgId_, nullptr)));
         } else {
             setting->OnAdvanceToNext();
         }
@@ -1010,25 +1196,32 @@ namespace MiscServices {
         return ErrorCode::NO_ERROR;
     }
 
+    /*! Get the bundle name of a remote caller from the bundle manager
+    \n Run in binder thread
+    \param uid the uid from which the remote call is
+    \return the bundle name, or an empty string if it's not known
+    */
+    std::string InputMethodSystemAbility::GetBundleNameByUid(int32_t uid)
+    {
+        sptr<AppExecFwk::IBundleMgr> bundleMgr = GetBundleMgr();
+        std::string bundleName;
+        if (!bundleMgr || !bundleMgr->GetBundleNameForUid(uid, bundleName)) {
+            return "";
+        }
+        return bundleName;
+    }
+
     sptr<OHOS::AppExecFwk::IBundleMgr> InputMethodSystemAbility::GetBundleMgr()
     {
         IMSA_HILOGI("InputMethodSystemAbility::GetBundleMgr");
-        sptr<ISystemAbilityManager> systemAbilityManager =
-        SystemAbilityManagerClient::GetInstance().GetSystemAbilityManager();
-        if (!systemAbilityManager) {
-            IMSA_HILOGI("InputMethodSystemAbility::GetBundleMgr systemAbilityManager is nullptr");
-            return nullptr;
-        }
-        sptr<IRemoteObject> remoteObject =
-        systemAbilityManager->GetSystemAbility(BUNDLE_MGR_SERVICE_SYS_ABILITY_ID);
+        sptr<IRemoteObject> remoteObject = ServiceLocator::GetSystemAbility(BUNDLE_MGR_SERVICE_SYS_ABILITY_ID);
         return iface_cast<AppExecFwk::IBundleMgr>(remoteObject);
     }
 
     sptr<AAFwk::IAbilityManager> InputMethodSystemAbility::GetAbilityManagerService()
     {
         IMSA_HILOGE("InputMethodSystemAbility::GetAbilityManagerService start");
-        sptr<IRemoteObject> abilityMsObj =
-        OHOS::DelayedSingleton<AAFwk::SaMgrClient>::GetInstance()->GetSystemAbility(ABILITY_MGR_SERVICE_ID);
+        sptr<IRemoteObject> abilityMsObj = ServiceLocator::GetSystemAbility(ABILITY_MGR_SERVICE_ID);
         if (!abilityMsObj) {
             IMSA_HILOGE("failed to get ability manager service");
             return nullptr;
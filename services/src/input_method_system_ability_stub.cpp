@@ -16,6 +16,8 @@
 #include "input_method_system_ability_stub.h"
 #include "message_handler.h"
 #include "ipc_skeleton.h"
+#include "trace_span.h"
+#include "utils.h"
 
 namespace OHOS {
 namespace MiscServices {
@@ -107,26 +109,21 @@ namespace MiscServices {
                 break;
             }
             case LIST_INPUT_METHOD_ENABLED: {
-                std::vector<InputMethodProperty*> properties;
+                std::vector<InputMethodPropertyPtr> properties;
                 int32_t ret = listInputMethodEnabled(&properties);
                 if (ret != ErrorCode::NO_ERROR) {
                     reply.WriteInt32(ErrorCode::ERROR_EX_ILLEGAL_STATE); // write exception code
                     reply.WriteInt32(-1);
                 } else {
                     reply.WriteInt32(NO_ERROR);
-                    int32_t size = properties.size();
-                    reply.WriteInt32(size);
-                    for (int32_t i = 0; i < size; i++) {
-                        reply.WriteParcelable(properties[i]);
-                    }
-                    properties.clear();
+                    InputMethodProperty::MarshallingList(reply, properties);
                 }
                 break;
             }
             case LIST_INPUT_METHOD: {
                 int32_t uid = IPCSkeleton::GetCallingUid();
                 int32_t userId = getUserId(uid);
-                std::vector<InputMethodProperty*> properties;
+                std::vector<InputMethodPropertyPtr> properties;
                 int32_t ret = listInputMethodByUserId(userId, &properties);
                 if (ret != ErrorCode::NO_ERROR) {
                     reply.WriteInt32(ErrorCode::ERROR_EX_ILLEGAL_STATE); // write exception code
@@ -134,17 +131,12 @@ namespace MiscServices {
                     return ret;
                 }
                 reply.WriteInt32(NO_ERROR);
-                int32_t size = properties.size();
-                reply.WriteInt32(size);
-                for (int32_t i = 0; i < size; i++) {
-                    reply.WriteParcelable(properties[i]);
-                }
-                properties.clear();
+                InputMethodProperty::MarshallingList(reply, properties);
                 break;
             }
             case LIST_KEYBOARD_TYPE: {
                 std::u16string imeId = data.ReadString16();
-                std::vector<KeyboardType*> kbdTypes;
+                std::vector<KeyboardTypePtr> kbdTypes;
                 int32_t ret = listKeyboardType(imeId, &kbdTypes);
                 if (ret != ErrorCode::NO_ERROR) {
                     reply.WriteInt32(ErrorCode::ERROR_EX_ILLEGAL_STATE);
@@ -152,12 +144,7 @@ namespace MiscServices {
                     return ret;
                 }
                 reply.WriteInt32(NO_ERROR);
-                int32_t size = kbdTypes.size();
-                reply.WriteInt32(size);
-                for (int32_t i = 0; i < size; i++) {
-                    reply.WriteParcelable(kbdTypes[i]);
-                }
-                kbdTypes.clear();
+                KeyboardType::MarshallingList(reply, kbdTypes);
                 break;
             }
             case DISPLAY_OPTIONAL_INPUT_METHOD: {
@@ -199,7 +186,7 @@ namespace MiscServices {
         parcel->WriteParcelable(data.ReadParcelable<InputAttribute>());
 
         Message *msg = new Message(MSG_ID_PREPARE_INPUT, parcel);
-        MessageHandler::Instance()->SendMessage(msg);
+        DispatchUserMessage(userId, msg);
     }
 
     void InputMethodSystemAbilityStub::displayOptionalInputMethod(MessageParcel& data)
@@ -233,7 +220,7 @@ namespace MiscServices {
         parcel->WriteRemoteObject(data.ReadRemoteObject());
 
         Message *msg = new Message(MSG_ID_RELEASE_INPUT, parcel);
-        MessageHandler::Instance()->SendMessage(msg);
+        DispatchUserMessage(userId, msg);
     }
 
     /*! Start input
@@ -248,10 +235,20 @@ namespace MiscServices {
         int32_t userId = getUserId(uid);
         MessageParcel *parcel = new MessageParcel();
         parcel->WriteInt32(userId);
-        parcel->WriteRemoteObject(data.ReadRemoteObject());
+        sptr<IRemoteObject> client = data.ReadRemoteObject();
+        parcel->WriteRemoteObject(client);
+        uint64_t traceId = data.ReadUint64();
+        int64_t sentNs = data.ReadInt64();
+        if (traceId) {
+            TraceRecorder::Instance()->Record(traceId, "IPC IMC->IMSA", sentNs, TraceRecorder::NowNs());
+        }
+        TraceSpan span(traceId, "IMSA::startInput");
 
         Message *msg = new Message(MSG_ID_START_INPUT, parcel);
-        MessageHandler::Instance()->SendMessage(msg);
+        msg->traceId_ = traceId;
+        // a pending start or stop request of the same client is superseded by this one
+        msg->coalesceKey_ = MessageHandler::MakeCoalesceKey(MSG_ID_START_INPUT, client.GetRefPtr());
+        DispatchUserMessage(userId, msg);
     }
 
     /*! Stop input
@@ -266,10 +263,13 @@ namespace MiscServices {
         int32_t userId = getUserId(uid);
         MessageParcel *parcel = new MessageParcel();
         parcel->WriteInt32(userId);
-        parcel->WriteRemoteObject(data.ReadRemoteObject());
+        sptr<IRemoteObject> client = data.ReadRemoteObject();
+        parcel->WriteRemoteObject(client);
 
         Message *msg = new Message(MSG_ID_STOP_INPUT, parcel);
-        MessageHandler::Instance()->SendMessage(msg);
+        // a pending start or stop request of the same client is superseded by this one
+        msg->coalesceKey_ = MessageHandler::MakeCoalesceKey(MSG_ID_START_INPUT, client.GetRefPtr());
+        DispatchUserMessage(userId, msg);
     }
 
         /*! Prepare input
@@ -287,9 +287,12 @@ namespace MiscServices {
         parcel->WriteInt32(userId);
         parcel->WriteRemoteObject(data.ReadRemoteObject());
         parcel->WriteRemoteObject(data.ReadRemoteObject());
+        // the session tells the default IME from the standby one by its bundle
+        parcel->WriteString16(Utils::to_utf16(GetBundleNameByUid(uid)));
+        parcel->WriteInt32(IPCSkeleton::GetCallingPid());
 
         Message *msg = new Message(MSG_ID_SET_CORE_AND_AGENT, parcel);
-        MessageHandler::Instance()->SendMessage(msg);
+        DispatchUserMessage(userId, msg);
     }
 
     void InputMethodSystemAbilityStub::HideCurrentInput(MessageParcel& data)
@@ -301,9 +304,31 @@ namespace MiscServices {
         parcel->WriteInt32(userId);
 
         Message *msg = new Message(MSG_HIDE_CURRENT_INPUT, parcel);
+        DispatchUserMessage(userId, msg);
+    }
+
+    /*! Send a message of a client to the work thread
+    \n The default implementation sends it to the work thread of the service.
+    \param userId the user id of the client
+    \param msg the message whose parcel starts with userId
+    */
+    void InputMethodSystemAbilityStub::DispatchUserMessage(int32_t userId, Message *msg)
+    {
+        (void)userId;
         MessageHandler::Instance()->SendMessage(msg);
     }
 
+    /*! Get the bundle name of a remote caller
+    \n The default implementation does not know any bundle.
+    \param uid the uid from which the remote call is
+    \return the bundle name, or an empty string if it's not known
+    */
+    std::string InputMethodSystemAbilityStub::GetBundleNameByUid(int32_t uid)
+    {
+        (void)uid;
+        return "";
+    }
+
     /*! Get user id from uid
     \param uid the uid from which the remote call is
     \return return user id of the remote caller
@@ -102,6 +102,42 @@ namespace MiscServices {
         return info;
     }
 
+    /*! Write a list of keyboard types to parcel
+      \param[out] parcel the list is written to this parcel, the size first
+      \param types the list to be written
+      \return true - the list is written
+    */
+    bool KeyboardType::MarshallingList(Parcel &parcel, const std::vector<KeyboardTypePtr>& types)
+    {
+        if (!parcel.WriteInt32((int32_t)types.size())) {
+            return false;
+        }
+        for (const auto &type : types) {
+            if (!parcel.WriteParcelable(type.get())) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /*! Read a list of keyboard types from parcel
+      \param parcel read the list written by MarshallingList from this parcel
+      \param[out] types the list read is appended to it, each element owned by its shared pointer
+      \return true - the whole list is read
+    */
+    bool KeyboardType::UnmarshallingList(Parcel &parcel, std::vector<KeyboardTypePtr> *types)
+    {
+        int32_t size = parcel.ReadInt32();
+        for (int32_t i = 0; i < size; i++) {
+            KeyboardType *type = parcel.ReadParcelable<KeyboardType>();
+            if (!type) {
+                return false;
+            }
+            types->push_back(KeyboardTypePtr(type));
+        }
+        return true;
+    }
+
     void KeyboardType::setId(int32_t typeId)
     {
         mId = typeId;
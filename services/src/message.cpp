@@ -14,6 +14,7 @@
  */
 
 #include "message.h"
+#include "message_pool.h"
 
 namespace OHOS {
 namespace MiscServices {
@@ -36,6 +37,8 @@ namespace MiscServices {
     Message::Message(const Message& msg)
     {
         msgId_ = msg.msgId_;
+        traceId_ = msg.traceId_;
+        sentNs_ = msg.sentNs_;
         if (msgContent_) {
             delete msgContent_;
             msgContent_ = nullptr;
@@ -53,6 +56,8 @@ namespace MiscServices {
             return *this;
         }
         msgId_ = msg.msgId_;
+        traceId_ = msg.traceId_;
+        sentNs_ = msg.sentNs_;
         if (msgContent_) {
             delete msgContent_;
             msgContent_ = nullptr;
@@ -72,5 +77,20 @@ namespace MiscServices {
             msgContent_ = nullptr;
         }
     }
+
+    /*! Release a message held by MessagePtr
+    \param msg the message to be released
+    */
+    void MessageDeleter::operator()(Message *msg) const
+    {
+        if (!msg) {
+            return;
+        }
+        if (msg->pool_) {
+            msg->pool_->Recycle(msg);
+            return;
+        }
+        delete msg;
+    }
 } // namespace MiscServices
 } // namespace OHOS
@@ -14,25 +14,57 @@
  */
 
 #include "message_handler.h"
+#include <thread>
+#include "trace_span.h"
 
 namespace OHOS {
 namespace MiscServices {
     /*! Constructor
     */
-    MessageHandler::MessageHandler()
+    MessageHandler::MessageHandler() : MessageHandler(QUEUE_MODE_MUTEX)
     {
     }
 
+    /*! Constructor
+    \param mode the queue implementation used by this handler
+    \param flags a combination of HandlerFlag, messages are served in FIFO order without FLAG_PRIORITIZED
+    */
+    MessageHandler::MessageHandler(QueueMode mode, uint32_t flags)
+        : mMode(mode), mPrioritized(flags & FLAG_PRIORITIZED), mCoalescing(flags & FLAG_COALESCING), mSleeping(false),
+          mCoalescedCount(0), mDeliveredCount(0)
+    {
+        if (mMode != QUEUE_MODE_LOCK_FREE) {
+            return;
+        }
+        int32_t laneCount = mPrioritized ? MessageLane::LANE_COUNT : 1;
+        for (int32_t i = 0; i < laneCount; i++) {
+            mLanes[i].ring = new MessageRing();
+        }
+    }
+
     /*! Destructor
     */
     MessageHandler::~MessageHandler()
     {
         std::unique_lock<std::mutex> lock(mMutex);
-        while (!mQueue.empty()) {
-            Message *msg = mQueue.front();
-            mQueue.pop();
-            delete msg;
-            msg = nullptr;
+        mPending.clear();
+        for (int32_t i = 0; i < MessageLane::LANE_COUNT; i++) {
+            Lane &lane = mLanes[i];
+            if (lane.ring) {
+                Message *msg = lane.ring->Pop();
+                while (msg) {
+                    MessageDeleter()(msg);
+                    msg = lane.ring->Pop();
+                }
+                delete lane.ring;
+                lane.ring = nullptr;
+            }
+            while (!lane.queue.empty()) {
+                Message *msg = lane.queue.front();
+                lane.queue.pop();
+                MessageDeleter()(msg);
+                msg = nullptr;
+            }
         }
     }
 
@@ -42,29 +74,362 @@ namespace MiscServices {
     */
     void MessageHandler::SendMessage(Message *msg)
     {
+        if (msg->traceId_) {
+            msg->sentNs_ = TraceRecorder::NowNs();
+        }
+        if (mCoalescing && msg->coalesceKey_) {
+            Coalesce(msg);
+        }
+        if (mMode == QUEUE_MODE_LOCK_FREE) {
+            SendToRing(msg);
+            return;
+        }
         {
             std::unique_lock<std::mutex> lock(mMutex);
-            mQueue.push(msg);
+            mLanes[LaneOf(msg)].queue.push(msg);
         }
         mCV.notify_one();
     }
 
+    /*! Send a message
+      \param msg a message to be sent, usually obtained by ObtainMessage
+    */
+    void MessageHandler::SendMessage(MessagePtr msg)
+    {
+        SendMessage(msg.release());
+    }
+
     /*! Get a message
-      \return a pointer referred to an object of message
-      \note the returned pointer should be freed by the caller.
+      \return a handle of the message
+      \note the message is released when the handle goes out of scope, it goes back to its pool
+      \n if it is obtained from a pool, or it is deleted.
     */
-    Message *MessageHandler::GetMessage()
+    MessagePtr MessageHandler::GetMessage()
     {
-        std::unique_lock<std::mutex> lock(mMutex);
-        mCV.wait(lock, [this] {
-            return !this->mQueue.empty();
-        });
+        while (true) {
+            Message *msg = nullptr;
+            if (mMode == QUEUE_MODE_LOCK_FREE) {
+                msg = GetFromRing();
+            } else {
+                std::unique_lock<std::mutex> lock(mMutex);
+                int32_t lane = -1;
+                mCV.wait(lock, [this, &lane] {
+                    lane = this->PickLane();
+                    return lane >= 0;
+                });
+                msg = (Message*) mLanes[lane].queue.front();
+                mLanes[lane].queue.pop();
+            }
+            if (Deliver(msg)) {
+                return MessagePtr(msg);
+            }
+            MessageDeleter()(msg);
+        }
+    }
+
+    /*! Get an empty message from the message pool of this handler
+      \param msgId the id of the message
+      \return a handle of the message, whose parcel is ready to be written
+    */
+    MessagePtr MessageHandler::ObtainMessage(int32_t msgId)
+    {
+        return mPool.Obtain(msgId);
+    }
+
+    /*! Get the message pool of this handler
+    */
+    MessagePool *MessageHandler::GetMessagePool()
+    {
+        return &mPool;
+    }
+
+    /*! Get the queue implementation used by this handler
+    */
+    MessageHandler::QueueMode MessageHandler::GetQueueMode() const
+    {
+        return mMode;
+    }
+
+    /*! Check if messages are served by the priority of their lanes
+    */
+    bool MessageHandler::IsPrioritized() const
+    {
+        return mPrioritized;
+    }
+
+    /*! Get the number of messages merged into a pending message since the handler was created
+    */
+    uint64_t MessageHandler::GetCoalescedCount() const
+    {
+        return mCoalescedCount.load(std::memory_order_relaxed);
+    }
+
+    /*! Get the number of messages returned by GetMessage since the handler was created
+    */
+    uint64_t MessageHandler::GetDeliveredCount() const
+    {
+        return mDeliveredCount.load(std::memory_order_relaxed);
+    }
+
+    /*! Set how a superseded message is folded into the message replacing it
+      \param msgId the id of the messages merged by merger
+      \param merger called with the pending message and the new one, it may rewrite the content of the new one
+      \note It must be set before any message is sent to this handler.
+    */
+    void MessageHandler::SetMerger(int32_t msgId, Merger merger)
+    {
+        mMergers[msgId] = merger;
+    }
+
+    /*! Make a coalesce key
+      \param msgId the id of the message
+      \param object the object the message is about, e.g. the remote object of an input client
+      \return a non-zero key, equal for the same msgId and object
+    */
+    uint64_t MessageHandler::MakeCoalesceKey(int32_t msgId, const void *object)
+    {
+        const uint32_t msgIdBits = 8;
+        const uint64_t msgIdMask = (1 << msgIdBits) - 1;
+        return (static_cast<uint64_t>(reinterpret_cast<uintptr_t>(object)) << msgIdBits)
+            | ((static_cast<uint64_t>(msgId) + 1) & msgIdMask);
+    }
+
+    /*! Supersede a pending message which has the same coalesce key
+      \param msg the new message, which is queued by the caller
+      \note The pending message is dropped when it is dequeued, and msg is queued at the tail, so it does not
+      \n overtake the messages without a key sent in between, e.g. a release of the same client.
+    */
+    void MessageHandler::Coalesce(Message *msg)
+    {
+        std::unique_lock<std::mutex> lock(mPendingMutex);
+        auto it = mPending.find(msg->coalesceKey_);
+        if (it == mPending.end()) {
+            mPending.insert(std::pair<uint64_t, Message*>(msg->coalesceKey_, msg));
+            return;
+        }
+        Message *pending = it->second;
+        auto merger = mMergers.find(msg->msgId_);
+        if (merger != mMergers.end() && pending->msgId_ == msg->msgId_) {
+            merger->second(*pending, *msg);
+        }
+        pending->superseded_ = true;
+        it->second = msg;
+        mCoalescedCount.fetch_add(1, std::memory_order_relaxed);
+    }
 
-        Message *msg = (Message*) mQueue.front();
-        mQueue.pop();
+    /*! Account a message which is going to be returned by GetMessage
+      \param msg the message taken from the queue
+      \return msg, or nullptr if it has been superseded and is to be dropped
+      \note Once it is removed from mPending, msg can not be superseded any more.
+    */
+    Message *MessageHandler::Deliver(Message *msg)
+    {
+        if (mCoalescing && msg->coalesceKey_) {
+            std::unique_lock<std::mutex> lock(mPendingMutex);
+            if (msg->superseded_) {
+                return nullptr;
+            }
+            auto it = mPending.find(msg->coalesceKey_);
+            if (it != mPending.end() && it->second == msg) {
+                mPending.erase(it);
+            }
+        }
+        mDeliveredCount.fetch_add(1, std::memory_order_relaxed);
+        if (msg->traceId_) {
+            TraceRecorder::Instance()->Record(msg->traceId_, "queue wait", msg->sentNs_, TraceRecorder::NowNs(),
+                msg->msgId_);
+        }
         return msg;
     }
 
+    /*! Get the priority lane of a message
+      \param msgId the id of the message
+      \return one of MessageLane
+      \note Requests which have to keep their order relative to each other (e.g. prepare/start/stop/release
+      \n input of the same client, or the IME connecting and the keyboard being shown) stay in one lane.
+      \n The death of a client or an IME, and the restart of an IME, are about an object an earlier interactive
+      \n request may refer to, so they are handled after it in the interactive lane. So are the set and the
+      \n check of the standby IME, which a switch of the IME consumes.
+    */
+    int32_t MessageHandler::GetLane(int32_t msgId)
+    {
+        switch (msgId) {
+            case MessageID::MSG_ID_SYSTEM_START:
+            case MessageID::MSG_ID_SYSTEM_STOP:
+            case MessageID::MSG_ID_USER_START:
+            case MessageID::MSG_ID_USER_STOP:
+            case MessageID::MSG_ID_USER_UNLOCK:
+            case MessageID::MSG_ID_USER_LOCK:
+            case MessageID::MSG_ID_PACKAGE_ADDED:
+            case MessageID::MSG_ID_PACKAGE_REMOVED:
+            case MessageID::MSG_ID_SETTING_CHANGED:
+            case MessageID::MSG_ID_SHELL_COMMAND:
+            case MessageID::MSG_ID_EXIT_SERVICE:
+                return MessageLane::LANE_HOUSEKEEPING;
+            case MessageID::MSG_ID_DISABLE_IMS:
+            case MessageID::MSG_ID_DISPLAY_OPTIONAL_INPUT_METHOD:
+            case MessageID::MSG_ID_INITIALIZE_INPUT:
+            case MessageID::MSG_ID_INIT_INPUT_CONTROL_CHANNEL:
+            case MessageID::MSG_ID_SET_KEYBOARD_TYPE:
+            case MessageID::MSG_ID_STOP_INPUT_SERVICE:
+            case MessageID::MSG_ID_GET_KEYBOARD_WINDOW_HEIGHT:
+                return MessageLane::LANE_LIFECYCLE;
+            default:
+                return MessageLane::LANE_INTERACTIVE;
+        }
+    }
+
+    /*! Get the lane in which a message is queued by this handler
+    */
+    int32_t MessageHandler::LaneOf(const Message *msg) const
+    {
+        return mPrioritized ? GetLane(msg->msgId_) : MessageLane::LANE_INTERACTIVE;
+    }
+
+    /*! Check if there is no message in a lane
+      \note called by the consumer, with mMutex held in QUEUE_MODE_MUTEX
+    */
+    bool MessageHandler::IsLaneEmpty(int32_t lane)
+    {
+        const Lane &target = mLanes[lane];
+        if (mMode != QUEUE_MODE_LOCK_FREE) {
+            return target.queue.empty();
+        }
+        if (!target.ring) {
+            return true;
+        }
+        return target.ring->IsEmpty() && target.overflowCount.load(std::memory_order_acquire) <= 0;
+    }
+
+    /*! Check if there is no message in any lane
+      \note called by the consumer
+    */
+    bool MessageHandler::IsEmpty()
+    {
+        for (int32_t i = 0; i < MessageLane::LANE_COUNT; i++) {
+            if (!IsLaneEmpty(i)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /*! Choose the lane to be served next
+      \return the index of the lane, or -1 if all the lanes are empty
+      \note The highest non-empty lane is served, unless a lower lane has been passed over
+      \n STARVATION_LIMIT times in a row, then that lane is served once.
+    */
+    int32_t MessageHandler::PickLane()
+    {
+        bool pending[MessageLane::LANE_COUNT];
+        int32_t picked = -1;
+        for (int32_t i = 0; i < MessageLane::LANE_COUNT; i++) {
+            pending[i] = !IsLaneEmpty(i);
+            if (picked < 0 && pending[i]) {
+                picked = i;
+            }
+        }
+        if (picked < 0 || !mPrioritized) {
+            return picked;
+        }
+        for (int32_t i = picked + 1; i < MessageLane::LANE_COUNT; i++) {
+            if (pending[i] && mLanes[i].waitCount >= STARVATION_LIMIT) {
+                picked = i;
+                break;
+            }
+        }
+        for (int32_t i = 0; i < MessageLane::LANE_COUNT; i++) {
+            if (i == picked || !pending[i]) {
+                mLanes[i].waitCount = 0;
+            } else {
+                mLanes[i].waitCount++;
+            }
+        }
+        return picked;
+    }
+
+    /*! Put a message into the lock-free ring of its lane
+      \param msg a message to be sent
+      \note When the ring is full, the message goes to the queue of the lane, and so do all the following
+      \n messages of the lane until the consumer has drained the queue, so that the order of one producer is kept.
+    */
+    void MessageHandler::SendToRing(Message *msg)
+    {
+        Lane &lane = mLanes[LaneOf(msg)];
+        if (lane.overflowCount.load(std::memory_order_acquire) > 0 || !lane.ring->Push(msg)) {
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                lane.queue.push(msg);
+                lane.overflowCount.fetch_add(1, std::memory_order_release);
+            }
+            mCV.notify_one();
+            return;
+        }
+        // pairs with the fence in GetFromRing: either the consumer sees the message, or we see it sleeping
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (mSleeping.load(std::memory_order_relaxed)) {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCV.notify_one();
+        }
+    }
+
+    /*! Take a message from the lock-free rings, or from the overflow queue when a ring is drained
+      \return the message, or nullptr if there is no message ready
+      \note A slot claimed by a producer but not published yet holds a message sent before any message of that
+      \n producer in the overflow queue, so the queue is only read once every claimed slot has been taken.
+    */
+    Message *MessageHandler::TryGetFromRing()
+    {
+        int32_t picked = PickLane();
+        if (picked < 0) {
+            return nullptr;
+        }
+        Lane &lane = mLanes[picked];
+        Message *msg = lane.ring->Pop();
+        if (msg) {
+            return msg;
+        }
+        if (!lane.ring->IsDrained()) {
+            // a producer is publishing, the caller spins till it's done
+            return nullptr;
+        }
+        std::unique_lock<std::mutex> lock(mMutex);
+        if (lane.queue.empty()) {
+            return nullptr;
+        }
+        msg = lane.queue.front();
+        lane.queue.pop();
+        lane.overflowCount.fetch_sub(1, std::memory_order_release);
+        return msg;
+    }
+
+    /*! Get a message from the lock-free rings
+      \return a pointer referred to an object of message
+      \note The consumer polls the rings SPIN_COUNT times before it parks on mCV, so a burst of
+      \n keystrokes is handled without any futex wait or wake.
+    */
+    Message *MessageHandler::GetFromRing()
+    {
+        while (true) {
+            for (int32_t i = 0; i < SPIN_COUNT; i++) {
+                Message *msg = TryGetFromRing();
+                if (msg) {
+                    return msg;
+                }
+                if (i >= SPIN_YIELD_THRESHOLD) {
+                    std::this_thread::yield();
+                }
+            }
+            std::unique_lock<std::mutex> lock(mMutex);
+            mSleeping.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            mCV.wait(lock, [this] {
+                return !this->IsEmpty();
+            });
+            mSleeping.store(false, std::memory_order_relaxed);
+        }
+    }
+
     /*! The single instance of MessageHandler in the service
       \return the pointer referred to an object.
     */
@@ -72,7 +437,7 @@ namespace MiscServices {
     {
         static MessageHandler *handler = nullptr;
         if (!handler) {
-            handler = new MessageHandler();
+            handler = new MessageHandler(QUEUE_MODE_LOCK_FREE, FLAG_COALESCING);
         }
         return handler;
     }
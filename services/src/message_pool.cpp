@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "message_pool.h"
+
+namespace OHOS {
+namespace MiscServices {
+    /*! Constructor
+    \param capacity the max number of idle messages kept in the pool
+    */
+    MessagePool::MessagePool(uint32_t capacity) : freeList_(capacity), createdCount_(0)
+    {
+    }
+
+    /*! Destructor
+    */
+    MessagePool::~MessagePool()
+    {
+        Message *msg = freeList_.Pop();
+        while (msg) {
+            msg->pool_ = nullptr;
+            delete msg;
+            msg = freeList_.Pop();
+        }
+    }
+
+    /*! Get an empty message from the pool
+    \param msgId the id of the message
+    \return a message with an empty parcel, which is recycled to this pool when released
+    */
+    MessagePtr MessagePool::Obtain(int32_t msgId)
+    {
+        Message *msg = freeList_.Pop();
+        if (!msg) {
+            msg = new Message(msgId, new MessageParcel());
+            msg->pool_ = this;
+            createdCount_.fetch_add(1, std::memory_order_relaxed);
+            return MessagePtr(msg);
+        }
+        msg->msgId_ = msgId;
+        msg->coalesceKey_ = 0;
+        msg->traceId_ = 0;
+        msg->superseded_ = false;
+        return MessagePtr(msg);
+    }
+
+    /*! Give a message back to the pool
+    \param msg the message obtained from this pool
+    \note A parcel which carries remote objects or has grown bigger than MAX_RETAINED_CAPACITY is not
+    \n kept, so that no object reference or large buffer is held by an idle message.
+    */
+    void MessagePool::Recycle(Message *msg)
+    {
+        MessageParcel *parcel = msg->msgContent_;
+        if (parcel && !parcel->GetOffsetsSize() && parcel->GetDataCapacity() <= MAX_RETAINED_CAPACITY
+            && parcel->RewindWrite(0) && parcel->RewindRead(0) && freeList_.Push(msg)) {
+            return;
+        }
+        msg->pool_ = nullptr;
+        delete msg;
+    }
+
+    /*! Get the number of messages allocated by the pool since it was created
+    */
+    uint32_t MessagePool::GetCreatedCount() const
+    {
+        return createdCount_.load(std::memory_order_relaxed);
+    }
+} // namespace MiscServices
+} // namespace OHOS
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "message_ring.h"
+
+namespace OHOS {
+namespace MiscServices {
+    /*! Constructor
+    \param capacity the number of slots, rounded up to a power of two
+    */
+    MessageRing::MessageRing(uint32_t capacity) : enqueuePos_(0), dequeuePos_(0)
+    {
+        uint64_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        mask_ = size - 1;
+        cells_ = new Cell[size];
+        for (uint64_t i = 0; i < size; i++) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+            cells_[i].msg = nullptr;
+        }
+    }
+
+    /*! Destructor
+    \note messages still in the ring are not freed here, the owner should drain it first.
+    */
+    MessageRing::~MessageRing()
+    {
+        delete[] cells_;
+        cells_ = nullptr;
+    }
+
+    /*! Put a message at the tail of the ring
+    \param msg the message to be queued
+    \return true - the message is queued
+    \n      false - the ring is full, the message is not queued
+    */
+    bool MessageRing::Push(Message *msg)
+    {
+        Cell *cell = nullptr;
+        uint64_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells_[pos & mask_];
+            uint64_t seq = cell->sequence.load(std::memory_order_acquire);
+            int64_t diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos);
+            if (!diff) {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->msg = msg;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /*! Take the message at the head of the ring
+    \return the message at the head, or nullptr if the ring is empty
+    */
+    Message *MessageRing::Pop()
+    {
+        Cell *cell = nullptr;
+        uint64_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells_[pos & mask_];
+            uint64_t seq = cell->sequence.load(std::memory_order_acquire);
+            int64_t diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos + 1);
+            if (!diff) {
+                if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return nullptr;
+            } else {
+                pos = dequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        Message *msg = cell->msg;
+        cell->msg = nullptr;
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return msg;
+    }
+
+    /*! Check if there is no message in the ring
+    \return true - no message is published in the ring
+    */
+    bool MessageRing::IsEmpty() const
+    {
+        uint64_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        uint64_t seq = cells_[pos & mask_].sequence.load(std::memory_order_acquire);
+        return seq != pos + 1;
+    }
+
+    /*! Check if every slot claimed by a producer has been taken by the consumer
+    \return true - there is no message in the ring, neither published nor being published
+    \note IsEmpty is also true while a producer has claimed the head slot but not published it yet.
+    */
+    bool MessageRing::IsDrained() const
+    {
+        uint64_t pos = dequeuePos_.load(std::memory_order_acquire);
+        return enqueuePos_.load(std::memory_order_acquire) == pos;
+    }
+
+    /*! Get the number of slots in the ring
+    */
+    uint32_t MessageRing::GetCapacity() const
+    {
+        return static_cast<uint32_t>(mask_ + 1);
+    }
+} // namespace MiscServices
+} // namespace OHOS
@@ -21,6 +21,8 @@
 #include "utils.h"
 #include "want.h"
 #include "input_method_ability_connection_stub.h"
+#include <chrono>
+#include <cstdio>
 #include <vector>
 #include "ability_connect_callback_proxy.h"
 #include "ability_manager_interface.h"
@@ -33,6 +35,7 @@
 #include "ipc_skeleton.h"
 #include "input_method_core_proxy.h"
 #include "input_method_agent_proxy.h"
+#include "trace_span.h"
 
 namespace OHOS {
 namespace MiscServices {
@@ -74,8 +77,11 @@ namespace MiscServices {
         userId_ = userId;
         currentIme[0] = nullptr;
         currentIme[1] = nullptr;
+        currentKbdIndex[0] = 0;
+        currentKbdIndex[1] = 0;
 
         needReshowClient = nullptr;
+        std::atomic_store(&sessionSnapshot, std::make_shared<const SessionSnapshot>());
 
         clientDeathRecipient = new RemoteObjectDeathRecipient(userId, MSG_ID_CLIENT_DIED);
         imsDeathRecipient = new RemoteObjectDeathRecipient(userId, MSG_ID_IMS_DIED);
@@ -86,6 +92,7 @@ namespace MiscServices {
     PerUserSession::~PerUserSession()
     {
         if (userState == UserState::USER_STATE_UNLOCKED) {
+            std::unique_lock<std::mutex> lock(imeLock);
             OnUserLocked();
         }
         clientDeathRecipient = nullptr;
@@ -115,6 +122,9 @@ namespace MiscServices {
     }
 
     /*! Work thread for this user
+    \n A message is handled under imeLock, except MSG_ID_PREPARE_INPUT which only adds a client, so that
+        a client can register while the service is resetting the ime. The snapshot read by the binder
+        threads is published after each message.
     */
     void PerUserSession::WorkThread()
     {
@@ -122,34 +132,44 @@ namespace MiscServices {
             return;
         }
         while (1) {
-            Message *msg = msgHandler->GetMessage();
-            std::unique_lock<std::mutex> lock(mtx);
+            MessagePtr msg = msgHandler->GetMessage();
+            if (msg->msgId_ == MSG_ID_PREPARE_INPUT) {
+                OnPrepareInput(msg.get());
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(imeLock);
             switch (msg->msgId_) {
                 case MSG_ID_USER_LOCK:
                 case MSG_ID_EXIT_SERVICE: {
                     OnUserLocked();
-                    delete msg;
-                    msg = nullptr;
                     return;
                 }
-                case MSG_ID_PREPARE_INPUT: {
-                    OnPrepareInput(msg);
-                    break;
-                }
                 case MSG_ID_RELEASE_INPUT: {
-                    OnReleaseInput(msg);
+                    OnReleaseInput(msg.get());
                     break;
                 }
                 case MSG_ID_START_INPUT: {
-                    OnStartInput(msg);
+                    OnStartInput(msg.get());
                     break;
                 }
                 case MSG_ID_STOP_INPUT: {
-                    OnStopInput(msg);
+                    OnStopInput(msg.get());
                     break;
                 }
                 case MSG_ID_SET_CORE_AND_AGENT: {
-                    SetCoreAndAgent(msg);
+                    SetCoreAndAgent(msg.get());
+                    break;
+                }
+                case MSG_ID_SWITCH_IME: {
+                    OnSwitchIme(msg.get());
+                    break;
+                }
+                case MSG_ID_SET_STANDBY_IME: {
+                    OnSetStandbyIme(msg.get());
+                    break;
+                }
+                case MSG_ID_CHECK_STANDBY_IME: {
+                    OnCheckStandbyIme(msg.get());
                     break;
                 }
                 case MSG_ID_CLIENT_DIED: {
@@ -189,8 +209,7 @@ namespace MiscServices {
                     break;
                 }
             }
-            delete msg;
-            msg = nullptr;
+            PublishSnapshot();
         }
     }
 
@@ -207,8 +226,10 @@ namespace MiscServices {
     */
     void PerUserSession::SetCurrentIme(InputMethodProperty *ime)
     {
+        std::unique_lock<std::mutex> lock(imeLock);
         currentIme[DEFAULT_IME] = ime;
         userState = UserState::USER_STATE_UNLOCKED;
+        PublishSnapshot();
     }
 
     /*! Set the system security input method engine
@@ -216,7 +237,9 @@ namespace MiscServices {
     */
     void PerUserSession::SetSecurityIme(InputMethodProperty *ime)
     {
+        std::unique_lock<std::mutex> lock(imeLock);
         currentIme[SECURITY_IME] = ime;
+        PublishSnapshot();
     }
 
     /*! Set the input method setting data
@@ -224,7 +247,43 @@ namespace MiscServices {
     */
     void PerUserSession::SetInputMethodSetting(InputMethodSetting *setting)
     {
+        std::unique_lock<std::mutex> lock(imeLock);
         inputMethodSetting = setting;
+        PublishSnapshot();
+    }
+
+    /*! Set the index over the installed input method engines
+    \param index InputMethodIndex pointer referred to the instance in PerUserSetting.
+    */
+    void PerUserSession::SetInputMethodIndex(InputMethodIndex *index)
+    {
+        inputMethodIndex = index;
+    }
+
+    /*! Set the start pipeline of the default input method service of this user
+    \param launcher the launcher created for this session by InputMethodSystemAbility
+    */
+    void PerUserSession::SetImeLauncher(std::shared_ptr<ImeLauncher> launcher)
+    {
+        imeLauncher = launcher;
+    }
+
+    /*! Get the start pipeline of the default input method service of this user
+    \return the launcher, nullptr if none is set
+    */
+    std::shared_ptr<ImeLauncher> PerUserSession::GetImeLauncher()
+    {
+        return imeLauncher;
+    }
+
+    /*! Set the handshake mode of the input clients
+    \param lazy true - a client gets the agent only when it starts input, so the background windows cost
+    \n             the service no binder call.
+    \n             false - every client gets the agent once it's prepared.
+    */
+    void PerUserSession::SetLazyHandshake(bool lazy)
+    {
+        lazyHandshake.store(lazy);
     }
 
     /*! Reset input method engine
@@ -236,7 +295,7 @@ namespace MiscServices {
     void PerUserSession::ResetIme(InputMethodProperty *defaultIme, InputMethodProperty *securityIme)
     {
         IMSA_HILOGI("PerUserSession::ResetIme");
-        std::unique_lock<std::mutex> lock(mtx);
+        std::unique_lock<std::mutex> lock(imeLock);
         InputMethodProperty *ime[] = {defaultIme, securityIme};
         for (int i = 0; i < MIN_IME; i++) {
             if (currentIme[i] == ime[i] && ime[i]) {
@@ -254,11 +313,11 @@ namespace MiscServices {
                 continue;
             }
 
-            std::map<sptr<IRemoteObject>, ClientInfo*>::const_iterator it;
             bool flag = false;
-            for (it = mapClients.cbegin(); it != mapClients.cend(); ++it) {
-                if ((i == DEFAULT_IME && !it->second->attribute.GetSecurityFlag()) ||
-                        (i == SECURITY_IME && it->second->attribute.GetSecurityFlag())) {
+            std::shared_ptr<const ClientRegistry::ClientList> clientList = clients.GetAll();
+            for (const auto &clientInfo : *clientList) {
+                if ((i == DEFAULT_IME && !clientInfo->attribute.GetSecurityFlag()) ||
+                        (i == SECURITY_IME && clientInfo->attribute.GetSecurityFlag())) {
                     flag = true;
                     break;
                 }
@@ -275,6 +334,7 @@ namespace MiscServices {
                 }
             }
         }
+        PublishSnapshot();
     }
 
     /*! Called when a package is removed
@@ -285,7 +345,7 @@ namespace MiscServices {
         IMSA_HILOGI("PerUserSession::OnPackageRemoved");
         InputMethodSetting tmpSetting;
         bool flag = false;
-        std::unique_lock<std::mutex> lock(mtx);
+        std::unique_lock<std::mutex> lock(imeLock);
         for (int i = 0; i < MAX_IME; i++) {
             if (currentIme[i] && currentIme[i]->mPackageName == packageName) {
                 if (currentClient && GetImeIndex(currentClient) == i) {
@@ -294,6 +354,11 @@ namespace MiscServices {
                 }
                 StopInputMethod(i);
                 currentIme[i] = nullptr;
+                std::string launchedId = imeLauncher ? imeLauncher->GetImeId() : "";
+                if (i == DEFAULT_IME && launchedId.substr(0, launchedId.find('/')) == Utils::to_utf8(packageName)) {
+                    // the pending starts of the removed ime are cancelled
+                    imeLauncher->OnDisconnected();
+                }
                 if (i == DEFAULT_IME) {
                     tmpSetting.SetCurrentKeyboardType(-1);
                     inputMethodSetting->SetCurrentKeyboardType(-1);
@@ -308,6 +373,7 @@ namespace MiscServices {
         if (flag) {
             Platform::Instance()->SetInputMethodSetting(userId_, tmpSetting);
         }
+        PublishSnapshot();
     }
 
     /*! Add an input client
@@ -326,19 +392,16 @@ namespace MiscServices {
                                   const InputAttribute& attribute)
     {
         IMSA_HILOGI("PerUserSession::AddClient");
-        ClientInfo *clientInfo = GetClientInfo(inputClient);
-        if (clientInfo) {
-            IMSA_HILOGE("PerUserSession::AddClient clientInfo is exist, not need add.");
-            return ErrorCode::NO_ERROR;
-        }
-
         sptr<IRemoteObject> obj = inputClient->AsObject();
         if (!obj) {
              IMSA_HILOGE("PerUserSession::AddClient inputClient AsObject is nullptr");
              return ErrorCode::ERROR_REMOTE_CLIENT_DIED;
         }
-        clientInfo = new ClientInfo(pid, uid, userId_, displayId, inputClient, channel, attribute);
-        mapClients.insert(std::pair<sptr<IRemoteObject>, ClientInfo*>(obj, clientInfo));
+        if (!clients.Add(obj, std::make_shared<ClientInfo>(pid, uid, userId_, displayId, inputClient, channel,
+            attribute))) {
+            IMSA_HILOGE("PerUserSession::AddClient clientInfo is exist, not need add.");
+            return ErrorCode::NO_ERROR;
+        }
         int ret = obj->AddDeathRecipient(clientDeathRecipient);
         if (ret != ErrorCode::NO_ERROR) {
             IMSA_HILOGE("PerUserSession::AddClient AddDeathRecipient return : %{public}s", ErrorCode::ToString(ret));
@@ -358,13 +421,16 @@ namespace MiscServices {
     {
         IMSA_HILOGE("PerUserSession::RemoveClient");
         sptr<IRemoteObject> b = inputClient->AsObject();
-        std::map<sptr<IRemoteObject>, ClientInfo*>::iterator it = mapClients.find(b);
-        if (it == mapClients.end()) {
+        std::shared_ptr<ClientInfo> clientInfo = clients.Remove(b);
+        if (!clientInfo) {
             IMSA_HILOGE("PerUserSession::RemoveClient ErrorCode::ERROR_CLIENT_NOT_FOUND");
             return ErrorCode::ERROR_CLIENT_NOT_FOUND;
         }
-        ClientInfo *clientInfo = it->second;
-        bool flag = clientInfo->attribute.GetSecurityFlag();
+        remainClientNum = clients.GetCount(clientInfo->attribute.GetSecurityFlag());
+        if (journal.client && journal.client->AsObject() == b) {
+            journal.client = nullptr;
+            journal.shown = false;
+        }
         int ret = b->RemoveDeathRecipient(clientDeathRecipient);
         if (ret != ErrorCode::NO_ERROR) {
             IMSA_HILOGE("PerUserSession::RemoveClient RemoveDeathRecipient fail %{public}s", ErrorCode::ToString(ret));
@@ -373,16 +439,6 @@ namespace MiscServices {
         if (ret != ErrorCode::NO_ERROR) {
             IMSA_HILOGE("PerUserSession::RemoveClient onInputReleased fail %{public}s", ErrorCode::ToString(ret));
         }
-        delete clientInfo;
-        clientInfo = nullptr;
-        mapClients.erase(it);
-
-        remainClientNum = 0;
-        for (it = mapClients.begin(); it != mapClients.end(); ++it) {
-            if (it->second->attribute.GetSecurityFlag() == flag) {
-                remainClientNum++;
-            }
-        }
         return ErrorCode::NO_ERROR;
     }
 
@@ -480,7 +536,7 @@ namespace MiscServices {
     int PerUserSession::ShowKeyboard(const sptr<IInputClient>& inputClient)
     {
         IMSA_HILOGI("PerUserSession::ShowKeyboard");
-        ClientInfo *clientInfo = GetClientInfo(inputClient);
+        std::shared_ptr<ClientInfo> clientInfo = GetClientInfo(inputClient);
         int index = GetImeIndex(inputClient);
         if (index == -1 || !clientInfo) {
             IMSA_HILOGE("PerUserSession::ShowKeyboard Aborted! index = -1 or clientInfo is nullptr");
@@ -495,6 +551,9 @@ namespace MiscServices {
         imsCore[0]->showKeyboard(clientInfo->channel);
 
         currentClient = inputClient;
+        if (imeLauncher) {
+            imeLauncher->OnKeyboardShown();
+        }
         return ErrorCode::NO_ERROR;
     }
 
@@ -515,7 +574,7 @@ namespace MiscServices {
             IMSA_HILOGE("PerUserSession::HideKeyboard Aborted! ErrorCode::ERROR_CLIENT_NOT_FOUND");
             return ErrorCode::ERROR_CLIENT_NOT_FOUND;
         }
-        ClientInfo *clientInfo = GetClientInfo(inputClient);
+        std::shared_ptr<ClientInfo> clientInfo = GetClientInfo(inputClient);
         if (!clientInfo) {
             IMSA_HILOGE("PerUserSession::HideKeyboard GetClientInfo pointer nullptr");
         }
@@ -536,20 +595,24 @@ namespace MiscServices {
     /*! Get the display mode of the current keyboard showing
     \return return display mode.
     \n 0 - part screen mode, 1 - full screen mode
+    \note It's called by binder threads and reads the published snapshot without lock.
     */
     int PerUserSession::GetDisplayMode()
     {
-        return currentDisplayMode;
+        return std::atomic_load(&sessionSnapshot)->displayMode;
     }
 
     /*! Get the keyboard window height
     \param[out] retHeight the height of keyboard window showing or showed returned to caller
     \return ErrorCode
+    \note It's called by binder threads. The snapshot holds the ime, so it can't be freed during the call
+        even if the work thread is stopping it.
     */
     int PerUserSession::GetKeyboardWindowHeight(int retHeight)
     {
-        if (imsCore[lastImeIndex]) {
-            int ret = imsCore[lastImeIndex]->getKeyboardWindowHeight(retHeight);
+        std::shared_ptr<const SessionSnapshot> snapshot = std::atomic_load(&sessionSnapshot);
+        if (snapshot->core) {
+            int ret = snapshot->core->getKeyboardWindowHeight(retHeight);
             if (ret != ErrorCode::NO_ERROR) {
                 IMSA_HILOGE("getKeyboardWindowHeight return : %{public}s", ErrorCode::ToString(ret));
             }
@@ -560,14 +623,31 @@ namespace MiscServices {
     }
 
     /*! Get the current keyboard type
-    \return return the pointer of the object of current keyboard type.
+    \return a copy of the current keyboard type, which stays valid after the ime or its types are freed.
     \n null if no keyboard type supported by the current ime.
-    \note The returned pointer should NOT be freed by the caller.
+    \note It's called by binder threads and reads the published snapshot without lock.
+    */
+    KeyboardTypePtr PerUserSession::GetCurrentKeyboardType()
+    {
+        return std::atomic_load(&sessionSnapshot)->keyboardType;
+    }
+
+    /*! Get the result of the last broadcast of the agent to the input clients
+    \note It's called by binder threads and reads the published snapshot without lock.
     */
-    KeyboardType *PerUserSession::GetCurrentKeyboardType()
+    BroadcastReport PerUserSession::GetLastBroadcast()
+    {
+        return std::atomic_load(&sessionSnapshot)->broadcast;
+    }
+
+    /*! Find the current keyboard type of the default ime
+    \return the pointer of the object of current keyboard type, null if it's not found.
+    \note It's called with imeLock held.
+    */
+    KeyboardType *PerUserSession::FindCurrentKeyboardType()
     {
         if (!inputMethodSetting || !currentIme[DEFAULT_IME]) {
-            IMSA_HILOGI("Ime has not started ! [%{public}d]\n", userId_);
+            IMSA_HILOGD("Ime has not started ! [%{public}d]\n", userId_);
             return nullptr;
         }
         if (currentIme[DEFAULT_IME] == currentIme[SECURITY_IME]) {
@@ -575,20 +655,17 @@ namespace MiscServices {
         }
         int hashCode = inputMethodSetting->GetCurrentKeyboardType();  // To be checked.
         if (hashCode == -1) {
-            std::vector<int> hashCodeList = inputMethodSetting->GetEnabledKeyboardTypes(currentIme[DEFAULT_IME]->mImeId);
-            if (!hashCodeList.size()) {
+            if (!inputMethodSetting->GetEnabledKeyboardType(currentIme[DEFAULT_IME]->mImeId, 0, hashCode)) {
                 IMSA_HILOGE("Cannot find any keyboard types for the current ime [%{public}d]\n", userId_);
                 return nullptr;
             }
-            hashCode = hashCodeList[0];
         }
 
-        for (int i = 0; i < (int)currentIme[DEFAULT_IME]->mTypes.size(); i++) {
-            if (currentIme[DEFAULT_IME]->mTypes[i]->getHashCode() == hashCode) {
-                return currentIme[DEFAULT_IME]->mTypes[i];
-            }
+        int num = FindKeyboardTypeIndex(currentIme[DEFAULT_IME], hashCode);
+        if (num == -1) {
+            return nullptr;
         }
-        return nullptr;
+        return currentIme[DEFAULT_IME]->mTypes[num];
     }
 
     /*! Handle the situation a remote input client died\n
@@ -598,26 +675,26 @@ namespace MiscServices {
     void PerUserSession::OnClientDied(const wptr<IRemoteObject>& who)
     {
         IMSA_HILOGI("PerUserSession::OnClientDied Start...[%{public}d]\n", userId_);
-        bool flag = false;
-        std::map<sptr<IRemoteObject>, ClientInfo*>::iterator it;
-
-        for (it = mapClients.begin(); it != mapClients.end(); ++it) {
-            if (it->first == who) {
-                flag = true;
-                break;
-            }
-        }
-        if (!flag) {
+        std::shared_ptr<ClientInfo> clientInfo = clients.Find(who.promote());
+        if (!clientInfo) {
             IMSA_HILOGW("Aborted! The client died is not found! [%{public}d]\n", userId_);
             return;
         }
 
-        sptr<IInputClient> client = it->second->client;
-        int remainClientNum = 0;
-        if (currentClient) {
-            HideKeyboard(client);
+        // The other windows of the dead process are removed together, their own notifications then find nothing.
+        // A client whose object is still alive belongs to a new process that reuses the pid, it's kept.
+        ClientRegistry::ClientList died = clients.FindByPid(clientInfo->pid);
+        for (const auto &info : died) {
+            sptr<IInputClient> client = info->client;
+            if (info != clientInfo && !client->AsObject()->IsObjectDead()) {
+                continue;
+            }
+            int remainClientNum = 0;
+            if (currentClient) {
+                HideKeyboard(client);
+            }
+            RemoveClient(client, remainClientNum);
         }
-        RemoveClient(client, remainClientNum);
     }
 
     /*! Handle the situation a input method service died\n
@@ -626,9 +703,14 @@ namespace MiscServices {
     */
     void PerUserSession::OnImsDied(const wptr<IRemoteObject>& who)
     {
-        (void)who; // temporary void it, as we will add support for security IME.
         IMSA_HILOGI("Start...[%{public}d]\n", userId_);
-        int index = 0;
+        if (standbyCore && standbyCore->AsObject() == who) {
+            IMSA_HILOGI("PerUserSession::OnImsDied standby ime %{public}s died", standbyImeId.c_str());
+            standbyCore = nullptr;
+            standbyAgent = nullptr;
+            return;
+        }
+        int index = -1;
         for (int i = 0; i < MAX_IME; i++) {
             if (!imsCore[i]) {
                 continue;
@@ -639,6 +721,14 @@ namespace MiscServices {
                 break;
             }
         }
+        if (index == -1) {
+            // an ime switched away from, it's not in use any more
+            IMSA_HILOGI("PerUserSession::OnImsDied the ime died is not in use [%{public}d]\n", userId_);
+            return;
+        }
+        if (imeLauncher) {
+            imeLauncher->OnDisconnected();
+        }
         if (currentClient && (GetImeIndex(currentClient) == index ||
             currentIme[index] == currentIme[1 - index])) {
             needReshowClient = currentClient;
@@ -650,22 +740,42 @@ namespace MiscServices {
         }
 
         if (IncreaseOrResetImeError(false, index) == IME_ERROR_CODE) {
-            // call to disable the current input method.
+            // call to disable the current input method. No input state is replayed into the ime enabled instead.
             MessageParcel *parcel = new MessageParcel();
             parcel->WriteInt32(userId_);
             parcel->WriteString16(currentIme[index]->mImeId);
             Message *msg = new Message(MSG_ID_DISABLE_IMS, parcel);
             MessageHandler::Instance()->SendMessage(msg);
+            journal.pending = false;
+            IMSA_HILOGI("End...[%{public}d]\n", userId_);
+            return;
+        }
+        // the input state is replayed into the restarted ime, see ReplayJournal
+        journal.kbdIndex = currentKbdIndex[DEFAULT_IME];
+        journal.pending = true;
+        journal.diedTime = std::chrono::steady_clock::now();
+        if (imeLauncher && index == DEFAULT_IME) {
+            // the launcher restarts the ime at once, and backs off if it keeps crashing. A removed ime fails to
+            // start until OnPackageRemoved stops the launch, or the launcher gives up.
+            IMSA_HILOGI("IME died. Restart input method ! [%{public}d]\n", userId_);
+            imeLauncher->Recover(Utils::to_utf8(currentIme[index]->mImeId));
         } else {
-            // restart current input method.
+            // restart current input method, after PACKAGE_REMOVED is received if this ime has been removed
             IMSA_HILOGI("IME died. Restart input method ! [%{public}d]\n", userId_);
-            MessageParcel *parcel = new MessageParcel();
-            parcel->WriteInt32(userId_);
-            parcel->WriteInt32(index);
-            parcel->WriteString16(currentIme[index]->mImeId);
-            Message *msg = new Message(MSG_ID_RESTART_IMS, parcel);
-            usleep(1600*1000); // wait that PACKAGE_REMOVED message is received if this ime has been removed
-            MessageHandler::Instance()->SendMessage(msg);
+            int userId = userId_;
+            std::u16string imeId = currentIme[index]->mImeId;
+            auto restart = [userId, index, imeId]() {
+                MessageParcel *parcel = new MessageParcel();
+                parcel->WriteInt32(userId);
+                parcel->WriteInt32(index);
+                parcel->WriteString16(imeId);
+                MessageHandler::Instance()->SendMessage(new Message(MSG_ID_RESTART_IMS, parcel));
+            };
+            if (imeLauncher) {
+                imeLauncher->Schedule(restart, RESTART_IMS_DELAY_MS);
+            } else {
+                restart();
+            }
         }
         IMSA_HILOGI("End...[%{public}d]\n", userId_);
     }
@@ -679,7 +789,20 @@ namespace MiscServices {
     int PerUserSession::OnSettingChanged(const std::u16string& key, const std::u16string& value)
     {
         IMSA_HILOGI("Start...[%{public}d]\n", userId_);
-        std::unique_lock<std::mutex> lock(mtx);
+        std::unique_lock<std::mutex> lock(imeLock);
+        int ret = UpdateSetting(key, value);
+        PublishSnapshot();
+        return ret;
+    }
+
+    /*! Apply the change of an input method setting item to this session
+    \param key the name of setting item changed.
+    \param value the value of setting item changed.
+    \return ErrorCode returned to OnSettingChanged
+    \note It's called with imeLock held.
+    */
+    int PerUserSession::UpdateSetting(const std::u16string& key, const std::u16string& value)
+    {
         if (!inputMethodSetting) {
             return ErrorCode::ERROR_NULL_POINTER;
         }
@@ -743,28 +866,21 @@ namespace MiscServices {
         }
         // switch within the current ime.
         if (index == SECURITY_IME || currentIme[DEFAULT_IME] == currentIme[SECURITY_IME]) {
-            int num = currentKbdIndex[index];
-            if (currentIme[index]->mTypes[num]->getHashCode() == hashCode) {
+            int num = FindKeyboardTypeIndex(currentIme[index], hashCode);
+            if (num == currentKbdIndex[index]) {
                 return ErrorCode::ERROR_SETTING_SAME_VALUE;
             }
-            for (int i = 0; i < (int)currentIme[index]->mTypes.size(); i++) {
-                if (currentIme[index]->mTypes[i]->getHashCode() == hashCode) {
-                    currentKbdIndex[index] = i;
-                    break;
-                }
+            if (num != -1) {
+                currentKbdIndex[index] = num;
             }
         } else {
             std::u16string imeId = currentIme[index]->mImeId;
-            std::vector<int> currentKbdTypes = inputMethodSetting->GetEnabledKeyboardTypes(imeId);
-            int num = currentKbdIndex[index];
-            if (currentKbdTypes[num] == hashCode) {
+            int num = inputMethodSetting->GetKeyboardTypeIndex(imeId, hashCode);
+            if (num == currentKbdIndex[index]) {
                 return ErrorCode::ERROR_SETTING_SAME_VALUE;
             }
-            for (int i = 0; i < (int)currentKbdTypes.size(); i++) {
-                if (currentKbdTypes[i] == hashCode) {
-                    currentKbdIndex[index] = i;
-                    break;
-                }
+            if (num != -1) {
+                currentKbdIndex[index] = num;
             }
         }
         KeyboardType *type = GetKeyboardType(index, currentKbdIndex[index]);
@@ -795,6 +911,7 @@ namespace MiscServices {
     {
         IMSA_HILOGW("PerUserSession::OnHideKeyboardSelf");
         (void) flags;
+        journal.shown = false;
         HideKeyboard(currentClient);
     }
 
@@ -811,9 +928,7 @@ namespace MiscServices {
         if (index == SECURITY_IME || currentIme[DEFAULT_IME] == currentIme[SECURITY_IME]) {
             size = currentIme[index]->mTypes.size();
         } else {
-            std::u16string imeId = currentIme[index]->mImeId;
-            std::vector<int> currentKbdTypes = inputMethodSetting->GetEnabledKeyboardTypes(imeId);
-            size = currentKbdTypes.size();
+            size = inputMethodSetting->GetEnabledKeyboardTypeCount(currentIme[index]->mImeId);
         }
         if (size < MIN_IME) {
             IMSA_HILOGW("No next keyboard is available. [%{public}d]\n", userId_);
@@ -849,7 +964,7 @@ namespace MiscServices {
     void PerUserSession::OnSetDisplayMode(int mode)
     {
         currentDisplayMode = mode;
-        ClientInfo *clientInfo = GetClientInfo(currentClient);
+        std::shared_ptr<ClientInfo> clientInfo = GetClientInfo(currentClient);
         if (!clientInfo) {
             IMSA_HILOGE("%{public}s [%{public}d]\n", ErrorCode::ToString(ErrorCode::ERROR_CLIENT_NOT_FOUND), userId_);
             return;
@@ -860,6 +975,37 @@ namespace MiscServices {
         }
     }
 
+    /*! Replay the input state journaled before the ime died into the one connected
+    \n Run in work thread of this user. The keyboard type and the attribute of the client are restored, and the
+        keyboard is shown again if it was showing.
+    */
+    void PerUserSession::ReplayJournal()
+    {
+        journal.pending = false;
+        std::shared_ptr<ClientInfo> clientInfo = journal.client ? GetClientInfo(journal.client) : nullptr;
+        if (!clientInfo) {
+            IMSA_HILOGI("PerUserSession::ReplayJournal no input client to restore [%{public}d]\n", userId_);
+            return;
+        }
+        if (currentIme[DEFAULT_IME] && (inputMethodSetting || currentIme[DEFAULT_IME] == currentIme[SECURITY_IME])) {
+            KeyboardType *type = GetKeyboardType(DEFAULT_IME, journal.kbdIndex);
+            if (type) {
+                currentKbdIndex[DEFAULT_IME] = journal.kbdIndex;
+                imsCore[0]->setKeyboardType(*type);
+            }
+        }
+        imsCore[0]->startInput(clientInfo->channel, journal.attribute, false);
+        if (journal.shown) {
+            imsCore[0]->SetClientState(true);
+            SendAgentToSingleClient(journal.client, imsAgent);
+            ShowKeyboard(journal.client);
+        }
+        auto cost = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() -
+            journal.diedTime);
+        IMSA_HILOGI("PerUserSession::ReplayJournal input restored in %{public}lld ms [%{public}d]\n",
+            (long long)cost.count(), userId_);
+    }
+
     /*! Restart input method service
     \param index it can be DEFAULT_IME or SECURITY_IME
     \param imeId the id of the input method service going to restart
@@ -900,29 +1046,26 @@ namespace MiscServices {
             StopInputMethod(i);
             currentIme[i] = nullptr;
         }
+        DropStandbyIme();
+        standbyImeId.clear();
         // disconnect all clients.
-        std::map<sptr<IRemoteObject>, ClientInfo*>::iterator it;
-        for (it = mapClients.begin(); it != mapClients.end();) {
-            sptr<IRemoteObject> b = it->first;
+        for (const auto &clientInfo : clients.Clear()) {
+            sptr<IRemoteObject> b = clientInfo->client->AsObject();
             b->RemoveDeathRecipient(clientDeathRecipient);
-            ClientInfo *clientInfo = it->second;
-            if (clientInfo) {
-                int ret = clientInfo->client->onInputReleased(0);
-                if (ret != ErrorCode::NO_ERROR) {
-                    IMSA_HILOGE("2-onInputReleased return : %{public}s", ErrorCode::ToString(ret));
-                }
-                delete clientInfo;
-                clientInfo = nullptr;
+            int ret = clientInfo->client->onInputReleased(0);
+            if (ret != ErrorCode::NO_ERROR) {
+                IMSA_HILOGE("2-onInputReleased return : %{public}s", ErrorCode::ToString(ret));
             }
             IMSA_HILOGD("erase client..\n");
-            it = mapClients.erase(it);
         }
-        mapClients.clear();
 
         // reset values
+        journal = RecoveryJournal();
         inputMethodSetting = nullptr;
+        inputMethodIndex = nullptr;
         currentClient = nullptr;
         needReshowClient = nullptr;
+        PublishSnapshot();
     }
 
     /*! Increase or reset ime error number
@@ -972,22 +1115,36 @@ namespace MiscServices {
             }
             return currentIme[imeIndex]->mTypes[typeIndex];
         } else {
-            std::u16string imeId = currentIme[imeIndex]->mImeId;
-            std::vector<int> currentKbdTypes = inputMethodSetting->GetEnabledKeyboardTypes(imeId);
-            int size = currentKbdTypes.size();
-            if (typeIndex >= size) {
+            int hashCode = 0;
+            if (!inputMethodSetting->GetEnabledKeyboardType(currentIme[imeIndex]->mImeId, typeIndex, hashCode)) {
                 return nullptr;
             }
-            int hashCode = currentKbdTypes[typeIndex];
-            for (int i = 0; i < (int)currentIme[imeIndex]->mTypes.size(); i++) {
-                if (currentIme[imeIndex]->mTypes[i]->getHashCode() == hashCode) {
-                    return currentIme[imeIndex]->mTypes[i];
-                }
+            int num = FindKeyboardTypeIndex(currentIme[imeIndex], hashCode);
+            if (num != -1) {
+                return currentIme[imeIndex]->mTypes[num];
             }
         }
         return nullptr;
     }
 
+    /*! Get the position of a keyboard type in the type list of an input method engine
+    \param ime the given input method engine
+    \param hashCode the hashCode of the keyboard type
+    \return the position in ime->mTypes, -1 when the keyboard type is not found
+    */
+    int PerUserSession::FindKeyboardTypeIndex(const InputMethodProperty *ime, int hashCode)
+    {
+        if (inputMethodIndex) {
+            return inputMethodIndex->GetKeyboardTypeIndex(ime, hashCode);
+        }
+        for (int i = 0; i < (int)ime->mTypes.size(); i++) {
+            if (ime->mTypes[i]->getHashCode() == hashCode) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
     /*! Reset current keyboard type
     \param imeIndex it can be 0 or 1. 0 - default ime, 1 - security ime
     */
@@ -1009,21 +1166,16 @@ namespace MiscServices {
         } else {
             bool flag = false;
             if (imeIndex == SECURITY_IME || currentIme[DEFAULT_IME] == currentIme[SECURITY_IME]) {
-                for (int i = 0; i < (int)currentIme[imeIndex]->mTypes.size(); i++) {
-                    if (currentIme[imeIndex]->mTypes[i]->getHashCode() == hashCode) {
-                        currentKbdIndex[imeIndex] = i;
-                        flag = true;
-                        break;
-                    }
+                int num = FindKeyboardTypeIndex(currentIme[imeIndex], hashCode);
+                if (num != -1) {
+                    currentKbdIndex[imeIndex] = num;
+                    flag = true;
                 }
             } else {
-                std::vector<int> hashCodeList = inputMethodSetting->GetEnabledKeyboardTypes(currentIme[imeIndex]->mImeId);
-                for (int i = 0; i < (int)hashCodeList.size(); i++) {
-                    if (hashCode == hashCodeList[i]) {
-                        currentKbdIndex[imeIndex] = i;
-                        flag = true;
-                        break;
-                    }
+                int num = inputMethodSetting->GetKeyboardTypeIndex(currentIme[imeIndex]->mImeId, hashCode);
+                if (num != -1) {
+                    currentKbdIndex[imeIndex] = num;
+                    flag = true;
                 }
             }
             if (!flag) {
@@ -1065,7 +1217,7 @@ namespace MiscServices {
             return -1;
         }
 
-        ClientInfo *clientInfo = GetClientInfo(inputClient);
+        std::shared_ptr<ClientInfo> clientInfo = GetClientInfo(inputClient);
         if (!clientInfo) {
             IMSA_HILOGW("PerUserSession::GetImeIndex clientInfo is nullptr");
             return -1;
@@ -1106,53 +1258,61 @@ namespace MiscServices {
 
     /*! Get ClientInfo
     \param inputClient the IInputClient remote handler of given input client
-    \return a pointer of ClientInfo if client is found
+    \return the ClientInfo if client is found
     \n      null if client is not found
-    \note the clientInfo pointer should not be freed by caller
+    \note the ClientInfo stays valid for the caller even if the client is removed meanwhile
     */
-    ClientInfo *PerUserSession::GetClientInfo(const sptr<IInputClient>& inputClient)
+    std::shared_ptr<ClientInfo> PerUserSession::GetClientInfo(const sptr<IInputClient>& inputClient)
     {
         if (!inputClient) {
             IMSA_HILOGE("PerUserSession::GetClientInfo inputClient is nullptr");
             return nullptr;
         }
-        sptr<IRemoteObject> b = Platform::RemoteBrokerToObject(inputClient);
-        std::map<sptr<IRemoteObject>, ClientInfo*>::iterator it = mapClients.find(b);
-        if (it == mapClients.end()) {
-            return nullptr;
-        }
-
-        return (ClientInfo*) it->second;
+        return clients.Find(Platform::RemoteBrokerToObject(inputClient));
     }
 
-    bool PerUserSession::StartInputService()
-    {
-        IMSA_HILOGE("PerUserSession::StartInputService");
-        sptr<AAFwk::IAbilityManager> ams = GetAbilityManagerService();
-        if (!ams) {
-            return false;
-        }
-        AAFwk::Want want;
-        want.SetAction("action.system.inputmethod");
-        want.SetElementName("com.example.kikakeyboard", "com.example.kikakeyboard.ServiceExtAbility");
-        int32_t result = ams->StartAbility(want);
-        if (result) {
-            IMSA_HILOGE("PerUserSession::StartInputService fail. result = %{public}d", result);
-            return false;
+    namespace {
+        /*! Check if the keyboard type published is the same as the current one
+        \param published the copy in the snapshot, null if none
+        \param type the keyboard type of the current ime, null if none
+        */
+        bool IsSameKeyboardType(const KeyboardType *published, const KeyboardType *type)
+        {
+            if (!published || !type) {
+                return published == type;
+            }
+            return published->getHashCode() == type->getHashCode() && published->getId() == type->getId() &&
+                published->getLabelId() == type->getLabelId() && published->getIconId() == type->getIconId() &&
+                published->getLanguage() == type->getLanguage() &&
+                published->getInputSource() == type->getInputSource() &&
+                published->getCustomizedValue() == type->getCustomizedValue();
         }
-        return true;
     }
 
-    sptr<AAFwk::IAbilityManager> PerUserSession::GetAbilityManagerService()
+    /*! Publish the state read by binder threads
+    \n A new snapshot is only built when the state is changed, the readers holding the old one keep it
+        alive until they are done. The keyboard type is copied into the snapshot, as the ime owning it can be
+        freed while a binder thread still reads it.
+    \note It's called with imeLock held.
+    */
+    void PerUserSession::PublishSnapshot()
     {
-        IMSA_HILOGE("GetAbilityManagerService start");
-        sptr<IRemoteObject> abilityMsObj =
-        OHOS::DelayedSingleton<AAFwk::SaMgrClient>::GetInstance()->GetSystemAbility(ABILITY_MGR_SERVICE_ID);
-        if (!abilityMsObj) {
-            IMSA_HILOGE("failed to get ability manager service");
-            return nullptr;
+        KeyboardType *keyboardType = FindCurrentKeyboardType();
+        std::shared_ptr<const SessionSnapshot> current = std::atomic_load(&sessionSnapshot);
+        if (current && current->displayMode == currentDisplayMode && current->core == imsCore[DEFAULT_IME] &&
+            current->agent == imsAgent && IsSameKeyboardType(current->keyboardType.get(), keyboardType) &&
+            current->broadcast.sequence == lastBroadcast.sequence) {
+            return;
         }
-        return iface_cast<AAFwk::IAbilityManager>(abilityMsObj);
+        std::shared_ptr<SessionSnapshot> snapshot = std::make_shared<SessionSnapshot>();
+        snapshot->displayMode = currentDisplayMode;
+        snapshot->core = imsCore[DEFAULT_IME];
+        snapshot->agent = imsAgent;
+        snapshot->broadcast = lastBroadcast;
+        if (keyboardType) {
+            snapshot->keyboardType = std::make_shared<const KeyboardType>(*keyboardType);
+        }
+        std::atomic_store(&sessionSnapshot, std::shared_ptr<const SessionSnapshot>(snapshot));
     }
 
     /*! Prepare input. Called by an input client.
@@ -1192,22 +1352,52 @@ namespace MiscServices {
             IMSA_HILOGE("PerUserSession::OnPrepareInput Aborted! %{public}s", ErrorCode::ToString(ret));
             return;
         }
-        SendAgentToSingleClient(client);
+        if (lazyHandshake.load() && !HasInputFocus(clientObject)) {
+            // a background window gets the agent when it starts input, see OnStartInput
+            IMSA_HILOGD("PerUserSession::OnPrepareInput handshake of pid %{public}d is deferred", pid);
+            return;
+        }
+        // called without imeLock, the agent is taken from the snapshot published by the work thread
+        SendAgentToSingleClient(client, std::atomic_load(&sessionSnapshot)->agent);
     }
 
-    void PerUserSession::SendAgentToSingleClient(const sptr<IInputClient>& inputClient)
+    /*! Send the agent of the input method service to an input client
+    \n Run in work thread of this user. Nothing is sent if the client already has the agent.
+    \param inputClient the input client
+    \param agent the agent of the current input method service
+    */
+    void PerUserSession::SendAgentToSingleClient(const sptr<IInputClient>& inputClient,
+        const sptr<IInputMethodAgent>& agent)
     {
         IMSA_HILOGI("PerUserSession::SendAgentToSingleClient");
-        if (!imsAgent) {
+        if (!agent) {
             IMSA_HILOGI("PerUserSession::SendAgentToSingleClient imsAgent is nullptr");
             return;
         }
-        ClientInfo *clientInfo = GetClientInfo(inputClient);
+        std::shared_ptr<ClientInfo> clientInfo = GetClientInfo(inputClient);
         if (!clientInfo) {
             IMSA_HILOGE("PerUserSession::SendAgentToSingleClient clientInfo is nullptr");
             return;
         }
-        clientInfo->client->onInputReady(imsAgent);
+        if (clientInfo->agent == agent) {
+            return;
+        }
+        int ret = clientInfo->client->onInputReady(agent);
+        if (ret != ErrorCode::NO_ERROR) {
+            IMSA_HILOGE("PerUserSession::SendAgentToSingleClient onInputReady return : %{public}s",
+                ErrorCode::ToString(ret));
+            return;
+        }
+        clientInfo->agent = agent;
+    }
+
+    /*! Check if an input client has the input focus
+    \n The service doesn't follow the window focus, the client which started input last is taken as focused.
+    \param clientObject the remote object of the client
+    */
+    bool PerUserSession::HasInputFocus(const sptr<IRemoteObject>& clientObject)
+    {
+        return journal.client && journal.client->AsObject() == clientObject;
     }
 
     /*! Release input. Called by an input client.
@@ -1243,12 +1433,24 @@ namespace MiscServices {
     void PerUserSession::OnStartInput(Message *msg)
     {
         IMSA_HILOGI("PerUserSession::OnStartInput");
+        TraceSpan span(msg->traceId_, "PerUserSession::OnStartInput");
         MessageParcel *data = msg->msgContent_;
         sptr<IRemoteObject> clientObject = data->ReadRemoteObject();
         sptr<InputClientProxy> client = new InputClientProxy(clientObject);
+        std::shared_ptr<ClientInfo> clientInfo = GetClientInfo(client);
+        if (clientInfo) {
+            journal.client = client;
+            journal.attribute = clientInfo->attribute;
+            journal.shown = true;
+        }
         if (imsCore[0]) {
             imsCore[0]->SetClientState(true);
+        } else {
+            // the IME is still starting, the keyboard is shown once it's connected
+            needReshowClient = client;
         }
+        // the handshake of a client whose window was in the background may be deferred till now
+        SendAgentToSingleClient(client, imsAgent);
         ShowKeyboard(client);
     }
 
@@ -1259,20 +1461,277 @@ namespace MiscServices {
 
         sptr<IRemoteObject> coreObject = data->ReadRemoteObject();
         sptr<InputMethodCoreProxy> core = new InputMethodCoreProxy(coreObject);
+        sptr<IRemoteObject> agentObject = data->ReadRemoteObject();
+        sptr<InputMethodAgentProxy> proxy = new InputMethodAgentProxy(agentObject);
+        std::string bundleName = Utils::to_utf8(data->ReadString16());
+        int pid = data->ReadInt32();
+
+        std::string standbyBundle = standbyLaunchedId.substr(0, standbyLaunchedId.find('/'));
+        if (imsCore[0] && !bundleName.empty() && bundleName != imsBundleName) {
+            if (bundleName == standbyBundle) {
+                OnStandbyConnected(core, proxy, pid);
+                return;
+            }
+            if (StopAbandonedStandby(bundleName, core)) {
+                return;
+            }
+        }
         if (imsCore[0]) {
             IMSA_HILOGI("PerUserSession::SetCoreAndAgent Input Method Service has already been started ! ");
+            imsCore[0]->AsObject()->RemoveDeathRecipient(imsDeathRecipient);
+        }
+        // the death of the ime is handled by OnImsDied, which restarts it
+        if (coreObject) {
+            coreObject->AddDeathRecipient(imsDeathRecipient);
         }
         imsCore[0] = core;
-
-        sptr<IRemoteObject> agentObject = data->ReadRemoteObject();
-        sptr<InputMethodAgentProxy> proxy = new InputMethodAgentProxy(agentObject);
         imsAgent = proxy;
+        imsBundleName = bundleName;
 
         InitInputControlChannel();
 
         SendAgentToAllClients();
+        if (imeLauncher) {
+            imeLauncher->OnConnected();
+        }
+        if (journal.pending) {
+            ReplayJournal();
+        } else if (needReshowClient && GetClientInfo(needReshowClient)) {
+            imsCore[0]->SetClientState(true);
+            SendAgentToSingleClient(needReshowClient, imsAgent);
+            ShowKeyboard(needReshowClient);
+        }
+        needReshowClient = nullptr;
+        LaunchStandbyIme();
+    }
+
+    /*! Switch the default input method service
+    \n Run in work thread of this user
+    \n If the ime switched to is the standby one, its core and agent replace the current ones and the keyboard
+        moves to it at once. Otherwise the current ime is stopped and the new one is launched.
+    \param msg the id of the ime switched to is saved in msg->msgContent_
+    */
+    void PerUserSession::OnSwitchIme(Message *msg)
+    {
+        std::string imeId = Utils::to_utf8(msg->msgContent_->ReadString16());
+        std::string oldImeId = imeLauncher ? imeLauncher->GetImeId() : "";
+        IMSA_HILOGI("PerUserSession::OnSwitchIme %{public}s -> %{public}s", oldImeId.c_str(), imeId.c_str());
+        sptr<IInputMethodCore> oldCore = imsCore[0];
+        if (!standbyCore || standbyImeId != imeId) {
+            if (oldCore) {
+                // the ime is stopped on purpose, it's not restarted when it exits
+                oldCore->AsObject()->RemoveDeathRecipient(imsDeathRecipient);
+                oldCore->StopInputService(oldImeId);
+            }
+            if (imeLauncher) {
+                imeLauncher->OnDisconnected();
+                imeLauncher->Launch(imeId);
+            }
+            return;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        sptr<IInputClient> client = currentClient;
+        if (client && oldCore) {
+            HideKeyboard(client);
+        }
+        imsCore[0] = standbyCore;
+        imsAgent = standbyAgent;
+        imsBundleName = standbyImeId.substr(0, standbyImeId.find('/'));
+        standbyCore = nullptr;
+        standbyAgent = nullptr;
+        standbyImeId.clear();
+        if (imeLauncher) {
+            imeLauncher->OnSwitched(imeId);
+        }
+
+        InitInputControlChannel();
+        SendAgentToAllClients();
+        if (client && GetClientInfo(client)) {
+            imsCore[0]->SetClientState(true);
+            ShowKeyboard(client);
+        }
+        if (oldCore) {
+            oldCore->StopInputService(oldImeId);
+        }
+        auto cost = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        IMSA_HILOGI("PerUserSession::OnSwitchIme switched to standby in %{public}lld us", (long long)cost.count());
+    }
+
+    /*! Set the input method service kept started in the background
+    \n Run in work thread of this user
+    \param msg the id of the ime and its memory budget in KB are saved in msg->msgContent_.
+        An empty id or a budget of 0 disables the standby.
+    */
+    void PerUserSession::OnSetStandbyIme(Message *msg)
+    {
+        MessageParcel *data = msg->msgContent_;
+        std::string imeId = Utils::to_utf8(data->ReadString16());
+        int64_t budgetKb = data->ReadInt64();
+        if (budgetKb <= 0) {
+            imeId.clear();
+        }
+        if (imeId != standbyImeId) {
+            DropStandbyIme();
+            if (!standbyLaunchedId.empty()) {
+                // the start of the replaced ime is not waited for, it's stopped if it still connects
+                standbyAbandoned[standbyLaunchedId] = standbyLaunchId;
+                standbyLaunchedId.clear();
+            }
+            standbyImeId = imeId;
+            standbyRejectedId.clear();
+        }
+        standbyBudgetKb = budgetKb;
+        LaunchStandbyIme();
     }
 
+    /*! Check the standby input method service, as asked by the launcher
+    \n Run in work thread of this user
+    \n A standby ime not connected after its start failed or timed out is not started again until the standby
+        ime changes. A connected one is dropped once it uses more memory than the budget, otherwise it's
+        checked again after ImeLauncher::STANDBY_CHECK_MS.
+    \param msg the id of the ime and the id of its start are saved in msg->msgContent_
+    */
+    void PerUserSession::OnCheckStandbyIme(Message *msg)
+    {
+        MessageParcel *data = msg->msgContent_;
+        std::string imeId = Utils::to_utf8(data->ReadString16());
+        uint64_t launchId = data->ReadUint64();
+        auto abandoned = standbyAbandoned.find(imeId);
+        if (abandoned != standbyAbandoned.end() && abandoned->second == launchId) {
+            // the replaced ime did not connect, nothing is left to stop
+            standbyAbandoned.erase(abandoned);
+            return;
+        }
+        if (launchId != standbyLaunchId || imeId != standbyImeId) {
+            return;
+        }
+        if (!standbyCore) {
+            if (standbyLaunchedId == imeId) {
+                IMSA_HILOGE("PerUserSession::OnCheckStandbyIme %{public}s not connected in time", imeId.c_str());
+                standbyLaunchedId.clear();
+                standbyRejectedId = imeId;
+            }
+            return;
+        }
+        int64_t residentKb = GetResidentKb(standbyPid);
+        if (residentKb < 0 || residentKb > standbyBudgetKb) {
+            IMSA_HILOGE("PerUserSession::OnCheckStandbyIme %{public}s uses %{public}lld KB, over %{public}lld KB",
+                imeId.c_str(), (long long)residentKb, (long long)standbyBudgetKb);
+            standbyRejectedId = imeId;
+            DropStandbyIme();
+            return;
+        }
+        if (imeLauncher) {
+            imeLauncher->ScheduleStandbyCheck(imeId, launchId, ImeLauncher::STANDBY_CHECK_MS);
+        }
+    }
+
+    /*! Stop a standby input method service connecting after it was replaced by another one
+    \param bundleName the bundle of the service connecting
+    \param core the remote handler of the service
+    \return true - the service is a replaced standby ime, and it's stopped
+    */
+    bool PerUserSession::StopAbandonedStandby(const std::string &bundleName, const sptr<IInputMethodCore>& core)
+    {
+        for (auto it = standbyAbandoned.begin(); it != standbyAbandoned.end(); ++it) {
+            if (it->first.substr(0, it->first.find('/')) == bundleName) {
+                IMSA_HILOGI("PerUserSession::StopAbandonedStandby %{public}s", it->first.c_str());
+                core->StopInputService(it->first);
+                standbyAbandoned.erase(it);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /*! Called when the standby input method service sends its core and agent
+    \param core the remote handler of the standby ime
+    \param agent the agent of the standby ime
+    \param pid the pid of the process of the standby ime
+    */
+    void PerUserSession::OnStandbyConnected(const sptr<IInputMethodCore>& core, const sptr<IInputMethodAgent>& agent,
+                                            int pid)
+    {
+        std::string imeId = standbyLaunchedId;
+        standbyLaunchedId.clear();
+        if (imeId != standbyImeId) {
+            // the standby is changed since it was launched
+            core->StopInputService(imeId);
+            return;
+        }
+        int64_t residentKb = GetResidentKb(pid);
+        if (residentKb < 0 || residentKb > standbyBudgetKb) {
+            IMSA_HILOGE("PerUserSession::OnStandbyConnected %{public}s uses %{public}lld KB, over %{public}lld KB",
+                imeId.c_str(), (long long)residentKb, (long long)standbyBudgetKb);
+            standbyRejectedId = imeId;
+            core->StopInputService(imeId);
+            return;
+        }
+        IMSA_HILOGI("PerUserSession::OnStandbyConnected %{public}s in standby, %{public}lld KB", imeId.c_str(),
+            (long long)residentKb);
+        standbyCore = core;
+        standbyAgent = agent;
+        standbyPid = pid;
+        core->AsObject()->AddDeathRecipient(imsDeathRecipient);
+    }
+
+    /*! Start the standby input method service once the default one is connected
+    \n The ability start is requested by the launcher out of this thread, which checks it back through
+        MSG_ID_CHECK_STANDBY_IME.
+    */
+    void PerUserSession::LaunchStandbyIme()
+    {
+        if (standbyImeId.empty() || standbyImeId == standbyRejectedId || !imsCore[0] || standbyCore ||
+            standbyLaunchedId == standbyImeId || !imeLauncher) {
+            return;
+        }
+        if (imeLauncher->StartStandby(standbyImeId, ++standbyLaunchId)) {
+            standbyLaunchedId = standbyImeId;
+        }
+    }
+
+    /*! Stop the standby input method service
+    \note A standby ime being started is stopped when it connects.
+    */
+    void PerUserSession::DropStandbyIme()
+    {
+        if (standbyCore) {
+            standbyCore->AsObject()->RemoveDeathRecipient(imsDeathRecipient);
+            standbyCore->StopInputService(standbyImeId);
+        }
+        standbyCore = nullptr;
+        standbyAgent = nullptr;
+    }
+
+    /*! Get the resident memory of a process
+    \param pid the pid of the process
+    \return the resident memory in KB, or -1 if it can't be read
+    */
+    int64_t PerUserSession::GetResidentKb(int pid)
+    {
+        std::string path = "/proc/" + std::to_string(pid) + "/statm";
+        FILE *file = fopen(path.c_str(), "r");
+        if (!file) {
+            return -1;
+        }
+        long size = 0;
+        long resident = 0;
+        int ret = fscanf(file, "%ld %ld", &size, &resident);
+        fclose(file);
+        if (ret != 2) { // size and resident are read
+            return -1;
+        }
+        return (int64_t)resident * sysconf(_SC_PAGESIZE) / 1024; // 1024: bytes in a KB
+    }
+
+    /*! Send the agent of the current input method service to all the input clients
+    \n onInputReady is a one-way call, so the broadcast doesn't wait for any client to handle it, and its
+        cost is bounded by the slowest single send rather than the sum of the clients' handling.
+        The clients which can't be reached and the sends slower than SLOW_CLIENT_CALL_US are reported,
+        and the result is published as the last broadcast.
+    \n In lazy handshake mode, only the client with the input focus gets the agent here.
+    */
     void PerUserSession::SendAgentToAllClients()
     {
         IMSA_HILOGI("PerUserSession::SendAgentToAllClients");
@@ -1281,13 +1740,42 @@ namespace MiscServices {
             return;
         }
 
-        for (std::map<sptr<IRemoteObject>, ClientInfo*>::iterator it = mapClients.begin();
-            it != mapClients.end(); ++it) {
-            ClientInfo *clientInfo = (ClientInfo*) it->second;
-            if (clientInfo) {
-                clientInfo->client->onInputReady(imsAgent);
+        std::shared_ptr<const ClientRegistry::ClientList> clientList = clients.GetAll();
+        bool lazy = lazyHandshake.load();
+        BroadcastReport report;
+        report.sequence = lastBroadcast.sequence + 1;
+        report.clientCount = static_cast<int32_t>(clientList->size());
+        std::string failedPids;
+        auto begin = std::chrono::steady_clock::now();
+        for (const auto &clientInfo : *clientList) {
+            if (lazy && !HasInputFocus(clientInfo->client->AsObject())) {
+                report.deferredCount++;
+                continue;
             }
+            auto start = std::chrono::steady_clock::now();
+            int ret = clientInfo->client->onInputReady(imsAgent);
+            auto cost = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+            if (cost.count() > SLOW_CLIENT_CALL_US) {
+                report.slowCount++;
+                IMSA_HILOGW("PerUserSession::SendAgentToAllClients pid %{public}d took %{public}lld us",
+                    clientInfo->pid, (long long)cost.count());
+            }
+            if (ret != ErrorCode::NO_ERROR) {
+                report.failedPids.push_back(clientInfo->pid);
+                failedPids += std::to_string(clientInfo->pid) + " ";
+                continue;
+            }
+            clientInfo->agent = imsAgent;
         }
+        report.costUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - begin).count();
+        if (!report.failedPids.empty()) {
+            IMSA_HILOGE("PerUserSession::SendAgentToAllClients %{public}zu of %{public}d failed, pid: %{public}s",
+                report.failedPids.size(), report.clientCount, failedPids.c_str());
+        }
+        IMSA_HILOGI("PerUserSession::SendAgentToAllClients %{public}d clients, %{public}d deferred, %{public}lld us",
+            report.clientCount, report.deferredCount, (long long)report.costUs);
+        lastBroadcast = report;
     }
 
     void PerUserSession::InitInputControlChannel()
@@ -1312,14 +1800,20 @@ namespace MiscServices {
 
         sptr<IRemoteObject> clientObject = data->ReadRemoteObject();
         sptr<InputClientProxy> client = new InputClientProxy(clientObject);
+        if (journal.client && journal.client->AsObject() == clientObject) {
+            journal.shown = false;
+        }
         HideKeyboard(client);
     }
 
     void PerUserSession::StopInputService(std::string imeId)
     {
         IMSA_HILOGI("PerUserSession::StopInputService");
-        if (imsCore[0]) {
-            imsCore[0]->StopInputService(imeId);
+        sptr<IInputMethodCore> core = std::atomic_load(&sessionSnapshot)->core;
+        if (core) {
+            // the ime is stopped on purpose, it's not restarted when it exits
+            core->AsObject()->RemoveDeathRecipient(imsDeathRecipient);
+            core->StopInputService(imeId);
         }
     }
 } // namespace MiscServices
@@ -13,6 +13,7 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include "unistd.h"
 #include "peruser_setting.h"
 #include "platform.h"
@@ -48,10 +49,19 @@ namespace MiscServices {
         userState = UserState::USER_STATE_UNLOCKED;
 
         inputMethodProperties.clear();
-        int ret = Platform::Instance()->ListInputMethod(userId_, &inputMethodProperties);
+        inputMethodIndex.Clear();
+        std::vector<InputMethodProperty*> properties;
+        int ret = Platform::Instance()->ListInputMethod(userId_, &properties);
         if (ret != ErrorCode::NO_ERROR) {
             IMSA_HILOGE("Failed to listInputMethod [%d]\n", userId_);
         }
+        // take the ownership of the properties created by the platform
+        for (int i = 0; i < (int)properties.size(); i++) {
+            if (properties[i]) {
+                inputMethodProperties.push_back(std::shared_ptr<InputMethodProperty>(properties[i]));
+                inputMethodIndex.Add(inputMethodProperties.back());
+            }
+        }
         int size = inputMethodProperties.size();
         if (!size) {
             currentImeId = Utils::to_utf16("");
@@ -87,15 +97,14 @@ namespace MiscServices {
             return ErrorCode::ERROR_IME_PACKAGE_DUPLICATED;
         }
         // retake the input method list installed in the system.
-        InputMethodProperty *property = new InputMethodProperty();
-        int ret = Platform::Instance()->GetInputMethodProperty(userId_, packageName, property);
+        auto property = std::make_shared<InputMethodProperty>();
+        int ret = Platform::Instance()->GetInputMethodProperty(userId_, packageName, property.get());
         if (ret != ErrorCode::NO_ERROR) {
-            delete property;
-            property = nullptr;
             IMSA_HILOGI("%s [%d]\n", ErrorCode::ToString(ErrorCode::ERROR_NOT_IME_PACKAGE), userId_);
             return ErrorCode::ERROR_NOT_IME_PACKAGE;
         }
         inputMethodProperties.push_back(property);
+        inputMethodIndex.Add(property);
         if (CheckIfSecurityIme(*property)) {
             if (isSecurityIme) {
                 isSecurityIme = true;
@@ -131,25 +140,19 @@ namespace MiscServices {
         if (isSecurityIme) {
             isSecurityIme = false;
         }
-        std::u16string imeId = GetImeId(packageName);
-        if (!imeId.size()) {
+        std::shared_ptr<InputMethodProperty> node = inputMethodIndex.FindByPackageName(packageName);
+        if (!node) {
             IMSA_HILOGI("%s [%d]\n", ErrorCode::ToString(ErrorCode::ERROR_NOT_IME_PACKAGE), userId_);
             return ErrorCode::ERROR_NOT_IME_PACKAGE;
         }
-        bool securityFlag = false;
-        std::vector<InputMethodProperty*>::iterator it;
-        for (it = inputMethodProperties.begin(); it < inputMethodProperties.end(); ++it) {
-            InputMethodProperty *node = (InputMethodProperty*)*it;
-            if (node->mImeId == imeId) {
-                if (CheckIfSecurityIme(*node)) {
-                    securityFlag = true;
-                }
-                inputMethodProperties.erase(it);
-                delete node;
-                node = nullptr;
-                break;
-            }
+        std::u16string imeId = node->mImeId;
+        bool securityFlag = CheckIfSecurityIme(*node);
+        auto it = std::find(inputMethodProperties.begin(), inputMethodProperties.end(), node);
+        if (it != inputMethodProperties.end()) {
+            inputMethodProperties.erase(it);
         }
+        inputMethodIndex.Remove(node.get());
+        node = nullptr;
         if (securityFlag) {
             if (isSecurityIme) {
                 isSecurityIme = true;
@@ -223,7 +226,7 @@ namespace MiscServices {
                     nextImeId = imeId;
                     break;
                 } else if (!firstEnabledProperty) {
-                    firstEnabledProperty = inputMethodProperties[i];
+                    firstEnabledProperty = inputMethodProperties[i].get();
                 }
             }
         }
@@ -257,16 +260,8 @@ namespace MiscServices {
         userState = UserState::USER_STATE_STARTED;
         currentImeId = Utils::to_utf16("");
 
-        // release input method properties
-        std::vector<InputMethodProperty*>::iterator it;
-        for (it = inputMethodProperties.begin(); it < inputMethodProperties.end();) {
-            InputMethodProperty *node = (InputMethodProperty*)*it;
-            if (node) {
-                it = inputMethodProperties.erase(it);
-                delete node;
-                node = nullptr;
-            }
-        }
+        // release input method properties, the snapshots still held by callers keep their own
+        inputMethodIndex.Clear();
         inputMethodProperties.clear();
         // release input method setting.
         inputMethodSetting.ClearData();
@@ -318,10 +313,9 @@ namespace MiscServices {
     */
     InputMethodProperty *PerUserSetting::GetCurrentInputMethod()
     {
-        for (int i = 0; i < (int)inputMethodProperties.size(); i++) {
-            if (currentImeId == inputMethodProperties[i]->mImeId) {
-                return inputMethodProperties[i];
-            }
+        InputMethodProperty *ime = inputMethodIndex.FindByImeId(currentImeId).get();
+        if (ime) {
+            return ime;
         }
         // if default ime is null, we use security ime as default ime.
         return GetSecurityInputMethod();
@@ -337,7 +331,7 @@ namespace MiscServices {
         InputMethodProperty *ime = nullptr;
         std::u16string systemLocales = inputMethodSetting.GetValue(InputMethodSetting::SYSTEM_LOCALE_TAG);
         for (int i = 0; i < (int)inputMethodProperties.size(); i++) {
-            InputMethodProperty *imp = inputMethodProperties[i];
+            InputMethodProperty *imp = inputMethodProperties[i].get();
             if (!CheckIfSecurityIme(*imp)) {
                 continue;
             }
@@ -376,9 +370,9 @@ namespace MiscServices {
                 flag = true;
             } else if (enabledInputMethods.find(imeId) != std::string::npos) {
                 if (flag) {
-                    return inputMethodProperties[i];
+                    return inputMethodProperties[i].get();
                 } else if (!firstEnabledProperty) {
-                    firstEnabledProperty = inputMethodProperties[i];
+                    firstEnabledProperty = inputMethodProperties[i].get();
                 }
             }
         }
@@ -394,11 +388,21 @@ namespace MiscServices {
         return &inputMethodSetting;
     }
 
+    /*! Get the index over the installed input method engines
+    \return a pointer of InputMethodIndex.
+    \note The returned pointer should NOT be freed by caller
+    */
+    InputMethodIndex *PerUserSetting::GetInputMethodIndex()
+    {
+        return &inputMethodIndex;
+    }
+
     /*! list the details of all the enabled input method engine
     \param[out] properties the details will be written to the param properties
     \return ErrorCode::NO_ERROR
+    \note The returned properties are shared, not copied, and stay valid after the IME is removed.
     */
-    int32_t PerUserSetting::ListInputMethodEnabled(std::vector<InputMethodProperty*> *properties)
+    int32_t PerUserSetting::ListInputMethodEnabled(std::vector<InputMethodPropertyPtr> *properties)
     {
         std::u16string enabledInputMethods = inputMethodSetting.GetValue(InputMethodSetting::ENABLED_INPUT_METHODS_TAG);
         for (int i = 0; i < (int)inputMethodProperties.size(); i++) {
@@ -413,7 +417,7 @@ namespace MiscServices {
     \param[out] properties the details will be written to the param properties
     \return ErrorCode::NO_ERROR
     */
-    int32_t PerUserSetting::ListInputMethod(std::vector<InputMethodProperty*> *properties)
+    int32_t PerUserSetting::ListInputMethod(std::vector<InputMethodPropertyPtr> *properties)
     {
         for (int i = 0; i < (int)inputMethodProperties.size(); i++) {
             properties->push_back(inputMethodProperties[i]);
@@ -426,16 +430,10 @@ namespace MiscServices {
     \param[out] types the data of type list of the given IME will be written to types
     \return ErrorCode::NO_ERROR
     */
-    int32_t PerUserSetting::ListKeyboardType(const std::u16string& imeId, std::vector<KeyboardType*> *types)
+    int32_t PerUserSetting::ListKeyboardType(const std::u16string& imeId, std::vector<KeyboardTypePtr> *types)
     {
-        for (int i = 0; i < (int)inputMethodProperties.size(); i++) {
-            if (imeId == inputMethodProperties[i]->mImeId) {
-                for (int j = 0; j < (int)inputMethodProperties[i]->mTypes.size(); j++) {
-                    types->push_back(inputMethodProperties[i]->mTypes[j]);
-                }
-                break;
-            }
-        }
+        std::vector<KeyboardTypePtr> list = InputMethodProperty::ListKeyboardTypes(inputMethodIndex.FindByImeId(imeId));
+        types->insert(types->end(), list.begin(), list.end());
         return ErrorCode::NO_ERROR;
     }
 
@@ -447,12 +445,7 @@ namespace MiscServices {
     */
     InputMethodProperty *PerUserSetting::GetInputMethodProperty(const std::u16string& imeId)
     {
-        for (int i = 0; i < (int)inputMethodProperties.size(); i++) {
-            if (inputMethodProperties[i]->mImeId == imeId) {
-                return inputMethodProperties[i];
-            }
-        }
-        return nullptr;
+        return inputMethodIndex.FindByImeId(imeId).get();
     }
 
     /*! Get the language of keyboard type according to the given hashCode
@@ -463,10 +456,9 @@ namespace MiscServices {
     */
     std::u16string PerUserSetting::GetKeyboardTypeLanguage(const InputMethodProperty *property, int hashCode)
     {
-        for (int i = 0; i < (int)property->mTypes.size(); i++) {
-            if (property->mTypes[i]->getHashCode() == hashCode) {
-                return property->mTypes[i]->getLanguage();
-            }
+        KeyboardType *type = inputMethodIndex.FindKeyboardType(property, hashCode);
+        if (type) {
+            return type->getLanguage();
         }
         return Utils::to_utf16("");
     }
@@ -524,12 +516,12 @@ namespace MiscServices {
                 continue;
             }
             if (!firstEnabledIme) {
-                firstEnabledIme = inputMethodProperties[i];
+                firstEnabledIme = inputMethodProperties[i].get();
             }
 
             std::vector<int> hashCodeList = inputMethodSetting.GetEnabledKeyboardTypes(imeId);
             for (int j = 0; j < (int)hashCodeList.size(); j++) {
-                std::u16string language = GetKeyboardTypeLanguage(inputMethodProperties[i], hashCodeList[j]);
+                std::u16string language = GetKeyboardTypeLanguage(inputMethodProperties[i].get(), hashCodeList[j]);
                 if (systemLocales.find(language) != std::string::npos) {
                     currentImeId = imeId;
                     flag = true;
@@ -560,10 +552,9 @@ namespace MiscServices {
     */
     std::u16string PerUserSetting::GetImeId(const std::u16string& packageName)
     {
-        for (int i = 0; i < (int)inputMethodProperties.size(); i++) {
-            if (inputMethodProperties[i]->mPackageName == packageName) {
-                return inputMethodProperties[i]->mImeId;
-            }
+        std::shared_ptr<InputMethodProperty> property = inputMethodIndex.FindByPackageName(packageName);
+        if (property) {
+            return property->mImeId;
         }
         return Utils::to_utf16("");
     }
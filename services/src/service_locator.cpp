@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "service_locator.h"
+#include "global.h"
+#include "iservice_registry.h"
+
+namespace OHOS {
+namespace MiscServices {
+    std::mutex ServiceLocator::lock_;
+    std::map<int32_t, sptr<IRemoteObject>> ServiceLocator::localAbilities_;
+    bool ServiceLocator::isolated_ = false;
+
+    /*! Get a system ability
+    \param systemAbilityId the id of the system ability, e.g. INPUT_METHOD_SYSTEM_ABILITY_ID
+    \return the local object put in place of the ability, or the one given by samgr
+    \n      nullptr - the ability is not found
+    */
+    sptr<IRemoteObject> ServiceLocator::GetSystemAbility(int32_t systemAbilityId)
+    {
+        {
+            std::lock_guard<std::mutex> lock(lock_);
+            auto it = localAbilities_.find(systemAbilityId);
+            if (it != localAbilities_.end()) {
+                return it->second;
+            }
+            if (isolated_) {
+                IMSA_HILOGE("ServiceLocator::GetSystemAbility %{public}d has no local object", systemAbilityId);
+                return nullptr;
+            }
+        }
+        sptr<ISystemAbilityManager> systemAbilityManager =
+            SystemAbilityManagerClient::GetInstance().GetSystemAbilityManager();
+        if (!systemAbilityManager) {
+            IMSA_HILOGE("ServiceLocator::GetSystemAbility systemAbilityManager is nullptr");
+            return nullptr;
+        }
+        return systemAbilityManager->GetSystemAbility(systemAbilityId);
+    }
+
+    /*! Put a local object in place of a system ability
+    \param systemAbilityId the id of the system ability
+    \param object the local object, nullptr to remove the one set before
+    */
+    void ServiceLocator::SetLocalAbility(int32_t systemAbilityId, const sptr<IRemoteObject> &object)
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        if (!object) {
+            localAbilities_.erase(systemAbilityId);
+            return;
+        }
+        localAbilities_[systemAbilityId] = object;
+    }
+
+    /*! Enable or disable the isolated mode, in which samgr is never asked
+    */
+    void ServiceLocator::SetIsolated(bool isolated)
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        isolated_ = isolated;
+    }
+
+    /*! Remove all the local objects and leave the isolated mode
+    */
+    void ServiceLocator::Reset()
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        localAbilities_.clear();
+        isolated_ = false;
+    }
+} // namespace MiscServices
+} // namespace OHOS
@@ -0,0 +1,365 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "shared_ring.h"
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "global.h"
+
+namespace OHOS {
+namespace MiscServices {
+    namespace {
+        const uint32_t RECORD_ALIGN = 8;
+    }
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "the ring positions are shared by two processes");
+
+    /*! Create a ring in a new shared memory
+      \param capacity the number of bytes for the records, rounded up to a power of two
+      \return the ring, or nullptr if the shared memory or the eventfds can not be created
+    */
+    SharedRing *SharedRing::Create(uint32_t capacity)
+    {
+        uint32_t size = 4 * MAX_RECORD_SIZE;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        int memFd = memfd_create("imf_shared_ring", MFD_CLOEXEC);
+        if (memFd < 0) {
+            IMSA_HILOGE("SharedRing::Create memfd_create failed, errno = %{public}d", errno);
+            return nullptr;
+        }
+        size_t mapSize = HEADER_SIZE + size;
+        void *address = MAP_FAILED;
+        if (ftruncate(memFd, mapSize) == 0) {
+            address = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, memFd, 0);
+        }
+        int readerFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        int writerFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (address == MAP_FAILED || readerFd < 0 || writerFd < 0) {
+            IMSA_HILOGE("SharedRing::Create failed, errno = %{public}d", errno);
+            if (address != MAP_FAILED) {
+                munmap(address, mapSize);
+            }
+            for (int fd : { readerFd, writerFd }) {
+                if (fd >= 0) {
+                    close(fd);
+                }
+            }
+            close(memFd);
+            return nullptr;
+        }
+        static_assert(sizeof(RingHeader) <= HEADER_SIZE, "the ring header does not fit in HEADER_SIZE");
+        RingHeader *header = new (address) RingHeader();
+        header->magic = MAGIC;
+        header->capacity = size;
+        return new SharedRing(memFd, readerFd, writerFd, address, mapSize);
+    }
+
+    /*! Map a ring created by another process
+      \param memFd the shared memory of the ring, the ring takes its ownership
+      \param readerFd the doorbell of the reader, the ring takes its ownership
+      \param writerFd the doorbell of the writer, the ring takes its ownership
+      \return the ring, or nullptr if the shared memory is not a ring
+    */
+    SharedRing *SharedRing::Attach(int memFd, int readerFd, int writerFd)
+    {
+        struct stat memStat = {};
+        void *address = MAP_FAILED;
+        size_t mapSize = 0;
+        if (memFd >= 0 && readerFd >= 0 && writerFd >= 0 && fstat(memFd, &memStat) == 0 &&
+            memStat.st_size > HEADER_SIZE) {
+            mapSize = static_cast<size_t>(memStat.st_size);
+            address = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, memFd, 0);
+        }
+        if (address != MAP_FAILED) {
+            RingHeader *header = reinterpret_cast<RingHeader *>(address);
+            uint32_t capacity = header->capacity;
+            if (header->magic == MAGIC && capacity && !(capacity & (capacity - 1))
+                && HEADER_SIZE + capacity == mapSize) {
+                return new SharedRing(memFd, readerFd, writerFd, address, mapSize);
+            }
+            munmap(address, mapSize);
+        }
+        IMSA_HILOGE("SharedRing::Attach the shared memory is not a ring");
+        for (int fd : { memFd, readerFd, writerFd }) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+        return nullptr;
+    }
+
+    /*! Constructor
+    */
+    SharedRing::SharedRing(int memFd, int readerFd, int writerFd, void *address, size_t mapSize)
+        : memFd_(memFd), readerFd_(readerFd), writerFd_(writerFd), mapSize_(mapSize), woken_(false)
+    {
+        header_ = reinterpret_cast<RingHeader *>(address);
+        records_ = reinterpret_cast<uint8_t *>(address) + HEADER_SIZE;
+        capacity_ = header_->capacity;
+    }
+
+    /*! Destructor
+    \n The other process keeps its own mapping, so the ring lives until both sides release it.
+    */
+    SharedRing::~SharedRing()
+    {
+        munmap(header_, mapSize_);
+        close(memFd_);
+        close(readerFd_);
+        close(writerFd_);
+    }
+
+    /*! Put a request at the tail of the ring, it must be called by one thread at a time
+      \param code the code of the request
+      \param data the data of the request
+      \param timeoutMs the max time to wait for the reader to make room when the ring is full
+      \return true - the request is in the ring
+      \n      false - the request is too large or the ring keeps full, it should be sent through binder
+    */
+    bool SharedRing::Write(uint32_t code, MessageParcel &data, int32_t timeoutMs)
+    {
+        size_t size = data.GetDataSize();
+        if (size > MAX_RECORD_SIZE) {
+            return false;
+        }
+        uint32_t recordSize = sizeof(RecordHeader) + ((size + RECORD_ALIGN - 1) & ~(RECORD_ALIGN - 1));
+        uint64_t writePos = header_->writePos.load(std::memory_order_relaxed);
+        uint32_t offset = writePos & (capacity_ - 1);
+        uint32_t padding = (offset + recordSize > capacity_) ? (capacity_ - offset) : 0;
+        if (!WaitReader(header_->readPos, writePos + padding + recordSize - capacity_, timeoutMs)) {
+            return false;
+        }
+        if (padding) {
+            RecordHeader paddingRecord = { 0, PADDING_CODE };
+            memcpy(records_ + offset, &paddingRecord, sizeof(paddingRecord));
+            writePos += padding;
+            offset = 0;
+        }
+        RecordHeader record = { static_cast<uint32_t>(size), code };
+        memcpy(records_ + offset, &record, sizeof(record));
+        memcpy(records_ + offset + sizeof(record), reinterpret_cast<const void *>(data.GetData()), size);
+        header_->writePos.store(writePos + recordSize, std::memory_order_release);
+
+        // pairs with the fence in WaitReadable, so either the reader sees the record or the writer sees it waiting
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (header_->readerWaiting.load(std::memory_order_relaxed)) {
+            uint64_t count = 1;
+            (void)write(readerFd_, &count, sizeof(count));
+        }
+        return true;
+    }
+
+    /*! Take the request at the head of the ring, it must be called by one thread at a time
+      \param[out] code the code of the request
+      \param[out] data the data of the request is appended to it
+      \param timeoutMs the max time to wait for a request, 0 - do not wait
+      \return false - no request before timeout, or the reader is woken up by Wakeup
+    */
+    bool SharedRing::Read(uint32_t &code, MessageParcel &data, int32_t timeoutMs)
+    {
+        while (true) {
+            uint64_t readPos = header_->readPos.load(std::memory_order_relaxed);
+            uint64_t writePos = header_->writePos.load(std::memory_order_acquire);
+            if (writePos == readPos) {
+                if (!WaitReadable(readPos, timeoutMs)) {
+                    return false;
+                }
+                writePos = header_->writePos.load(std::memory_order_acquire);
+            }
+            uint32_t offset = readPos & (capacity_ - 1);
+            RecordHeader record;
+            memcpy(&record, records_ + offset, sizeof(record));
+            if (record.code == PADDING_CODE) {
+                header_->readPos.store(readPos + capacity_ - offset, std::memory_order_release);
+                WakeupWriter();
+                continue;
+            }
+            uint32_t recordSize = sizeof(RecordHeader) + ((record.size + RECORD_ALIGN - 1) & ~(RECORD_ALIGN - 1));
+            if (record.size > MAX_RECORD_SIZE || offset + recordSize > capacity_ || writePos - readPos < recordSize) {
+                IMSA_HILOGE("SharedRing::Read the record is malformed, drop all the pending records");
+                header_->readPos.store(writePos, std::memory_order_release);
+                WakeupWriter();
+                return false;
+            }
+            code = record.code;
+            data.WriteBuffer(records_ + offset + sizeof(record), record.size);
+            header_->readPos.store(readPos + recordSize, std::memory_order_release);
+            WakeupWriter();
+            return true;
+        }
+    }
+
+    /*! Tell the writer that the reader has handled all the requests it has read
+    */
+    void SharedRing::Acknowledge()
+    {
+        header_->handledPos.store(header_->readPos.load(std::memory_order_relaxed), std::memory_order_release);
+        WakeupWriter();
+    }
+
+    /*! Wait for the reader to handle all the requests in the ring
+    \n The writer calls it before it sends a request through binder, so the request does not overtake the ones
+    \n still in the ring.
+      \param timeoutMs the max time to wait
+      \return true - the reader has acknowledged all the requests
+    */
+    bool SharedRing::WaitEmpty(int32_t timeoutMs)
+    {
+        return WaitReader(header_->handledPos, header_->writePos.load(std::memory_order_relaxed), timeoutMs);
+    }
+
+    /*! Sleep on writerFd until a position of the reader reaches target
+    \n The positions only grow and never wrap in practice, so reaching is a plain comparison.
+      \param readerPos readPos to wait for room, or handledPos to wait for the ring to be empty
+      \param target the position to wait for
+      \param timeoutMs the max time to wait
+      \return true - the reader has reached target
+    */
+    bool SharedRing::WaitReader(const std::atomic<uint64_t> &readerPos, uint64_t target, int32_t timeoutMs)
+    {
+        if (static_cast<int64_t>(readerPos.load(std::memory_order_acquire) - target) >= 0) {
+            return true;
+        }
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        bool reached = false;
+        while (!reached) {
+            header_->writerWaiting.store(1, std::memory_order_relaxed);
+            // pairs with the fence in WakeupWriter, so either the writer sees the position or the reader sees it
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            reached = static_cast<int64_t>(readerPos.load(std::memory_order_acquire) - target) >= 0;
+            auto leftMs = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if (reached || leftMs.count() <= 0) {
+                break;
+            }
+            struct pollfd pollFd = { writerFd_, POLLIN, 0 };
+            poll(&pollFd, 1, static_cast<int>(leftMs.count()));
+            uint64_t count = 0;
+            (void)read(writerFd_, &count, sizeof(count));
+        }
+        header_->writerWaiting.store(0, std::memory_order_relaxed);
+        return reached;
+    }
+
+    /*! Wake up the writer sleeping in Write or WaitEmpty, after the reader has moved
+    */
+    void SharedRing::WakeupWriter()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (header_->writerWaiting.load(std::memory_order_relaxed)) {
+            uint64_t count = 1;
+            (void)write(writerFd_, &count, sizeof(count));
+        }
+    }
+
+    /*! Sleep on readerFd until the writer moves past readPos
+    \n A doorbell rung after the reader has seen the record it was rung for is left in readerFd, so the reader
+        sleeps again after such a stale one until timeout, unless it is woken up by Wakeup.
+    */
+    bool SharedRing::WaitReadable(uint64_t readPos, int32_t timeoutMs)
+    {
+        if (!timeoutMs) {
+            return false;
+        }
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        bool readable = false;
+        while (!woken_.exchange(false)) {
+            header_->readerWaiting.store(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            readable = header_->writePos.load(std::memory_order_acquire) != readPos;
+            auto leftMs = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if (readable || leftMs.count() <= 0) {
+                break;
+            }
+            struct pollfd pollFd = { readerFd_, POLLIN, 0 };
+            poll(&pollFd, 1, static_cast<int>(leftMs.count()));
+            uint64_t count = 0;
+            (void)read(readerFd_, &count, sizeof(count));
+        }
+        header_->readerWaiting.store(0, std::memory_order_relaxed);
+        return readable;
+    }
+
+    /*! Wake up the reader sleeping in Read, which returns false then
+    */
+    void SharedRing::Wakeup()
+    {
+        woken_ = true;
+        uint64_t count = 1;
+        (void)write(readerFd_, &count, sizeof(count));
+    }
+
+    int SharedRing::GetMemFd() const
+    {
+        return memFd_;
+    }
+
+    int SharedRing::GetReaderFd() const
+    {
+        return readerFd_;
+    }
+
+    int SharedRing::GetWriterFd() const
+    {
+        return writerFd_;
+    }
+
+    uint32_t SharedRing::GetCapacity() const
+    {
+        return capacity_;
+    }
+
+    /*! Constructor
+      \param ring the ring to read, the receiver takes its ownership
+      \param handler it is called on the thread of the receiver for each request
+    */
+    SharedRingReceiver::SharedRingReceiver(SharedRing *ring, const Handler &handler)
+        : ring_(ring), handler_(handler), stop_(false)
+    {
+        thread_ = std::thread([this] { Run(); });
+    }
+
+    /*! Destructor
+    \n The requests still in the ring are dropped.
+    */
+    SharedRingReceiver::~SharedRingReceiver()
+    {
+        stop_ = true;
+        ring_->Wakeup();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    void SharedRingReceiver::Run()
+    {
+        while (!stop_) {
+            uint32_t code = 0;
+            MessageParcel data;
+            if (ring_->Read(code, data, POLL_INTERVAL_MS) && !stop_) {
+                handler_(code, data);
+                ring_->Acknowledge();
+            }
+        }
+    }
+} // namespace MiscServices
+} // namespace OHOS
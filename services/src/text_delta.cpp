@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "text_delta.h"
+#include <algorithm>
+
+namespace OHOS {
+namespace MiscServices {
+    /*! Constructor
+    */
+    TextDelta::TextDelta()
+        : mSequence(0), mAckedEdit(0), mFullSync(false), mReplaceBegin(0), mReplaceEnd(0),
+          mOldBegin(0), mOldEnd(0), mNewBegin(0), mNewEnd(0)
+    {
+    }
+
+    /*! Constructor
+      \param fullSync true - text is the whole text of the editor
+      \param replaceBegin the begin of the replaced range in the previous text, ignored by a full sync
+      \param replaceEnd the end of the replaced range in the previous text, ignored by a full sync
+      \param text the text put in place of the replaced range
+    */
+    TextDelta::TextDelta(bool fullSync, int32_t replaceBegin, int32_t replaceEnd, const std::u16string& text)
+        : mSequence(0), mAckedEdit(0), mFullSync(fullSync), mReplaceBegin(replaceBegin), mReplaceEnd(replaceEnd),
+          mText(text), mOldBegin(0), mOldEnd(0), mNewBegin(0), mNewEnd(0)
+    {
+    }
+
+    /*! Constructor from another instance
+      \param delta the source instance
+    */
+    TextDelta::TextDelta(const TextDelta& delta)
+    {
+        *this = delta;
+    }
+
+    /*! Get value from another instance
+      \param delta source instance
+      \return return this
+    */
+    TextDelta& TextDelta::operator =(const TextDelta& delta)
+    {
+        if (this == &delta) {
+            return *this;
+        }
+        mSequence = delta.mSequence;
+        mAckedEdit = delta.mAckedEdit;
+        mFullSync = delta.mFullSync;
+        mReplaceBegin = delta.mReplaceBegin;
+        mReplaceEnd = delta.mReplaceEnd;
+        mText = delta.mText;
+        mOldBegin = delta.mOldBegin;
+        mOldEnd = delta.mOldEnd;
+        mNewBegin = delta.mNewBegin;
+        mNewEnd = delta.mNewEnd;
+        return *this;
+    }
+
+    /*! Destructor
+    */
+    TextDelta::~TextDelta()
+    {
+    }
+
+    /*! Write the details of object to parcel
+    */
+    bool TextDelta::Marshalling(Parcel &parcel) const
+    {
+        if (!(parcel.WriteUint64(mSequence)
+            && parcel.WriteUint64(mAckedEdit)
+            && parcel.WriteBool(mFullSync)
+            && parcel.WriteInt32(mReplaceBegin)
+            && parcel.WriteInt32(mReplaceEnd)
+            && parcel.WriteString16(mText)
+            && parcel.WriteInt32(mOldBegin)
+            && parcel.WriteInt32(mOldEnd)
+            && parcel.WriteInt32(mNewBegin)
+            && parcel.WriteInt32(mNewEnd)))
+            return false;
+        return true;
+    }
+
+    /*! Read the details of object from parcel
+      \param parcel read the details of object from this parcel
+      \return the object, or nullptr if its replaced range is malformed
+    */
+    TextDelta *TextDelta::Unmarshalling(Parcel &parcel)
+    {
+        auto delta = new TextDelta();
+        if (!delta->ReadFromParcel(parcel)) {
+            delete delta;
+            return nullptr;
+        }
+        return delta;
+    }
+
+    /*! Read the details of object from parcel into this instance
+      \return false - the replaced range is malformed
+    */
+    bool TextDelta::ReadFromParcel(Parcel &parcel)
+    {
+        mSequence = parcel.ReadUint64();
+        mAckedEdit = parcel.ReadUint64();
+        mFullSync = parcel.ReadBool();
+        mReplaceBegin = parcel.ReadInt32();
+        mReplaceEnd = parcel.ReadInt32();
+        mText = parcel.ReadString16();
+        mOldBegin = parcel.ReadInt32();
+        mOldEnd = parcel.ReadInt32();
+        mNewBegin = parcel.ReadInt32();
+        mNewEnd = parcel.ReadInt32();
+        return mFullSync || (mReplaceBegin >= 0 && mReplaceBegin <= mReplaceEnd);
+    }
+
+    /*! Build the smallest delta which changes oldText to newText
+    \n The replaced range is what is left after removing the common prefix and the common suffix.
+    */
+    TextDelta TextDelta::Diff(const std::u16string& oldText, const std::u16string& newText)
+    {
+        size_t shorter = std::min(oldText.size(), newText.size());
+        size_t prefix = 0;
+        while (prefix < shorter && oldText[prefix] == newText[prefix]) {
+            prefix++;
+        }
+        size_t suffix = 0;
+        while (suffix < shorter - prefix
+            && oldText[oldText.size() - suffix - 1] == newText[newText.size() - suffix - 1]) {
+            suffix++;
+        }
+        return TextDelta(false, prefix, oldText.size() - suffix,
+                         newText.substr(prefix, newText.size() - suffix - prefix));
+    }
+
+    /*! Build a delta carrying the whole text
+    */
+    TextDelta TextDelta::FullSync(const std::u16string& text)
+    {
+        return TextDelta(true, 0, 0, text);
+    }
+
+    /*! Apply the delta to a text
+      \param[in, out] text the text before the delta, it is the text after the delta on success
+      \return false - the replaced range is out of text, text is not changed
+    */
+    bool TextDelta::ApplyTo(std::u16string& text) const
+    {
+        if (mFullSync) {
+            text = mText;
+            return true;
+        }
+        if (mReplaceBegin < 0 || mReplaceBegin > mReplaceEnd || static_cast<size_t>(mReplaceEnd) > text.size()) {
+            return false;
+        }
+        text.replace(mReplaceBegin, mReplaceEnd - mReplaceBegin, mText);
+        return true;
+    }
+
+    void TextDelta::SetSequence(uint64_t sequence)
+    {
+        mSequence = sequence;
+    }
+
+    /*! Set the id of the last edit the editor has applied before the change
+    */
+    void TextDelta::SetAckedEdit(uint64_t editId)
+    {
+        mAckedEdit = editId;
+    }
+
+    void TextDelta::SetSelection(int32_t oldBegin, int32_t oldEnd, int32_t newBegin, int32_t newEnd)
+    {
+        mOldBegin = oldBegin;
+        mOldEnd = oldEnd;
+        mNewBegin = newBegin;
+        mNewEnd = newEnd;
+    }
+
+    uint64_t TextDelta::GetSequence() const
+    {
+        return mSequence;
+    }
+
+    uint64_t TextDelta::GetAckedEdit() const
+    {
+        return mAckedEdit;
+    }
+
+    bool TextDelta::IsFullSync() const
+    {
+        return mFullSync;
+    }
+
+    int32_t TextDelta::GetReplaceBegin() const
+    {
+        return mReplaceBegin;
+    }
+
+    int32_t TextDelta::GetReplaceEnd() const
+    {
+        return mReplaceEnd;
+    }
+
+    const std::u16string& TextDelta::GetText() const
+    {
+        return mText;
+    }
+
+    int32_t TextDelta::GetOldBegin() const
+    {
+        return mOldBegin;
+    }
+
+    int32_t TextDelta::GetOldEnd() const
+    {
+        return mOldEnd;
+    }
+
+    int32_t TextDelta::GetNewBegin() const
+    {
+        return mNewBegin;
+    }
+
+    int32_t TextDelta::GetNewEnd() const
+    {
+        return mNewEnd;
+    }
+} // namespace MiscServices
+} // namespace OHOS
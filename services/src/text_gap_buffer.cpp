@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "text_gap_buffer.h"
+#include <algorithm>
+
+namespace OHOS {
+namespace MiscServices {
+    const size_t TextGapBuffer::MIN_GAP_SIZE;
+
+    /*! Constructor
+    */
+    TextGapBuffer::TextGapBuffer() : gapBegin_(0), gapEnd_(0)
+    {
+    }
+
+    /*! Destructor
+    */
+    TextGapBuffer::~TextGapBuffer()
+    {
+    }
+
+    /*! Replace the whole content of the buffer
+      \param text the new content
+    */
+    void TextGapBuffer::Assign(const std::u16string& text)
+    {
+        buffer_.assign(text.size() + MIN_GAP_SIZE, u'\0');
+        std::copy(text.begin(), text.end(), buffer_.begin());
+        gapBegin_ = text.size();
+        gapEnd_ = buffer_.size();
+    }
+
+    /*! Replace the characters in [begin, end) with text
+      \param begin the position of the first character to be replaced
+      \param end the position after the last character to be replaced
+      \param text the text to be put at begin
+      \return false - the range is out of the buffer, nothing is changed
+    */
+    bool TextGapBuffer::Replace(size_t begin, size_t end, const std::u16string& text)
+    {
+        if (begin > end || end > Size()) {
+            return false;
+        }
+        MoveGap(begin);
+        gapEnd_ += end - begin;
+        if (gapEnd_ - gapBegin_ < text.size()) {
+            GrowGap(text.size());
+        }
+        std::copy(text.begin(), text.end(), buffer_.begin() + gapBegin_);
+        gapBegin_ += text.size();
+        return true;
+    }
+
+    /*! Get at most length characters from pos
+    */
+    std::u16string TextGapBuffer::Substr(size_t pos, size_t length) const
+    {
+        size_t size = Size();
+        if (pos >= size) {
+            return u"";
+        }
+        size_t end = pos + std::min(length, size - pos);
+        std::u16string text;
+        text.reserve(end - pos);
+        if (pos < gapBegin_) {
+            text.append(buffer_.data() + pos, std::min(end, gapBegin_) - pos);
+        }
+        if (end > gapBegin_) {
+            size_t from = std::max(pos, gapBegin_);
+            text.append(buffer_.data() + from + (gapEnd_ - gapBegin_), end - from);
+        }
+        return text;
+    }
+
+    /*! Get the whole content of the buffer
+    */
+    std::u16string TextGapBuffer::ToString() const
+    {
+        return Substr(0, Size());
+    }
+
+    /*! Get the number of characters in the buffer
+    */
+    size_t TextGapBuffer::Size() const
+    {
+        return buffer_.size() - (gapEnd_ - gapBegin_);
+    }
+
+    /*! Remove all the characters and release the memory
+    */
+    void TextGapBuffer::Clear()
+    {
+        std::vector<char16_t>().swap(buffer_);
+        gapBegin_ = 0;
+        gapEnd_ = 0;
+    }
+
+    /*! Move the gap so that it starts at pos
+    */
+    void TextGapBuffer::MoveGap(size_t pos)
+    {
+        if (pos < gapBegin_) {
+            std::copy_backward(buffer_.begin() + pos, buffer_.begin() + gapBegin_, buffer_.begin() + gapEnd_);
+            gapEnd_ -= gapBegin_ - pos;
+            gapBegin_ = pos;
+        } else if (pos > gapBegin_) {
+            size_t count = pos - gapBegin_;
+            std::copy(buffer_.begin() + gapEnd_, buffer_.begin() + gapEnd_ + count, buffer_.begin() + gapBegin_);
+            gapBegin_ = pos;
+            gapEnd_ += count;
+        }
+    }
+
+    /*! Reallocate the buffer so that the gap holds at least length characters
+    \n The gap grows with the size of the text, so a sequence of inserts reallocates a logarithmic number of times.
+    */
+    void TextGapBuffer::GrowGap(size_t length)
+    {
+        size_t tailSize = buffer_.size() - gapEnd_;
+        size_t gapSize = std::max(length, std::max(MIN_GAP_SIZE, Size() / 2));
+        std::vector<char16_t> buffer(gapBegin_ + gapSize + tailSize, u'\0');
+        std::copy(buffer_.begin(), buffer_.begin() + gapBegin_, buffer.begin());
+        std::copy(buffer_.begin() + gapEnd_, buffer_.end(), buffer.begin() + gapBegin_ + gapSize);
+        buffer_.swap(buffer);
+        gapEnd_ = gapBegin_ + gapSize;
+    }
+} // namespace MiscServices
+} // namespace OHOS
@@ -0,0 +1,299 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "trace_span.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <ctime>
+#include <new>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace OHOS {
+namespace MiscServices {
+    /*! Owner of the ring of a thread, which gives it back when the thread exits
+    */
+    struct ThreadRingHolder {
+        TraceRecorder::ThreadRing *ring = nullptr;
+        ~ThreadRingHolder()
+        {
+            if (ring) {
+                ring->owned.store(false, std::memory_order_release);
+            }
+        }
+    };
+
+    namespace {
+        thread_local ThreadRingHolder g_ringHolder;
+        thread_local uint64_t g_currentTraceId = 0;
+        std::atomic<uint32_t> g_traceCounter(0);
+        const int64_t NS_PER_SECOND = 1000000000;
+        const double NS_PER_US = 1000.0;
+    }
+
+    TraceRecorder::TraceRecorder() : enabled_(false), clearedNs_(0)
+    {
+    }
+
+    TraceRecorder::~TraceRecorder()
+    {
+    }
+
+    /*! Get the recorder of this process
+    \note It's never freed, so the threads exiting late can still give their rings back.
+    */
+    TraceRecorder *TraceRecorder::Instance()
+    {
+        static TraceRecorder *instance = new TraceRecorder();
+        return instance;
+    }
+
+    /*! Create a trace id, unique among the processes of the device
+    */
+    uint64_t TraceRecorder::NewTraceId()
+    {
+        uint32_t count = g_traceCounter.fetch_add(1, std::memory_order_relaxed) + 1;
+        return (static_cast<uint64_t>(getpid()) << 32) | count; // 32: the pid in the high half
+    }
+
+    /*! Get the time of CLOCK_MONOTONIC in nanoseconds
+    */
+    int64_t TraceRecorder::NowNs()
+    {
+        struct timespec ts = { 0, 0 };
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * NS_PER_SECOND + ts.tv_nsec;
+    }
+
+    /*! Get the trace id of the request handled by this thread, 0 if none
+    */
+    uint64_t TraceRecorder::GetCurrentTraceId()
+    {
+        return g_currentTraceId;
+    }
+
+    /*! Set the trace id of the request handled by this thread
+    */
+    void TraceRecorder::SetCurrentTraceId(uint64_t traceId)
+    {
+        g_currentTraceId = traceId;
+    }
+
+    /*! Record a step of a traced request in the ring of this thread
+    \param traceId the id of the request. Nothing is recorded for 0.
+    \param name a string literal naming the step
+    \param beginNs the begin time, from NowNs
+    \param endNs the end time, from NowNs
+    \param arg the message id of a queue wait, 0 otherwise
+    */
+    void TraceRecorder::Record(uint64_t traceId, const char *name, int64_t beginNs, int64_t endNs, int32_t arg)
+    {
+        if (!traceId || !enabled_.load(std::memory_order_relaxed)) {
+            return;
+        }
+        ThreadRing *ring = GetThreadRing();
+        if (!ring) {
+            return;
+        }
+        uint64_t head = ring->head.load(std::memory_order_relaxed);
+        Slot &slot = ring->slots[head % RING_CAPACITY];
+        uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+        slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.traceId.store(traceId, std::memory_order_relaxed);
+        slot.name.store(name, std::memory_order_relaxed);
+        slot.beginNs.store(beginNs, std::memory_order_relaxed);
+        slot.endNs.store(endNs, std::memory_order_relaxed);
+        slot.arg.store(arg, std::memory_order_relaxed);
+        slot.tid.store(ring->tid, std::memory_order_relaxed);
+        slot.sequence.store(sequence + 2, std::memory_order_release); // 2: back to even, the slot is complete
+        ring->head.store(head + 1, std::memory_order_release);
+    }
+
+    /*! Enable or disable the recording. It's disabled by default.
+    */
+    void TraceRecorder::SetEnabled(bool enabled)
+    {
+        enabled_.store(enabled, std::memory_order_relaxed);
+    }
+
+    bool TraceRecorder::IsEnabled() const
+    {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+
+    /*! Copy the events recorded by all the threads, sorted by begin time
+    \param[out] events the events are appended to it
+    \note An event being overwritten while it's read is skipped.
+    */
+    void TraceRecorder::Snapshot(std::vector<TraceEvent> &events)
+    {
+        int64_t clearedNs = clearedNs_.load(std::memory_order_relaxed);
+        size_t first = events.size();
+        std::unique_lock<std::mutex> lock(ringsLock_);
+        for (ThreadRing *ring : rings_) {
+            uint64_t head = ring->head.load(std::memory_order_acquire);
+            uint64_t count = std::min<uint64_t>(head, RING_CAPACITY);
+            for (uint64_t i = head - count; i < head; i++) {
+                Slot &slot = ring->slots[i % RING_CAPACITY];
+                uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+                if (sequence & 1) {
+                    continue;
+                }
+                TraceEvent event;
+                event.traceId = slot.traceId.load(std::memory_order_relaxed);
+                event.name = slot.name.load(std::memory_order_relaxed);
+                event.beginNs = slot.beginNs.load(std::memory_order_relaxed);
+                event.endNs = slot.endNs.load(std::memory_order_relaxed);
+                event.arg = slot.arg.load(std::memory_order_relaxed);
+                event.tid = slot.tid.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.sequence.load(std::memory_order_relaxed) != sequence || !event.name ||
+                    event.beginNs < clearedNs) {
+                    continue;
+                }
+                events.push_back(event);
+            }
+        }
+        lock.unlock();
+        std::sort(events.begin() + first, events.end(), [](const TraceEvent &a, const TraceEvent &b) {
+            return a.beginNs < b.beginNs;
+        });
+    }
+
+    /*! Drop the events recorded so far
+    */
+    void TraceRecorder::Clear()
+    {
+        clearedNs_.store(NowNs(), std::memory_order_relaxed);
+    }
+
+    /*! Print the events recorded into the given stream
+    \param fd the raw file descriptor that the dump is being sent to
+    */
+    void TraceRecorder::Dump(int fd)
+    {
+        std::vector<TraceEvent> events;
+        Snapshot(events);
+        dprintf(fd, "\n - Trace Events : %zu\n", events.size());
+        for (const auto &event : events) {
+            dprintf(fd, "  %016" PRIx64 " %-32s tid = %d begin = %" PRId64 " duration = %" PRId64 " ns",
+                event.traceId, event.name, event.tid, event.beginNs, event.endNs - event.beginNs);
+            if (event.arg) {
+                dprintf(fd, " msg = %d", event.arg);
+            }
+            dprintf(fd, "\n");
+        }
+    }
+
+    /*! Export the events recorded in the Chrome trace event format
+    \return a JSON document, loadable by chrome://tracing and Perfetto
+    */
+    std::string TraceRecorder::ExportChromeTrace()
+    {
+        std::vector<TraceEvent> events;
+        Snapshot(events);
+        std::string json = "{\"traceEvents\":[";
+        char buffer[256];
+        int pid = getpid();
+        for (size_t i = 0; i < events.size(); i++) {
+            const TraceEvent &event = events[i];
+            int len = snprintf(buffer, sizeof(buffer),
+                "%s{\"name\":\"%s\",\"cat\":\"imf\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,"
+                "\"args\":{\"trace\":\"%016" PRIx64 "\",\"msg\":%d}}",
+                i ? "," : "", event.name, pid, event.tid, event.beginNs / NS_PER_US,
+                (event.endNs - event.beginNs) / NS_PER_US, event.traceId, event.arg);
+            if (len > 0) {
+                json.append(buffer, std::min<size_t>(len, sizeof(buffer) - 1));
+            }
+        }
+        json += "],\"displayTimeUnit\":\"ns\"}";
+        return json;
+    }
+
+    /*! Export the events recorded as a Chrome trace into the file imf_trace_<pid>.json of the given directory
+    \param dir the directory of the file. The file is replaced.
+    \return true if the file is written
+    */
+    bool TraceRecorder::ExportToFile(const std::string &dir)
+    {
+        std::string path = dir + "/imf_trace_" + std::to_string(getpid()) + ".json";
+        FILE *file = fopen(path.c_str(), "w");
+        if (!file) {
+            return false;
+        }
+        std::string json = ExportChromeTrace();
+        bool written = fwrite(json.data(), 1, json.size(), file) == json.size();
+        return (fclose(file) == 0) && written;
+    }
+
+    /*! Get the ring of this thread, taking one at its first record
+    */
+    TraceRecorder::ThreadRing *TraceRecorder::GetThreadRing()
+    {
+        if (!g_ringHolder.ring) {
+            g_ringHolder.ring = AcquireRing();
+        }
+        return g_ringHolder.ring;
+    }
+
+    /*! Take a ring given back by an exited thread, or create one
+    */
+    TraceRecorder::ThreadRing *TraceRecorder::AcquireRing()
+    {
+        int32_t tid = static_cast<int32_t>(syscall(SYS_gettid));
+        std::unique_lock<std::mutex> lock(ringsLock_);
+        for (ThreadRing *ring : rings_) {
+            bool owned = false;
+            if (ring->owned.compare_exchange_strong(owned, true, std::memory_order_acquire)) {
+                ring->tid = tid;
+                return ring;
+            }
+        }
+        ThreadRing *ring = new (std::nothrow) ThreadRing();
+        if (!ring) {
+            return nullptr;
+        }
+        ring->owned.store(true, std::memory_order_relaxed);
+        ring->tid = tid;
+        rings_.push_back(ring);
+        return ring;
+    }
+
+    /*! Constructor
+    \param traceId the id of the traced request, 0 if the request is not traced
+    \param name a string literal naming the step
+    */
+    TraceSpan::TraceSpan(uint64_t traceId, const char *name)
+        : traceId_(traceId), parentTraceId_(g_currentTraceId), name_(name)
+    {
+        if (traceId_) {
+            g_currentTraceId = traceId_;
+            beginNs_ = TraceRecorder::NowNs();
+        }
+    }
+
+    /*! Destructor. The step is recorded, and the trace id of the thread is restored.
+    */
+    TraceSpan::~TraceSpan()
+    {
+        if (traceId_) {
+            TraceRecorder::Instance()->Record(traceId_, name_, beginNs_, TraceRecorder::NowNs());
+            g_currentTraceId = parentTraceId_;
+        }
+    }
+} // namespace MiscServices
+} // namespace OHOS
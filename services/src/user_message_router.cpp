@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "user_message_router.h"
+
+namespace OHOS {
+namespace MiscServices {
+    /*! Constructor
+    \param serviceHandler the handler of the work thread of the service, which takes the client messages of
+        a user without work thread
+    */
+    UserMessageRouter::UserMessageRouter(MessageHandler *serviceHandler) : serviceHandler_(serviceHandler)
+    {
+    }
+
+    /*! Destructor
+    \n The handlers are not owned by the router, see RemoveAll.
+    */
+    UserMessageRouter::~UserMessageRouter()
+    {
+    }
+
+    /*! Create the work thread of a user, if the user has none
+    \param userId the id of the user
+    \param factory creates the handler and starts the thread serving it, it's called with the router locked,
+        so no message of the user is routed until the handler is added
+    \return true - a handler is added
+    \n      false - the user already has one, or factory returns null
+    */
+    bool UserMessageRouter::AddHandler(int32_t userId, const HandlerFactory &factory)
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        if (handlers_.find(userId) != handlers_.end()) {
+            return false;
+        }
+        MessageHandler *handler = factory();
+        if (!handler) {
+            return false;
+        }
+        handlers_.insert(std::pair<int32_t, MessageHandler *>(userId, handler));
+        return true;
+    }
+
+    /*! Remove the work thread of a user
+    \n The messages of the user routed after it go to the service thread, which drops them.
+    \param userId the id of the user
+    \return the handler removed, which the caller stops and frees, or null if the user has none
+    */
+    MessageHandler *UserMessageRouter::RemoveHandler(int32_t userId)
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        auto it = handlers_.find(userId);
+        if (it == handlers_.end()) {
+            return nullptr;
+        }
+        MessageHandler *handler = it->second;
+        handlers_.erase(it);
+        return handler;
+    }
+
+    /*! Remove the work threads of all the users
+    \return the handlers removed by user id, which the caller stops and frees
+    */
+    std::map<int32_t, MessageHandler *> UserMessageRouter::RemoveAll()
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        std::map<int32_t, MessageHandler *> handlers;
+        handlers.swap(handlers_);
+        return handlers;
+    }
+
+    /*! Check if a user has a work thread
+    \param userId the id of the user
+    */
+    bool UserMessageRouter::HasHandler(int32_t userId)
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        return handlers_.find(userId) != handlers_.end();
+    }
+
+    /*! Route a client message to the work thread of its user
+    \n Run in binder thread
+    \param userId the user id of the client
+    \param msg the message whose parcel starts with userId. The user id is consumed when the message goes to
+        the thread of the user directly, as the service thread does when it hands a message over.
+    \note A message going through the service thread is not coalesced there, every one of them has to reach
+        HandOver to take its count off.
+    \see HandOver
+    */
+    void UserMessageRouter::Dispatch(int32_t userId, Message *msg)
+    {
+        {
+            std::lock_guard<std::mutex> lock(lock_);
+            auto it = handlers_.find(userId);
+            if (it != handlers_.end() && forwarding_[userId] == 0) {
+                msg->msgContent_->ReadInt32();
+                it->second->SendMessage(msg);
+                return;
+            }
+            forwarding_[userId]++;
+        }
+        msg->coalesceKey_ = 0;
+        serviceHandler_->SendMessage(msg);
+    }
+
+    /*! Hand a client message routed through the service thread over to the thread of its user
+    \n Run in the work thread of the service
+    \param userId the user id the message is dispatched to
+    \param msg a message queued by Dispatch, or null if the service thread has dropped it
+    \return true - the message is sent to the thread of the user
+    \n      false - the user has no work thread or msg is null, the message is dropped
+    */
+    bool UserMessageRouter::HandOver(int32_t userId, MessagePtr msg)
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        auto count = forwarding_.find(userId);
+        if (count != forwarding_.end() && --count->second <= 0) {
+            forwarding_.erase(count);
+        }
+        auto it = handlers_.find(userId);
+        if (!msg || it == handlers_.end()) {
+            return false;
+        }
+        it->second->SendMessage(std::move(msg));
+        return true;
+    }
+
+    /*! Send a message to the work thread of a user
+    \n It is for the messages which are not from a client, e.g. the death of a remote object or a request
+        of the service itself.
+    \param userId the id of the user
+    \param msg the message to be sent, it's freed if the user has no work thread
+    \return true - the message is sent
+    */
+    bool UserMessageRouter::Send(int32_t userId, MessagePtr msg)
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        auto it = handlers_.find(userId);
+        if (it == handlers_.end()) {
+            return false;
+        }
+        it->second->SendMessage(std::move(msg));
+        return true;
+    }
+
+    /*! Get the number of client messages of a user which are queued in the service thread
+    \param userId the id of the user
+    */
+    int32_t UserMessageRouter::GetForwardingCount(int32_t userId)
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        auto it = forwarding_.find(userId);
+        return it == forwarding_.end() ? 0 : it->second;
+    }
+} // namespace MiscServices
+} // namespace OHOS
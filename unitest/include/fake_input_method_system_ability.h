@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file fake_input_method_system_ability.h */
+#ifndef UNITEST_INCLUDE_FAKE_INPUT_METHOD_SYSTEM_ABILITY_H
+#define UNITEST_INCLUDE_FAKE_INPUT_METHOD_SYSTEM_ABILITY_H
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+#include "global.h"
+#include "i_input_method_system_ability.h"
+#include "input_client_proxy.h"
+#include "input_data_channel_proxy.h"
+#include "input_method_agent_proxy.h"
+#include "input_method_core_proxy.h"
+#include "ipc_object_stub.h"
+
+namespace OHOS {
+namespace MiscServices {
+    /*! A stand-in of the input method service, put in place of it by ServiceLocator::SetLocalAbility
+      \n It binds the one editor and the one IME of the process the way PerUserSession does: the editor
+      \n gets the agent of the IME when it's prepared, and the IME is asked to show the keyboard with the
+      \n data channel of the editor when the editor starts input. The requests it receives are kept.
+    */
+    class FakeInputMethodSystemAbility : public IPCObjectStub {
+    public:
+        FakeInputMethodSystemAbility() : IPCObjectStub(IInputMethodSystemAbility::GetDescriptor()) {}
+        ~FakeInputMethodSystemAbility() = default;
+
+        int OnRemoteRequest(uint32_t code, MessageParcel &data, MessageParcel &reply, MessageOption &option) override
+        {
+            std::lock_guard<std::mutex> lock(lock_);
+            codes_.push_back(code);
+            data.ReadInterfaceToken();
+            switch (code) {
+                case IInputMethodSystemAbility::SET_CORE_AND_AGENT: {
+                    sptr<IRemoteObject> coreObject = data.ReadRemoteObject();
+                    sptr<IRemoteObject> agentObject = data.ReadRemoteObject();
+                    core_ = coreObject ? new InputMethodCoreProxy(coreObject) : nullptr;
+                    agent_ = agentObject ? new InputMethodAgentProxy(agentObject) : nullptr;
+                    break;
+                }
+                case IInputMethodSystemAbility::PREPARE_INPUT: {
+                    data.ReadInt32(); // the display id
+                    sptr<IRemoteObject> clientObject = data.ReadRemoteObject();
+                    dataChannel_ = data.ReadRemoteObject();
+                    client_ = clientObject ? new InputClientProxy(clientObject) : nullptr;
+                    if (client_ && agent_) {
+                        client_->onInputReady(agent_);
+                    }
+                    break;
+                }
+                case IInputMethodSystemAbility::START_INPUT: {
+                    if (core_ && dataChannel_) {
+                        sptr<IInputDataChannel> channel = new InputDataChannelProxy(dataChannel_);
+                        core_->showKeyboard(channel);
+                    }
+                    break;
+                }
+                case IInputMethodSystemAbility::STOP_INPUT: {
+                    if (core_) {
+                        core_->hideKeyboard(1);
+                    }
+                    break;
+                }
+                default: {
+                    break;
+                }
+            }
+            reply.WriteInt32(ErrorCode::NO_ERROR);
+            return ErrorCode::NO_ERROR;
+        }
+
+        /*! Check if a request with the given code is received */
+        bool HasReceived(uint32_t code)
+        {
+            std::lock_guard<std::mutex> lock(lock_);
+            return std::find(codes_.begin(), codes_.end(), code) != codes_.end();
+        }
+
+        /*! Get the data channel of the editor prepared last, nullptr if none */
+        sptr<IRemoteObject> GetDataChannel()
+        {
+            std::lock_guard<std::mutex> lock(lock_);
+            return dataChannel_;
+        }
+
+    private:
+        std::mutex lock_;
+        std::vector<uint32_t> codes_;
+        sptr<IInputMethodCore> core_;
+        sptr<IInputMethodAgent> agent_;
+        sptr<IInputClient> client_;
+        sptr<IRemoteObject> dataChannel_;
+    };
+} // namespace MiscServices
+} // namespace OHOS
+#endif // UNITEST_INCLUDE_FAKE_INPUT_METHOD_SYSTEM_ABILITY_H
@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "client_registry.h"
+#include "global.h"
+#include "ipc_object_stub.h"
+
+using namespace testing::ext;
+namespace OHOS {
+namespace MiscServices {
+    class ClientRegistryTest : public testing::Test {
+    public:
+        static constexpr int32_t CLIENT_COUNT = 1000;
+        static constexpr int32_t WINDOWS_PER_PROCESS = 4;
+        static constexpr int32_t DISPLAY_COUNT = 2;
+
+        static void SetUpTestCase(void);
+        static void TearDownTestCase(void);
+        void SetUp();
+        void TearDown();
+
+        std::shared_ptr<ClientInfo> CreateClient(int32_t index, bool security);
+
+        std::vector<sptr<IRemoteObject>> objects; // the remote objects of the simulated clients
+    };
+
+    void ClientRegistryTest::SetUpTestCase(void)
+    {
+        IMSA_HILOGI("ClientRegistryTest::SetUpTestCase");
+    }
+
+    void ClientRegistryTest::TearDownTestCase(void)
+    {
+        IMSA_HILOGI("ClientRegistryTest::TearDownTestCase");
+    }
+
+    void ClientRegistryTest::SetUp(void)
+    {
+        IMSA_HILOGI("ClientRegistryTest::SetUp");
+        objects.clear();
+        for (int32_t i = 0; i < CLIENT_COUNT; i++) {
+            objects.push_back(new IPCObjectStub(u"ohos.miscservices.inputmethod.ClientRegistryTest"));
+        }
+    }
+
+    void ClientRegistryTest::TearDown(void)
+    {
+        IMSA_HILOGI("ClientRegistryTest::TearDown");
+        objects.clear();
+    }
+
+    /*! Create a simulated client, several windows of a process share its pid
+    \param index the index of the client
+    \param security true - the client is a password field
+    */
+    std::shared_ptr<ClientInfo> ClientRegistryTest::CreateClient(int32_t index, bool security)
+    {
+        InputAttribute attribute;
+        attribute.SetInputPattern(security ? InputAttribute::PATTERN_PASSWORD : InputAttribute::PATTERN_TEXT);
+        return std::make_shared<ClientInfo>(index / WINDOWS_PER_PROCESS, index, 0, index % DISPLAY_COUNT, nullptr,
+                                            nullptr, attribute);
+    }
+
+    /**
+    * @tc.name: testLookup
+    * @tc.desc: Checkout clients are found by remote object and pid, and counted by kind.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(ClientRegistryTest, testLookup, TestSize.Level0)
+    {
+        ClientRegistry registry;
+        constexpr int32_t count = 8;
+        for (int32_t i = 0; i < count; i++) {
+            EXPECT_TRUE(registry.Add(objects[i], CreateClient(i, i == 0)));
+        }
+        EXPECT_FALSE(registry.Add(objects[0], CreateClient(0, false)));
+        EXPECT_EQ(registry.GetSize(), count);
+        EXPECT_EQ(registry.GetCount(true), 1);
+        EXPECT_EQ(registry.GetCount(false), count - 1);
+
+        std::shared_ptr<ClientInfo> info = registry.Find(objects[5]);
+        ASSERT_NE(info, nullptr);
+        EXPECT_EQ(info->uid, 5);
+        EXPECT_EQ((int32_t)registry.FindByPid(1).size(), WINDOWS_PER_PROCESS);
+
+        std::shared_ptr<const ClientRegistry::ClientList> before = registry.GetAll();
+        EXPECT_EQ(registry.Remove(objects[5]), info);
+        EXPECT_EQ(registry.Remove(objects[5]), nullptr);
+        EXPECT_EQ(registry.Find(objects[5]), nullptr);
+        EXPECT_EQ(info->uid, 5);
+        EXPECT_EQ((int32_t)registry.FindByPid(1).size(), WINDOWS_PER_PROCESS - 1);
+        EXPECT_EQ((int32_t)before->size(), count);
+        EXPECT_EQ((int32_t)registry.GetAll()->size(), count - 1);
+
+        registry.Remove(objects[0]);
+        EXPECT_EQ(registry.GetCount(true), 0);
+        EXPECT_EQ((int32_t)registry.Clear().size(), count - 2);
+        EXPECT_EQ(registry.GetSize(), 0);
+        EXPECT_TRUE(registry.GetAll()->empty());
+        EXPECT_TRUE(registry.FindByPid(0).empty());
+    }
+
+    /**
+    * @tc.name: testConcurrentIteration
+    * @tc.desc: Checkout broadcasts iterate the clients safely while windows are attached and detached.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(ClientRegistryTest, testConcurrentIteration, TestSize.Level1)
+    {
+        ClientRegistry registry;
+        constexpr int32_t steady = CLIENT_COUNT / 2;
+        for (int32_t i = 0; i < steady; i++) {
+            registry.Add(objects[i], CreateClient(i, false));
+        }
+        std::atomic<bool> stop(false);
+        std::atomic<int32_t> badLists(0);
+        std::vector<std::thread> readers;
+        for (int32_t r = 0; r < 2; r++) {
+            readers.emplace_back([&]() {
+                while (!stop.load()) {
+                    std::shared_ptr<const ClientRegistry::ClientList> list = registry.GetAll();
+                    int32_t seen = 0;
+                    for (const auto &info : *list) {
+                        seen += (info->uid < steady) ? 1 : 0;
+                    }
+                    if (seen != steady) {
+                        badLists++;
+                    }
+                    registry.Find(objects[seen % CLIENT_COUNT]);
+                }
+            });
+        }
+        for (int32_t round = 0; round < 50; round++) {
+            for (int32_t i = steady; i < CLIENT_COUNT; i++) {
+                registry.Add(objects[i], CreateClient(i, false));
+            }
+            for (int32_t i = steady; i < CLIENT_COUNT; i++) {
+                registry.Remove(objects[i]);
+            }
+        }
+        stop.store(true);
+        for (auto &reader : readers) {
+            reader.join();
+        }
+        EXPECT_EQ(badLists.load(), 0);
+        EXPECT_EQ(registry.GetSize(), steady);
+    }
+
+    /**
+    * @tc.name: testBenchmark
+    * @tc.desc: Report how the cost of a lookup grows with the number of attached clients, and checkout a
+    *           broadcast doesn't copy the list while no client comes or goes.
+    * @tc.type: PERF
+    */
+    HWTEST_F(ClientRegistryTest, testBenchmark, TestSize.Level1)
+    {
+        constexpr int32_t lookups = 100 * CLIENT_COUNT;
+        constexpr int32_t fewClients = 10;
+        ClientRegistry few;
+        ClientRegistry many;
+        for (int32_t i = 0; i < CLIENT_COUNT; i++) {
+            if (i < fewClients) {
+                few.Add(objects[i], CreateClient(i, false));
+            }
+            many.Add(objects[i], CreateClient(i, i % 10 == 0));
+        }
+
+        auto measure = [this](const ClientRegistry &registry, int32_t size) {
+            int64_t best = INT64_MAX;
+            for (int32_t round = 0; round < 5; round++) {
+                int64_t sum = 0;
+                auto start = std::chrono::steady_clock::now();
+                for (int32_t i = 0; i < lookups; i++) {
+                    sum += registry.Find(objects[i % size])->uid + 1;
+                }
+                auto cost = std::chrono::steady_clock::now() - start;
+                EXPECT_GT(sum, 0);
+                best = std::min<int64_t>(best, std::chrono::duration_cast<std::chrono::nanoseconds>(cost).count());
+            }
+            return best;
+        };
+        int64_t fewCost = measure(few, fewClients);
+        int64_t manyCost = measure(many, CLIENT_COUNT);
+        // the wall clock of a shared test device is too noisy to assert on, a hashed lookup keeps the ratio near 1
+        IMSA_HILOGI("ClientRegistryTest::testBenchmark %{public}d lookups: %{public}lld ns with %{public}d clients, "
+            "%{public}lld ns with %{public}d, ratio %{public}.2f", lookups, (long long)fewCost, fewClients,
+            (long long)manyCost, CLIENT_COUNT, fewCost > 0 ? (double)manyCost / fewCost : 0.0);
+
+        std::shared_ptr<const ClientRegistry::ClientList> list = many.GetAll();
+        EXPECT_EQ((int32_t)list->size(), CLIENT_COUNT);
+        EXPECT_EQ(many.GetAll(), list);
+        many.Remove(objects[0]);
+        EXPECT_NE(many.GetAll(), list);
+        EXPECT_EQ(many.GetAll(), many.GetAll());
+        EXPECT_EQ(many.GetCount(true), CLIENT_COUNT / 10 - 1);
+    }
+} // namespace MiscServices
+} // namespace OHOS
@@ -0,0 +1,286 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "global.h"
+#include "ime_launcher.h"
+
+using namespace testing::ext;
+namespace OHOS {
+namespace MiscServices {
+    class ImeLauncherTest : public testing::Test {
+    public:
+        static void SetUpTestCase(void);
+        static void TearDownTestCase(void);
+        void SetUp();
+        void TearDown();
+
+        std::shared_ptr<ImeLauncher> CreateLauncher();
+        void RunTasks(int32_t count);
+
+        int32_t failCount = 0; // the number of ability starts failing before one succeeds
+        int32_t startCount = 0;
+        std::vector<std::pair<std::function<void()>, int64_t>> tasks; // the tasks posted, with their delay
+        std::vector<int64_t> delays; // the delays of all the tasks run
+    };
+
+    void ImeLauncherTest::SetUpTestCase(void)
+    {
+        IMSA_HILOGI("ImeLauncherTest::SetUpTestCase");
+    }
+
+    void ImeLauncherTest::TearDownTestCase(void)
+    {
+        IMSA_HILOGI("ImeLauncherTest::TearDownTestCase");
+    }
+
+    void ImeLauncherTest::SetUp(void)
+    {
+        IMSA_HILOGI("ImeLauncherTest::SetUp");
+        failCount = 0;
+        startCount = 0;
+        tasks.clear();
+        delays.clear();
+    }
+
+    void ImeLauncherTest::TearDown(void)
+    {
+        IMSA_HILOGI("ImeLauncherTest::TearDown");
+    }
+
+    /*! Create a launcher whose ability starts fail failCount times, and whose delayed tasks are queued
+    */
+    std::shared_ptr<ImeLauncher> ImeLauncherTest::CreateLauncher()
+    {
+        return std::make_shared<ImeLauncher>(
+            [this](const std::string &imeId) {
+                startCount++;
+                return startCount > failCount;
+            },
+            [this](std::function<void()> task, int64_t delayMs) {
+                tasks.emplace_back(task, delayMs);
+            });
+    }
+
+    /*! Run the queued tasks as their delays expire, including the ones they post
+    \param count the maximum number of tasks to run
+    */
+    void ImeLauncherTest::RunTasks(int32_t count)
+    {
+        for (int32_t i = 0; i < count && !tasks.empty(); i++) {
+            auto task = tasks.front();
+            tasks.erase(tasks.begin());
+            delays.push_back(task.second);
+            task.first();
+        }
+    }
+
+    /**
+    * @tc.name: testLaunchBackoff
+    * @tc.desc: Checkout failed starts are retried with an exponential backoff and jitter until the IME starts.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(ImeLauncherTest, testLaunchBackoff, TestSize.Level0)
+    {
+        failCount = 4;
+        std::shared_ptr<ImeLauncher> launcher = CreateLauncher();
+        EXPECT_TRUE(launcher->Launch("com.example.ime/ImeService"));
+        EXPECT_EQ(launcher->GetState(), ImeLauncher::STATE_BACKOFF);
+        EXPECT_FALSE(launcher->Launch("com.example.ime/ImeService"));
+
+        RunTasks(failCount);
+        EXPECT_EQ(startCount, failCount + 1);
+        EXPECT_EQ(launcher->GetState(), ImeLauncher::STATE_STARTING);
+        ASSERT_EQ((int32_t)delays.size(), failCount);
+        for (int32_t i = 0; i < failCount; i++) {
+            int64_t delay = ImeLauncher::BASE_RETRY_DELAY_MS << i;
+            EXPECT_GE(delays[i], delay / 2);
+            EXPECT_LE(delays[i], delay);
+        }
+        // the connection timeout is pending, it does nothing once connected
+        ASSERT_EQ((int32_t)tasks.size(), 1);
+        EXPECT_EQ(tasks[0].second, ImeLauncher::CONNECT_TIMEOUT_MS);
+
+        launcher->OnConnected();
+        RunTasks(1);
+        EXPECT_TRUE(tasks.empty());
+        launcher->OnKeyboardShown();
+        ImeLauncher::LaunchMetrics metrics = launcher->GetMetrics();
+        EXPECT_EQ(launcher->GetState(), ImeLauncher::STATE_CONNECTED);
+        EXPECT_EQ(metrics.attempts, failCount + 1);
+        EXPECT_GE(metrics.connectMs, 0);
+        EXPECT_GE(metrics.firstKeyboardMs, metrics.connectMs);
+        EXPECT_LE(launcher->GetRetryDelay(100), ImeLauncher::MAX_RETRY_DELAY_MS);
+    }
+
+    /**
+    * @tc.name: testLaunchTimeoutAndStop
+    * @tc.desc: Checkout an IME not connecting in time is started again, and a stop cancels the pending retries.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(ImeLauncherTest, testLaunchTimeoutAndStop, TestSize.Level0)
+    {
+        std::shared_ptr<ImeLauncher> launcher = CreateLauncher();
+        EXPECT_TRUE(launcher->Launch("com.example.ime/ImeService"));
+        EXPECT_EQ(startCount, 1);
+        ASSERT_EQ((int32_t)tasks.size(), 1);
+        EXPECT_EQ(tasks[0].second, ImeLauncher::CONNECT_TIMEOUT_MS);
+
+        // the connection times out, the retry is scheduled
+        auto timeout = tasks[0].first;
+        tasks.clear();
+        timeout();
+        EXPECT_EQ(launcher->GetState(), ImeLauncher::STATE_BACKOFF);
+        ASSERT_EQ((int32_t)tasks.size(), 1);
+
+        launcher->OnDisconnected();
+        RunTasks(1);
+        EXPECT_TRUE(tasks.empty());
+        EXPECT_EQ(startCount, 1);
+        EXPECT_EQ(launcher->GetState(), ImeLauncher::STATE_IDLE);
+
+        EXPECT_TRUE(launcher->Launch("com.example.ime/ImeService"));
+        EXPECT_EQ(startCount, 2);
+        launcher->OnConnected();
+        RunTasks(1);
+        EXPECT_TRUE(tasks.empty());
+        EXPECT_EQ(startCount, 2);
+        EXPECT_EQ(launcher->GetMetrics().attempts, 1);
+    }
+
+    /**
+    * @tc.name: testLaunchGivesUp
+    * @tc.desc: Checkout an IME which never starts, e.g. its bundle is removed, is not retried forever.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(ImeLauncherTest, testLaunchGivesUp, TestSize.Level0)
+    {
+        failCount = ImeLauncher::MAX_START_ATTEMPTS * 2;
+        std::shared_ptr<ImeLauncher> launcher = CreateLauncher();
+        EXPECT_TRUE(launcher->Launch("com.example.ime/ImeService"));
+        RunTasks(failCount);
+        EXPECT_TRUE(tasks.empty());
+        EXPECT_EQ(startCount, ImeLauncher::MAX_START_ATTEMPTS);
+        EXPECT_EQ(launcher->GetState(), ImeLauncher::STATE_IDLE);
+        EXPECT_EQ(launcher->GetMetrics().attempts, ImeLauncher::MAX_START_ATTEMPTS);
+
+        // a new launch starts over
+        EXPECT_TRUE(launcher->Launch("com.example.ime/ImeService"));
+        EXPECT_EQ(startCount, ImeLauncher::MAX_START_ATTEMPTS + 1);
+    }
+
+    /**
+    * @tc.name: testCrashRecovery
+    * @tc.desc: Checkout an IME which died is restarted at once, and an IME crashing in a loop is restarted
+    *           with the backoff.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(ImeLauncherTest, testCrashRecovery, TestSize.Level0)
+    {
+        std::shared_ptr<ImeLauncher> launcher = CreateLauncher();
+        EXPECT_TRUE(launcher->Launch("com.example.ime/ImeService"));
+        launcher->OnConnected();
+        RunTasks(1);
+
+        EXPECT_EQ(launcher->Recover("com.example.ime/ImeService"), 0);
+        EXPECT_EQ(startCount, 2);
+        EXPECT_EQ(launcher->GetState(), ImeLauncher::STATE_STARTING);
+        launcher->OnConnected();
+        RunTasks(1);
+        EXPECT_TRUE(tasks.empty());
+
+        for (int32_t crashes = 2; crashes <= 4; crashes++) {
+            int64_t delay = launcher->Recover("com.example.ime/ImeService");
+            int64_t maxDelay = ImeLauncher::BASE_RETRY_DELAY_MS << (crashes - 2);
+            EXPECT_GE(delay, maxDelay / 2);
+            EXPECT_LE(delay, maxDelay);
+            EXPECT_EQ(launcher->GetState(), ImeLauncher::STATE_BACKOFF);
+            ASSERT_EQ((int32_t)tasks.size(), 1);
+            EXPECT_EQ(tasks[0].second, delay);
+            RunTasks(1);
+            EXPECT_EQ(startCount, crashes + 1);
+            launcher->OnConnected();
+            RunTasks(1);
+        }
+        EXPECT_EQ(launcher->GetState(), ImeLauncher::STATE_CONNECTED);
+        EXPECT_GE(launcher->GetMetrics().connectMs, 0);
+    }
+
+    /**
+    * @tc.name: testStandbyStart
+    * @tc.desc: Checkout a standby IME is started in a task rather than by the caller, and the session is asked
+    *           to check it after the connection timeout, or at once if its start fails.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(ImeLauncherTest, testStandbyStart, TestSize.Level0)
+    {
+        const std::string imeIds[] = {
+            "com.example.ime0/ImeService", "com.example.ime1/ImeService", "com.example.ime2/ImeService"
+        };
+        std::vector<std::pair<std::string, uint64_t>> checks;
+        auto launcher = std::make_shared<ImeLauncher>(
+            [&](const std::string &imeId) {
+                startCount++;
+                return imeId != imeIds[2];
+            },
+            [this](std::function<void()> task, int64_t delayMs) {
+                tasks.emplace_back(task, delayMs);
+            },
+            [&checks](const std::string &imeId, uint64_t launchId) {
+                checks.emplace_back(imeId, launchId);
+            });
+        EXPECT_TRUE(launcher->Launch(imeIds[0]));
+        launcher->OnConnected();
+        tasks.clear();
+        EXPECT_FALSE(launcher->StartStandby(imeIds[0], 1));
+
+        EXPECT_TRUE(launcher->StartStandby(imeIds[1], 2));
+        EXPECT_EQ(startCount, 1);
+        ASSERT_EQ((int32_t)tasks.size(), 1);
+        EXPECT_EQ(tasks[0].second, 0);
+        RunTasks(1);
+        EXPECT_EQ(startCount, 2);
+        ASSERT_EQ((int32_t)tasks.size(), 1);
+        EXPECT_EQ(tasks[0].second, ImeLauncher::CONNECT_TIMEOUT_MS);
+        RunTasks(1);
+        ASSERT_EQ((int32_t)checks.size(), 1);
+        EXPECT_EQ(checks[0].first, imeIds[1]);
+        EXPECT_EQ(checks[0].second, 2u);
+
+        // the session keeps the standby IME, and checks its memory again later
+        launcher->ScheduleStandbyCheck(imeIds[1], 2, ImeLauncher::STANDBY_CHECK_MS);
+        ASSERT_EQ((int32_t)tasks.size(), 1);
+        EXPECT_EQ(tasks[0].second, ImeLauncher::STANDBY_CHECK_MS);
+        tasks.clear();
+
+        // a failed start is checked at once
+        EXPECT_TRUE(launcher->StartStandby(imeIds[2], 3));
+        RunTasks(2);
+        EXPECT_EQ(startCount, 3);
+        ASSERT_EQ((int32_t)checks.size(), 2);
+        EXPECT_EQ(checks[1].first, imeIds[2]);
+        EXPECT_EQ(checks[1].second, 3u);
+        EXPECT_EQ(delays.back(), 0);
+        EXPECT_TRUE(tasks.empty());
+        EXPECT_EQ(launcher->GetImeId(), imeIds[0]);
+        EXPECT_EQ(launcher->GetState(), ImeLauncher::STATE_CONNECTED);
+    }
+} // namespace MiscServices
+} // namespace OHOS
@@ -14,7 +14,15 @@
  */
 #include <functional>
 #include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <random>
 #include <vector>
 #include <sys/time.h>
 #include <thread>
@@ -26,10 +34,17 @@
 #include "i_input_method_system_ability.h"
 #include "i_input_method_agent.h"
 #include "input_data_channel_stub.h"
+#include "input_data_channel_proxy.h"
 #include "input_client_stub.h"
+#include "input_client_proxy.h"
+#include "input_method_agent_stub.h"
+#include "ipc_object_stub.h"
 #include "iservice_registry.h"
 #include "system_ability_definition.h"
 #include "input_method_setting.h"
+#include "input_method_index.h"
+#include "editor_text_mirror.h"
+#include "text_delta.h"
 
 using namespace testing::ext;
 namespace OHOS {
@@ -69,14 +84,158 @@ namespace MiscServices {
             IMSA_HILOGI("IMC TEST TextListener MoveCursor");
         }
     };
+
+    /*! An in-process stand-in for binder.
+      \n Requests are served one by one by a server thread. A synchronous caller waits until its request is
+      \n served, while a one-way caller returns once the request is queued, as the binder driver does.
+    */
+    class LoopbackRemoteObject : public IPCObjectStub {
+    public:
+        LoopbackRemoteObject(sptr<IPCObjectStub> target, bool honorAsync)
+            : target_(target), honorAsync_(honorAsync), exit_(false)
+        {
+            server_ = std::thread([this] { Serve(); });
+        }
+
+        ~LoopbackRemoteObject()
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                exit_ = true;
+            }
+            cv_.notify_one();
+            server_.join();
+        }
+
+        int SendRequest(uint32_t code, MessageParcel &data, MessageParcel &reply, MessageOption &option) override
+        {
+            bool async = honorAsync_ && (option.GetFlags() & MessageOption::TF_ASYNC);
+            std::shared_ptr<MessageParcel> request = std::make_shared<MessageParcel>();
+            request->WriteBuffer(reinterpret_cast<const void *>(data.GetData()), data.GetDataSize());
+            std::shared_ptr<std::promise<void>> served = std::make_shared<std::promise<void>>();
+            std::future<void> done = served->get_future();
+            MessageParcel *replyParcel = async ? nullptr : &reply;
+            int flags = option.GetFlags();
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                flags_.push_back(flags);
+                tasks_.push_back([this, code, request, replyParcel, flags, served] {
+                    MessageParcel unusedReply;
+                    MessageOption requestOption(flags);
+                    target_->OnRemoteRequest(code, *request, replyParcel ? *replyParcel : unusedReply, requestOption);
+                    served->set_value();
+                });
+            }
+            cv_.notify_one();
+            if (!async) {
+                done.wait();
+            }
+            return NO_ERROR;
+        }
+
+        std::vector<int> GetFlags()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            return flags_;
+        }
+
+    private:
+        void Serve()
+        {
+            while (true) {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    cv_.wait(lock, [this] { return exit_ || !tasks_.empty(); });
+                    if (tasks_.empty()) {
+                        return;
+                    }
+                    task = tasks_.front();
+                    tasks_.pop_front();
+                }
+                task();
+            }
+        }
+
+        sptr<IPCObjectStub> target_;
+        bool honorAsync_; // false - every request is served synchronously, as before one-way calls were used
+        bool exit_;
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::deque<std::function<void()>> tasks_;
+        std::vector<int> flags_;
+        std::thread server_;
+    };
+
+    /*! An input client whose process is slow to handle the requests, e.g. it's busy or hung */
+    class SlowClient : public IPCObjectStub {
+    public:
+        explicit SlowClient(int32_t delayMs) : IPCObjectStub(u"ohos.miscservices.inputmethod.SlowClient"),
+            delayMs_(delayMs), served_(0) {}
+        ~SlowClient() = default;
+
+        int OnRemoteRequest(uint32_t code, MessageParcel &data, MessageParcel &reply, MessageOption &option) override
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(delayMs_));
+            std::unique_lock<std::mutex> lock(mutex_);
+            codes_.push_back(code);
+            served_++;
+            return NO_ERROR;
+        }
+
+        int32_t GetServed()
+        {
+            return served_.load();
+        }
+
+        std::vector<uint32_t> GetCodes()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            return codes_;
+        }
+
+    private:
+        int32_t delayMs_;
+        std::atomic<int32_t> served_;
+        std::mutex mutex_;
+        std::vector<uint32_t> codes_; // the requests served, in order
+    };
+
     class InputMethodControllerTest : public testing::Test {
     public:
         static void SetUpTestCase(void);
         static void TearDownTestCase(void);
         void SetUp();
         void TearDown();
+        static int64_t GetMoveCursorCostNs(bool honorAsync);
     };
 
+    /*! Get the average time the IME side spends on InputDataChannelProxy::MoveCursor
+      \param honorAsync false - the call is served synchronously, as it was before it became one-way
+    */
+    int64_t InputMethodControllerTest::GetMoveCursorCostNs(bool honorAsync)
+    {
+        const int32_t callCount = 2000;
+        sptr<InputDataChannelStub> channel = new InputDataChannelStub();
+        MessageHandler *handler = new MessageHandler(MessageHandler::QUEUE_MODE_LOCK_FREE);
+        channel->SetHandler(handler);
+        int64_t costNs = 0;
+        {
+            sptr<LoopbackRemoteObject> loopback = new LoopbackRemoteObject(channel, honorAsync);
+            sptr<InputDataChannelProxy> proxy = new InputDataChannelProxy(loopback);
+            auto begin = std::chrono::steady_clock::now();
+            for (int32_t i = 0; i < callCount; i++) {
+                proxy->MoveCursor(i);
+            }
+            costNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - begin).count() / callCount;
+        }
+        for (int32_t i = 0; i < callCount; i++) {
+            EXPECT_EQ(handler->GetMessage()->msgContent_->ReadInt32(), i);
+        }
+        return costNs;
+    }
+
     void InputMethodControllerTest::SetUpTestCase(void)
     {
         IMSA_HILOGI("InputMethodControllerTest::SetUpTestCase");
@@ -126,6 +285,295 @@ namespace MiscServices {
         EXPECT_TRUE(iface != nullptr);
     }
 
+    /**
+    * @tc.name: testDataChannelOneWayCall
+    * @tc.desc: Checkout the edits, batch edits and events of IInputDataChannel are one-way calls and handled
+    *           in order.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(InputMethodControllerTest, testDataChannelOneWayCall, TestSize.Level0)
+    {
+        sptr<InputDataChannelStub> channel = new InputDataChannelStub();
+        MessageHandler *handler = new MessageHandler(MessageHandler::QUEUE_MODE_LOCK_FREE);
+        channel->SetHandler(handler);
+        sptr<LoopbackRemoteObject> loopback = new LoopbackRemoteObject(channel, true);
+        sptr<InputDataChannelProxy> proxy = new InputDataChannelProxy(loopback);
+
+        EXPECT_TRUE(proxy->InsertText(u"a"));
+        proxy->MoveCursor(1);
+        EXPECT_TRUE(proxy->DeleteBackward(1));
+        proxy->SendFunctionKey(1);
+        EXPECT_TRUE(proxy->DeleteForward(1));
+        proxy->SendKeyboardStatus(1);
+        std::vector<EditOperation> operations = { EditOperation(EditOperation::DELETE_BACKWARD, u"", 5),
+            EditOperation(EditOperation::INSERT_TEXT, u"word", 0),
+            EditOperation(EditOperation::MOVE_CURSOR, u"", static_cast<int32_t>(Direction::LEFT)) };
+        EXPECT_TRUE(proxy->BatchEdit(operations));
+
+        std::vector<int32_t> expected = { MessageID::MSG_ID_INSERT_CHAR, MessageID::MSG_ID_MOVE_CURSOR,
+            MessageID::MSG_ID_DELETE_BACKWARD, MessageID::MSG_ID_SEND_FUNCTION_KEY,
+            MessageID::MSG_ID_DELETE_FORWARD, MessageID::MSG_ID_SEND_KEYBOARD_STATUS };
+        for (auto msgId : expected) {
+            EXPECT_EQ(handler->GetMessage()->msgId_, msgId);
+        }
+        MessagePtr msg = handler->GetMessage();
+        EXPECT_EQ(msg->msgId_, MessageID::MSG_ID_BATCH_EDIT);
+        std::vector<EditOperation> received;
+        EXPECT_TRUE(EditOperation::ReadBatch(*msg->msgContent_, received));
+        ASSERT_EQ(received.size(), operations.size());
+        for (size_t i = 0; i < operations.size(); i++) {
+            EXPECT_EQ(received[i].GetType(), operations[i].GetType());
+            EXPECT_EQ(received[i].GetText(), operations[i].GetText());
+            EXPECT_EQ(received[i].GetValue(), operations[i].GetValue());
+        }
+        for (auto flags : loopback->GetFlags()) {
+            EXPECT_EQ(flags & MessageOption::TF_ASYNC, MessageOption::TF_ASYNC);
+        }
+    }
+
+    /**
+    * @tc.name: testDataChannelCallCost
+    * @tc.desc: Compare the IME side cost of IInputDataChannel::MoveCursor as a synchronous and a one-way call.
+    * @tc.type: PERF
+    */
+    HWTEST_F(InputMethodControllerTest, testDataChannelCallCost, TestSize.Level1)
+    {
+        int64_t syncNs = GetMoveCursorCostNs(false);
+        int64_t asyncNs = GetMoveCursorCostNs(true);
+        printf("MoveCursor cost on IME side: sync %lld ns, one-way %lld ns\n", (long long)syncNs,
+            (long long)asyncNs);
+    }
+
+    /**
+    * @tc.name: testInputReadyFanOut
+    * @tc.desc: Checkout sending the IME agent, the display mode and the release to many clients isn't held by
+    *           slow clients, and each client handles them in the order they are sent.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(InputMethodControllerTest, testInputReadyFanOut, TestSize.Level1)
+    {
+        const int32_t clientCount = 8;
+        const int32_t delayMs = 200;
+        sptr<IInputMethodAgent> agent = new InputMethodAgentStub();
+        std::vector<sptr<SlowClient>> targets;
+        std::vector<sptr<LoopbackRemoteObject>> loopbacks;
+        std::vector<sptr<InputClientProxy>> clients;
+        for (int32_t i = 0; i < clientCount; i++) {
+            targets.push_back(new SlowClient(delayMs));
+            loopbacks.push_back(new LoopbackRemoteObject(targets.back(), true));
+            clients.push_back(new InputClientProxy(loopbacks.back()));
+        }
+
+        auto begin = std::chrono::steady_clock::now();
+        for (auto &client : clients) {
+            EXPECT_EQ(client->onInputReady(agent), NO_ERROR);
+            EXPECT_EQ(client->setDisplayMode(1), NO_ERROR);
+            EXPECT_EQ(client->onInputReleased(0), NO_ERROR);
+        }
+        auto cost = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin);
+        EXPECT_LT(cost.count(), delayMs);
+
+        for (int32_t i = 0; i < clientCount; i++) {
+            for (auto flags : loopbacks[i]->GetFlags()) {
+                EXPECT_EQ(flags & MessageOption::TF_ASYNC, MessageOption::TF_ASYNC);
+            }
+        }
+        // the loopbacks serve the queued requests before they are destroyed
+        clients.clear();
+        loopbacks.clear();
+        const std::vector<uint32_t> expected = {
+            IInputClient::ON_INPUT_READY, IInputClient::SET_DISPLAY_MODE, IInputClient::ON_INPUT_RELEASED
+        };
+        for (auto &target : targets) {
+            EXPECT_EQ(target->GetServed(), 3);
+            EXPECT_EQ(target->GetCodes(), expected);
+        }
+    }
+
+    /**
+    * @tc.name: testEditorTextMirror
+    * @tc.desc: Checkout the text mirror of the IME answers the surrounding text queries from the text of the editor,
+    *           and stays stale after an edit until a delta reports the editor has applied that edit.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(InputMethodControllerTest, testEditorTextMirror, TestSize.Level0)
+    {
+        const int32_t roundCount = 1000;
+        const size_t maxLength = 20;
+        const int32_t numbers[] = { 0, 1, 3, 25 };
+        EditorTextMirror mirror;
+        std::u16string result;
+        EXPECT_FALSE(mirror.GetTextBeforeCursor(1, result));
+
+        mirror.Update(u"hello world", 5, 5);
+        EXPECT_TRUE(mirror.GetTextBeforeCursor(3, result));
+        EXPECT_EQ(result, u"llo");
+        EXPECT_TRUE(mirror.GetTextAfterCursor(3, result));
+        EXPECT_EQ(result, u" wo");
+
+        // the delta built before the editor applies edit 7 does not make the mirror fresh, nor a full update
+        uint64_t sequence = 0;
+        mirror.Invalidate(7);
+        EXPECT_FALSE(mirror.GetTextAfterCursor(3, result));
+        TextDelta delta = TextDelta::FullSync(u"hello world");
+        delta.SetSequence(++sequence);
+        delta.SetAckedEdit(6);
+        delta.SetSelection(5, 5, 6, 6);
+        EXPECT_TRUE(mirror.ApplyDelta(delta));
+        EXPECT_FALSE(mirror.IsFresh());
+        EXPECT_FALSE(mirror.GetTextBeforeCursor(3, result));
+        mirror.Update(u"hello world", 6, 6);
+        EXPECT_FALSE(mirror.IsFresh());
+        EXPECT_EQ(mirror.GetPendingEdit(), static_cast<uint64_t>(7));
+
+        delta = TextDelta::FullSync(u"hello, world");
+        delta.SetSequence(++sequence);
+        delta.SetAckedEdit(7);
+        delta.SetSelection(5, 5, 6, 6);
+        EXPECT_TRUE(mirror.ApplyDelta(delta));
+        EXPECT_TRUE(mirror.IsFresh());
+        EXPECT_EQ(mirror.GetPendingEdit(), static_cast<uint64_t>(0));
+        EXPECT_TRUE(mirror.GetTextBeforeCursor(3, result));
+        EXPECT_EQ(result, u"lo,");
+
+        // an edit sent while the mirror is fresh makes it stale at once
+        mirror.Invalidate(8);
+        EXPECT_FALSE(mirror.GetTextBeforeCursor(3, result));
+        mirror.Reset();
+        mirror.Update(u"hello", 5, 5);
+        EXPECT_TRUE(mirror.IsFresh());
+
+        std::mt19937 random(roundCount);
+        for (int32_t i = 0; i < roundCount; i++) {
+            std::u16string text(random() % (maxLength + 1), u'a');
+            for (auto &c : text) {
+                c = u'a' + random() % 26;
+            }
+            size_t begin = random() % (text.size() + 1);
+            size_t end = begin + random() % (text.size() - begin + 1);
+            mirror.Update(text, begin, end);
+            for (auto number : numbers) {
+                size_t count = static_cast<size_t>(number);
+                EXPECT_TRUE(mirror.GetTextBeforeCursor(number, result));
+                EXPECT_EQ(result, text.substr(begin - std::min(begin, count), std::min(begin, count)));
+                EXPECT_TRUE(mirror.GetTextAfterCursor(number, result));
+                EXPECT_EQ(result, text.substr(end, count));
+            }
+        }
+    }
+
+    /**
+    * @tc.name: testTextDeltaMirror
+    * @tc.desc: Checkout the text deltas keep the mirror of the IME the same as the editor text, and a lost delta
+    *           makes the mirror stale until the next full sync.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(InputMethodControllerTest, testTextDeltaMirror, TestSize.Level0)
+    {
+        const int32_t roundCount = 2000;
+        const int32_t lostInterval = 97;
+        std::mt19937 random(roundCount);
+        EditorTextMirror mirror;
+        std::u16string text = u"hello world";
+        uint64_t sequence = 1;
+        TextDelta delta = TextDelta::FullSync(text);
+        delta.SetSequence(sequence);
+        EXPECT_TRUE(mirror.ApplyDelta(delta));
+
+        for (int32_t i = 1; i <= roundCount; i++) {
+            std::u16string newText = text;
+            size_t begin = random() % (newText.size() + 1);
+            size_t length = random() % (std::min<size_t>(newText.size() - begin, 8) + 1);
+            std::u16string inserted(random() % 6, u'x');
+            for (auto &c : inserted) {
+                c = u'a' + random() % 26;
+            }
+            newText.replace(begin, length, inserted);
+            delta = TextDelta::Diff(text, newText);
+            std::u16string applied = text;
+            EXPECT_TRUE(delta.ApplyTo(applied));
+            EXPECT_EQ(applied, newText);
+            EXPECT_LE(delta.GetText().size(), inserted.size());
+            text = newText;
+
+            delta.SetSequence(++sequence);
+            delta.SetSelection(0, 0, begin, begin);
+            MessageParcel parcel;
+            EXPECT_TRUE(delta.Marshalling(parcel));
+            TextDelta received;
+            EXPECT_TRUE(received.ReadFromParcel(parcel));
+            if (i % lostInterval == 0) {
+                continue;
+            }
+            if (i > lostInterval && i % lostInterval == 1) {
+                // the delta after a lost one can not be applied, the editor text is got by a full sync later
+                EXPECT_FALSE(mirror.ApplyDelta(received));
+                EXPECT_FALSE(mirror.IsFresh());
+                TextDelta sync = TextDelta::FullSync(text);
+                sync.SetSequence(++sequence);
+                sync.SetSelection(0, 0, begin, begin);
+                received = sync;
+            }
+            EXPECT_TRUE(mirror.ApplyDelta(received));
+            EXPECT_EQ(mirror.GetText(), text);
+            std::u16string before;
+            EXPECT_TRUE(mirror.GetTextBeforeCursor(5, before));
+            EXPECT_EQ(before, EditorTextMirror::GetTextBefore(text, begin, 5));
+        }
+    }
+
+    /**
+    * @tc.name: testTextDeltaCost
+    * @tc.desc: Compare the cost of a keystroke in the middle of 1 KB, 100 KB and 1 MB documents, when the whole
+    *           text is sent and converted to UTF-8, and when a delta is sent and applied to the mirror.
+    * @tc.type: PERF
+    */
+    HWTEST_F(InputMethodControllerTest, testTextDeltaCost, TestSize.Level1)
+    {
+        const size_t sizes[] = { 1024, 100 * 1024, 1024 * 1024 };
+        const int32_t keyCount = 100;
+        for (auto size : sizes) {
+            std::u16string text(size, u'a');
+            EditorTextMirror mirror;
+            TextDelta sync = TextDelta::FullSync(text);
+            sync.SetSequence(1);
+            mirror.ApplyDelta(sync);
+            int32_t cursor = size / 2;
+
+            std::u16string typed = text;
+            auto begin = std::chrono::steady_clock::now();
+            for (int32_t i = 0; i < keyCount; i++) {
+                typed.insert(cursor + i, 1, u'b');
+                MessageParcel parcel;
+                parcel.WriteString16(typed);
+                std::string utf8 = Utils::to_utf8(parcel.ReadString16());
+                EXPECT_EQ(utf8.size(), typed.size());
+            }
+            int64_t fullNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - begin).count() / keyCount;
+
+            std::u16string last = text;
+            typed = text;
+            begin = std::chrono::steady_clock::now();
+            for (int32_t i = 0; i < keyCount; i++) {
+                typed.insert(cursor + i, 1, u'b');
+                TextDelta delta = TextDelta::Diff(last, typed);
+                last = typed;
+                delta.SetSequence(i + 2);
+                MessageParcel parcel;
+                delta.Marshalling(parcel);
+                TextDelta received;
+                received.ReadFromParcel(parcel);
+                EXPECT_TRUE(mirror.ApplyDelta(received));
+            }
+            int64_t deltaNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - begin).count() / keyCount;
+            EXPECT_EQ(mirror.GetText(), typed);
+            printf("keystroke in %zu chars: full text %lld ns, delta %lld ns\n", size, (long long)fullNs,
+                (long long)deltaNs);
+        }
+    }
+
     /**
     * @tc.name: testIMCBindToIMSA
     * @tc.desc: Bind IMSA.
@@ -201,6 +649,182 @@ namespace MiscServices {
         EXPECT_EQ(setting.GetCurrentKeyboardType(), curType);
     }
 
+    /**
+    * @tc.name: testInputMethodSettingEnabledList
+    * @tc.desc: Checkout the parsed enabled ime list stays in sync with its serialized value.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(InputMethodControllerTest, testInputMethodSettingEnabledList, TestSize.Level0)
+    {
+        InputMethodSetting setting;
+        setting.SetValue(InputMethodSetting::ENABLED_INPUT_METHODS_TAG, u"ime.a;1;2:ime.ab;3");
+        EXPECT_EQ(setting.GetEnabledKeyboardTypes(u"ime.ab"), std::vector<int32_t>({ 3 }));
+        EXPECT_EQ(setting.GetKeyboardTypeIndex(u"ime.a", 2), 1);
+        EXPECT_EQ(setting.GetKeyboardTypeIndex(u"ime.a", 3), -1);
+        EXPECT_EQ(setting.GetEnabledKeyboardTypeCount(u"ime"), 0);
+
+        EXPECT_FALSE(setting.AddEnabledInputMethod(u"ime.a", { 1, 2 }));
+        EXPECT_TRUE(setting.AddEnabledInputMethod(u"ime.a", { 4 }));
+        EXPECT_TRUE(setting.AddEnabledInputMethod(u"ime.c", { 5, 6 }));
+        EXPECT_EQ(setting.GetValue(InputMethodSetting::ENABLED_INPUT_METHODS_TAG), u"ime.a;4:ime.ab;3:ime.c;5;6");
+
+        EXPECT_TRUE(setting.RemoveEnabledInputMethod(u"ime.ab"));
+        EXPECT_FALSE(setting.RemoveEnabledInputMethod(u"ime.ab"));
+        int32_t hashCode = 0;
+        EXPECT_TRUE(setting.GetEnabledKeyboardType(u"ime.c", 1, hashCode));
+        EXPECT_EQ(hashCode, 6);
+        EXPECT_FALSE(setting.GetEnabledKeyboardType(u"ime.c", 2, hashCode));
+
+        InputMethodSetting copy = setting;
+        MessageParcel parcel;
+        copy.Marshalling(parcel);
+        std::unique_ptr<InputMethodSetting> received(InputMethodSetting::Unmarshalling(parcel));
+        EXPECT_EQ(received->GetEnabledInputMethodList(), std::vector<std::u16string>({ u"ime.a", u"ime.c" }));
+        EXPECT_EQ(received->GetValue(InputMethodSetting::ENABLED_INPUT_METHODS_TAG), u"ime.a;4:ime.c;5;6");
+    }
+
+    /**
+    * @tc.name: testInputMethodSettingSwitchCost
+    * @tc.desc: Compare the cost of a keyboard switch when the enabled ime list is split from its serialized
+    *           value on every query and when it's looked up in the parsed index, as the list grows.
+    * @tc.type: PERF
+    */
+    HWTEST_F(InputMethodControllerTest, testInputMethodSettingSwitchCost, TestSize.Level1)
+    {
+        const int32_t sizes[][2] = { { 2, 4 }, { 16, 16 }, { 128, 64 } };
+        const int32_t switchCount = 1000;
+        for (auto size : sizes) {
+            int32_t imeCount = size[0];
+            int32_t typeCount = size[1];
+            InputMethodSetting setting;
+            for (int32_t i = 0; i < imeCount; i++) {
+                std::vector<int32_t> types;
+                for (int32_t j = 0; j < typeCount; j++) {
+                    types.push_back(i * typeCount + j + 1);
+                }
+                setting.AddEnabledInputMethod(Utils::to_utf16("ime." + std::to_string(i)), types);
+            }
+            std::u16string value = setting.GetValue(InputMethodSetting::ENABLED_INPUT_METHODS_TAG);
+            std::u16string imeId = Utils::to_utf16("ime." + std::to_string(imeCount - 1));
+            int32_t firstType = (imeCount - 1) * typeCount + 1;
+
+            // setting the raw value drops the parsed list, so every query splits the string again
+            int32_t index = 0;
+            auto begin = std::chrono::steady_clock::now();
+            for (int32_t i = 0; i < switchCount; i++) {
+                setting.SetValue(InputMethodSetting::ENABLED_INPUT_METHODS_TAG, value);
+                std::vector<int32_t> types = setting.GetEnabledKeyboardTypes(imeId);
+                index = (index + 1) % types.size();
+                setting.SetCurrentKeyboardType(types[index]);
+            }
+            int64_t splitNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - begin).count() / switchCount;
+
+            begin = std::chrono::steady_clock::now();
+            for (int32_t i = 0; i < switchCount; i++) {
+                int32_t current = setting.GetKeyboardTypeIndex(imeId, setting.GetCurrentKeyboardType());
+                int32_t hashCode = 0;
+                EXPECT_TRUE(setting.GetEnabledKeyboardType(imeId,
+                    (current + 1) % setting.GetEnabledKeyboardTypeCount(imeId), hashCode));
+                setting.SetCurrentKeyboardType(hashCode);
+            }
+            int64_t indexNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - begin).count() / switchCount;
+            EXPECT_EQ(setting.GetCurrentKeyboardType(), firstType + (2 * switchCount) % typeCount);
+            printf("keyboard switch with %d imes x %d types: split %lld ns, index %lld ns\n", imeCount, typeCount,
+                (long long)splitNs, (long long)indexNs);
+        }
+    }
+
+    /**
+    * @tc.name: testInputMethodIndex
+    * @tc.desc: Look up 500 synthetic IMEs and their keyboard types by a linear scan and by the index,
+    *           and checkout the index follows added and removed IMEs, including the ones sharing an imeId.
+    * @tc.type: PERF
+    */
+    HWTEST_F(InputMethodControllerTest, testInputMethodIndex, TestSize.Level1)
+    {
+        const int32_t imeCount = 500;
+        const int32_t typeCount = 8;
+        std::vector<std::shared_ptr<InputMethodProperty>> properties;
+        InputMethodIndex index;
+        for (int32_t i = 0; i < imeCount; i++) {
+            auto property = std::make_shared<InputMethodProperty>();
+            property->mImeId = Utils::to_utf16("com.example.ime" + std::to_string(i) + "/ImeService");
+            property->mPackageName = Utils::to_utf16("com.example.ime" + std::to_string(i));
+            for (int32_t j = 0; j < typeCount; j++) {
+                KeyboardType *type = new KeyboardType();
+                type->setId(i * typeCount + j + 1);
+                type->setLanguage(Utils::to_utf16("lang" + std::to_string(j)));
+                property->mTypes.push_back(type);
+            }
+            index.Add(property);
+            properties.push_back(property);
+        }
+        EXPECT_EQ(index.Size(), imeCount);
+
+        const int32_t lookupCount = 1000;
+        KeyboardType *found = nullptr;
+        auto begin = std::chrono::steady_clock::now();
+        for (int32_t n = 0; n < lookupCount; n++) {
+            int32_t i = imeCount - 1 - n % 10;
+            std::u16string imeId = properties[i]->mImeId;
+            int32_t hashCode = i * typeCount + typeCount;
+            found = nullptr;
+            for (int32_t k = 0; k < (int32_t)properties.size() && !found; k++) {
+                if (properties[k]->mImeId != imeId) {
+                    continue;
+                }
+                for (int32_t j = 0; j < (int32_t)properties[k]->mTypes.size(); j++) {
+                    if (properties[k]->mTypes[j]->getHashCode() == hashCode) {
+                        found = properties[k]->mTypes[j];
+                        break;
+                    }
+                }
+            }
+            EXPECT_TRUE(found != nullptr);
+        }
+        int64_t scanNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - begin).count() / lookupCount;
+
+        begin = std::chrono::steady_clock::now();
+        for (int32_t n = 0; n < lookupCount; n++) {
+            int32_t i = imeCount - 1 - n % 10;
+            std::shared_ptr<InputMethodProperty> property = index.FindByImeId(properties[i]->mImeId);
+            found = index.FindKeyboardType(property.get(), i * typeCount + typeCount);
+            EXPECT_EQ(found, properties[i]->mTypes[typeCount - 1]);
+        }
+        int64_t indexNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - begin).count() / lookupCount;
+        printf("keyboard type lookup in %d imes: scan %lld ns, index %lld ns\n", imeCount, (long long)scanNs,
+            (long long)indexNs);
+
+        std::shared_ptr<InputMethodProperty> removed = properties[imeCount / 2];
+        EXPECT_EQ(index.FindByPackageName(removed->mPackageName), removed);
+        index.Remove(removed.get());
+        EXPECT_EQ(index.FindByImeId(removed->mImeId), nullptr);
+        EXPECT_EQ(index.FindByPackageName(removed->mPackageName), nullptr);
+        EXPECT_EQ(index.GetKeyboardTypeIndex(removed.get(), imeCount / 2 * typeCount + 1), -1);
+        EXPECT_EQ(index.Size(), imeCount - 1);
+
+        index.Add(removed);
+        EXPECT_EQ(index.GetKeyboardTypeIndex(removed.get(), imeCount / 2 * typeCount + 3), 2);
+
+        // the engine added first is found for a duplicated imeId, and the other one once the first is removed
+        auto duplicate = std::make_shared<InputMethodProperty>();
+        duplicate->mImeId = properties[0]->mImeId;
+        duplicate->mPackageName = properties[0]->mPackageName;
+        index.Add(duplicate);
+        EXPECT_EQ(index.FindByImeId(duplicate->mImeId), properties[0]);
+        index.Remove(properties[0].get());
+        EXPECT_EQ(index.FindByImeId(duplicate->mImeId), duplicate);
+        EXPECT_EQ(index.FindByPackageName(duplicate->mPackageName), duplicate);
+        index.Remove(duplicate.get());
+        EXPECT_EQ(index.FindByImeId(duplicate->mImeId), nullptr);
+        index.Clear();
+        EXPECT_EQ(index.FindByImeId(removed->mImeId), nullptr);
+    }
+
     /**
     * @tc.name: testInputMethodWholeProcess
     * @tc.desc: Bind IMSA.
@@ -0,0 +1,424 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "global.h"
+#include "i_platform_api.h"
+#include "input_method_catalogue.h"
+#include "input_method_property.h"
+#include "input_method_system_ability.h"
+#include "input_method_system_ability_proxy.h"
+#include "keyboard_type.h"
+#include "message_parcel.h"
+#include "peruser_setting.h"
+#include "platform.h"
+#include "utils.h"
+
+using namespace testing::ext;
+
+/*! Options of AddressSanitizer when the test is built with it. Freed memory is not held in quarantine,
+    so the resident memory measured is what the lists really keep, and leaks are reported at exit.
+*/
+extern "C" const char *__asan_default_options()
+{
+    return "quarantine_size_mb=0:detect_leaks=1";
+}
+
+namespace OHOS {
+namespace MiscServices {
+    /*! The platform reporting the installed IMEs to PerUserSetting, with TYPE_COUNT keyboard types each
+    */
+    class FakePlatformApi : public IPlatformApi {
+    public:
+        static constexpr int32_t TYPE_COUNT = 4;
+
+        sptr<IRemoteObject> AsObject() override
+        {
+            return nullptr;
+        }
+        int32_t registerCallback(const sptr<IPlatformCallback>& cb) override
+        {
+            return ErrorCode::NO_ERROR;
+        }
+        sptr<IInputMethodCore> bindInputMethodService(const std::u16string& packageName,
+                                                      const std::u16string& intention, int userId) override
+        {
+            return nullptr;
+        }
+        int32_t unbindInputMethodService(int userId, const std::u16string& packageName) override
+        {
+            return ErrorCode::NO_ERROR;
+        }
+        sptr<IRemoteObject> createWindowToken(int userId, int displayId, const std::u16string& packageName) override
+        {
+            return nullptr;
+        }
+        int32_t destroyWindowToken(int userId, const std::u16string& packageName) override
+        {
+            return ErrorCode::NO_ERROR;
+        }
+        int32_t listInputMethod(int userId, std::vector<InputMethodProperty*> *properties) override
+        {
+            return ErrorCode::NO_ERROR;
+        }
+        int32_t getInputMethodProperty(int userId, const std::u16string& packageName,
+                                       InputMethodProperty *inputMethodProperty) override
+        {
+            inputMethodProperty->mPackageName = packageName;
+            inputMethodProperty->mAbilityName = u"ImeService";
+            inputMethodProperty->mImeId = packageName + u"/" + inputMethodProperty->mAbilityName;
+            inputMethodProperty->label = u"Example IME";
+            for (int32_t i = 0; i < TYPE_COUNT; i++) {
+                KeyboardType *type = new KeyboardType();
+                type->setId(i + 1);
+                type->setLanguage(Utils::to_utf16("lang" + std::to_string(i)));
+                inputMethodProperty->mTypes.push_back(type);
+            }
+            return ErrorCode::NO_ERROR;
+        }
+        int32_t getInputMethodSetting(int userId, InputMethodSetting *inputMethodSetting) override
+        {
+            return ErrorCode::NO_ERROR;
+        }
+        int32_t setInputMethodSetting(int userId, const InputMethodSetting& inputMethodSetting) override
+        {
+            return ErrorCode::NO_ERROR;
+        }
+    };
+
+    class InputMethodListTest : public testing::Test {
+    public:
+        static void SetUpTestCase(void);
+        static void TearDownTestCase(void);
+        void SetUp();
+        void TearDown();
+
+        static constexpr int32_t IME_COUNT = 20;
+        static constexpr int32_t TYPE_COUNT = 4;
+        static constexpr int32_t EXTENSION_COUNT = 100;
+        static std::vector<std::shared_ptr<InputMethodProperty>> CreateInstalledList();
+        static int64_t GetResidentKb();
+        static std::vector<InputMethodCatalogue::Extension> CreateExtensions();
+    };
+
+    void InputMethodListTest::SetUpTestCase(void)
+    {
+        IMSA_HILOGI("InputMethodListTest::SetUpTestCase");
+    }
+
+    void InputMethodListTest::TearDownTestCase(void)
+    {
+        IMSA_HILOGI("InputMethodListTest::TearDownTestCase");
+    }
+
+    void InputMethodListTest::SetUp(void)
+    {
+        IMSA_HILOGI("InputMethodListTest::SetUp");
+    }
+
+    void InputMethodListTest::TearDown(void)
+    {
+        IMSA_HILOGI("InputMethodListTest::TearDown");
+    }
+
+    /*! Create a list of synthetic installed IMEs, as PerUserSetting keeps them
+    */
+    std::vector<std::shared_ptr<InputMethodProperty>> InputMethodListTest::CreateInstalledList()
+    {
+        std::vector<std::shared_ptr<InputMethodProperty>> installed;
+        for (int32_t i = 0; i < IME_COUNT; i++) {
+            auto property = std::make_shared<InputMethodProperty>();
+            property->mPackageName = Utils::to_utf16("com.example.ime" + std::to_string(i));
+            property->mAbilityName = Utils::to_utf16("ImeService");
+            property->mImeId = property->mPackageName + u"/" + property->mAbilityName;
+            property->label = Utils::to_utf16("Example IME " + std::to_string(i));
+            for (int32_t j = 0; j < TYPE_COUNT; j++) {
+                KeyboardType *type = new KeyboardType();
+                type->setId(i * TYPE_COUNT + j + 1);
+                type->setLanguage(Utils::to_utf16("lang" + std::to_string(j)));
+                property->mTypes.push_back(type);
+            }
+            installed.push_back(property);
+        }
+        return installed;
+    }
+
+    /*! Get the resident set size of this process in KB
+    */
+    int64_t InputMethodListTest::GetResidentKb()
+    {
+        FILE *file = fopen("/proc/self/statm", "r");
+        if (!file) {
+            return -1;
+        }
+        long size = 0;
+        long resident = 0;
+        int ret = fscanf(file, "%ld %ld", &size, &resident);
+        fclose(file);
+        if (ret != 2) {
+            return -1;
+        }
+        return (int64_t)resident * sysconf(_SC_PAGESIZE) / 1024;
+    }
+
+    /*! Create the IME extensions the mocked bundle manager reports
+    */
+    std::vector<InputMethodCatalogue::Extension> InputMethodListTest::CreateExtensions()
+    {
+        std::vector<InputMethodCatalogue::Extension> extensions;
+        for (int32_t i = 0; i < EXTENSION_COUNT; i++) {
+            InputMethodCatalogue::Extension extension;
+            extension.bundleName = "com.example.ime" + std::to_string(i);
+            extension.abilityName = "ImeService";
+            extension.versionCode = 1;
+            extension.labelId = i;
+            extension.descriptionId = EXTENSION_COUNT + i;
+            extension.resourcePath = "/data/app/el1/bundle/" + extension.bundleName + "/resources.index";
+            extensions.push_back(extension);
+        }
+        return extensions;
+    }
+
+    /**
+    * @tc.name: testListSnapshotShared
+    * @tc.desc: Checkout a listed snapshot shares the installed IMEs without copying, and outlives their removal.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(InputMethodListTest, testListSnapshotShared, TestSize.Level0)
+    {
+        std::vector<std::shared_ptr<InputMethodProperty>> installed = CreateInstalledList();
+        std::vector<InputMethodPropertyPtr> snapshot(installed.begin(), installed.end());
+        EXPECT_EQ(snapshot[0].get(), installed[0].get());
+        EXPECT_EQ(installed[0].use_count(), 2);
+
+        std::vector<KeyboardTypePtr> types = InputMethodProperty::ListKeyboardTypes(installed[1]);
+        EXPECT_EQ((int32_t)types.size(), TYPE_COUNT);
+        EXPECT_EQ(types[0].get(), installed[1]->mTypes[0]);
+
+        // the user is locked, or the packages are removed
+        std::u16string imeId = installed[1]->mImeId;
+        installed.clear();
+        EXPECT_EQ(snapshot[1]->mImeId, imeId);
+        snapshot.clear();
+        EXPECT_EQ(types[TYPE_COUNT - 1]->getHashCode(), TYPE_COUNT + TYPE_COUNT);
+    }
+
+    /**
+    * @tc.name: testListInputMethodMemory
+    * @tc.desc: List the IMEs 10k times, from PerUserSetting and from the service through its proxy and stub,
+    *           and checkout the resident memory stays flat. Built with AddressSanitizer, so a leak also fails
+    *           the run.
+    * @tc.type: PERF
+    */
+    HWTEST_F(InputMethodListTest, testListInputMethodMemory, TestSize.Level1)
+    {
+        const int32_t userId = 100;
+        const int32_t listCount = 10000;
+        const int32_t warmUpCount = 1000;
+        const int64_t maxGrowthKb = 1024;
+        Platform::Instance()->SetPlatform(new FakePlatformApi());
+        PerUserSetting setting(userId);
+        for (int32_t i = 0; i < IME_COUNT; i++) {
+            std::u16string packageName = Utils::to_utf16("com.example.ime" + std::to_string(i));
+            EXPECT_EQ(setting.OnPackageAdded(packageName, false), ErrorCode::NO_ERROR);
+        }
+
+        std::vector<InputMethodCatalogue::Extension> extensions = CreateExtensions();
+        sptr<InputMethodSystemAbility> ability = new InputMethodSystemAbility();
+        ability->SetCatalogue(std::make_unique<InputMethodCatalogue>(
+            [&](int32_t id, std::vector<InputMethodCatalogue::Extension> &result) {
+                result = extensions;
+                return true;
+            },
+            [&](const InputMethodCatalogue::Extension &extension, InputMethodCatalogue::Resources &resources) {
+                resources.label = "label" + std::to_string(extension.labelId);
+                resources.description = "description" + std::to_string(extension.descriptionId);
+                return true;
+            }));
+        sptr<InputMethodSystemAbilityProxy> proxy = new InputMethodSystemAbilityProxy(ability->AsObject());
+
+        int64_t residentKb = 0;
+        for (int32_t i = 0; i < listCount; i++) {
+            if (i == warmUpCount) {
+                residentKb = GetResidentKb();
+            }
+            std::vector<InputMethodPropertyPtr> installed;
+            EXPECT_EQ(setting.ListInputMethod(&installed), ErrorCode::NO_ERROR);
+            EXPECT_EQ((int32_t)installed.size(), IME_COUNT);
+            std::vector<KeyboardTypePtr> types = InputMethodProperty::ListKeyboardTypes(installed[i % IME_COUNT]);
+            EXPECT_EQ((int32_t)types.size(), FakePlatformApi::TYPE_COUNT);
+
+            std::vector<InputMethodPropertyPtr> listed;
+            EXPECT_EQ(ability->listInputMethodByUserId(userId, &listed), ErrorCode::NO_ERROR);
+            EXPECT_EQ((int32_t)listed.size(), EXTENSION_COUNT);
+
+            std::vector<InputMethodPropertyPtr> properties;
+            EXPECT_EQ(proxy->listInputMethod(&properties), ErrorCode::NO_ERROR);
+            EXPECT_EQ((int32_t)properties.size(), EXTENSION_COUNT);
+        }
+        int64_t growthKb = GetResidentKb() - residentKb;
+        printf("resident memory after %d lists: %+lld KB\n", listCount, (long long)growthKb);
+        EXPECT_LT(growthKb, maxGrowthKb);
+    }
+
+    /**
+    * @tc.name: testCatalogueInvalidate
+    * @tc.desc: Checkout the IME catalogue is built once, and only the changed bundles are resolved again
+    *           after a package event.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(InputMethodListTest, testCatalogueInvalidate, TestSize.Level0)
+    {
+        const int32_t userId = 100;
+        std::vector<InputMethodCatalogue::Extension> extensions = CreateExtensions();
+        int32_t queryCount = 0;
+        int32_t resolveCount = 0;
+        InputMethodCatalogue catalogue(
+            [&](int32_t id, std::vector<InputMethodCatalogue::Extension> &result) {
+                queryCount++;
+                result = extensions;
+                return id == userId;
+            },
+            [&](const InputMethodCatalogue::Extension &extension, InputMethodCatalogue::Resources &resources) {
+                resolveCount++;
+                resources.label = "label" + std::to_string(extension.labelId) + "v" +
+                    std::to_string(extension.versionCode);
+                return true;
+            });
+
+        std::vector<InputMethodPropertyPtr> first;
+        EXPECT_EQ(catalogue.List(userId, &first), ErrorCode::NO_ERROR);
+        std::vector<InputMethodPropertyPtr> second;
+        EXPECT_EQ(catalogue.List(userId, &second), ErrorCode::NO_ERROR);
+        EXPECT_EQ((int32_t)second.size(), EXTENSION_COUNT);
+        EXPECT_EQ(first[0].get(), second[0].get());
+        EXPECT_EQ(queryCount, 1);
+        EXPECT_EQ(resolveCount, EXTENSION_COUNT);
+        EXPECT_EQ(second[1]->label, u"label1v1");
+
+        // one bundle is updated, another one is removed
+        extensions[1].versionCode = 2;
+        extensions.pop_back();
+        catalogue.Invalidate(userId);
+        std::vector<InputMethodPropertyPtr> third;
+        EXPECT_EQ(catalogue.List(userId, &third), ErrorCode::NO_ERROR);
+        EXPECT_EQ((int32_t)third.size(), EXTENSION_COUNT - 1);
+        EXPECT_EQ(queryCount, 2);
+        EXPECT_EQ(resolveCount, EXTENSION_COUNT + 1);
+        EXPECT_EQ(third[1]->label, u"label1v2");
+        EXPECT_EQ(first[1]->label, u"label1v1");
+
+        std::vector<InputMethodPropertyPtr> other;
+        EXPECT_EQ(catalogue.List(userId + 1, &other), ErrorCode::ERROR_STATUS_UNKNOWN_ERROR);
+        EXPECT_TRUE(other.empty());
+    }
+
+    /**
+    * @tc.name: testCatalogueInvalidateDuringBuild
+    * @tc.desc: Checkout a package event coming while the list is built from the bundle manager is not lost,
+    *           and doesn't wait for the build.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(InputMethodListTest, testCatalogueInvalidateDuringBuild, TestSize.Level0)
+    {
+        const int32_t userId = 100;
+        std::vector<InputMethodCatalogue::Extension> extensions = CreateExtensions();
+        int32_t queryCount = 0;
+        InputMethodCatalogue *target = nullptr;
+        InputMethodCatalogue catalogue(
+            [&](int32_t id, std::vector<InputMethodCatalogue::Extension> &result) {
+                queryCount++;
+                result = extensions;
+                if (queryCount == 1) {
+                    // a package is installed while the bundle manager is queried
+                    extensions.pop_back();
+                    target->Invalidate(userId);
+                }
+                return true;
+            },
+            [&](const InputMethodCatalogue::Extension &extension, InputMethodCatalogue::Resources &resources) {
+                resources.label = "label" + std::to_string(extension.labelId);
+                return true;
+            });
+        target = &catalogue;
+
+        std::vector<InputMethodPropertyPtr> first;
+        EXPECT_EQ(catalogue.List(userId, &first), ErrorCode::NO_ERROR);
+        EXPECT_EQ((int32_t)first.size(), EXTENSION_COUNT);
+        std::vector<InputMethodPropertyPtr> second;
+        EXPECT_EQ(catalogue.List(userId, &second), ErrorCode::NO_ERROR);
+        EXPECT_EQ((int32_t)second.size(), EXTENSION_COUNT - 1);
+        std::vector<InputMethodPropertyPtr> third;
+        EXPECT_EQ(catalogue.List(userId, &third), ErrorCode::NO_ERROR);
+        EXPECT_EQ(queryCount, 2);
+        EXPECT_EQ(third[0].get(), second[0].get());
+    }
+
+    /**
+    * @tc.name: testCatalogueListCost
+    * @tc.desc: Compare listing 100 IME extensions from a mocked bundle manager and resource manager, cold
+    *           and from the catalogue.
+    * @tc.type: PERF
+    */
+    HWTEST_F(InputMethodListTest, testCatalogueListCost, TestSize.Level1)
+    {
+        const int32_t userId = 100;
+        const int32_t listCount = 100;
+        const std::chrono::microseconds resolveCost(20);
+        std::vector<InputMethodCatalogue::Extension> extensions = CreateExtensions();
+        InputMethodCatalogue catalogue(
+            [&](int32_t id, std::vector<InputMethodCatalogue::Extension> &result) {
+                result = extensions;
+                return true;
+            },
+            [&](const InputMethodCatalogue::Extension &extension, InputMethodCatalogue::Resources &resources) {
+                // loading a resource index and looking up the strings
+                auto end = std::chrono::steady_clock::now() + resolveCost;
+                while (std::chrono::steady_clock::now() < end) {
+                }
+                resources.label = "label" + std::to_string(extension.labelId);
+                resources.description = "description" + std::to_string(extension.descriptionId);
+                return true;
+            });
+
+        auto start = std::chrono::steady_clock::now();
+        for (int32_t i = 0; i < listCount; i++) {
+            std::vector<InputMethodPropertyPtr> properties;
+            catalogue.RemoveUser(userId);
+            EXPECT_EQ(catalogue.List(userId, &properties), ErrorCode::NO_ERROR);
+        }
+        auto coldNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count() / listCount;
+
+        start = std::chrono::steady_clock::now();
+        for (int32_t i = 0; i < listCount; i++) {
+            std::vector<InputMethodPropertyPtr> properties;
+            EXPECT_EQ(catalogue.List(userId, &properties), ErrorCode::NO_ERROR);
+            EXPECT_EQ((int32_t)properties.size(), EXTENSION_COUNT);
+        }
+        auto cachedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count() / listCount;
+        printf("list %d extensions: cold %lld ns, cached %lld ns\n", EXTENSION_COUNT, (long long)coldNs,
+            (long long)cachedNs);
+        EXPECT_LT(cachedNs, coldNs);
+    }
+} // namespace MiscServices
+} // namespace OHOS
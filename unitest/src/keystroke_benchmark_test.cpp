@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "event_handler.h"
+#include "event_runner.h"
+#include "fake_input_method_system_ability.h"
+#include "global.h"
+#include "input_method_ability.h"
+#include "input_method_controller.h"
+#include "js_input_method_engine_listener.h"
+#include "service_locator.h"
+#include "system_ability_definition.h"
+#include "trace_span.h"
+
+using namespace testing::ext;
+namespace OHOS {
+namespace MiscServices {
+    /*! The editor: records when the text and the keyboard status arrive */
+    class BenchTextListener : public OnTextChangedListener {
+    public:
+        void InsertText(const std::u16string& text) override
+        {
+            int64_t now = TraceRecorder::NowNs();
+            if (text != expectedText) {
+                mismatchCount++;
+            }
+            latencies.push_back(now - sentNs.load(std::memory_order_acquire));
+            lastArrivalNs = now;
+            insertCount.fetch_add(1, std::memory_order_release);
+        }
+        void DeleteForward(int32_t length) override {}
+        void DeleteBackward(int32_t length) override {}
+        void SendKeyEventFromInputMethod(const KeyEvent& event) override {}
+        void SendKeyboardInfo(const KeyboardInfo& info) override
+        {
+            if (info.GetKeyboardStatus() == KeyboardStatus::SHOW) {
+                showCount.fetch_add(1, std::memory_order_release);
+            }
+        }
+        void SetKeyboardStatus(bool status) override {}
+        void MoveCursor(const Direction direction) override {}
+
+        std::u16string expectedText = u"a";
+        std::atomic<int64_t> sentNs { 0 }; // when the keystroke being measured is sent by the IME
+        std::atomic<int32_t> insertCount { 0 };
+        std::atomic<int32_t> showCount { 0 };
+        std::vector<int64_t> latencies; // only touched by the work thread of the controller
+        int64_t lastArrivalNs = 0;
+        int32_t mismatchCount = 0;
+    };
+
+    /*! The real InputMethodController and InputMethodAbility of one process, bound by a local stand-in of
+      \n the service which ServiceLocator returns in place of it. The proxies call the local stubs directly,
+      \n so no binder driver is needed: the numbers are the marshalling, queueing, thread switching and
+      \n handler costs of the framework, without the binder transactions.
+    */
+    class KeystrokeBenchmarkTest : public testing::Test {
+    public:
+        static void SetUpTestCase(void);
+        static void TearDownTestCase(void);
+        void SetUp();
+        void TearDown();
+
+        static void Report(const char *name, std::vector<int64_t> &samples);
+        static void WaitFor(const std::atomic<int32_t> &count, int32_t expected);
+        void ShowKeyboard();
+
+        // the controller and the ability are singletons, they keep the service they find first
+        static sptr<FakeInputMethodSystemAbility> service_;
+        static sptr<InputMethodController> controller_;
+        static sptr<InputMethodAbility> ability_;
+        sptr<BenchTextListener> listener_;
+    };
+    sptr<FakeInputMethodSystemAbility> KeystrokeBenchmarkTest::service_;
+    sptr<InputMethodController> KeystrokeBenchmarkTest::controller_;
+    sptr<InputMethodAbility> KeystrokeBenchmarkTest::ability_;
+
+    void KeystrokeBenchmarkTest::SetUpTestCase(void)
+    {
+        IMSA_HILOGI("KeystrokeBenchmarkTest::SetUpTestCase");
+        service_ = new FakeInputMethodSystemAbility();
+        ServiceLocator::SetIsolated(true);
+        ServiceLocator::SetLocalAbility(INPUT_METHOD_SYSTEM_ABILITY_ID, service_);
+        ability_ = InputMethodAbility::GetInstance();
+        // there's no JS engine here: the JS callbacks are posted to a runner which never runs them
+        std::shared_ptr<AppExecFwk::EventHandler> jsHandler =
+            std::make_shared<AppExecFwk::EventHandler>(AppExecFwk::EventRunner::Create(false));
+        sptr<JsInputMethodEngineListener> imeListener = new JsInputMethodEngineListener(nullptr, jsHandler);
+        ability_->setImeListener(imeListener);
+        controller_ = InputMethodController::GetInstance();
+    }
+
+    void KeystrokeBenchmarkTest::TearDownTestCase(void)
+    {
+        IMSA_HILOGI("KeystrokeBenchmarkTest::TearDownTestCase");
+        ServiceLocator::Reset();
+    }
+
+    void KeystrokeBenchmarkTest::SetUp(void)
+    {
+        IMSA_HILOGI("KeystrokeBenchmarkTest::SetUp");
+        listener_ = new BenchTextListener();
+        sptr<OnTextChangedListener> listener = listener_;
+        controller_->Attach(listener);
+        WaitFor(listener_->showCount, 1);
+    }
+
+    void KeystrokeBenchmarkTest::TearDown(void)
+    {
+        IMSA_HILOGI("KeystrokeBenchmarkTest::TearDown");
+        controller_->Close();
+    }
+
+    /*! Print the percentiles of the samples, in microseconds
+    */
+    void KeystrokeBenchmarkTest::Report(const char *name, std::vector<int64_t> &samples)
+    {
+        if (samples.empty()) {
+            return;
+        }
+        const double nsPerUs = 1000.0;
+        std::sort(samples.begin(), samples.end());
+        auto percentile = [&samples, nsPerUs](int32_t p) {
+            const int32_t hundred = 100;
+            size_t index = std::min(samples.size() - 1, samples.size() * p / hundred);
+            return samples[index] / nsPerUs;
+        };
+        const int32_t p50 = 50;
+        const int32_t p90 = 90;
+        const int32_t p99 = 99;
+        printf("%-10s n = %zu p50 %.1f us | p90 %.1f us | p99 %.1f us | max %.1f us\n", name, samples.size(),
+            percentile(p50), percentile(p90), percentile(p99), samples.back() / nsPerUs);
+    }
+
+    void KeystrokeBenchmarkTest::WaitFor(const std::atomic<int32_t> &count, int32_t expected)
+    {
+        while (count.load(std::memory_order_acquire) < expected) {
+            std::this_thread::yield();
+        }
+    }
+
+    /*! Show the keyboard from the editor and wait until the editor is told the IME shows it
+    */
+    void KeystrokeBenchmarkTest::ShowKeyboard()
+    {
+        int32_t shown = listener_->showCount.load();
+        controller_->ShowTextInput();
+        WaitFor(listener_->showCount, shown + 1);
+    }
+
+    /**
+    * @tc.name: testShowKeyboardLatency
+    * @tc.desc: Measure the time from InputMethodController::ShowTextInput to the editor being told by
+    *           InputMethodAbility that the keyboard is shown.
+    * @tc.type: PERF
+    */
+    HWTEST_F(KeystrokeBenchmarkTest, testShowKeyboardLatency, TestSize.Level1)
+    {
+        const int32_t showCount = 1000;
+        int32_t shownBefore = listener_->showCount.load();
+        std::vector<int64_t> samples;
+        for (int32_t i = 0; i < showCount; i++) {
+            int64_t begin = TraceRecorder::NowNs();
+            ShowKeyboard();
+            samples.push_back(TraceRecorder::NowNs() - begin);
+        }
+        EXPECT_EQ(listener_->showCount.load() - shownBefore, showCount);
+        Report("show", samples);
+    }
+
+    /**
+    * @tc.name: testKeystrokeLatency
+    * @tc.desc: Type characters one by one by InputMethodAbility::InsertText, measure the time until each
+    *           one reaches OnTextChangedListener::InsertText of the editor.
+    * @tc.type: PERF
+    */
+    HWTEST_F(KeystrokeBenchmarkTest, testKeystrokeLatency, TestSize.Level1)
+    {
+        const int32_t warmUpCount = 100;
+        const int32_t typingCount = 10000;
+        for (int32_t i = 0; i < warmUpCount + typingCount; i++) {
+            listener_->sentNs.store(TraceRecorder::NowNs(), std::memory_order_release);
+            ASSERT_TRUE(ability_->InsertText("a"));
+            WaitFor(listener_->insertCount, i + 1);
+        }
+        std::vector<int64_t> samples(listener_->latencies.begin() + warmUpCount, listener_->latencies.end());
+        EXPECT_EQ(listener_->mismatchCount, 0);
+        EXPECT_EQ(samples.size(), static_cast<size_t>(typingCount));
+        Report("keystroke", samples);
+    }
+
+    /**
+    * @tc.name: testKeystrokeThroughput
+    * @tc.desc: Type a burst of characters by InputMethodAbility::InsertText without waiting, measure the
+    *           characters per second reaching the editor.
+    * @tc.type: PERF
+    */
+    HWTEST_F(KeystrokeBenchmarkTest, testKeystrokeThroughput, TestSize.Level1)
+    {
+        const int32_t typingCount = 100000;
+        int64_t begin = TraceRecorder::NowNs();
+        for (int32_t i = 0; i < typingCount; i++) {
+            ability_->InsertText("a");
+        }
+        WaitFor(listener_->insertCount, typingCount);
+        int64_t elapsedNs = listener_->lastArrivalNs - begin;
+        const double nsPerSecond = 1e9;
+        EXPECT_EQ(listener_->mismatchCount, 0);
+        printf("throughput %.0f events/s\n", typingCount * nsPerSecond / std::max<int64_t>(elapsedNs, 1));
+    }
+} // namespace MiscServices
+} // namespace OHOS
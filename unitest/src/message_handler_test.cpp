@@ -0,0 +1,840 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <gtest/gtest.h>
+#include <dlfcn.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "global.h"
+#include "input_data_channel_proxy.h"
+#include "input_data_channel_stub.h"
+#include "input_method_agent_stub.h"
+#include "message_handler.h"
+#include "user_message_router.h"
+
+namespace {
+    using MallocFunc = void *(*)(size_t);
+    using CallocFunc = void *(*)(size_t, size_t);
+    using ReallocFunc = void *(*)(void *, size_t);
+    using FreeFunc = void (*)(void *);
+
+    std::atomic<bool> g_countAllocations(false);
+    std::atomic<int32_t> g_allocationCount(0);
+
+    // dlsym may call calloc before the real calloc is known, it is served from here
+    const size_t BOOTSTRAP_HEAP_SIZE = 4096;
+    alignas(std::max_align_t) char g_bootstrapHeap[BOOTSTRAP_HEAP_SIZE];
+    size_t g_bootstrapUsed = 0;
+    bool g_resolvingCalloc = false;
+
+    void CountAllocation()
+    {
+        if (g_countAllocations.load(std::memory_order_relaxed)) {
+            g_allocationCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    bool IsBootstrapMemory(const void *ptr)
+    {
+        const char *address = static_cast<const char *>(ptr);
+        return address >= g_bootstrapHeap && address < g_bootstrapHeap + BOOTSTRAP_HEAP_SIZE;
+    }
+
+    template<typename Func>
+    Func GetRealFunc(const char *name)
+    {
+        Func func = reinterpret_cast<Func>(dlsym(RTLD_NEXT, name));
+        if (!func) {
+            abort();
+        }
+        return func;
+    }
+}
+
+/*! The allocations are counted at malloc, so operator new, the parcel buffers and
+  \n anything else which goes to the heap are all taken into account.
+*/
+extern "C" void *malloc(size_t size)
+{
+    static MallocFunc realMalloc = GetRealFunc<MallocFunc>("malloc");
+    CountAllocation();
+    return realMalloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+    static CallocFunc realCalloc = nullptr;
+    if (!realCalloc) {
+        if (g_resolvingCalloc) {
+            const size_t align = alignof(std::max_align_t);
+            size_t bytes = (count * size + align - 1) / align * align;
+            if (g_bootstrapUsed + bytes > BOOTSTRAP_HEAP_SIZE) {
+                return nullptr;
+            }
+            void *ptr = g_bootstrapHeap + g_bootstrapUsed;
+            g_bootstrapUsed += bytes;
+            return ptr;
+        }
+        g_resolvingCalloc = true;
+        realCalloc = GetRealFunc<CallocFunc>("calloc");
+        g_resolvingCalloc = false;
+    }
+    CountAllocation();
+    return realCalloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+    static ReallocFunc realRealloc = GetRealFunc<ReallocFunc>("realloc");
+    if (ptr && IsBootstrapMemory(ptr)) {
+        size_t offset = static_cast<size_t>(static_cast<char *>(ptr) - g_bootstrapHeap);
+        void *moved = malloc(size);
+        if (moved) {
+            memcpy(moved, ptr, std::min(size, BOOTSTRAP_HEAP_SIZE - offset));
+        }
+        return moved;
+    }
+    CountAllocation();
+    return realRealloc(ptr, size);
+}
+
+extern "C" void free(void *ptr)
+{
+    static FreeFunc realFree = GetRealFunc<FreeFunc>("free");
+    if (IsBootstrapMemory(ptr)) {
+        return;
+    }
+    realFree(ptr);
+}
+
+using namespace testing::ext;
+namespace OHOS {
+namespace MiscServices {
+    using namespace MessageID;
+    class MessageHandlerTest : public testing::Test {
+    public:
+        static void SetUpTestCase(void);
+        static void TearDownTestCase(void);
+        void SetUp();
+        void TearDown();
+
+        struct BenchResult {
+            int64_t enqueueNs; // average time spent in SendMessage
+            int64_t totalNs; // average time per message from the first send to the last receive
+        };
+        static BenchResult RunBench(MessageHandler::QueueMode mode, int32_t producers, int32_t count);
+        static int64_t GetStartInputLatencyP99(bool prioritized);
+        static int64_t RunUserDispatch(int32_t userCount, bool sharded);
+        static int64_t NowUs();
+    };
+
+    void MessageHandlerTest::SetUpTestCase(void)
+    {
+        IMSA_HILOGI("MessageHandlerTest::SetUpTestCase");
+    }
+
+    void MessageHandlerTest::TearDownTestCase(void)
+    {
+        IMSA_HILOGI("MessageHandlerTest::TearDownTestCase");
+    }
+
+    void MessageHandlerTest::SetUp(void)
+    {
+        IMSA_HILOGI("MessageHandlerTest::SetUp");
+    }
+
+    void MessageHandlerTest::TearDown(void)
+    {
+        IMSA_HILOGI("MessageHandlerTest::TearDown");
+    }
+
+    /*! Send count messages from each of the producers and drain them from the calling thread.
+      \n Every message carries its producer index in msgId_ and a sequence number in the parcel,
+      \n so the order of each producer is checked as well.
+    */
+    MessageHandlerTest::BenchResult MessageHandlerTest::RunBench(MessageHandler::QueueMode mode,
+        int32_t producers, int32_t count)
+    {
+        MessageHandler handler(mode);
+        std::atomic<int64_t> enqueueNs(0);
+        std::vector<std::thread> threads;
+        auto begin = std::chrono::steady_clock::now();
+        for (int32_t p = 0; p < producers; p++) {
+            threads.emplace_back([&handler, &enqueueNs, p, count] {
+                int64_t spent = 0;
+                for (int32_t i = 0; i < count; i++) {
+                    MessageParcel *parcel = new MessageParcel();
+                    parcel->WriteInt32(i);
+                    Message *msg = new Message(p, parcel);
+                    auto start = std::chrono::steady_clock::now();
+                    handler.SendMessage(msg);
+                    spent += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start).count();
+                }
+                enqueueNs += spent;
+            });
+        }
+
+        std::vector<int32_t> next(producers, 0);
+        int32_t total = producers * count;
+        for (int32_t i = 0; i < total; i++) {
+            MessagePtr msg = handler.GetMessage();
+            int32_t seq = msg->msgContent_->ReadInt32();
+            EXPECT_EQ(seq, next[msg->msgId_]);
+            next[msg->msgId_] = seq + 1;
+        }
+        auto end = std::chrono::steady_clock::now();
+        for (auto &thread : threads) {
+            thread.join();
+        }
+
+        BenchResult result;
+        result.enqueueNs = enqueueNs / total;
+        result.totalNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() / total;
+        return result;
+    }
+
+    int64_t MessageHandlerTest::NowUs()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /*! Send START_INPUT requests while package add/remove events keep the work thread busy.
+      \return p99 of the time from sending a START_INPUT to the work thread getting it, in us
+    */
+    int64_t MessageHandlerTest::GetStartInputLatencyP99(bool prioritized)
+    {
+        const int32_t startInputCount = 200;
+        const int32_t packageEventCount = 10; // package events sent before each START_INPUT
+        const int64_t packageEventCostUs = 100; // time the work thread spends on a package event
+        const int64_t intervalUs = 800; // less than the cost of the package events, so a backlog builds up
+        const int32_t percentile = 99;
+        const int32_t percent = 100;
+        MessageHandler handler(MessageHandler::QUEUE_MODE_LOCK_FREE,
+            prioritized ? MessageHandler::FLAG_PRIORITIZED : 0);
+        std::vector<int64_t> latencies;
+        std::thread worker([&handler, &latencies, startInputCount, packageEventCostUs] {
+            while (static_cast<int32_t>(latencies.size()) < startInputCount) {
+                MessagePtr msg = handler.GetMessage();
+                if (msg->msgId_ == MSG_ID_START_INPUT) {
+                    latencies.push_back(NowUs() - msg->msgContent_->ReadInt64());
+                    continue;
+                }
+                int64_t end = NowUs() + packageEventCostUs;
+                while (NowUs() < end) {
+                }
+            }
+        });
+
+        for (int32_t i = 0; i < startInputCount; i++) {
+            for (int32_t j = 0; j < packageEventCount; j++) {
+                handler.SendMessage(handler.ObtainMessage(j % 2 ? MSG_ID_PACKAGE_REMOVED : MSG_ID_PACKAGE_ADDED));
+            }
+            MessagePtr msg = handler.ObtainMessage(MSG_ID_START_INPUT);
+            msg->msgContent_->WriteInt64(NowUs());
+            handler.SendMessage(std::move(msg));
+            std::this_thread::sleep_for(std::chrono::microseconds(intervalUs));
+        }
+        worker.join();
+        std::sort(latencies.begin(), latencies.end());
+        return latencies[latencies.size() * percentile / percent];
+    }
+
+    /*! Send client messages of userCount users, each from its own binder thread, to the per-user work threads.
+      \param sharded true - messages are sent to the handler of the user directly
+      \n             false - messages go through a global work thread which forwards them to the user
+      \return throughput in messages per millisecond
+    */
+    int64_t MessageHandlerTest::RunUserDispatch(int32_t userCount, bool sharded)
+    {
+        const int32_t messageCount = 20000; // messages of each user
+        const int64_t sessionCostNs = 2000; // time a per-user work thread spends on a message
+        std::vector<MessageHandler*> handlers;
+        for (int32_t i = 0; i < userCount; i++) {
+            handlers.push_back(new MessageHandler(MessageHandler::QUEUE_MODE_LOCK_FREE));
+        }
+        MessageHandler global(MessageHandler::QUEUE_MODE_LOCK_FREE);
+        UserMessageRouter router(&global);
+        for (int32_t i = 0; i < userCount && sharded; i++) {
+            router.AddHandler(i, [&handlers, i] { return handlers[i]; });
+        }
+        std::vector<std::thread> threads;
+        auto begin = std::chrono::steady_clock::now();
+        for (int32_t i = 0; i < userCount; i++) {
+            threads.emplace_back([&handlers, i, sessionCostNs] {
+                while (true) {
+                    MessagePtr msg = handlers[i]->GetMessage();
+                    if (msg->msgId_ == MSG_ID_EXIT_SERVICE) {
+                        return;
+                    }
+                    auto end = std::chrono::steady_clock::now() + std::chrono::nanoseconds(sessionCostNs);
+                    while (std::chrono::steady_clock::now() < end) {
+                    }
+                }
+            });
+        }
+        std::thread dispatcher;
+        if (!sharded) {
+            dispatcher = std::thread([&handlers, &global, userCount] {
+                int32_t exited = 0;
+                while (exited < userCount) {
+                    MessagePtr msg = global.GetMessage();
+                    int32_t userId = msg->msgContent_->ReadInt32();
+                    exited += (msg->msgId_ == MSG_ID_EXIT_SERVICE) ? 1 : 0;
+                    handlers[userId]->SendMessage(std::move(msg));
+                }
+            });
+        }
+        std::vector<std::thread> binders;
+        for (int32_t i = 0; i < userCount; i++) {
+            binders.emplace_back([&handlers, &global, &router, i, sharded, messageCount] {
+                MessageHandler *pool = sharded ? handlers[i] : &global;
+                for (int32_t j = 0; j <= messageCount; j++) {
+                    MessagePtr msg = pool->ObtainMessage(j < messageCount ? MSG_ID_START_INPUT : MSG_ID_EXIT_SERVICE);
+                    msg->msgContent_->WriteInt32(i);
+                    if (sharded) {
+                        router.Dispatch(i, msg.release()); // as InputMethodSystemAbility::DispatchUserMessage does
+                    } else {
+                        global.SendMessage(std::move(msg));
+                    }
+                }
+            });
+        }
+        for (auto &thread : binders) {
+            thread.join();
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        int64_t elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - begin).count();
+        if (dispatcher.joinable()) {
+            dispatcher.join();
+        }
+        router.RemoveAll();
+        for (auto handler : handlers) {
+            delete handler;
+        }
+        return static_cast<int64_t>(messageCount) * userCount / (elapsedMs ? elapsedMs : 1);
+    }
+
+    /**
+    * @tc.name: testLockFreeQueueOrder
+    * @tc.desc: Checkout the lock-free queue keeps the order of each producer, including ring overflow.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(MessageHandlerTest, testLockFreeQueueOrder, TestSize.Level0)
+    {
+        MessageHandler handler(MessageHandler::QUEUE_MODE_LOCK_FREE);
+        const int32_t count = MessageRing::DEFAULT_CAPACITY * 3;
+        for (int32_t i = 0; i < count; i++) {
+            handler.SendMessage(new Message(i, nullptr));
+        }
+        for (int32_t i = 0; i < count; i++) {
+            MessagePtr msg = handler.GetMessage();
+            EXPECT_EQ(msg->msgId_, i);
+        }
+    }
+
+    /**
+    * @tc.name: testTypingPathWithoutAllocation
+    * @tc.desc: Type 10k characters through InputDataChannelStub and the work queue of the controller,
+    *           checkout no malloc, calloc or realloc call happens after warm-up.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(MessageHandlerTest, testTypingPathWithoutAllocation, TestSize.Level0)
+    {
+        const int32_t warmUpCount = 100;
+        const int32_t typingCount = 10000;
+        MessageHandler *handler = new MessageHandler(MessageHandler::QUEUE_MODE_LOCK_FREE);
+        sptr<InputDataChannelStub> channel = new InputDataChannelStub();
+        channel->SetHandler(handler);
+        const std::u16string text = u"a";
+        int32_t mismatchCount = 0;
+        auto typeOneChar = [&channel, &handler, &text, &mismatchCount] {
+            channel->InsertText(text);
+            MessagePtr msg = handler->GetMessage();
+            if (msg->msgId_ != MSG_ID_INSERT_CHAR || msg->msgContent_->ReadString16() != text) {
+                mismatchCount++;
+            }
+        };
+
+        for (int32_t i = 0; i < warmUpCount; i++) {
+            typeOneChar();
+        }
+        uint32_t createdCount = handler->GetMessagePool()->GetCreatedCount();
+        g_allocationCount = 0;
+        g_countAllocations = true;
+        for (int32_t i = 0; i < typingCount; i++) {
+            typeOneChar();
+        }
+        g_countAllocations = false;
+
+        EXPECT_EQ(mismatchCount, 0);
+        EXPECT_EQ(g_allocationCount.load(), 0);
+        EXPECT_EQ(handler->GetMessagePool()->GetCreatedCount(), createdCount);
+        channel->SetHandler(nullptr);
+        delete handler;
+    }
+
+    /**
+    * @tc.name: testTypingThroughProxy
+    * @tc.desc: Type 10k characters from the IME side: InputDataChannelProxy, InputDataChannelStub and the work
+    *           queue of the controller. The only heap allocations allowed after warm-up are the ones the IPC
+    *           framework makes to write and check the interface token, the text and the edit id of a request.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(MessageHandlerTest, testTypingThroughProxy, TestSize.Level0)
+    {
+        const int32_t warmUpCount = 100;
+        const int32_t typingCount = 10000;
+        MessageHandler *handler = new MessageHandler(MessageHandler::QUEUE_MODE_LOCK_FREE);
+        sptr<InputDataChannelStub> channel = new InputDataChannelStub();
+        channel->SetHandler(handler);
+        sptr<InputDataChannelProxy> proxy = new InputDataChannelProxy(channel->AsObject());
+        const std::u16string text = u"a";
+        int32_t mismatchCount = 0;
+        auto typeOneChar = [&proxy, &handler, &text, &mismatchCount] {
+            proxy->InsertText(text);
+            MessagePtr msg = handler->GetMessage();
+            if (msg->msgId_ != MSG_ID_INSERT_CHAR || msg->msgContent_->ReadString16() != text) {
+                mismatchCount++;
+            }
+        };
+        // what the proxy and the stub ask from MessageParcel for one request
+        bool tokenMatched = true;
+        auto parcelOnly = [&text, &tokenMatched] {
+            MessageParcel data;
+            data.WriteInterfaceToken(InputDataChannelProxy::GetDescriptor());
+            data.WriteString16(text);
+            data.WriteUint64(1);
+            tokenMatched = data.ReadInterfaceToken() == InputDataChannelStub::GetDescriptor() && tokenMatched;
+            tokenMatched = data.ReadString16() == text && tokenMatched;
+            tokenMatched = data.ReadUint64() == 1 && tokenMatched;
+        };
+
+        for (int32_t i = 0; i < warmUpCount; i++) {
+            typeOneChar();
+            parcelOnly();
+        }
+        g_allocationCount = 0;
+        g_countAllocations = true;
+        for (int32_t i = 0; i < typingCount; i++) {
+            parcelOnly();
+        }
+        g_countAllocations = false;
+        int32_t parcelAllocations = g_allocationCount.load();
+        uint32_t createdCount = handler->GetMessagePool()->GetCreatedCount();
+        g_allocationCount = 0;
+        g_countAllocations = true;
+        for (int32_t i = 0; i < typingCount; i++) {
+            typeOneChar();
+        }
+        g_countAllocations = false;
+
+        EXPECT_TRUE(tokenMatched);
+        EXPECT_EQ(mismatchCount, 0);
+        EXPECT_EQ(g_allocationCount.load(), parcelAllocations);
+        EXPECT_EQ(handler->GetMessagePool()->GetCreatedCount(), createdCount);
+        channel->SetHandler(nullptr);
+        delete handler;
+    }
+
+    /**
+    * @tc.name: testMessageLane
+    * @tc.desc: Checkout the lanes of show/hide keyboard, ime lifecycle and package events.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(MessageHandlerTest, testMessageLane, TestSize.Level0)
+    {
+        EXPECT_EQ(MessageHandler::GetLane(MSG_ID_START_INPUT), MessageLane::LANE_INTERACTIVE);
+        EXPECT_EQ(MessageHandler::GetLane(MSG_HIDE_CURRENT_INPUT), MessageLane::LANE_INTERACTIVE);
+        EXPECT_EQ(MessageHandler::GetLane(MSG_ID_SET_CORE_AND_AGENT), MessageLane::LANE_INTERACTIVE);
+        EXPECT_EQ(MessageHandler::GetLane(MSG_ID_RESTART_IMS), MessageLane::LANE_INTERACTIVE);
+        EXPECT_EQ(MessageHandler::GetLane(MSG_ID_CLIENT_DIED), MessageLane::LANE_INTERACTIVE);
+        EXPECT_EQ(MessageHandler::GetLane(MSG_ID_IMS_DIED), MessageLane::LANE_INTERACTIVE);
+        EXPECT_EQ(MessageHandler::GetLane(MSG_ID_DISPLAY_OPTIONAL_INPUT_METHOD), MessageLane::LANE_LIFECYCLE);
+        EXPECT_EQ(MessageHandler::GetLane(MSG_ID_PACKAGE_ADDED), MessageLane::LANE_HOUSEKEEPING);
+    }
+
+    /**
+    * @tc.name: testDeathFollowsItsObject
+    * @tc.desc: Checkout the death of a client or an ime is handled after the earlier requests about it,
+    *           and the package events queued before them are still overtaken.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(MessageHandlerTest, testDeathFollowsItsObject, TestSize.Level0)
+    {
+        const int32_t sent[] = {
+            MSG_ID_PACKAGE_ADDED, MSG_ID_SET_CORE_AND_AGENT, MSG_ID_PREPARE_INPUT, MSG_ID_START_INPUT,
+            MSG_ID_CLIENT_DIED, MSG_ID_IMS_DIED, MSG_ID_RESTART_IMS
+        };
+        const int32_t expected[] = {
+            MSG_ID_SET_CORE_AND_AGENT, MSG_ID_PREPARE_INPUT, MSG_ID_START_INPUT, MSG_ID_CLIENT_DIED,
+            MSG_ID_IMS_DIED, MSG_ID_RESTART_IMS, MSG_ID_PACKAGE_ADDED
+        };
+        MessageHandler handler(MessageHandler::QUEUE_MODE_LOCK_FREE, MessageHandler::FLAG_PRIORITIZED);
+        for (int32_t msgId : sent) {
+            handler.SendMessage(new Message(msgId, nullptr));
+        }
+        for (int32_t msgId : expected) {
+            MessagePtr msg = handler.GetMessage();
+            EXPECT_EQ(msg->msgId_, msgId);
+        }
+    }
+
+    /**
+    * @tc.name: testPriorityLaneStarvation
+    * @tc.desc: Checkout interactive requests overtake package events, but a burst of them does not starve
+    *           the package events.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(MessageHandlerTest, testPriorityLaneStarvation, TestSize.Level0)
+    {
+        const int32_t interactiveCount = 100;
+        const int32_t maxWait = 16;
+        MessageHandler handler(MessageHandler::QUEUE_MODE_LOCK_FREE, MessageHandler::FLAG_PRIORITIZED);
+        handler.SendMessage(new Message(MSG_ID_PACKAGE_ADDED, nullptr));
+        for (int32_t i = 0; i < interactiveCount; i++) {
+            handler.SendMessage(new Message(MSG_ID_START_INPUT, nullptr));
+        }
+        int32_t position = -1;
+        for (int32_t i = 0; i <= interactiveCount; i++) {
+            MessagePtr msg = handler.GetMessage();
+            if (msg->msgId_ == MSG_ID_PACKAGE_ADDED) {
+                position = i;
+            }
+        }
+        EXPECT_GT(position, 0);
+        EXPECT_LE(position, maxWait);
+    }
+
+    /**
+    * @tc.name: testCursorUpdateCoalescing
+    * @tc.desc: Send a burst of 1000 cursor updates through InputMethodAgentStub while the work thread is busy,
+    *           checkout only the latest one is delivered.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(MessageHandlerTest, testCursorUpdateCoalescing, TestSize.Level0)
+    {
+        const int32_t burstCount = 1000;
+        const int32_t height = 20;
+        MessageHandler handler(MessageHandler::QUEUE_MODE_LOCK_FREE, MessageHandler::FLAG_COALESCING);
+        sptr<InputMethodAgentStub> agent = new InputMethodAgentStub();
+        agent->SetMessageHandler(&handler);
+        for (int32_t i = 0; i < burstCount; i++) {
+            agent->OnCursorUpdate(i, i + 1, height);
+        }
+        handler.SendMessage(new Message(MSG_ID_EXIT_SERVICE, nullptr));
+
+        MessagePtr msg = handler.GetMessage();
+        EXPECT_EQ(msg->msgId_, MSG_ID_ON_CURSOR_UPDATE);
+        EXPECT_EQ(msg->msgContent_->ReadInt32(), burstCount - 1);
+        EXPECT_EQ(msg->msgContent_->ReadInt32(), burstCount);
+        EXPECT_EQ(msg->msgContent_->ReadInt32(), height);
+        msg = handler.GetMessage();
+        EXPECT_EQ(msg->msgId_, MSG_ID_EXIT_SERVICE);
+        EXPECT_EQ(handler.GetDeliveredCount(), 2u);
+        EXPECT_EQ(handler.GetCoalescedCount(), static_cast<uint64_t>(burstCount - 1));
+
+        agent->OnCursorUpdate(0, 0, height);
+        EXPECT_EQ(handler.GetMessage()->msgContent_->ReadInt32(), 0);
+        EXPECT_EQ(handler.GetCoalescedCount(), static_cast<uint64_t>(burstCount - 1));
+        agent->SetMessageHandler(nullptr);
+    }
+
+    /**
+    * @tc.name: testCoalescedStartFollowsRelease
+    * @tc.desc: Send START, RELEASE, PREPARE and START of one client, checkout the second START is served after
+    *           the RELEASE and the PREPARE, and the first one is dropped.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(MessageHandlerTest, testCoalescedStartFollowsRelease, TestSize.Level0)
+    {
+        int32_t client = 0;
+        const uint64_t key = MessageHandler::MakeCoalesceKey(MSG_ID_START_INPUT, &client);
+        const int32_t sent[] = { MSG_ID_START_INPUT, MSG_ID_RELEASE_INPUT, MSG_ID_PREPARE_INPUT, MSG_ID_START_INPUT };
+        const int32_t expected[] = { MSG_ID_RELEASE_INPUT, MSG_ID_PREPARE_INPUT, MSG_ID_START_INPUT };
+        for (auto mode : { MessageHandler::QUEUE_MODE_MUTEX, MessageHandler::QUEUE_MODE_LOCK_FREE }) {
+            MessageHandler handler(mode, MessageHandler::FLAG_PRIORITIZED | MessageHandler::FLAG_COALESCING);
+            for (int32_t msgId : sent) {
+                Message *msg = new Message(msgId, nullptr);
+                msg->coalesceKey_ = msgId == MSG_ID_START_INPUT ? key : 0;
+                handler.SendMessage(msg);
+            }
+            for (int32_t msgId : expected) {
+                EXPECT_EQ(handler.GetMessage()->msgId_, msgId);
+            }
+            EXPECT_EQ(handler.GetCoalescedCount(), 1u);
+            EXPECT_EQ(handler.GetDeliveredCount(), 3u);
+        }
+    }
+
+    /**
+    * @tc.name: testSelectionChangeCoalescing
+    * @tc.desc: Send three selection changes while the work thread is busy, checkout the delivered one goes from
+    *           the selection of the first change to the selection of the last one.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(MessageHandlerTest, testSelectionChangeCoalescing, TestSize.Level0)
+    {
+        MessageHandler handler(MessageHandler::QUEUE_MODE_LOCK_FREE, MessageHandler::FLAG_COALESCING);
+        handler.SetMerger(MSG_ID_ON_SELECTION_CHANGE, InputMethodAgentStub::MergeSelectionChange);
+        sptr<InputMethodAgentStub> agent = new InputMethodAgentStub();
+        agent->SetMessageHandler(&handler);
+        agent->OnSelectionChange(u"abc", 0, 0, 1, 1);
+        agent->OnSelectionChange(u"abc", 1, 1, 2, 2);
+        agent->OnSelectionChange(u"abcd", 2, 2, 0, 4);
+
+        MessagePtr msg = handler.GetMessage();
+        EXPECT_EQ(msg->msgId_, MSG_ID_ON_SELECTION_CHANGE);
+        EXPECT_EQ(msg->msgContent_->ReadString16(), u"abcd");
+        EXPECT_EQ(msg->msgContent_->ReadInt32(), 0);
+        EXPECT_EQ(msg->msgContent_->ReadInt32(), 0);
+        EXPECT_EQ(msg->msgContent_->ReadInt32(), 0);
+        EXPECT_EQ(msg->msgContent_->ReadInt32(), 4);
+        EXPECT_EQ(handler.GetCoalescedCount(), 2u);
+        EXPECT_EQ(handler.GetDeliveredCount(), 1u);
+        agent->SetMessageHandler(nullptr);
+    }
+
+    /**
+    * @tc.name: testStartInputLatencyUnderLoad
+    * @tc.desc: Compare p99 StartInput latency of the FIFO queue and the prioritized queue under a background
+    *           load of package add/remove events, and checkout a queued StartInput is served before the backlog.
+    * @tc.type: PERF
+    */
+    HWTEST_F(MessageHandlerTest, testStartInputLatencyUnderLoad, TestSize.Level1)
+    {
+        const int32_t backlog = 10;
+        int64_t fifoP99 = GetStartInputLatencyP99(false);
+        int64_t prioritizedP99 = GetStartInputLatencyP99(true);
+        printf("StartInput p99 latency: fifo %lld us, prioritized %lld us\n", (long long)fifoP99,
+            (long long)prioritizedP99);
+
+        for (bool prioritized : { false, true }) {
+            MessageHandler handler(MessageHandler::QUEUE_MODE_LOCK_FREE,
+                prioritized ? MessageHandler::FLAG_PRIORITIZED : 0);
+            for (int32_t i = 0; i < backlog; i++) {
+                handler.SendMessage(new Message(i % 2 ? MSG_ID_PACKAGE_REMOVED : MSG_ID_PACKAGE_ADDED, nullptr));
+            }
+            handler.SendMessage(new Message(MSG_ID_START_INPUT, nullptr));
+            int32_t position = 0;
+            while (handler.GetMessage()->msgId_ != MSG_ID_START_INPUT) {
+                position++;
+            }
+            EXPECT_EQ(position, prioritized ? 0 : backlog);
+        }
+    }
+
+    /**
+    * @tc.name: testQueueModeBenchmark
+    * @tc.desc: Compare the enqueue and end-to-end latency of the mutex queue and the lock-free queue
+    *           with 1 to 16 producer threads.
+    * @tc.type: PERF
+    */
+    HWTEST_F(MessageHandlerTest, testQueueModeBenchmark, TestSize.Level1)
+    {
+        const int32_t messageCount = 100000;
+        for (int32_t producers = 1; producers <= 16; producers *= 2) {
+            int32_t count = messageCount / producers;
+            BenchResult mutexResult = RunBench(MessageHandler::QUEUE_MODE_MUTEX, producers, count);
+            BenchResult ringResult = RunBench(MessageHandler::QUEUE_MODE_LOCK_FREE, producers, count);
+            printf("producers %2d: mutex enqueue %5lld ns total %5lld ns | lock-free enqueue %5lld ns total %5lld ns\n",
+                producers, (long long)mutexResult.enqueueNs, (long long)mutexResult.totalNs,
+                (long long)ringResult.enqueueNs, (long long)ringResult.totalNs);
+        }
+    }
+
+    /**
+    * @tc.name: testShardedDispatchBenchmark
+    * @tc.desc: Compare the throughput of client messages of N concurrent users, forwarded by the global
+    *           work thread or sent to the work threads of the users directly.
+    * @tc.type: PERF
+    */
+    HWTEST_F(MessageHandlerTest, testShardedDispatchBenchmark, TestSize.Level1)
+    {
+        int32_t maxUsers = std::max(2, static_cast<int32_t>(std::thread::hardware_concurrency()));
+        for (int32_t users = 1; users <= maxUsers; users *= 2) {
+            int64_t forwarded = RunUserDispatch(users, false);
+            int64_t sharded = RunUserDispatch(users, true);
+            printf("users %2d: forwarded %6lld msg/ms | sharded %6lld msg/ms\n", users, (long long)forwarded,
+                (long long)sharded);
+        }
+    }
+
+    /**
+    * @tc.name: testDispatchKeepsClientOrder
+    * @tc.desc: Dispatch client messages of a user while its work thread is being created, checkout the thread
+    *           gets them in order, and the messages take the direct way once the service thread has caught up.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(MessageHandlerTest, testDispatchKeepsClientOrder, TestSize.Level0)
+    {
+        const int32_t userId = 100;
+        const int32_t count = 1000;
+        MessageHandler global(MessageHandler::QUEUE_MODE_LOCK_FREE);
+        MessageHandler session(MessageHandler::QUEUE_MODE_LOCK_FREE);
+        UserMessageRouter router(&global);
+        auto dispatch = [&router, userId](int32_t seq) {
+            MessageParcel *parcel = new MessageParcel();
+            parcel->WriteInt32(userId);
+            parcel->WriteInt32(seq);
+            router.Dispatch(userId, new Message(MSG_ID_START_INPUT, parcel));
+        };
+        std::thread service;
+        for (int32_t i = 0; i < count; i++) {
+            if (i == count / 2) {
+                router.AddHandler(userId, [&session] { return &session; });
+                // the service thread catches up while the rest are dispatched
+                service = std::thread([&global, &router] {
+                    while (true) {
+                        MessagePtr msg = global.GetMessage();
+                        if (msg->msgId_ == MSG_ID_EXIT_SERVICE) {
+                            return;
+                        }
+                        int32_t id = msg->msgContent_->ReadInt32();
+                        router.HandOver(id, std::move(msg));
+                    }
+                });
+            }
+            dispatch(i);
+        }
+        global.SendMessage(new Message(MSG_ID_EXIT_SERVICE, nullptr));
+        service.join();
+
+        int32_t mismatchCount = 0;
+        for (int32_t i = 0; i < count; i++) {
+            MessagePtr msg = session.GetMessage();
+            mismatchCount += (msg->msgContent_->ReadInt32() != i) ? 1 : 0;
+        }
+        EXPECT_EQ(mismatchCount, 0);
+        EXPECT_EQ(router.GetForwardingCount(userId), 0);
+
+        // nothing is on the way any more, so it's sent to the session directly, the service thread has exited
+        dispatch(count);
+        EXPECT_EQ(router.GetForwardingCount(userId), 0);
+        EXPECT_EQ(session.GetMessage()->msgContent_->ReadInt32(), count);
+        router.RemoveAll();
+    }
+
+    /**
+    * @tc.name: testDispatchThroughCoalescingService
+    * @tc.desc: Dispatch a start input and its stop input of a client before its user has a work thread, through a
+    *           coalescing service thread as the service has, checkout both are handed over and the user takes the
+    *           direct way afterwards.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(MessageHandlerTest, testDispatchThroughCoalescingService, TestSize.Level0)
+    {
+        const int32_t userId = 100;
+        MessageHandler global(MessageHandler::QUEUE_MODE_LOCK_FREE, MessageHandler::FLAG_COALESCING);
+        MessageHandler session(MessageHandler::QUEUE_MODE_LOCK_FREE);
+        UserMessageRouter router(&global);
+        int32_t client = 0;
+        auto dispatch = [&router, &client, userId](int32_t msgId) {
+            MessageParcel *parcel = new MessageParcel();
+            parcel->WriteInt32(userId);
+            Message *msg = new Message(msgId, parcel);
+            msg->coalesceKey_ = MessageHandler::MakeCoalesceKey(MSG_ID_START_INPUT, &client);
+            router.Dispatch(userId, msg);
+        };
+        dispatch(MSG_ID_START_INPUT);
+        dispatch(MSG_ID_STOP_INPUT);
+        EXPECT_EQ(router.GetForwardingCount(userId), 2);
+
+        router.AddHandler(userId, [&session] { return &session; });
+        global.SendMessage(new Message(MSG_ID_EXIT_SERVICE, nullptr));
+        while (true) {
+            MessagePtr msg = global.GetMessage();
+            if (msg->msgId_ == MSG_ID_EXIT_SERVICE) {
+                break;
+            }
+            int32_t id = msg->msgContent_->ReadInt32();
+            EXPECT_TRUE(router.HandOver(id, std::move(msg)));
+        }
+        EXPECT_EQ(router.GetForwardingCount(userId), 0);
+        EXPECT_EQ(session.GetMessage()->msgId_, MSG_ID_START_INPUT);
+        EXPECT_EQ(session.GetMessage()->msgId_, MSG_ID_STOP_INPUT);
+
+        dispatch(MSG_ID_START_INPUT);
+        EXPECT_EQ(router.GetForwardingCount(userId), 0);
+        EXPECT_EQ(session.GetMessage()->msgId_, MSG_ID_START_INPUT);
+        router.RemoveAll();
+    }
+
+    /**
+    * @tc.name: testDisabledLogLevel
+    * @tc.desc: Checkout the arguments of a log below the runtime log level are not evaluated.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(MessageHandlerTest, testDisabledLogLevel, TestSize.Level0)
+    {
+        int32_t evaluatedCount = 0;
+        auto argument = [&evaluatedCount] {
+            return ++evaluatedCount;
+        };
+        SetLogLevel(IMSA_LOG_LEVEL_INFO);
+        IMSA_HILOGD("MessageHandlerTest::testDisabledLogLevel %{public}d", argument());
+        EXPECT_EQ(evaluatedCount, 0);
+        IMSA_HILOGW("MessageHandlerTest::testDisabledLogLevel %{public}d", argument());
+        EXPECT_EQ(evaluatedCount, 1);
+        SetLogLevel(IMSA_LOG_LEVEL_DEBUG);
+        IMSA_HILOGD("MessageHandlerTest::testDisabledLogLevel %{public}d", argument());
+        EXPECT_EQ(evaluatedCount, IMSA_LOG_LEVEL_MIN <= IMSA_LOG_LEVEL_DEBUG ? 2 : 1);
+        SetLogLevel(IMSA_LOG_LEVEL_INFO);
+    }
+
+    /**
+    * @tc.name: testKeystrokeLogCost
+    * @tc.desc: Compare the time of typing a character through InputDataChannelStub and the work queue of
+    *           the controller, with the debug logs of the typing path enabled and disabled at runtime.
+    * @tc.type: PERF
+    */
+    HWTEST_F(MessageHandlerTest, testKeystrokeLogCost, TestSize.Level1)
+    {
+        const int32_t typingCount = 10000;
+        MessageHandler *handler = new MessageHandler(MessageHandler::QUEUE_MODE_LOCK_FREE);
+        sptr<InputDataChannelStub> channel = new InputDataChannelStub();
+        channel->SetHandler(handler);
+        const std::u16string text = u"a";
+        auto typeChars = [&channel, &handler, &text, typingCount] {
+            auto begin = std::chrono::steady_clock::now();
+            for (int32_t i = 0; i < typingCount; i++) {
+                channel->InsertText(text);
+                handler->GetMessage();
+            }
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - begin).count() / typingCount;
+        };
+
+        typeChars();
+        SetLogLevel(IMSA_LOG_LEVEL_DEBUG);
+        int64_t loggedNs = typeChars();
+        SetLogLevel(IMSA_LOG_LEVEL_INFO);
+        int64_t gatedNs = typeChars();
+        printf("keystroke: debug logs %lld ns | gated %lld ns\n", (long long)loggedNs, (long long)gatedNs);
+        channel->SetHandler(nullptr);
+        delete handler;
+    }
+} // namespace MiscServices
+} // namespace OHOS
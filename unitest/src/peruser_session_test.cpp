@@ -0,0 +1,716 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "global.h"
+#include "i_input_client.h"
+#include "i_input_method_core.h"
+#include "ime_launcher.h"
+#include "input_attribute.h"
+#include "input_method_agent_stub.h"
+#include "input_method_property.h"
+#include "input_method_setting.h"
+#include "keyboard_type.h"
+#include "message.h"
+#include "message_handler.h"
+#include "message_parcel.h"
+#include "peruser_session.h"
+#include "utils.h"
+
+using namespace testing::ext;
+namespace OHOS {
+namespace MiscServices {
+    /*! An input client which counts the agents it's sent */
+    class CountingClient : public IPCObjectStub {
+    public:
+        explicit CountingClient(std::atomic<int32_t> &readyCount)
+            : IPCObjectStub(u"ohos.miscservices.inputmethod.CountingClient"), readyCount_(readyCount) {}
+        ~CountingClient() = default;
+
+        int OnRemoteRequest(uint32_t code, MessageParcel &data, MessageParcel &reply, MessageOption &option) override
+        {
+            if (code == IInputClient::ON_INPUT_READY) {
+                readyCount_++;
+            }
+            return NO_ERROR;
+        }
+
+    private:
+        std::atomic<int32_t> &readyCount_;
+    };
+
+    /*! An input client which is slow to take the agent, or can't be reached at all */
+    class FaultyClient : public IPCObjectStub {
+    public:
+        FaultyClient(int32_t delayMs, bool reachable)
+            : IPCObjectStub(u"ohos.miscservices.inputmethod.FaultyClient"), delayMs_(delayMs), reachable_(reachable) {}
+        ~FaultyClient() = default;
+
+        int OnRemoteRequest(uint32_t code, MessageParcel &data, MessageParcel &reply, MessageOption &option) override
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(delayMs_));
+            return reachable_ ? NO_ERROR : ErrorCode::ERROR_STATUS_FAILED_TRANSACTION;
+        }
+
+    private:
+        int32_t delayMs_;
+        bool reachable_;
+    };
+
+    /*! An input method service which counts the calls from the session */
+    class FakeIme : public IPCObjectStub {
+    public:
+        FakeIme() : IPCObjectStub(u"ohos.miscservices.inputmethod.FakeIme") {}
+        ~FakeIme() = default;
+
+        int OnRemoteRequest(uint32_t code, MessageParcel &data, MessageParcel &reply, MessageOption &option) override
+        {
+            if (code == IInputMethodCore::SET_KEYBOARD_TYPE) {
+                std::unique_ptr<KeyboardType> type(data.ReadParcelable<KeyboardType>());
+                keyboardType = type ? type->getHashCode() : 0;
+            }
+            if (code < CODE_COUNT) {
+                calls_[code]++;
+            }
+            if (code == IInputMethodCore::INITIALIZE_INPUT) {
+                auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(MAX_HOLD_MS);
+                while (holdInitialize.load() && std::chrono::steady_clock::now() < deadline) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+                initializeReturns++;
+            }
+            reply.WriteInt32(ErrorCode::NO_ERROR);
+            return NO_ERROR;
+        }
+
+        int32_t GetCalls(uint32_t code)
+        {
+            return code < CODE_COUNT ? calls_[code].load() : 0;
+        }
+
+        std::atomic<int32_t> keyboardType {0}; // the hash code of the keyboard type set last
+        std::atomic<bool> holdInitialize {false}; // initializeInput blocks the caller until it's cleared
+        std::atomic<int32_t> initializeReturns {0}; // the calls to initializeInput returned to the caller
+
+    private:
+        static constexpr uint32_t CODE_COUNT = 16;
+        static constexpr int32_t MAX_HOLD_MS = 5000; // a getter waiting for the work thread fails, not hangs
+        std::atomic<int32_t> calls_[CODE_COUNT] {};
+    };
+
+    class PerUserSessionTest : public testing::Test {
+    public:
+        static constexpr int32_t USER_ID = 100;
+        static constexpr int32_t FIRST_TYPE = 1;
+        static constexpr int32_t SECOND_TYPE = 2;
+        static constexpr int32_t FOCUSED_PID = 1000;
+        static constexpr int32_t BACKGROUND_CLIENT_COUNT = 200;
+
+        static void SetUpTestCase(void);
+        static void TearDownTestCase(void);
+        void SetUp();
+        void TearDown();
+
+        void StartSession();
+        void StopSession();
+        void SetDisplayMode(int32_t mode);
+        bool WaitDisplayMode(int32_t mode);
+        bool WaitWorkThread();
+        void ConnectIme();
+        void ConnectIme(const std::u16string &packageName);
+        bool WaitImeCalls(size_t index, uint32_t code);
+        sptr<FakeIme> GetIme(size_t index);
+        sptr<IRemoteObject> PrepareClient(int32_t pid);
+        sptr<IRemoteObject> PrepareClient(int32_t pid, const sptr<IRemoteObject> &client);
+        static InputMethodProperty *NewIme(const InputMethodProperty &source);
+        void StartInput(const sptr<IRemoteObject> &client);
+
+        InputMethodProperty ime;
+        InputMethodSetting setting;
+        std::unique_ptr<MessageHandler> handler;
+        std::unique_ptr<PerUserSession> session;
+        std::shared_ptr<ImeLauncher> launcher;
+        std::mutex imesLock;
+        std::vector<sptr<FakeIme>> imes; // the input method services connected, in order
+        std::atomic<int32_t> readyCount {0};
+        std::vector<sptr<IRemoteObject>> clientObjects;
+    };
+
+    void PerUserSessionTest::SetUpTestCase(void)
+    {
+        IMSA_HILOGI("PerUserSessionTest::SetUpTestCase");
+    }
+
+    void PerUserSessionTest::TearDownTestCase(void)
+    {
+        IMSA_HILOGI("PerUserSessionTest::TearDownTestCase");
+    }
+
+    void PerUserSessionTest::SetUp(void)
+    {
+        IMSA_HILOGI("PerUserSessionTest::SetUp");
+        ime.mImeId = u"com.example.ime/ImeService";
+        ime.mPackageName = u"com.example.ime";
+        for (int32_t id : {FIRST_TYPE, SECOND_TYPE}) {
+            KeyboardType *type = new KeyboardType();
+            type->setId(id);
+            ime.mTypes.push_back(type);
+        }
+        setting.SetCurrentKeyboardType(SECOND_TYPE);
+        StartSession();
+    }
+
+    void PerUserSessionTest::TearDown(void)
+    {
+        IMSA_HILOGI("PerUserSessionTest::TearDown");
+        StopSession();
+    }
+
+    /*! Create the session of the user and start its work thread
+    */
+    void PerUserSessionTest::StartSession()
+    {
+        handler = std::make_unique<MessageHandler>();
+        session = std::make_unique<PerUserSession>(USER_ID);
+        session->SetInputMethodSetting(&setting);
+        session->SetCurrentIme(&ime);
+        session->CreateWorkThread(*handler);
+    }
+
+    /*! Stop the work thread and destroy the session with the clients prepared in it
+    */
+    void PerUserSessionTest::StopSession()
+    {
+        handler->SendMessage(new Message(MSG_ID_EXIT_SERVICE, nullptr));
+        session->JoinWorkThread();
+        session.reset();
+        handler.reset();
+        launcher.reset();
+        clientObjects.clear();
+        readyCount.store(0);
+        std::lock_guard<std::mutex> lock(imesLock);
+        imes.clear();
+    }
+
+    /*! Send a display mode change to the work thread, as the input control channel does
+    \param mode 0 - part screen mode, 1 - full screen mode
+    */
+    void PerUserSessionTest::SetDisplayMode(int32_t mode)
+    {
+        MessageParcel *parcel = new MessageParcel();
+        parcel->WriteInt32(mode);
+        handler->SendMessage(new Message(MSG_ID_SET_DISPLAY_MODE, parcel));
+    }
+
+    /*! Wait till the work thread publishes the display mode
+    \param mode the display mode expected
+    \return true - the mode is published in time
+    */
+    bool PerUserSessionTest::WaitDisplayMode(int32_t mode)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        while (session->GetDisplayMode() != mode) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                return false;
+            }
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    /*! Wait till the work thread handles all the messages sent before
+    \return true - the messages are handled in time
+    */
+    bool PerUserSessionTest::WaitWorkThread()
+    {
+        int32_t mode = 1 - session->GetDisplayMode();
+        SetDisplayMode(mode);
+        return WaitDisplayMode(mode);
+    }
+
+    /*! Connect a fake input method service to the session, as it does once its ability is started
+    */
+    void PerUserSessionTest::ConnectIme()
+    {
+        ConnectIme(ime.mPackageName);
+    }
+
+    /*! Connect a fake input method service of a given bundle to the session
+    \param packageName the bundle of the service
+    */
+    void PerUserSessionTest::ConnectIme(const std::u16string &packageName)
+    {
+        sptr<FakeIme> core = new FakeIme();
+        sptr<InputMethodAgentStub> agent = new InputMethodAgentStub();
+        MessageParcel *parcel = new MessageParcel();
+        parcel->WriteRemoteObject(core->AsObject());
+        parcel->WriteRemoteObject(agent->AsObject());
+        parcel->WriteString16(packageName);
+        parcel->WriteInt32(getpid());
+        // listed once its connection is queued, so a message sent after the lookup is handled after it
+        std::lock_guard<std::mutex> lock(imesLock);
+        handler->SendMessage(new Message(MSG_ID_SET_CORE_AND_AGENT, parcel));
+        imes.push_back(core);
+    }
+
+    /*! Get a fake input method service connected
+    \param index the order of the connection, from 0
+    \return the service, or nullptr if it's not connected yet
+    */
+    sptr<FakeIme> PerUserSessionTest::GetIme(size_t index)
+    {
+        std::lock_guard<std::mutex> lock(imesLock);
+        return index < imes.size() ? imes[index] : nullptr;
+    }
+
+    /*! Wait till a fake input method service is connected and called by the session
+    \param index the order of the connection, from 0
+    \param code the call expected
+    \return true - the call is received in time
+    */
+    bool PerUserSessionTest::WaitImeCalls(size_t index, uint32_t code)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        for (;;) {
+            sptr<FakeIme> core = GetIme(index);
+            if (core && core->GetCalls(code) > 0) {
+                return true;
+            }
+            if (std::chrono::steady_clock::now() > deadline) {
+                return false;
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    /*! Register an input client to the session, as InputMethodController::PrepareInput does
+    \param pid the process id of the client
+    \return the remote object of the client
+    */
+    sptr<IRemoteObject> PerUserSessionTest::PrepareClient(int32_t pid)
+    {
+        return PrepareClient(pid, new CountingClient(readyCount));
+    }
+
+    /*! Register a given input client to the session
+    \param pid the process id of the client
+    \param client the remote object of the client
+    \return the remote object of the client
+    */
+    sptr<IRemoteObject> PerUserSessionTest::PrepareClient(int32_t pid, const sptr<IRemoteObject> &client)
+    {
+        sptr<IRemoteObject> channel = new IPCObjectStub(u"ohos.miscservices.inputmethod.InputDataChannel");
+        InputAttribute attribute;
+        MessageParcel *parcel = new MessageParcel();
+        parcel->WriteInt32(pid);
+        parcel->WriteInt32(pid);
+        parcel->WriteInt32(0);
+        parcel->WriteRemoteObject(client);
+        parcel->WriteRemoteObject(channel);
+        parcel->WriteParcelable(&attribute);
+        handler->SendMessage(new Message(MSG_ID_PREPARE_INPUT, parcel));
+        clientObjects.push_back(client);
+        clientObjects.push_back(channel);
+        return client;
+    }
+
+    /*! Create an ime with the same id and keyboard types as the given one, each type a new object
+    \param source the ime copied
+    */
+    InputMethodProperty *PerUserSessionTest::NewIme(const InputMethodProperty &source)
+    {
+        InputMethodProperty *property = new InputMethodProperty();
+        property->mImeId = source.mImeId;
+        property->mPackageName = source.mPackageName;
+        for (const KeyboardType *type : source.mTypes) {
+            property->mTypes.push_back(new KeyboardType(*type));
+        }
+        return property;
+    }
+
+    /*! Ask the session to show the keyboard for an input client
+    \param client the remote object of the client
+    */
+    void PerUserSessionTest::StartInput(const sptr<IRemoteObject> &client)
+    {
+        MessageParcel *parcel = new MessageParcel();
+        parcel->WriteRemoteObject(client);
+        handler->SendMessage(new Message(MSG_ID_START_INPUT, parcel));
+    }
+
+
+    /**
+    * @tc.name: testSnapshotGetters
+    * @tc.desc: Checkout the getters read the state published by the work thread and the setting callbacks.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(PerUserSessionTest, testSnapshotGetters, TestSize.Level0)
+    {
+        KeyboardTypePtr type = session->GetCurrentKeyboardType();
+        ASSERT_NE(type, nullptr);
+        EXPECT_EQ(type->getHashCode(), SECOND_TYPE);
+        EXPECT_EQ(session->GetDisplayMode(), 0);
+        EXPECT_EQ(session->GetKeyboardWindowHeight(0), ErrorCode::ERROR_IME_NOT_STARTED);
+
+        SetDisplayMode(1);
+        EXPECT_TRUE(WaitDisplayMode(1));
+
+        session->ResetIme(nullptr, nullptr);
+        EXPECT_EQ(session->GetCurrentKeyboardType(), nullptr);
+        session->ResetIme(&ime, nullptr);
+        type = session->GetCurrentKeyboardType();
+        ASSERT_NE(type, nullptr);
+        EXPECT_EQ(type->getHashCode(), SECOND_TYPE);
+
+        // the ime is replaced and freed, as when its package is updated: the type got before is still valid
+        InputMethodProperty *updated = NewIme(ime);
+        session->ResetIme(updated, nullptr);
+        KeyboardTypePtr updatedType = session->GetCurrentKeyboardType();
+        session->ResetIme(&ime, nullptr);
+        delete updated;
+        ASSERT_NE(updatedType, nullptr);
+        EXPECT_EQ(updatedType->getHashCode(), SECOND_TYPE);
+        EXPECT_EQ(type->getHashCode(), SECOND_TYPE);
+    }
+
+    /**
+    * @tc.name: testConcurrentGetters
+    * @tc.desc: Checkout binder threads read a consistent state without lock, while the work thread and the
+    *           setting callbacks change it, and the imes replaced are freed with their keyboard types.
+    *           It's expected to be clean under ThreadSanitizer and AddressSanitizer.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(PerUserSessionTest, testConcurrentGetters, TestSize.Level1)
+    {
+        constexpr int32_t readerCount = 4;
+        constexpr int32_t changeCount = 2000;
+        std::atomic<bool> stop(false);
+        std::atomic<int32_t> badReads(0);
+        std::atomic<int64_t> reads(0);
+
+        std::vector<std::thread> readers;
+        for (int32_t i = 0; i < readerCount; i++) {
+            readers.emplace_back([&]() {
+                while (!stop.load()) {
+                    int32_t mode = session->GetDisplayMode();
+                    KeyboardTypePtr type = session->GetCurrentKeyboardType();
+                    int32_t ret = session->GetKeyboardWindowHeight(0);
+                    if ((mode != 0 && mode != 1) || (type && type->getHashCode() != SECOND_TYPE) ||
+                        ret != ErrorCode::ERROR_IME_NOT_STARTED) {
+                        badReads++;
+                    }
+                    reads++;
+                }
+            });
+        }
+        std::thread setter([&]() {
+            InputMethodProperty *previous = nullptr;
+            for (int32_t i = 0; i < changeCount; i++) {
+                InputMethodProperty *next = (i % 2) ? NewIme(ime) : nullptr;
+                session->ResetIme(next, nullptr);
+                delete previous;
+                previous = next;
+            }
+            session->ResetIme(&ime, nullptr);
+            delete previous;
+        });
+        for (int32_t i = 0; i < changeCount; i++) {
+            SetDisplayMode(i % 2);
+        }
+        SetDisplayMode(1);
+        setter.join();
+        EXPECT_TRUE(WaitDisplayMode(1));
+        stop.store(true);
+        for (auto &reader : readers) {
+            reader.join();
+        }
+
+        EXPECT_EQ(badReads.load(), 0);
+        EXPECT_GT(reads.load(), 0);
+        KeyboardTypePtr type = session->GetCurrentKeyboardType();
+        ASSERT_NE(type, nullptr);
+        EXPECT_EQ(type->getHashCode(), SECOND_TYPE);
+    }
+
+    /**
+    * @tc.name: testGettersDuringSlowStart
+    * @tc.desc: Checkout the getters called by binder threads return while the work thread is still blocked in
+    *           StartInputMethod by an ime slow to initialize.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(PerUserSessionTest, testGettersDuringSlowStart, TestSize.Level1)
+    {
+        constexpr int32_t readCount = 100;
+        ConnectIme();
+        ASSERT_TRUE(WaitWorkThread());
+        sptr<FakeIme> core = GetIme(0);
+        ASSERT_TRUE(core != nullptr);
+        int32_t initializeCount = core->GetCalls(IInputMethodCore::INITIALIZE_INPUT);
+        int32_t returnCount = core->initializeReturns.load();
+        core->holdInitialize.store(true);
+
+        MessageParcel *parcel = new MessageParcel();
+        parcel->WriteInt32(0);
+        parcel->WriteString16(ime.mImeId);
+        handler->SendMessage(new Message(MSG_ID_RESTART_IMS, parcel));
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        while (core->GetCalls(IInputMethodCore::INITIALIZE_INPUT) == initializeCount) {
+            ASSERT_LT(std::chrono::steady_clock::now(), deadline);
+            std::this_thread::yield();
+        }
+
+        // the work thread is in initializeInput, holding imeLock, until holdInitialize is cleared
+        for (int32_t i = 0; i < readCount; i++) {
+            session->GetDisplayMode();
+            KeyboardTypePtr type = session->GetCurrentKeyboardType();
+            session->GetKeyboardWindowHeight(0);
+            EXPECT_NE(type, nullptr);
+        }
+        EXPECT_EQ(core->initializeReturns.load(), returnCount);
+        core->holdInitialize.store(false);
+        EXPECT_TRUE(WaitWorkThread());
+        EXPECT_GT(core->initializeReturns.load(), returnCount);
+    }
+
+    /**
+    * @tc.name: testLazyHandshake
+    * @tc.desc: Checkout a client gets the agent only when it starts input in lazy handshake mode, a restarted IME
+    *           sends its agent to the client with the input focus only, and it's sent once per agent.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(PerUserSessionTest, testLazyHandshake, TestSize.Level0)
+    {
+        session->SetLazyHandshake(true);
+        ConnectIme();
+        sptr<IRemoteObject> focused = PrepareClient(FOCUSED_PID);
+        sptr<IRemoteObject> background = PrepareClient(FOCUSED_PID + 1);
+        ASSERT_TRUE(WaitWorkThread());
+        EXPECT_EQ(readyCount.load(), 0);
+
+        StartInput(focused);
+        ASSERT_TRUE(WaitWorkThread());
+        EXPECT_EQ(readyCount.load(), 1);
+
+        // the IME restarts
+        ConnectIme();
+        ASSERT_TRUE(WaitWorkThread());
+        EXPECT_EQ(readyCount.load(), 2);
+        EXPECT_EQ(session->GetLastBroadcast().deferredCount, 1);
+
+        StartInput(background);
+        StartInput(background);
+        StartInput(focused);
+        ASSERT_TRUE(WaitWorkThread());
+        EXPECT_EQ(readyCount.load(), 3);
+    }
+
+    /**
+    * @tc.name: testHandshakeCost
+    * @tc.desc: Measure the agent handshakes and the broadcast time of a restarted IME with many background clients,
+    *           in eager and lazy handshake modes.
+    * @tc.type: PERF
+    */
+    HWTEST_F(PerUserSessionTest, testHandshakeCost, TestSize.Level1)
+    {
+        int32_t handshakes[2] = {0, 0};
+        for (bool lazy : {false, true}) {
+            session->SetLazyHandshake(lazy);
+            ConnectIme();
+            for (int32_t i = 1; i <= BACKGROUND_CLIENT_COUNT; i++) {
+                PrepareClient(FOCUSED_PID + i);
+            }
+            StartInput(PrepareClient(FOCUSED_PID));
+            // the IME restarts, the agent is broadcast again
+            ConnectIme();
+            ASSERT_TRUE(WaitWorkThread());
+            handshakes[lazy] = readyCount.load();
+            BroadcastReport report = session->GetLastBroadcast();
+            EXPECT_EQ(report.clientCount, BACKGROUND_CLIENT_COUNT + 1);
+            EXPECT_EQ(report.deferredCount, lazy ? BACKGROUND_CLIENT_COUNT : 0);
+            EXPECT_TRUE(report.failedPids.empty());
+            printf("%s handshake, %d background clients: %d handshakes, broadcast in %lld us\n",
+                lazy ? "lazy" : "eager", BACKGROUND_CLIENT_COUNT, handshakes[lazy], (long long)report.costUs);
+            StopSession();
+            StartSession();
+        }
+        EXPECT_EQ(handshakes[0], (BACKGROUND_CLIENT_COUNT + 1) * 2);
+        EXPECT_EQ(handshakes[1], 2);
+    }
+
+    /**
+    * @tc.name: testCrashRecovery
+    * @tc.desc: Kill the input method service while the keyboard is shown, and measure the time until the
+    *           restarted one shows the keyboard again, with the keyboard type and the input attribute replayed.
+    * @tc.type: PERF
+    */
+    HWTEST_F(PerUserSessionTest, testCrashRecovery, TestSize.Level1)
+    {
+        // the security ime is the default one, so the keyboard types are taken from the ime itself
+        setting.SetCurrentKeyboardType(FIRST_TYPE);
+        session->SetSecurityIme(&ime);
+        // the ime connects in the ability start, the connection timeout is not needed
+        launcher = std::make_shared<ImeLauncher>(
+            [this](const std::string &imeId) {
+                ConnectIme();
+                return true;
+            },
+            [](std::function<void()> task, int64_t delayMs) {});
+        session->SetImeLauncher(launcher);
+        launcher->Launch("com.example.ime/ImeService");
+        sptr<IRemoteObject> client = PrepareClient(FOCUSED_PID);
+        StartInput(client);
+        ASSERT_TRUE(WaitWorkThread());
+        sptr<FakeIme> crashed = GetIme(0);
+        ASSERT_NE(crashed, nullptr);
+        EXPECT_EQ(crashed->GetCalls(IInputMethodCore::SHOW_KEYBOARD), 1);
+
+        // the user switches the keyboard type while typing, then the ime crashes
+        EXPECT_EQ(session->OnSettingChanged(InputMethodSetting::CURRENT_KEYBOARD_TYPE_TAG, u"2"), ErrorCode::NO_ERROR);
+        EXPECT_EQ(crashed->keyboardType.load(), SECOND_TYPE);
+        auto begin = std::chrono::steady_clock::now();
+        MessageParcel *parcel = new MessageParcel();
+        parcel->WriteRemoteObject(crashed->AsObject());
+        handler->SendMessage(new Message(MSG_ID_IMS_DIED, parcel));
+
+        sptr<FakeIme> restarted = nullptr;
+        bool restored = false;
+        auto deadline = begin + std::chrono::seconds(1);
+        while (!restored && std::chrono::steady_clock::now() < deadline) {
+            restarted = GetIme(1);
+            restored = restarted && restarted->GetCalls(IInputMethodCore::SHOW_KEYBOARD) > 0;
+            std::this_thread::yield();
+        }
+        auto cost = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin);
+        ASSERT_TRUE(restored);
+        printf("keyboard restored %lld us after the ime died\n", (long long)cost.count());
+        EXPECT_EQ(restarted->GetCalls(IInputMethodCore::START_INPUT), 1);
+        EXPECT_EQ(restarted->keyboardType.load(), SECOND_TYPE);
+        EXPECT_EQ(readyCount.load(), 2);
+
+        ASSERT_TRUE(WaitWorkThread());
+        EXPECT_EQ(launcher->GetState(), ImeLauncher::STATE_CONNECTED);
+        EXPECT_EQ(launcher->GetMetrics().attempts, 1);
+    }
+
+    /**
+    * @tc.name: testStandbySwitchLatency
+    * @tc.desc: Compare switching to an IME launched on demand with switching to an IME kept in standby, both
+    *           through the work thread of the session. The ability start of an IME is modelled by a fixed cost.
+    * @tc.type: PERF
+    */
+    HWTEST_F(PerUserSessionTest, testStandbySwitchLatency, TestSize.Level1)
+    {
+        const int32_t switchCount = 5;
+        const std::chrono::milliseconds startCost(20);
+        const int64_t budgetKb = 1 << 30;
+        const std::string imeIds[] = {
+            "com.example.ime/ImeService", "com.example.ime1/ImeService", "com.example.ime2/ImeService"
+        };
+        std::atomic<int32_t> startCount {0};
+        // the standby starts run out of the work thread, as in the service handler
+        struct Starters {
+            std::mutex lock;
+            std::vector<std::thread> threads;
+            ~Starters()
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                for (auto &thread : threads) {
+                    thread.join();
+                }
+            }
+        } starters;
+        launcher = std::make_shared<ImeLauncher>(
+            [&](const std::string &imeId) {
+                std::this_thread::sleep_for(startCost);
+                startCount++;
+                ConnectIme(Utils::to_utf16(imeId.substr(0, imeId.find('/'))));
+                return true;
+            },
+            [&starters](std::function<void()> task, int64_t delayMs) {
+                // the checks after the connection timeout are not needed here
+                if (delayMs == 0) {
+                    std::lock_guard<std::mutex> guard(starters.lock);
+                    starters.threads.emplace_back(task);
+                }
+            },
+            [this](const std::string &imeId, uint64_t launchId) {
+                MessageParcel *parcel = new MessageParcel();
+                parcel->WriteString16(Utils::to_utf16(imeId));
+                parcel->WriteUint64(launchId);
+                handler->SendMessage(new Message(MSG_ID_CHECK_STANDBY_IME, parcel));
+            });
+        session->SetImeLauncher(launcher);
+        launcher->Launch(imeIds[0]);
+        StartInput(PrepareClient(FOCUSED_PID));
+        ASSERT_TRUE(WaitImeCalls(0, IInputMethodCore::SHOW_KEYBOARD));
+
+        int64_t coldUs = 0;
+        int64_t standbyUs = 0;
+        size_t connected = 1;
+        int32_t current = 0;
+        for (int32_t i = 0; i < switchCount; i++) {
+            int32_t cold = (current + 1) % 3;
+            auto begin = std::chrono::steady_clock::now();
+            MessageParcel *parcel = new MessageParcel();
+            parcel->WriteString16(Utils::to_utf16(imeIds[cold]));
+            handler->SendMessage(new Message(MSG_ID_SWITCH_IME, parcel));
+            ASSERT_TRUE(WaitImeCalls(connected, IInputMethodCore::INIT_INPUT_CONTROL_CHANNEL));
+            coldUs += std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - begin).count();
+            connected++;
+
+            int32_t standby = (current + 2) % 3;
+            parcel = new MessageParcel();
+            parcel->WriteString16(Utils::to_utf16(imeIds[standby]));
+            parcel->WriteInt64(budgetKb);
+            handler->SendMessage(new Message(MSG_ID_SET_STANDBY_IME, parcel));
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+            while (!GetIme(connected) && std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::yield();
+            }
+            ASSERT_TRUE(WaitWorkThread());
+
+            begin = std::chrono::steady_clock::now();
+            parcel = new MessageParcel();
+            parcel->WriteString16(Utils::to_utf16(imeIds[standby]));
+            handler->SendMessage(new Message(MSG_ID_SWITCH_IME, parcel));
+            ASSERT_TRUE(WaitImeCalls(connected, IInputMethodCore::SHOW_KEYBOARD));
+            standbyUs += std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - begin).count();
+            connected++;
+            current = standby;
+        }
+        printf("switch IME: launched %lld us, standby %lld us\n", (long long)(coldUs / switchCount),
+            (long long)(standbyUs / switchCount));
+        EXPECT_EQ(startCount.load(), 1 + switchCount * 2);
+        EXPECT_EQ(launcher->GetImeId(), imeIds[current]);
+        EXPECT_EQ(launcher->GetState(), ImeLauncher::STATE_CONNECTED);
+        EXPECT_LT(standbyUs, coldUs);
+        StopSession();
+        StartSession();
+    }
+} // namespace MiscServices
+} // namespace OHOS
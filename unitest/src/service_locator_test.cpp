@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "event_handler.h"
+#include "event_runner.h"
+#include "fake_input_method_system_ability.h"
+#include "global.h"
+#include "input_data_channel_proxy.h"
+#include "input_method_ability.h"
+#include "input_method_controller.h"
+#include "js_input_method_engine_listener.h"
+#include "service_locator.h"
+#include "system_ability_definition.h"
+
+using namespace testing::ext;
+namespace OHOS {
+namespace MiscServices {
+    class CountingTextListener : public OnTextChangedListener {
+    public:
+        void InsertText(const std::u16string& text) override
+        {
+            std::lock_guard<std::mutex> lock(lock_);
+            this->text += text;
+            insertCount.fetch_add(1);
+        }
+        void DeleteForward(int32_t length) override {}
+        void DeleteBackward(int32_t length) override {}
+        void SendKeyEventFromInputMethod(const KeyEvent& event) override {}
+        void SendKeyboardInfo(const KeyboardInfo& info) override
+        {
+            if (info.GetKeyboardStatus() == KeyboardStatus::SHOW) {
+                showCount.fetch_add(1);
+            }
+        }
+        void SetKeyboardStatus(bool status) override {}
+        void MoveCursor(const Direction direction) override {}
+
+        std::u16string GetText()
+        {
+            std::lock_guard<std::mutex> lock(lock_);
+            return text;
+        }
+
+        std::mutex lock_;
+        std::u16string text;
+        std::atomic<int32_t> insertCount { 0 };
+        std::atomic<int32_t> showCount { 0 };
+    };
+
+    class ServiceLocatorTest : public testing::Test {
+    public:
+        static void SetUpTestCase(void);
+        static void TearDownTestCase(void);
+        void SetUp();
+        void TearDown();
+
+        static bool WaitUntil(const std::function<bool()> &condition);
+
+        // the controller and the ability are singletons, they keep the service they find first
+        static sptr<FakeInputMethodSystemAbility> service_;
+    };
+    sptr<FakeInputMethodSystemAbility> ServiceLocatorTest::service_;
+
+    void ServiceLocatorTest::SetUpTestCase(void)
+    {
+        IMSA_HILOGI("ServiceLocatorTest::SetUpTestCase");
+        service_ = new FakeInputMethodSystemAbility();
+        ServiceLocator::SetIsolated(true);
+        ServiceLocator::SetLocalAbility(INPUT_METHOD_SYSTEM_ABILITY_ID, service_);
+    }
+
+    void ServiceLocatorTest::TearDownTestCase(void)
+    {
+        IMSA_HILOGI("ServiceLocatorTest::TearDownTestCase");
+        ServiceLocator::Reset();
+        service_ = nullptr;
+    }
+
+    void ServiceLocatorTest::SetUp(void)
+    {
+        IMSA_HILOGI("ServiceLocatorTest::SetUp");
+    }
+
+    void ServiceLocatorTest::TearDown(void)
+    {
+        IMSA_HILOGI("ServiceLocatorTest::TearDown");
+    }
+
+    /*! Poll the condition for up to one second
+    \return true if the condition is met
+    */
+    bool ServiceLocatorTest::WaitUntil(const std::function<bool()> &condition)
+    {
+        const int32_t waitCount = 1000;
+        for (int32_t i = 0; i < waitCount; i++) {
+            if (condition()) {
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return condition();
+    }
+
+    /**
+    * @tc.name: testLocalAbility
+    * @tc.desc: Checkout a local object is returned in place of the system ability, and nothing is found
+    *           in the isolated mode once it's removed.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(ServiceLocatorTest, testLocalAbility, TestSize.Level0)
+    {
+        EXPECT_TRUE(ServiceLocator::GetSystemAbility(INPUT_METHOD_SYSTEM_ABILITY_ID) == service_);
+        EXPECT_TRUE(ServiceLocator::GetSystemAbility(BUNDLE_MGR_SERVICE_SYS_ABILITY_ID) == nullptr);
+        sptr<IRemoteObject> object = new FakeInputMethodSystemAbility();
+        ServiceLocator::SetLocalAbility(BUNDLE_MGR_SERVICE_SYS_ABILITY_ID, object);
+        EXPECT_TRUE(ServiceLocator::GetSystemAbility(BUNDLE_MGR_SERVICE_SYS_ABILITY_ID) == object);
+        ServiceLocator::SetLocalAbility(BUNDLE_MGR_SERVICE_SYS_ABILITY_ID, nullptr);
+        EXPECT_TRUE(ServiceLocator::GetSystemAbility(BUNDLE_MGR_SERVICE_SYS_ABILITY_ID) == nullptr);
+    }
+
+    /**
+    * @tc.name: testControllerWithLocalService
+    * @tc.desc: Run InputMethodController against a local stand-in of the service, checkout the service
+    *           receives prepareInput and startInput, and the text typed into the data channel it got
+    *           reaches the editor.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(ServiceLocatorTest, testControllerWithLocalService, TestSize.Level0)
+    {
+        sptr<InputMethodController> controller = InputMethodController::GetInstance();
+        sptr<OnTextChangedListener> listener = new CountingTextListener();
+        controller->Attach(listener);
+        EXPECT_TRUE(service_->HasReceived(IInputMethodSystemAbility::PREPARE_INPUT));
+        EXPECT_TRUE(service_->HasReceived(IInputMethodSystemAbility::START_INPUT));
+        sptr<IRemoteObject> dataChannel = service_->GetDataChannel();
+        ASSERT_TRUE(dataChannel != nullptr);
+
+        // what the IME does once the service passes the channel to it
+        sptr<IInputDataChannel> channel = new InputDataChannelProxy(dataChannel);
+        const int32_t typingCount = 3;
+        for (int32_t i = 0; i < typingCount; i++) {
+            channel->InsertText(u"a");
+        }
+        CountingTextListener *counter = static_cast<CountingTextListener *>(listener.GetRefPtr());
+        EXPECT_TRUE(WaitUntil([counter] { return counter->insertCount.load() >= typingCount; }));
+        EXPECT_EQ(counter->GetText(), u"aaa");
+        controller->Close();
+    }
+
+    /**
+    * @tc.name: testControllerServiceAbilityPipeline
+    * @tc.desc: Run the real InputMethodController and InputMethodAbility of one process against the local
+    *           service: the IME registers its core and agent, the editor shown gets the keyboard shown by
+    *           the IME, the text typed by the IME reaches the editor, and the text of the editor reaches the
+    *           IME through its agent.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(ServiceLocatorTest, testControllerServiceAbilityPipeline, TestSize.Level0)
+    {
+        sptr<InputMethodAbility> ability = InputMethodAbility::GetInstance();
+        EXPECT_TRUE(service_->HasReceived(IInputMethodSystemAbility::SET_CORE_AND_AGENT));
+        // there's no JS engine here: the JS callbacks are posted to a runner which never runs them
+        std::shared_ptr<AppExecFwk::EventHandler> jsHandler =
+            std::make_shared<AppExecFwk::EventHandler>(AppExecFwk::EventRunner::Create(false));
+        sptr<JsInputMethodEngineListener> imeListener = new JsInputMethodEngineListener(nullptr, jsHandler);
+        ability->setImeListener(imeListener);
+
+        sptr<InputMethodController> controller = InputMethodController::GetInstance();
+        sptr<OnTextChangedListener> listener = new CountingTextListener();
+        CountingTextListener *counter = static_cast<CountingTextListener *>(listener.GetRefPtr());
+        controller->Attach(listener);
+        EXPECT_TRUE(WaitUntil([counter] { return counter->showCount.load() > 0; }));
+
+        EXPECT_TRUE(ability->InsertText("abc"));
+        EXPECT_TRUE(WaitUntil([counter] { return counter->GetText() == u"abc"; }));
+
+        controller->OnSelectionChange(u"hello", 5, 5);
+        EXPECT_TRUE(WaitUntil([ability] { return ability->GetTextBeforeCursor(5) == u"hello"; }));
+
+        controller->HideTextInput();
+        EXPECT_TRUE(service_->HasReceived(IInputMethodSystemAbility::STOP_INPUT));
+        controller->Close();
+    }
+} // namespace MiscServices
+} // namespace OHOS
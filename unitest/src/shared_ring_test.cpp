@@ -0,0 +1,362 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "global.h"
+#include "shared_ring.h"
+
+using namespace testing::ext;
+namespace OHOS {
+namespace MiscServices {
+    class SharedRingTest : public testing::Test {
+    public:
+        static void SetUpTestCase(void);
+        static void TearDownTestCase(void);
+        void SetUp();
+        void TearDown();
+
+        static const uint32_t KEY_CODE = 1;
+        static const int32_t TIMEOUT_MS = 5000;
+        static void WriteKey(MessageParcel &data, int32_t index, size_t length);
+        static bool ReadKey(MessageParcel &data, int32_t index, size_t length);
+        static SharedRing *AttachPeer(const SharedRing &ring);
+        static int32_t WaitChild(pid_t pid);
+        static int64_t RunRingStream(int32_t count);
+        static int64_t RunSocketStream(int32_t count);
+        static int64_t RunRingPingPong(int32_t count);
+        static int64_t RunSocketPingPong(int32_t count);
+    };
+
+    void SharedRingTest::SetUpTestCase(void)
+    {
+        IMSA_HILOGI("SharedRingTest::SetUpTestCase");
+    }
+
+    void SharedRingTest::TearDownTestCase(void)
+    {
+        IMSA_HILOGI("SharedRingTest::TearDownTestCase");
+    }
+
+    void SharedRingTest::SetUp(void)
+    {
+        IMSA_HILOGI("SharedRingTest::SetUp");
+    }
+
+    void SharedRingTest::TearDown(void)
+    {
+        IMSA_HILOGI("SharedRingTest::TearDown");
+    }
+
+    /*! Write a request like IInputDataChannel::InsertText
+    */
+    void SharedRingTest::WriteKey(MessageParcel &data, int32_t index, size_t length)
+    {
+        data.WriteString16(u"ohos.miscservices.inputmethod.IInputDataChannel");
+        data.WriteInt32(index);
+        data.WriteString16(std::u16string(length, u'a' + index % 26));
+    }
+
+    bool SharedRingTest::ReadKey(MessageParcel &data, int32_t index, size_t length)
+    {
+        return data.ReadString16() == u"ohos.miscservices.inputmethod.IInputDataChannel" && data.ReadInt32() == index
+            && data.ReadString16() == std::u16string(length, u'a' + index % 26);
+    }
+
+    /*! Map the ring again, as the other process does with the fds it gets through binder
+    */
+    SharedRing *SharedRingTest::AttachPeer(const SharedRing &ring)
+    {
+        return SharedRing::Attach(dup(ring.GetMemFd()), dup(ring.GetReaderFd()), dup(ring.GetWriterFd()));
+    }
+
+    int32_t SharedRingTest::WaitChild(pid_t pid)
+    {
+        int status = -1;
+        waitpid(pid, &status, 0);
+        return (WIFEXITED(status) && !WEXITSTATUS(status)) ? 0 : -1;
+    }
+
+    /*! Stream count keystrokes from a child process to this process through a shared ring
+    \return the average time per keystroke in ns, or -1 if a keystroke is lost or broken
+    */
+    int64_t SharedRingTest::RunRingStream(int32_t count)
+    {
+        std::unique_ptr<SharedRing> ring(SharedRing::Create());
+        auto begin = std::chrono::steady_clock::now();
+        pid_t pid = fork();
+        if (!pid) {
+            std::unique_ptr<SharedRing> writer(AttachPeer(*ring));
+            for (int32_t i = 0; i < count; i++) {
+                MessageParcel data;
+                WriteKey(data, i, 1);
+                if (!writer || !writer->Write(KEY_CODE, data, TIMEOUT_MS)) {
+                    _exit(1);
+                }
+            }
+            _exit(0);
+        }
+        bool intact = true;
+        for (int32_t i = 0; i < count && intact; i++) {
+            uint32_t code = 0;
+            MessageParcel data;
+            intact = ring->Read(code, data, TIMEOUT_MS) && code == KEY_CODE && ReadKey(data, i, 1);
+        }
+        int64_t costNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - begin).count() / count;
+        return (WaitChild(pid) || !intact) ? -1 : costNs;
+    }
+
+    /*! Stream count keystrokes from a child process to this process, each one is a message on a socket, which
+        enters the kernel on both sides like a binder transaction
+    */
+    int64_t SharedRingTest::RunSocketStream(int32_t count)
+    {
+        int fds[2] = { -1, -1 };
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds)) {
+            return -1;
+        }
+        auto begin = std::chrono::steady_clock::now();
+        pid_t pid = fork();
+        if (!pid) {
+            close(fds[0]);
+            for (int32_t i = 0; i < count; i++) {
+                MessageParcel data;
+                WriteKey(data, i, 1);
+                if (write(fds[1], reinterpret_cast<const void *>(data.GetData()), data.GetDataSize()) < 0) {
+                    _exit(1);
+                }
+            }
+            _exit(0);
+        }
+        close(fds[1]);
+        bool intact = true;
+        char buffer[SharedRing::MAX_RECORD_SIZE];
+        for (int32_t i = 0; i < count && intact; i++) {
+            ssize_t size = read(fds[0], buffer, sizeof(buffer));
+            MessageParcel data;
+            intact = size > 0 && data.WriteBuffer(buffer, size) && ReadKey(data, i, 1);
+        }
+        int64_t costNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - begin).count() / count;
+        close(fds[0]);
+        return (WaitChild(pid) || !intact) ? -1 : costNs;
+    }
+
+    /*! Send count requests to a child process and wait for each reply, through a shared ring per direction
+    \return the average round trip time in ns, or -1 if a request or a reply is lost
+    */
+    int64_t SharedRingTest::RunRingPingPong(int32_t count)
+    {
+        std::unique_ptr<SharedRing> request(SharedRing::Create());
+        std::unique_ptr<SharedRing> response(SharedRing::Create());
+        pid_t pid = fork();
+        if (!pid) {
+            for (int32_t i = 0; i < count; i++) {
+                uint32_t code = 0;
+                MessageParcel data;
+                if (!request->Read(code, data, TIMEOUT_MS) || !response->Write(code, data, TIMEOUT_MS)) {
+                    _exit(1);
+                }
+            }
+            _exit(0);
+        }
+        bool intact = true;
+        auto begin = std::chrono::steady_clock::now();
+        for (int32_t i = 0; i < count && intact; i++) {
+            MessageParcel data;
+            WriteKey(data, i, 1);
+            uint32_t code = 0;
+            MessageParcel reply;
+            intact = request->Write(KEY_CODE, data, TIMEOUT_MS) && response->Read(code, reply, TIMEOUT_MS)
+                && ReadKey(reply, i, 1);
+        }
+        int64_t costNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - begin).count() / count;
+        return (WaitChild(pid) || !intact) ? -1 : costNs;
+    }
+
+    int64_t SharedRingTest::RunSocketPingPong(int32_t count)
+    {
+        int fds[2] = { -1, -1 };
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds)) {
+            return -1;
+        }
+        char buffer[SharedRing::MAX_RECORD_SIZE];
+        pid_t pid = fork();
+        if (!pid) {
+            close(fds[0]);
+            for (int32_t i = 0; i < count; i++) {
+                ssize_t size = read(fds[1], buffer, sizeof(buffer));
+                if (size <= 0 || write(fds[1], buffer, size) != size) {
+                    _exit(1);
+                }
+            }
+            _exit(0);
+        }
+        close(fds[1]);
+        bool intact = true;
+        auto begin = std::chrono::steady_clock::now();
+        for (int32_t i = 0; i < count && intact; i++) {
+            MessageParcel data;
+            WriteKey(data, i, 1);
+            MessageParcel reply;
+            intact = write(fds[0], reinterpret_cast<const void *>(data.GetData()), data.GetDataSize()) > 0;
+            ssize_t size = intact ? read(fds[0], buffer, sizeof(buffer)) : -1;
+            intact = size > 0 && reply.WriteBuffer(buffer, size) && ReadKey(reply, i, 1);
+        }
+        int64_t costNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - begin).count() / count;
+        close(fds[0]);
+        return (WaitChild(pid) || !intact) ? -1 : costNs;
+    }
+
+    /**
+    * @tc.name: testSharedRingAcrossProcesses
+    * @tc.desc: Checkout the requests written by another process are read in order and intact, including the
+    *           ones which wrap around the end of the ring and the ones written while the ring is full.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(SharedRingTest, testSharedRingAcrossProcesses, TestSize.Level0)
+    {
+        const int32_t count = 3000;
+        const size_t maxLength = 2000;
+        EXPECT_EQ(SharedRing::Attach(-1, -1, -1), nullptr);
+        std::unique_ptr<SharedRing> ring(SharedRing::Create(1));
+        ASSERT_NE(ring, nullptr);
+        MessageParcel large;
+        WriteKey(large, 0, SharedRing::MAX_RECORD_SIZE);
+        EXPECT_FALSE(ring->Write(KEY_CODE, large, 0));
+
+        pid_t pid = fork();
+        if (!pid) {
+            std::unique_ptr<SharedRing> writer(AttachPeer(*ring));
+            for (int32_t i = 0; i < count; i++) {
+                MessageParcel data;
+                WriteKey(data, i, (i * 7919) % maxLength);
+                if (!writer || !writer->Write(KEY_CODE + i, data, TIMEOUT_MS)) {
+                    _exit(1);
+                }
+            }
+            _exit(writer->WaitEmpty(TIMEOUT_MS) ? 0 : 1);
+        }
+        for (int32_t i = 0; i < count; i++) {
+            uint32_t code = 0;
+            MessageParcel data;
+            ASSERT_TRUE(ring->Read(code, data, TIMEOUT_MS));
+            EXPECT_EQ(code, KEY_CODE + i);
+            EXPECT_TRUE(ReadKey(data, i, (i * 7919) % maxLength));
+            ring->Acknowledge();
+        }
+        EXPECT_EQ(WaitChild(pid), 0);
+        uint32_t code = 0;
+        MessageParcel data;
+        EXPECT_FALSE(ring->Read(code, data, 0));
+    }
+
+    /**
+    * @tc.name: testSharedRingReceiver
+    * @tc.desc: Checkout the receiver hands all the requests to the handler before the writer sees the ring empty.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(SharedRingTest, testSharedRingReceiver, TestSize.Level0)
+    {
+        const int32_t count = 1000;
+        std::unique_ptr<SharedRing> ring(SharedRing::Create());
+        ASSERT_NE(ring, nullptr);
+        int32_t handled = 0;
+        bool intact = true;
+        auto receiver = std::make_unique<SharedRingReceiver>(
+            AttachPeer(*ring),
+            [&handled, &intact](uint32_t code, MessageParcel &data) {
+                intact = intact && code == KEY_CODE && ReadKey(data, handled, 1);
+                handled++;
+            });
+        for (int32_t i = 0; i < count; i++) {
+            MessageParcel data;
+            WriteKey(data, i, 1);
+            EXPECT_TRUE(ring->Write(KEY_CODE, data, TIMEOUT_MS));
+        }
+        EXPECT_TRUE(ring->WaitEmpty(TIMEOUT_MS));
+        receiver.reset();
+        EXPECT_EQ(handled, count);
+        EXPECT_TRUE(intact);
+    }
+
+    /**
+    * @tc.name: testSharedRingWriterDoorbell
+    * @tc.desc: Checkout a writer waiting on a full ring is woken up by the reader, and WaitEmpty fails when the
+    *           reader does not drain the ring in time.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(SharedRingTest, testSharedRingWriterDoorbell, TestSize.Level0)
+    {
+        const int32_t shortTimeoutMs = 10;
+        std::unique_ptr<SharedRing> ring(SharedRing::Create(1));
+        ASSERT_NE(ring, nullptr);
+        std::unique_ptr<SharedRing> reader(AttachPeer(*ring));
+        ASSERT_NE(reader, nullptr);
+        int32_t written = 0;
+        MessageParcel data;
+        WriteKey(data, 0, 1);
+        while (ring->Write(KEY_CODE, data, 0)) {
+            written++;
+        }
+        EXPECT_GT(written, 0);
+        EXPECT_FALSE(ring->WaitEmpty(shortTimeoutMs));
+
+        std::thread writer([&ring, &data] { EXPECT_TRUE(ring->Write(KEY_CODE, data, TIMEOUT_MS)); });
+        uint32_t code = 0;
+        MessageParcel received;
+        EXPECT_TRUE(reader->Read(code, received, TIMEOUT_MS));
+        writer.join();
+        for (int32_t i = 0; i < written; i++) {
+            MessageParcel next;
+            EXPECT_TRUE(reader->Read(code, next, TIMEOUT_MS));
+        }
+        reader->Acknowledge();
+        EXPECT_TRUE(ring->WaitEmpty(TIMEOUT_MS));
+    }
+
+    /**
+    * @tc.name: testSharedRingCost
+    * @tc.desc: Compare the throughput and the round trip time of keystroke sized requests between two processes,
+    *           through shared rings and through a socket, which enters the kernel for every request as binder does.
+    * @tc.type: PERF
+    */
+    HWTEST_F(SharedRingTest, testSharedRingCost, TestSize.Level1)
+    {
+        const int32_t streamCount = 200000;
+        const int32_t pingPongCount = 20000;
+        int64_t ringStream = RunRingStream(streamCount);
+        int64_t socketStream = RunSocketStream(streamCount);
+        EXPECT_GT(ringStream, 0);
+        EXPECT_GT(socketStream, 0);
+        printf("stream per request: shared ring %lld ns, socket %lld ns\n", (long long)ringStream,
+            (long long)socketStream);
+        int64_t ringPingPong = RunRingPingPong(pingPongCount);
+        int64_t socketPingPong = RunSocketPingPong(pingPongCount);
+        EXPECT_GT(ringPingPong, 0);
+        EXPECT_GT(socketPingPong, 0);
+        printf("round trip: shared ring %lld ns, socket %lld ns\n", (long long)ringPingPong,
+            (long long)socketPingPong);
+    }
+} // namespace MiscServices
+} // namespace OHOS
@@ -0,0 +1,247 @@
+/*
+ * Copyright (C) 2021 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "global.h"
+#include "message_handler.h"
+#include "trace_span.h"
+
+using namespace testing::ext;
+namespace OHOS {
+namespace MiscServices {
+    class TraceSpanTest : public testing::Test {
+    public:
+        static void SetUpTestCase(void);
+        static void TearDownTestCase(void);
+        void SetUp();
+        void TearDown();
+
+        static std::vector<TraceEvent> GetEvents(uint64_t traceId);
+    };
+
+    void TraceSpanTest::SetUpTestCase(void)
+    {
+        IMSA_HILOGI("TraceSpanTest::SetUpTestCase");
+    }
+
+    void TraceSpanTest::TearDownTestCase(void)
+    {
+        IMSA_HILOGI("TraceSpanTest::TearDownTestCase");
+    }
+
+    void TraceSpanTest::SetUp(void)
+    {
+        IMSA_HILOGI("TraceSpanTest::SetUp");
+        TraceRecorder::Instance()->SetEnabled(true);
+        TraceRecorder::Instance()->Clear();
+    }
+
+    void TraceSpanTest::TearDown(void)
+    {
+        IMSA_HILOGI("TraceSpanTest::TearDown");
+        TraceRecorder::SetCurrentTraceId(0);
+        TraceRecorder::Instance()->SetEnabled(false);
+    }
+
+    /*! Get the recorded events of a trace, sorted by begin time
+    */
+    std::vector<TraceEvent> TraceSpanTest::GetEvents(uint64_t traceId)
+    {
+        std::vector<TraceEvent> events;
+        TraceRecorder::Instance()->Snapshot(events);
+        std::vector<TraceEvent> result;
+        for (const auto &event : events) {
+            if (event.traceId == traceId) {
+                result.push_back(event);
+            }
+        }
+        return result;
+    }
+
+    /**
+    * @tc.name: testNestedSpan
+    * @tc.desc: Checkout a span sets the current trace id of the thread and restores the parent one,
+    *           and a span with trace id 0 records nothing.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(TraceSpanTest, testNestedSpan, TestSize.Level0)
+    {
+        uint64_t outerId = TraceRecorder::NewTraceId();
+        uint64_t innerId = TraceRecorder::NewTraceId();
+        EXPECT_NE(outerId, innerId);
+        {
+            TraceSpan outer(outerId, "outer");
+            EXPECT_EQ(TraceRecorder::GetCurrentTraceId(), outerId);
+            {
+                TraceSpan inner(innerId, "inner");
+                EXPECT_EQ(TraceRecorder::GetCurrentTraceId(), innerId);
+            }
+            EXPECT_EQ(TraceRecorder::GetCurrentTraceId(), outerId);
+            TraceSpan untraced(0, "untraced");
+            EXPECT_EQ(TraceRecorder::GetCurrentTraceId(), outerId);
+        }
+        EXPECT_EQ(TraceRecorder::GetCurrentTraceId(), 0u);
+
+        std::vector<TraceEvent> outer = GetEvents(outerId);
+        std::vector<TraceEvent> inner = GetEvents(innerId);
+        ASSERT_EQ(outer.size(), 1u);
+        ASSERT_EQ(inner.size(), 1u);
+        EXPECT_STREQ(outer[0].name, "outer");
+        EXPECT_LE(outer[0].beginNs, inner[0].beginNs);
+        EXPECT_GE(outer[0].endNs, inner[0].endNs);
+        EXPECT_TRUE(GetEvents(0).empty());
+    }
+
+    /**
+    * @tc.name: testRingWrap
+    * @tc.desc: Record more events than a ring holds from several threads, checkout each thread keeps
+    *           its latest RING_CAPACITY events.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(TraceSpanTest, testRingWrap, TestSize.Level0)
+    {
+        const int32_t threadCount = 4;
+        const int32_t eventCount = TraceRecorder::RING_CAPACITY * 2;
+        uint64_t traceId = TraceRecorder::NewTraceId();
+        std::atomic<int32_t> doneCount(0);
+        std::vector<std::thread> threads;
+        for (int32_t i = 0; i < threadCount; i++) {
+            threads.emplace_back([traceId, eventCount, threadCount, &doneCount]() {
+                for (int32_t j = 0; j < eventCount; j++) {
+                    int64_t now = TraceRecorder::NowNs();
+                    TraceRecorder::Instance()->Record(traceId, "step", now, now, j + 1);
+                }
+                // the ring of an exited thread is reused by the next one, keep them all until the snapshot
+                doneCount.fetch_add(1);
+                while (doneCount.load() < threadCount * 2) {
+                    std::this_thread::yield();
+                }
+            });
+        }
+        while (doneCount.load() < threadCount) {
+            std::this_thread::yield();
+        }
+        std::vector<TraceEvent> events = GetEvents(traceId);
+        doneCount.fetch_add(threadCount);
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        EXPECT_EQ(events.size(), static_cast<size_t>(threadCount * TraceRecorder::RING_CAPACITY));
+        for (const auto &event : events) {
+            EXPECT_GT(event.arg, eventCount - static_cast<int32_t>(TraceRecorder::RING_CAPACITY));
+        }
+    }
+
+    /**
+    * @tc.name: testQueueWait
+    * @tc.desc: Send a traced message through MessageHandler, checkout its wait in the queue is recorded,
+    *           and the trace of a coalesced message follows the content which is delivered.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(TraceSpanTest, testQueueWait, TestSize.Level0)
+    {
+        MessageHandler handler(MessageHandler::QUEUE_MODE_LOCK_FREE, MessageHandler::FLAG_COALESCING);
+        uint64_t traceId = TraceRecorder::NewTraceId();
+        Message *msg = new Message(MessageID::MSG_ID_SHOW_KEYBOARD, nullptr);
+        msg->traceId_ = traceId;
+        handler.SendMessage(msg);
+        MessagePtr delivered = handler.GetMessage();
+        EXPECT_EQ(delivered->traceId_, traceId);
+        std::vector<TraceEvent> events = GetEvents(traceId);
+        ASSERT_EQ(events.size(), 1u);
+        EXPECT_STREQ(events[0].name, "queue wait");
+        EXPECT_EQ(events[0].arg, MessageID::MSG_ID_SHOW_KEYBOARD);
+        EXPECT_LE(events[0].beginNs, events[0].endNs);
+
+        uint64_t firstId = TraceRecorder::NewTraceId();
+        uint64_t secondId = TraceRecorder::NewTraceId();
+        const uint64_t key = MessageHandler::MakeCoalesceKey(MessageID::MSG_ID_START_INPUT, &handler);
+        for (uint64_t id : { firstId, secondId }) {
+            msg = new Message(MessageID::MSG_ID_START_INPUT, nullptr);
+            msg->traceId_ = id;
+            msg->coalesceKey_ = key;
+            handler.SendMessage(msg);
+        }
+        delivered = handler.GetMessage();
+        EXPECT_EQ(delivered->traceId_, secondId);
+        EXPECT_TRUE(GetEvents(firstId).empty());
+        EXPECT_EQ(GetEvents(secondId).size(), 1u);
+    }
+
+    /**
+    * @tc.name: testChromeTraceExport
+    * @tc.desc: Checkout the recorded events are exported as complete events of the Chrome trace format,
+    *           and nothing is recorded while the recorder is disabled.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(TraceSpanTest, testChromeTraceExport, TestSize.Level0)
+    {
+        uint64_t traceId = TraceRecorder::NewTraceId();
+        {
+            TraceSpan span(traceId, "IMC::StartInput");
+        }
+        TraceRecorder::Instance()->SetEnabled(false);
+        {
+            TraceSpan span(traceId, "IMSA::startInput");
+        }
+        TraceRecorder::Instance()->SetEnabled(true);
+
+        std::string json = TraceRecorder::Instance()->ExportChromeTrace();
+        EXPECT_EQ(json.find("{\"traceEvents\":["), 0u);
+        EXPECT_NE(json.find("\"name\":\"IMC::StartInput\""), std::string::npos);
+        EXPECT_NE(json.find("\"ph\":\"X\""), std::string::npos);
+        EXPECT_EQ(json.find("IMSA::startInput"), std::string::npos);
+
+        TraceRecorder::Instance()->Clear();
+        EXPECT_TRUE(GetEvents(traceId).empty());
+    }
+
+    /**
+    * @tc.name: testExportToFile
+    * @tc.desc: Checkout the trace of the process is written into imf_trace_<pid>.json of the export directory,
+    *           as the controller and the ability do at the end of an input session.
+    * @tc.type: FUNC
+    */
+    HWTEST_F(TraceSpanTest, testExportToFile, TestSize.Level0)
+    {
+        uint64_t traceId = TraceRecorder::NewTraceId();
+        {
+            TraceSpan span(traceId, "IMA::ShowInputWindow");
+        }
+        ASSERT_TRUE(TraceRecorder::Instance()->ExportToFile(TraceRecorder::EXPORT_DIR));
+
+        std::string path = std::string(TraceRecorder::EXPORT_DIR) + "/imf_trace_" + std::to_string(getpid()) +
+            ".json";
+        std::ifstream file(path);
+        ASSERT_TRUE(file.good());
+        std::stringstream content;
+        content << file.rdbuf();
+        EXPECT_EQ(content.str(), TraceRecorder::Instance()->ExportChromeTrace());
+        EXPECT_NE(content.str().find("IMA::ShowInputWindow"), std::string::npos);
+        remove(path.c_str());
+
+        EXPECT_FALSE(TraceRecorder::Instance()->ExportToFile("/nonexistent/dir"));
+    }
+} // namespace MiscServices
+} // namespace OHOS